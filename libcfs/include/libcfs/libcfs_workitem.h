@@ -39,7 +39,9 @@
  * - a workitem can be concurrent with other workitems but is strictly
  *   serialized with respect to itself.
  * - no CPU affinity, a workitem does not necessarily run on the same CPU
- *   that schedules it. However, this might change in the future.
+ *   that schedules it. A workitem of a CPT-bound scheduler normally runs on
+ *   that CPT, but an idle scheduler of the same name on another CPT of the
+ *   same table can run it when all threads of its own scheduler are busy.
  * - if a workitem is scheduled again before it has a chance to run, it
  *   runs only once.
  * - if a workitem is scheduled while it runs, it runs again after it
@@ -79,6 +81,8 @@ struct cfs_workitem {
 	unsigned short		wi_running:1;
 	/** scheduled */
 	unsigned short		wi_scheduled:1;
+	/** time when queued on runq, for scheduling latency */
+	ktime_t			wi_queued;
 };
 
 static inline void
@@ -95,6 +99,8 @@ void cfs_wi_schedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi);
 int  cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi);
 void cfs_wi_exit(struct cfs_wi_sched *sched, struct cfs_workitem *wi);
 
+int  cfs_wi_stats_print(char *buf, int len);
+
 int  cfs_wi_startup(void);
 void cfs_wi_shutdown(void);
 
@@ -67,8 +67,8 @@ static __always_inline u32 cfs_hash_64(u64 val, unsigned int bits)
 #endif /* HAVE_BROKEN_HASH_64 */
 
 #ifndef HAVE_RHASHTABLE_WALK_ENTER
-static int rhashtable_walk_enter(struct rhashtable *ht,
-				 struct rhashtable_iter *iter)
+static inline int rhashtable_walk_enter(struct rhashtable *ht,
+					struct rhashtable_iter *iter)
 {
 #ifdef HAVE_3ARG_RHASHTABLE_WALK_INIT
 	return rhashtable_walk_init(ht, iter, GFP_KERNEL);
@@ -243,6 +243,10 @@ MODULE_PARM_DESC(libcfs_console_backoff, "Lustre kernel debug console backoff fa
 
 unsigned int libcfs_debug_binary = 1;
 
+unsigned int libcfs_debug_defer;
+module_param(libcfs_debug_defer, uint, 0644);
+MODULE_PARM_DESC(libcfs_debug_defer, "Lustre kernel debug log formats messages when dumped, not when logged");
+
 unsigned int libcfs_stack = 3 * THREAD_SIZE / 4;
 EXPORT_SYMBOL(libcfs_stack);
 
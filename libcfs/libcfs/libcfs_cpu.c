@@ -31,6 +31,7 @@
 #define DEBUG_SUBSYSTEM S_LNET
 
 #include <linux/cpu.h>
+#include <linux/netdevice.h>
 #include <linux/sched.h>
 #include <libcfs/libcfs_cpu.h>
 #include <libcfs/libcfs.h>
@@ -61,6 +62,9 @@ MODULE_PARM_DESC(cpu_npartitions, "# of CPU partitions");
  *
  * i.e: "N", shortcut expression to create CPT from NUMA & CPU topology
  *
+ * i.e: "D", same as "N" but NUMA nodes local to network devices are split
+ *       into more partitions, because most of the load lands there
+ *
  * NB: If user specified cpu_pattern, cpu_npartitions will be ignored
  */
 static char *cpu_pattern = "N";
@@ -929,6 +933,122 @@ failed:
 	return ERR_PTR(rc);
 }
 
+/**
+ * Shortcut to create CPT from NUMA & CPU topology and the NUMA locality of
+ * network devices. Each NUMA node with CPUs is a partition, like "N", but a
+ * node local to network devices is split into one more partition per
+ * device, as long as each partition keeps CPT_WEIGHT_MIN CPUs. LNet binds
+ * network interfaces to the CPT of their NUMA node, so more partitions there
+ * means more service threads and less contention where the requests arrive.
+ *
+ * Returns NULL if no network device has NUMA affinity or if the table
+ * can't be built, so the caller can fall back to "N".
+ */
+static struct cfs_cpt_table *cfs_cpt_table_create_devices(void)
+{
+	struct cfs_cpt_table *cptab = NULL;
+	struct net_device *dev;
+	cpumask_var_t node_mask;
+	int *nparts;
+	int ndevs = 0;
+	int ncpt = 0;
+	int cpt = 0;
+	int node;
+	int rc = 0;
+
+	LIBCFS_ALLOC(nparts, nr_node_ids * sizeof(*nparts));
+	if (!nparts)
+		return NULL;
+
+	if (!zalloc_cpumask_var(&node_mask, GFP_NOFS)) {
+		CERROR("Failed to allocate scratch cpumask\n");
+		goto out_parts;
+	}
+
+	rcu_read_lock();
+	for_each_netdev_rcu(&init_net, dev) {
+		if (dev->flags & IFF_LOOPBACK)
+			continue;
+
+		node = dev_to_node(&dev->dev);
+		if (node < 0 || node >= nr_node_ids)
+			continue;
+
+		nparts[node]++;
+		ndevs++;
+	}
+	rcu_read_unlock();
+
+	if (!ndevs)
+		goto out_mask;
+
+	for_each_online_node(node) {
+		int weight;
+
+		/* only the online CPUs are put in the partitions */
+		cpumask_and(node_mask, cpumask_of_node(node), cpu_online_mask);
+		weight = cpumask_weight(node_mask);
+		if (!weight) {
+			nparts[node] = 0;
+			continue;
+		}
+
+		nparts[node] = clamp(1 + nparts[node], 1,
+				     max(weight / CPT_WEIGHT_MIN, 1));
+		ncpt += nparts[node];
+	}
+
+	cptab = cfs_cpt_table_alloc(ncpt);
+	if (!cptab) {
+		CERROR("Failed to allocate CPU partition table\n");
+		goto out_mask;
+	}
+
+	for_each_online_node(node) {
+		int num;
+		int rem;
+		int i;
+
+		if (!nparts[node])
+			continue;
+
+		cpumask_and(node_mask, cpumask_of_node(node), cpu_online_mask);
+		num = cpumask_weight(node_mask) / nparts[node];
+		rem = cpumask_weight(node_mask) % nparts[node];
+
+		for (i = 0; i < nparts[node]; i++, cpt++) {
+			/* the last partition takes whatever is left */
+			rc = cfs_cpt_choose_ncpus(cptab, cpt, node_mask,
+						  i == nparts[node] - 1 ?
+						  nr_cpu_ids : num + (i < rem));
+			if (rc < 0)
+				goto out_table;
+
+			if (!cfs_cpt_online(cptab, cpt)) {
+				CERROR("No online CPU is found on partition %d\n",
+				       cpt);
+				rc = -ENODEV;
+				goto out_table;
+			}
+		}
+	}
+
+	CDEBUG(D_INFO, "%d network devices, %d partitions on %d NUMA nodes\n",
+	       ndevs, ncpt, num_online_nodes());
+	goto out_mask;
+
+out_table:
+	CWARN("Failed (rc = %d) to set up CPU partitions for network devices, using NUMA nodes\n",
+	      rc);
+	cfs_cpt_table_free(cptab);
+	cptab = NULL;
+out_mask:
+	free_cpumask_var(node_mask);
+out_parts:
+	LIBCFS_FREE(nparts, nr_node_ids * sizeof(*nparts));
+	return cptab;
+}
+
 static struct cfs_cpt_table *cfs_cpt_table_create_pattern(const char *pattern)
 {
 	struct cfs_cpt_table *cptab;
@@ -950,7 +1070,24 @@ static struct cfs_cpt_table *cfs_cpt_table_create_pattern(const char *pattern)
 	}
 
 	str = strim(pattern_dup);
-	if (*str == 'n' || *str == 'N') {
+	if ((*str == 'd' || *str == 'D') && str[1] == '\0') {
+		str++; /* skip 'D' char, same as "N" if no device affinity */
+		for_each_online_node(i) {
+			if (!cpumask_empty(cpumask_of_node(i)))
+				ncpt++;
+		}
+		if (ncpt == 1) { /* single NUMA node */
+			kfree(pattern_dup);
+			return cfs_cpt_table_create(cpu_npartitions);
+		}
+
+		cptab = cfs_cpt_table_create_devices();
+		if (cptab) {
+			kfree(pattern_dup);
+			return cptab;
+		}
+		node = -1;
+	} else if (*str == 'n' || *str == 'N') {
 		str++; /* skip 'N' char */
 		node = 1; /* NUMA pattern */
 		if (*str == '\0') {
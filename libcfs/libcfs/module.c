@@ -374,6 +374,52 @@ static int proc_cpt_distance(struct ctl_table *table, int write,
 				     __proc_cpt_distance);
 }
 
+static int __proc_wi_stats(void *data, int write,
+			   loff_t pos, void __user *buffer, int nob)
+{
+	char *buf = NULL;
+	int   len = 4096;
+	int   rc  = 0;
+
+	if (write)
+		return -EPERM;
+
+	while (1) {
+		LIBCFS_ALLOC(buf, len);
+		if (buf == NULL)
+			return -ENOMEM;
+
+		rc = cfs_wi_stats_print(buf, len);
+		if (rc >= 0)
+			break;
+
+		if (rc == -E2BIG) {
+			LIBCFS_FREE(buf, len);
+			len <<= 1;
+			continue;
+		}
+		goto out;
+	}
+
+	if (pos >= rc) {
+		rc = 0;
+		goto out;
+	}
+
+	rc = cfs_trace_copyout_string(buffer, nob, buf + pos, NULL);
+ out:
+	if (buf != NULL)
+		LIBCFS_FREE(buf, len);
+	return rc;
+}
+
+static int proc_wi_stats(struct ctl_table *table, int write,
+			 void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_wi_stats);
+}
+
 static struct ctl_table lnet_table[] = {
 	{
 		INIT_CTL_NAME
@@ -413,6 +459,13 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_cpt_distance,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "workitem_stats",
+		.maxlen		= 128,
+		.mode		= 0444,
+		.proc_handler	= &proc_wi_stats,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "debug_log_upcall",
@@ -508,6 +561,8 @@ static const struct lnet_debugfs_symlink_def lnet_debugfs_symlinks[] = {
 	  .target	= "../../../module/libcfs/parameters/libcfs_console_backoff" },
 	{ .name		= "debug_mb",
 	  .target	= "../../../module/libcfs/parameters/libcfs_debug_mb" },
+	{ .name		= "debug_defer",
+	  .target	= "../../../module/libcfs/parameters/libcfs_debug_defer" },
 	{ .name		= "console_min_delay_centisecs",
 	  .target	= "../../../module/libcfs/parameters/libcfs_console_min_delay" },
 	{ .name		= "console_max_delay_centisecs",
@@ -43,6 +43,7 @@
 #include <linux/ctype.h>
 #include <linux/fs.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/pagemap.h>
 #include <linux/uaccess.h>
 #include <libcfs/linux/linux-fs.h>
@@ -168,6 +169,7 @@ cfs_trace_get_tage_try(struct cfs_trace_cpu_data *tcd, unsigned long len)
 		}
 
 		tage->used = 0;
+		tage->deferred = 0;
 		tage->cpu = smp_processor_id();
 		tage->type = tcd->tcd_type;
 		list_add_tail(&tage->linkage, &tcd->tcd_pages);
@@ -239,11 +241,474 @@ static struct cfs_trace_page *cfs_trace_get_tage(struct cfs_trace_cpu_data *tcd,
         if (tcd->tcd_cur_pages > 0) {
                 tage = cfs_tage_from_list(tcd->tcd_pages.next);
                 tage->used = 0;
+		tage->deferred = 0;
                 cfs_tage_to_tail(tage, &tcd->tcd_pages);
         }
         return tage;
 }
 
+/*
+ * Deferred formatting of debug messages.
+ *
+ * With libcfs_debug_defer set, messages that are not printed on the console
+ * are stored as the format pointer followed by the raw arguments, and only
+ * formatted when the trace pages are dumped. Numeric arguments take 8 bytes,
+ * strings are copied as a 16-bit length followed by the NUL terminated
+ * string. Formats using anything that can't be captured this way, like '*'
+ * widths or %p extensions, are formatted immediately as before.
+ *
+ * The format strings belong to the modules logging them, so pending records
+ * are formatted when a module is unloaded, see cfs_trace_module_notify().
+ */
+#define CFS_DEFER_SPEC_MAX	16	/* flags, width and precision */
+#define CFS_DEFER_STR_MAX	512	/* longest string argument */
+
+enum cfs_defer_qual {
+	CFS_DQ_NONE,
+	CFS_DQ_HH,
+	CFS_DQ_H,
+	CFS_DQ_L,
+	CFS_DQ_LL,
+	CFS_DQ_Z,
+	CFS_DQ_T,
+};
+
+struct cfs_defer_spec {
+	const char		*cds_flags;	/* flags, width, precision */
+	int			 cds_flags_len;
+	int			 cds_prec;	/* -1 if not given */
+	enum cfs_defer_qual	 cds_qual;
+	char			 cds_conv;
+};
+
+static bool cfs_trace_deferred_used;
+
+/*
+ * Parse the conversion following a '%' at \a f.
+ * Return the character after it, or NULL if it can't be deferred.
+ */
+static const char *cfs_trace_defer_parse(const char *f,
+					 struct cfs_defer_spec *spec)
+{
+	spec->cds_flags = f;
+	spec->cds_prec = -1;
+	spec->cds_qual = CFS_DQ_NONE;
+
+	while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0')
+		f++;
+	while (isdigit(*f))
+		f++;
+	if (*f == '.') {
+		f++;
+		spec->cds_prec = 0;
+		while (isdigit(*f))
+			spec->cds_prec = spec->cds_prec * 10 + *f++ - '0';
+	}
+	spec->cds_flags_len = f - spec->cds_flags;
+	if (spec->cds_flags_len > CFS_DEFER_SPEC_MAX)
+		return NULL;
+
+	switch (*f) {
+	case 'h':
+		f++;
+		spec->cds_qual = CFS_DQ_H;
+		if (*f == 'h') {
+			f++;
+			spec->cds_qual = CFS_DQ_HH;
+		}
+		break;
+	case 'l':
+		f++;
+		spec->cds_qual = CFS_DQ_L;
+		if (*f == 'l') {
+			f++;
+			spec->cds_qual = CFS_DQ_LL;
+		}
+		break;
+	case 'L':
+	case 'q':
+	case 'j':
+		f++;
+		spec->cds_qual = CFS_DQ_LL;
+		break;
+	case 'z':
+		f++;
+		spec->cds_qual = CFS_DQ_Z;
+		break;
+	case 't':
+		f++;
+		spec->cds_qual = CFS_DQ_T;
+		break;
+	}
+
+	spec->cds_conv = *f;
+	switch (*f) {
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+		return f + 1;
+	case 'p':
+		/* %p extensions dereference the pointer when printing */
+		if (isalnum(f[1]))
+			return NULL;
+		/* fallthrough */
+	case 'c':
+	case 's':
+		return spec->cds_qual == CFS_DQ_NONE ? f + 1 : NULL;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Capture the arguments of \a fmt into \a buf, or only compute the space
+ * needed if \a buf is NULL. Return the size or a negative errno if the
+ * message can't be deferred.
+ */
+static int cfs_trace_defer_args(const char *fmt, va_list ap, char *buf)
+{
+	struct cfs_defer_spec spec;
+	const char *f = fmt;
+	const char *str;
+	__u16 len16;
+	char last = 0;
+	__u64 val;
+	int size = sizeof(fmt);
+	int len;
+
+	if (buf)
+		memcpy(buf, &fmt, sizeof(fmt));
+
+	while (*f) {
+		if (*f != '%') {
+			last = *f++;
+			continue;
+		}
+		if (f[1] == '%') {
+			last = '%';
+			f += 2;
+			continue;
+		}
+		f = cfs_trace_defer_parse(f + 1, &spec);
+		if (!f)
+			return -EINVAL;
+		last = 0;
+
+		switch (spec.cds_conv) {
+		case 'd':
+		case 'i':
+			switch (spec.cds_qual) {
+			case CFS_DQ_HH:
+				val = (signed char)va_arg(ap, int);
+				break;
+			case CFS_DQ_H:
+				val = (short)va_arg(ap, int);
+				break;
+			case CFS_DQ_L:
+				val = va_arg(ap, long);
+				break;
+			case CFS_DQ_LL:
+				val = va_arg(ap, long long);
+				break;
+			case CFS_DQ_Z:
+				val = va_arg(ap, ssize_t);
+				break;
+			case CFS_DQ_T:
+				val = va_arg(ap, ptrdiff_t);
+				break;
+			default:
+				val = va_arg(ap, int);
+				break;
+			}
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			switch (spec.cds_qual) {
+			case CFS_DQ_HH:
+				val = (unsigned char)va_arg(ap, unsigned int);
+				break;
+			case CFS_DQ_H:
+				val = (unsigned short)va_arg(ap, unsigned int);
+				break;
+			case CFS_DQ_L:
+				val = va_arg(ap, unsigned long);
+				break;
+			case CFS_DQ_LL:
+				val = va_arg(ap, unsigned long long);
+				break;
+			case CFS_DQ_Z:
+				val = va_arg(ap, size_t);
+				break;
+			case CFS_DQ_T:
+				val = (unsigned long)va_arg(ap, ptrdiff_t);
+				break;
+			default:
+				val = va_arg(ap, unsigned int);
+				break;
+			}
+			break;
+		case 'c':
+			val = va_arg(ap, int);
+			break;
+		case 'p':
+			val = (unsigned long)va_arg(ap, void *);
+			break;
+		case 's':
+			str = va_arg(ap, const char *);
+			if (!str)
+				str = "(null)";
+			if (spec.cds_prec >= 0 &&
+			    spec.cds_prec <= CFS_DEFER_STR_MAX)
+				len = strnlen(str, spec.cds_prec);
+			else
+				len = strnlen(str, CFS_DEFER_STR_MAX + 1);
+			if (len > CFS_DEFER_STR_MAX)
+				return -E2BIG;
+			if (buf) {
+				len16 = len;
+				memcpy(buf + size, &len16, sizeof(len16));
+				memcpy(buf + size + sizeof(len16), str, len);
+				buf[size + sizeof(len16) + len] = '\0';
+			}
+			size += sizeof(len16) + len + 1;
+			continue;
+		}
+
+		if (buf)
+			memcpy(buf + size, &val, sizeof(val));
+		size += sizeof(val);
+	}
+
+	/* let the immediate path complain about a missing newline */
+	if (last != '\n')
+		return -EINVAL;
+
+	return size;
+}
+
+/*
+ * Format a deferred record whose arguments are in [\a args, \a end) into
+ * \a buf of \a size bytes. Return the length of the text, not counting the
+ * terminating NUL.
+ */
+static int cfs_trace_defer_format(const char *args, const char *end,
+				  char *buf, int size)
+{
+	char spec_buf[CFS_DEFER_SPEC_MAX + 5];
+	struct cfs_defer_spec spec;
+	const char *fmt;
+	const char *f;
+	__u16 len16;
+	__u64 val;
+	int len = 0;
+	int n;
+
+	if (size <= 0)
+		return 0;
+	buf[0] = '\0';
+	if (args + sizeof(fmt) > end)
+		return 0;
+	memcpy(&fmt, args, sizeof(fmt));
+	args += sizeof(fmt);
+
+	for (f = fmt; *f && len < size - 1; ) {
+		if (*f != '%' || f[1] == '%') {
+			buf[len++] = *f;
+			f += *f == '%' ? 2 : 1;
+			continue;
+		}
+		f = cfs_trace_defer_parse(f + 1, &spec);
+		if (!f)
+			break;
+
+		n = 0;
+		spec_buf[n++] = '%';
+		memcpy(spec_buf + n, spec.cds_flags, spec.cds_flags_len);
+		n += spec.cds_flags_len;
+
+		if (spec.cds_conv == 's') {
+			if (args + sizeof(len16) > end)
+				break;
+			memcpy(&len16, args, sizeof(len16));
+			args += sizeof(len16);
+			if (args + len16 + 1 > end)
+				break;
+			spec_buf[n++] = 's';
+			spec_buf[n] = '\0';
+			len += scnprintf(buf + len, size - len, spec_buf, args);
+			args += len16 + 1;
+			continue;
+		}
+
+		if (args + sizeof(val) > end)
+			break;
+		memcpy(&val, args, sizeof(val));
+		args += sizeof(val);
+
+		switch (spec.cds_conv) {
+		case 'c':
+		case 'p':
+			spec_buf[n++] = spec.cds_conv;
+			spec_buf[n] = '\0';
+			if (spec.cds_conv == 'c')
+				len += scnprintf(buf + len, size - len,
+						 spec_buf, (int)val);
+			else
+				len += scnprintf(buf + len, size - len,
+						 spec_buf,
+						 (void *)(unsigned long)val);
+			break;
+		case 'd':
+		case 'i':
+			spec_buf[n++] = 'l';
+			spec_buf[n++] = 'l';
+			spec_buf[n++] = spec.cds_conv;
+			spec_buf[n] = '\0';
+			len += scnprintf(buf + len, size - len, spec_buf,
+					 (long long)val);
+			break;
+		default:
+			spec_buf[n++] = 'l';
+			spec_buf[n++] = 'l';
+			spec_buf[n++] = spec.cds_conv;
+			spec_buf[n] = '\0';
+			len += scnprintf(buf + len, size - len, spec_buf,
+					 (unsigned long long)val);
+			break;
+		}
+	}
+	buf[len] = '\0';
+
+	return len;
+}
+
+/* locate the file, function and payload of a trace record */
+static char *cfs_trace_record_parse(struct ptldebug_header *hdr,
+				    char **file, char **fn)
+{
+	char *p = (char *)(hdr + 1);
+
+	*file = p;
+	p += strlen(p) + 1;
+	*fn = p;
+	p += strlen(p) + 1;
+
+	return p;
+}
+
+/* return \a out or a new page before \a next with \a len bytes free */
+static struct cfs_trace_page *
+cfs_trace_format_tage(struct cfs_trace_page *out, struct cfs_trace_page *next,
+		      unsigned int len, gfp_t gfp)
+{
+	if (out && out->used + len <= PAGE_SIZE)
+		return out;
+
+	out = cfs_tage_alloc(gfp);
+	if (!out)
+		return NULL;
+
+	out->used = 0;
+	out->deferred = 0;
+	out->cpu = next->cpu;
+	out->type = next->type;
+	list_add_tail(&out->linkage, &next->linkage);
+
+	return out;
+}
+
+/*
+ * Replace the pages of \a pc holding deferred records with pages of
+ * formatted records, in the same order. Records that can't be formatted
+ * for lack of memory are dropped.
+ */
+static void cfs_trace_format_pages(struct page_collection *pc, gfp_t gfp)
+{
+	struct cfs_trace_page *tage;
+	struct cfs_trace_page *tmp;
+	char *text = NULL;
+	int dropped = 0;
+
+	list_for_each_entry_safe(tage, tmp, &pc->pc_pages, linkage) {
+		struct cfs_trace_page *out = NULL;
+		char *p = page_address(tage->page);
+		char *end = p + tage->used;
+
+		__LASSERT_TAGE_INVARIANT(tage);
+
+		if (tage->deferred == 0)
+			continue;
+
+		if (!text) {
+			text = kmalloc(PAGE_SIZE, gfp | __GFP_NOWARN);
+			if (!text) {
+				dropped += tage->deferred;
+				list_del(&tage->linkage);
+				cfs_tage_free(tage);
+				continue;
+			}
+		}
+
+		while (p < end) {
+			struct ptldebug_header *hdr = (void *)p;
+			struct ptldebug_header *dst;
+			char *file;
+			char *fn;
+			char *args;
+			int prefix;
+			int len;
+
+			p += hdr->ph_len;
+
+			if (!(hdr->ph_flags & PH_FLAG_DEFERRED)) {
+				out = cfs_trace_format_tage(out, tage,
+							    hdr->ph_len, gfp);
+				if (!out) {
+					dropped++;
+					continue;
+				}
+				memcpy(page_address(out->page) + out->used,
+				       hdr, hdr->ph_len);
+				out->used += hdr->ph_len;
+				continue;
+			}
+
+			args = cfs_trace_record_parse(hdr, &file, &fn);
+			prefix = args - (char *)hdr;
+			len = cfs_trace_defer_format(args, p, text,
+						     PAGE_SIZE - prefix);
+
+			out = cfs_trace_format_tage(out, tage, prefix + len,
+						    gfp);
+			if (!out) {
+				dropped++;
+				continue;
+			}
+
+			dst = page_address(out->page) + out->used;
+			memcpy(dst, hdr, prefix);
+			dst->ph_flags &= ~PH_FLAG_DEFERRED;
+			dst->ph_len = prefix + len;
+			memcpy((char *)dst + prefix, text, len);
+			out->used += prefix + len;
+		}
+
+		list_del(&tage->linkage);
+		cfs_tage_free(tage);
+	}
+
+	kfree(text);
+
+	if (dropped && printk_ratelimit())
+		printk(KERN_WARNING "Lustre: dropped %d debug messages "
+		       "while formatting, out of memory\n", dropped);
+}
+
 int libcfs_debug_msg(struct libcfs_debug_msg_data *msgdata,
                      const char *format, ...)
 {
@@ -292,6 +757,44 @@ int libcfs_debug_msg(struct libcfs_debug_msg_data *msgdata,
         if (libcfs_debug_binary)
                 known_size += sizeof(header);
 
+	/* nothing goes to the console, so the message can be formatted
+	 * later, when the trace pages are dumped */
+	if (libcfs_debug_defer && libcfs_debug_binary && msgdata->msg_fn &&
+	    (mask & libcfs_printk) == 0) {
+		va_start(ap, format);
+		needed = cfs_trace_defer_args(format, ap, NULL);
+		va_end(ap);
+
+		tage = needed > 0 ?
+		       cfs_trace_get_tage(tcd, known_size + needed) : NULL;
+		if (tage != NULL) {
+			header.ph_flags |= PH_FLAG_DEFERRED;
+			header.ph_len = known_size + needed;
+			debug_buf = (char *)page_address(tage->page) +
+				    tage->used;
+
+			memcpy(debug_buf, &header, sizeof(header));
+			debug_buf += sizeof(header);
+			strcpy(debug_buf, file);
+			debug_buf += strlen(file) + 1;
+			strcpy(debug_buf, msgdata->msg_fn);
+			debug_buf += strlen(msgdata->msg_fn) + 1;
+
+			va_start(ap, format);
+			cfs_trace_defer_args(format, ap, debug_buf);
+			va_end(ap);
+
+			tage->used += header.ph_len;
+			tage->deferred++;
+			cfs_trace_deferred_used = true;
+			__LASSERT(tage->used <= PAGE_SIZE);
+
+			cfs_trace_put_tcd(tcd);
+			return 1;
+		}
+		needed = 85;
+	}
+
         /*/
          * '2' used because vsnprintf return real size required for output
          * _without_ terminating NULL.
@@ -619,14 +1122,22 @@ void cfs_trace_debug_print(void)
                         struct ptldebug_header *hdr;
                         int len;
                         hdr = (void *)p;
-                        p += sizeof(*hdr);
-                        file = p;
-                        p += strlen(file) + 1;
-                        fn = p;
-                        p += strlen(fn) + 1;
+                        p = cfs_trace_record_parse(hdr, &file, &fn);
                         len = hdr->ph_len - (int)(p - (char *)hdr);
 
-                        cfs_print_to_console(hdr, D_EMERG, p, len, file, fn);
+			if (hdr->ph_flags & PH_FLAG_DEFERRED) {
+				char *buf = cfs_trace_get_console_buffer();
+				int nob;
+
+				nob = cfs_trace_defer_format(p, p + len, buf,
+						CFS_TRACE_CONSOLE_BUFFER_SIZE);
+				cfs_print_to_console(hdr, D_EMERG, buf, nob,
+						     file, fn);
+				put_cpu();
+			} else {
+				cfs_print_to_console(hdr, D_EMERG, p, len,
+						     file, fn);
+			}
 
                         p += len;
                 }
@@ -663,6 +1174,9 @@ int cfs_tracefile_dump_all_pages(char *filename)
                 goto close;
         }
 
+	cfs_trace_format_pages(&pc, libcfs_panic_in_progress ?
+				    GFP_ATOMIC : GFP_KERNEL);
+
 	/* ok, for now, just write the pages.  in the future we'll be building
 	 * iobufs with the pages and calling generic_direct_IO */
 	list_for_each_entry_safe(tage, tmp, &pc.pc_pages, linkage) {
@@ -953,6 +1467,8 @@ static int tracefiled(void *arg)
                         goto end_loop;
                 }
 
+		cfs_trace_format_pages(&pc, GFP_KERNEL);
+
 		list_for_each_entry_safe(tage, tmp, &pc.pc_pages, linkage) {
 			struct dentry *de = file_dentry(filp);
 			static loff_t f_pos;
@@ -1061,6 +1577,47 @@ void cfs_trace_stop_thread(void)
 	mutex_unlock(&cfs_trace_thread_mutex);
 }
 
+/*
+ * Deferred records point to format strings of the module that logged them,
+ * so format all pending records before a module goes away.
+ */
+static int cfs_trace_module_notify(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	struct page_collection pc;
+	struct cfs_trace_cpu_data *tcd;
+	int i, cpu;
+
+	if (action != MODULE_STATE_GOING || !cfs_trace_deferred_used)
+		return NOTIFY_DONE;
+
+	cfs_tracefile_write_lock();
+
+	pc.pc_want_daemon_pages = 0;
+	collect_pages(&pc);
+	cfs_trace_format_pages(&pc, GFP_KERNEL);
+	put_pages_back(&pc);
+
+	INIT_LIST_HEAD(&pc.pc_pages);
+	for_each_possible_cpu(cpu) {
+		cfs_tcd_for_each_type_lock(tcd, i, cpu) {
+			list_splice_init(&tcd->tcd_daemon_pages,
+					 &pc.pc_pages);
+			tcd->tcd_cur_daemon_pages = 0;
+		}
+	}
+	cfs_trace_format_pages(&pc, GFP_KERNEL);
+	put_pages_on_daemon_list(&pc);
+
+	cfs_tracefile_write_unlock();
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cfs_trace_module_nb = {
+	.notifier_call = cfs_trace_module_notify,
+};
+
 int cfs_tracefile_init(int max_pages)
 {
 	struct cfs_trace_cpu_data *tcd;
@@ -1086,7 +1643,12 @@ int cfs_tracefile_init(int max_pages)
 		LASSERT(tcd->tcd_max_pages > 0);
 		tcd->tcd_shutting_down = 0;
 	}
-	return 0;
+
+	rc = register_module_notifier(&cfs_trace_module_nb);
+	if (rc != 0)
+		cfs_tracefile_fini_arch();
+
+	return rc;
 }
 
 static void trace_cleanup_on_all_cpus(void)
@@ -1124,6 +1686,7 @@ static void cfs_trace_cleanup(void)
 
 void cfs_tracefile_exit(void)
 {
+	unregister_module_notifier(&cfs_trace_module_nb);
         cfs_trace_stop_thread();
         cfs_trace_cleanup();
 }
@@ -108,6 +108,14 @@ extern int  cfs_trace_max_debug_mb(void);
  * from system */
 #define CFS_TRACE_CONSOLE_BUFFER_SIZE   1024
 
+/*
+ * Record holds the format pointer and the raw arguments instead of the
+ * message text, see libcfs_debug_defer. Such records only live in memory,
+ * they are formatted by cfs_trace_format_pages() before being written out,
+ * so this flag is never seen in debug files.
+ */
+#define PH_FLAG_DEFERRED	0x80000000
+
 union cfs_trace_data_union {
 	struct cfs_trace_cpu_data {
 		/*
@@ -247,6 +255,10 @@ struct cfs_trace_page {
 	 * type(context) of this page
 	 */
 	unsigned short		type;
+	/*
+	 * number of PH_FLAG_DEFERRED records in this page
+	 */
+	unsigned int		deferred;
 };
 
 extern void cfs_set_ptldebug_header(struct ptldebug_header *header,
@@ -38,30 +38,71 @@
 #define DEBUG_SUBSYSTEM S_LNET
 
 #include <linux/kthread.h>
+#include <linux/hash.h>
 #include <libcfs/libcfs.h>
 
 #define CFS_WS_NAME_LEN         16
 
-struct cfs_wi_sched {
-	struct list_head		ws_list;	/* chain on global list */
-	/** serialised workitems */
-	spinlock_t			ws_lock;
-	/** where schedulers sleep */
-	wait_queue_head_t		ws_waitq;
+struct cfs_wi_sched;
+
+/*
+ * Each scheduler thread has its own run queue. A workitem always queues on
+ * the same run queue, its "home", so the lock of that queue serialises it.
+ * Idle threads run workitems from the queues of the other threads of the
+ * scheduler, then from the busy schedulers of the same name on the nearest
+ * CPTs.
+ */
+struct cfs_wi_runq {
+	/** serialised workitems homed on this queue */
+	spinlock_t			wr_lock;
 	/** concurrent workitems */
-	struct list_head		ws_runq;
+	struct list_head		wr_runq;
 	/** rescheduled running-workitems, a workitem can be rescheduled
 	 * while running in wi_action(), but we don't to execute it again
-	 * unless it returns from wi_action(), so we put it on ws_rerunq
+	 * unless it returns from wi_action(), so we put it on wr_rerunq
 	 * while rescheduling, and move it to runq after it returns
 	 * from wi_action() */
-	struct list_head		ws_rerunq;
+	struct list_head		wr_rerunq;
+	/** number of scheduled workitems */
+	int				wr_nscheduled;
+	/** owning scheduler */
+	struct cfs_wi_sched		*wr_sched;
+	/** statistics, protected by wr_lock */
+	__u64				wr_nrun;
+	/** workitems run by other threads than the owner of this queue */
+	__u64				wr_nstolen;
+	/** total and maximum time from schedule to run, in nsec */
+	__u64				wr_wait_ns;
+	__u64				wr_wait_max_ns;
+	/** maximum length of wr_runq */
+	int				wr_depth;
+	int				wr_depth_max;
+} ____cacheline_aligned_in_smp;
+
+struct cfs_wi_sched {
+	struct list_head		ws_list;	/* chain on global list */
+	/** where idle scheduler threads sleep */
+	wait_queue_head_t		ws_waitq;
+	/** run queues, one per thread */
+	struct cfs_wi_runq		*ws_runqs;
+	int				ws_nrunqs;
+	/** workitems on the run queues */
+	atomic_t			ws_nqueued;
+	/** threads looking for work */
+	atomic_t			ws_nidle;
+	/** wakeups by busy peers, to steal their workitems */
+	atomic_t			ws_nsteal;
+	/** workitems of this scheduler run by threads of peers */
+	atomic_t			ws_nforeign;
+	/** workitems of peers run by threads of this scheduler */
+	atomic64_t			ws_nremote;
+	/** schedulers with the same name on other CPTs, nearest first,
+	 * updated under cfs_wi_data::wi_group_mutex, read under RCU */
+	struct cfs_wi_peers		*ws_peers;
 	/** CPT-table for this scheduler */
 	struct cfs_cpt_table	*ws_cptab;
 	/** CPT id for affinity */
 	int			ws_cpt;
-	/** number of scheduled workitems */
-	int			ws_nscheduled;
 	/** started scheduler thread, protected by cfs_wi_data::wi_glock */
 	unsigned int		ws_nthreads:30;
 	/** shutting down, protected by cfs_wi_data::wi_glock */
@@ -72,9 +113,17 @@ struct cfs_wi_sched {
 	char			ws_name[CFS_WS_NAME_LEN];
 };
 
+struct cfs_wi_peers {
+	struct rcu_head		wp_rcu;
+	int			wp_npeers;
+	struct cfs_wi_sched	*wp_peers[0];
+};
+
 static struct cfs_workitem_data {
 	/** serialize */
 	spinlock_t		wi_glock;
+	/** serialize changes of peers */
+	struct mutex		wi_group_mutex;
 	/** list of all schedulers */
 	struct list_head	wi_scheds;
 	/** WI module is initialized */
@@ -83,23 +132,196 @@ static struct cfs_workitem_data {
 	int			wi_stopping;
 } cfs_wi_data;
 
+static inline struct cfs_wi_runq *
+cfs_wi_home(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
+{
+	if (sched->ws_nrunqs == 1)
+		return &sched->ws_runqs[0];
+
+	return &sched->ws_runqs[hash_ptr(wi, 32) % sched->ws_nrunqs];
+}
+
 static inline int
 cfs_wi_sched_cansleep(struct cfs_wi_sched *sched)
 {
-	spin_lock(&sched->ws_lock);
-	if (sched->ws_stopping) {
-		spin_unlock(&sched->ws_lock);
+	if (sched->ws_stopping)
 		return 0;
-	}
 
-	if (!list_empty(&sched->ws_runq)) {
-		spin_unlock(&sched->ws_lock);
+	if (atomic_read(&sched->ws_nqueued) > 0)
 		return 0;
-	}
-	spin_unlock(&sched->ws_lock);
+
+	/* a busy peer asked for help */
+	if (atomic_add_unless(&sched->ws_nsteal, -1, 0))
+		return 0;
+
 	return 1;
 }
 
+/* a workitem is queued on \a sched, make sure a thread will run it */
+static void
+cfs_wi_sched_kick(struct cfs_wi_sched *sched)
+{
+	struct cfs_wi_peers *peers;
+	int i;
+
+	wake_up(&sched->ws_waitq);
+	if (atomic_read(&sched->ws_nidle) > 0)
+		return;
+
+	/* all threads are busy, wake an idle thread of the nearest peer */
+	rcu_read_lock();
+	peers = rcu_dereference(sched->ws_peers);
+	for (i = 0; peers != NULL && i < peers->wp_npeers; i++) {
+		struct cfs_wi_sched *peer = peers->wp_peers[i];
+
+		if (peer->ws_stopping || atomic_read(&peer->ws_nidle) == 0)
+			continue;
+
+		atomic_inc(&peer->ws_nsteal);
+		wake_up(&peer->ws_waitq);
+		break;
+	}
+	rcu_read_unlock();
+}
+
+/* queue \a wi on \a rq, called with rq::wr_lock held */
+static inline void
+cfs_wi_enqueue(struct cfs_wi_runq *rq, struct cfs_workitem *wi)
+{
+	list_add_tail(&wi->wi_list, &rq->wr_runq);
+	wi->wi_queued = ktime_get();
+	atomic_inc(&rq->wr_sched->ws_nqueued);
+	if (++rq->wr_depth > rq->wr_depth_max)
+		rq->wr_depth_max = rq->wr_depth;
+}
+
+/* take the first workitem of \a rq, \a stolen if not run by its owner */
+static struct cfs_workitem *
+cfs_wi_dequeue(struct cfs_wi_runq *rq, bool stolen)
+{
+	struct cfs_workitem *wi;
+	__u64 wait;
+
+	if (list_empty(&rq->wr_runq)) /* racy peek */
+		return NULL;
+
+	spin_lock(&rq->wr_lock);
+	if (list_empty(&rq->wr_runq)) {
+		spin_unlock(&rq->wr_lock);
+		return NULL;
+	}
+
+	wi = list_entry(rq->wr_runq.next, struct cfs_workitem, wi_list);
+	LASSERT(wi->wi_scheduled && !wi->wi_running);
+
+	list_del_init(&wi->wi_list);
+	atomic_dec(&rq->wr_sched->ws_nqueued);
+	rq->wr_depth--;
+
+	LASSERT(rq->wr_nscheduled > 0);
+	rq->wr_nscheduled--;
+
+	wi->wi_running	 = 1;
+	wi->wi_scheduled = 0;
+
+	wait = ktime_to_ns(ktime_sub(ktime_get(), wi->wi_queued));
+	rq->wr_nrun++;
+	rq->wr_wait_ns += wait;
+	if (wait > rq->wr_wait_max_ns)
+		rq->wr_wait_max_ns = wait;
+	if (stolen)
+		rq->wr_nstolen++;
+	spin_unlock(&rq->wr_lock);
+
+	return wi;
+}
+
+/*
+ * Find a workitem for the thread owning \a self: from its own queue, then
+ * from the other queues of its scheduler, then from peers with no idle
+ * thread, nearest first. *\a rqp is the home queue of the workitem.
+ */
+static struct cfs_workitem *
+cfs_wi_pick(struct cfs_wi_runq *self, struct cfs_wi_runq **rqp)
+{
+	struct cfs_wi_sched *sched = self->wr_sched;
+	struct cfs_wi_peers *peers;
+	struct cfs_workitem *wi;
+	int idx = self - sched->ws_runqs;
+	int i;
+	int j;
+
+	*rqp = self;
+	wi = cfs_wi_dequeue(self, false);
+	if (wi != NULL)
+		return wi;
+
+	for (i = 1; i < sched->ws_nrunqs &&
+		    atomic_read(&sched->ws_nqueued) > 0; i++) {
+		*rqp = &sched->ws_runqs[(idx + i) % sched->ws_nrunqs];
+		wi = cfs_wi_dequeue(*rqp, true);
+		if (wi != NULL)
+			return wi;
+	}
+
+	rcu_read_lock();
+	peers = rcu_dereference(sched->ws_peers);
+	for (i = 0; peers != NULL && i < peers->wp_npeers; i++) {
+		struct cfs_wi_sched *peer = peers->wp_peers[i];
+
+		if (peer->ws_stopping ||
+		    atomic_read(&peer->ws_nqueued) == 0 ||
+		    atomic_read(&peer->ws_nidle) > 0)
+			continue;
+
+		for (j = 0; j < peer->ws_nrunqs; j++) {
+			*rqp = &peer->ws_runqs[(idx + j) % peer->ws_nrunqs];
+			wi = cfs_wi_dequeue(*rqp, true);
+			if (wi != NULL) {
+				/* pin peer until the workitem is done */
+				atomic_inc(&peer->ws_nforeign);
+				atomic64_inc(&sched->ws_nremote);
+				rcu_read_unlock();
+				return wi;
+			}
+		}
+	}
+	rcu_read_unlock();
+
+	return NULL;
+}
+
+/* run \a wi taken from \a rq by a thread of \a sched */
+static void
+cfs_wi_run(struct cfs_wi_sched *sched, struct cfs_wi_runq *rq,
+	   struct cfs_workitem *wi)
+{
+	struct cfs_wi_sched *home = rq->wr_sched;
+	bool requeued = false;
+	int rc;
+
+	rc = (*wi->wi_action) (wi);
+	if (rc == 0) {
+		spin_lock(&rq->wr_lock);
+		wi->wi_running = 0;
+		if (!list_empty(&wi->wi_list)) {
+			LASSERT(wi->wi_scheduled);
+			/* wi is rescheduled, should be on rerunq now, we
+			 * move it to runq so it can run action now */
+			list_del_init(&wi->wi_list);
+			cfs_wi_enqueue(rq, wi);
+			requeued = true;
+		}
+		spin_unlock(&rq->wr_lock);
+	}
+	/* else WI should be dead, even be freed! */
+
+	if (requeued && home != sched)
+		cfs_wi_sched_kick(home);
+	if (home != sched)
+		atomic_dec(&home->ws_nforeign);
+}
+
 /* XXX:
  * 0. it only works when called from wi->wi_action.
  * 1. when it returns no one shall try to schedule the workitem.
@@ -107,10 +329,12 @@ cfs_wi_sched_cansleep(struct cfs_wi_sched *sched)
 void
 cfs_wi_exit(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_runq *rq = cfs_wi_home(sched, wi);
+
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
 	LASSERT(!sched->ws_stopping);
 
-	spin_lock(&sched->ws_lock);
+	spin_lock(&rq->wr_lock);
 
 	LASSERT(wi->wi_running);
 
@@ -118,14 +342,14 @@ cfs_wi_exit(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 		LASSERT(!list_empty(&wi->wi_list));
 		list_del_init(&wi->wi_list);
 
-		LASSERT(sched->ws_nscheduled > 0);
-		sched->ws_nscheduled--;
+		LASSERT(rq->wr_nscheduled > 0);
+		rq->wr_nscheduled--;
 	}
 
 	LASSERT(list_empty(&wi->wi_list));
 
 	wi->wi_scheduled = 1; /* LBUG future schedule attempts */
-	spin_unlock(&sched->ws_lock);
+	spin_unlock(&rq->wr_lock);
 
 	return;
 }
@@ -137,6 +361,7 @@ EXPORT_SYMBOL(cfs_wi_exit);
 int
 cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_runq *rq = cfs_wi_home(sched, wi);
 	int	rc;
 
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
@@ -147,7 +372,7 @@ cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
          * means the workitem will not be scheduled and will not have
          * any race with wi_action.
          */
-	spin_lock(&sched->ws_lock);
+	spin_lock(&rq->wr_lock);
 
 	rc = !(wi->wi_running);
 
@@ -155,15 +380,21 @@ cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 		LASSERT(!list_empty(&wi->wi_list));
 		list_del_init(&wi->wi_list);
 
-		LASSERT(sched->ws_nscheduled > 0);
-		sched->ws_nscheduled--;
+		LASSERT(rq->wr_nscheduled > 0);
+		rq->wr_nscheduled--;
+
+		/* not running, so it was on runq rather than rerunq */
+		if (!wi->wi_running) {
+			atomic_dec(&sched->ws_nqueued);
+			rq->wr_depth--;
+		}
 
 		wi->wi_scheduled = 0;
 	}
 
 	LASSERT (list_empty(&wi->wi_list));
 
-	spin_unlock(&sched->ws_lock);
+	spin_unlock(&rq->wr_lock);
 	return rc;
 }
 EXPORT_SYMBOL(cfs_wi_deschedule);
@@ -178,34 +409,40 @@ EXPORT_SYMBOL(cfs_wi_deschedule);
 void
 cfs_wi_schedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_runq *rq = cfs_wi_home(sched, wi);
+	bool queued = false;
+
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
 	LASSERT(!sched->ws_stopping);
 
-	spin_lock(&sched->ws_lock);
+	spin_lock(&rq->wr_lock);
 
 	if (!wi->wi_scheduled) {
 		LASSERT (list_empty(&wi->wi_list));
 
 		wi->wi_scheduled = 1;
-		sched->ws_nscheduled++;
+		rq->wr_nscheduled++;
 		if (!wi->wi_running) {
-			list_add_tail(&wi->wi_list, &sched->ws_runq);
-			wake_up(&sched->ws_waitq);
+			cfs_wi_enqueue(rq, wi);
+			queued = true;
 		} else {
-			list_add(&wi->wi_list, &sched->ws_rerunq);
+			list_add(&wi->wi_list, &rq->wr_rerunq);
 		}
 	}
 
 	LASSERT (!list_empty(&wi->wi_list));
-	spin_unlock(&sched->ws_lock);
-	return;
+	spin_unlock(&rq->wr_lock);
+
+	if (queued)
+		cfs_wi_sched_kick(sched);
 }
 EXPORT_SYMBOL(cfs_wi_schedule);
 
 static int
 cfs_wi_scheduler(void *arg)
 {
-	struct cfs_wi_sched *sched = (struct cfs_wi_sched *)arg;
+	struct cfs_wi_runq *self = (struct cfs_wi_runq *)arg;
+	struct cfs_wi_sched *sched = self->wr_sched;
 
 	cfs_block_allsigs();
 
@@ -223,62 +460,29 @@ cfs_wi_scheduler(void *arg)
 
 	spin_unlock(&cfs_wi_data.wi_glock);
 
-	spin_lock(&sched->ws_lock);
-
 	while (!sched->ws_stopping) {
 		int		nloops = 0;
-		int		rc;
+		struct cfs_wi_runq *rq;
 		struct cfs_workitem *wi;
 
-		while (!list_empty(&sched->ws_runq) &&
-		       nloops < CFS_WI_RESCHED) {
-			wi = list_entry(sched->ws_runq.next,
-					struct cfs_workitem, wi_list);
-			LASSERT(wi->wi_scheduled && !wi->wi_running);
-
-			list_del_init(&wi->wi_list);
-
-			LASSERT(sched->ws_nscheduled > 0);
-			sched->ws_nscheduled--;
-
-                        wi->wi_running   = 1;
-                        wi->wi_scheduled = 0;
-
-			spin_unlock(&sched->ws_lock);
-                        nloops++;
-
-                        rc = (*wi->wi_action) (wi);
-
-			spin_lock(&sched->ws_lock);
-                        if (rc != 0) /* WI should be dead, even be freed! */
-                                continue;
-
-			wi->wi_running = 0;
-			if (list_empty(&wi->wi_list))
-                                continue;
-
-			LASSERT(wi->wi_scheduled);
-			/* wi is rescheduled, should be on rerunq now, we
-			 * move it to runq so it can run action now */
-			list_move_tail(&wi->wi_list, &sched->ws_runq);
-                }
+		while (nloops < CFS_WI_RESCHED &&
+		       (wi = cfs_wi_pick(self, &rq)) != NULL) {
+			nloops++;
+			cfs_wi_run(sched, rq, wi);
+		}
 
-		if (!list_empty(&sched->ws_runq)) {
-			spin_unlock(&sched->ws_lock);
+		if (nloops == CFS_WI_RESCHED) {
 			/* don't sleep because some workitems still
 			 * expect me to come back soon */
 			cond_resched();
-			spin_lock(&sched->ws_lock);
 			continue;
 		}
 
-		spin_unlock(&sched->ws_lock);
-		rc = wait_event_interruptible_exclusive(sched->ws_waitq,
+		atomic_inc(&sched->ws_nidle);
+		wait_event_interruptible_exclusive(sched->ws_waitq,
 				!cfs_wi_sched_cansleep(sched));
-		spin_lock(&sched->ws_lock);
-        }
-
-	spin_unlock(&sched->ws_lock);
+		atomic_dec(&sched->ws_nidle);
+	}
 
 	spin_lock(&cfs_wi_data.wi_glock);
 	sched->ws_nthreads--;
@@ -287,9 +491,99 @@ cfs_wi_scheduler(void *arg)
 	return 0;
 }
 
+static void
+cfs_wi_peers_free(struct rcu_head *head)
+{
+	struct cfs_wi_peers *peers = container_of(head, struct cfs_wi_peers,
+						  wp_rcu);
+
+	LIBCFS_FREE(peers, offsetof(struct cfs_wi_peers,
+				    wp_peers[peers->wp_npeers]));
+}
+
+static inline bool
+cfs_wi_sched_grouped(struct cfs_wi_sched *sched, struct cfs_wi_sched *peer)
+{
+	return sched != peer && sched->ws_cptab != NULL &&
+	       sched->ws_cpt >= 0 && !peer->ws_stopping &&
+	       peer->ws_cptab == sched->ws_cptab && peer->ws_cpt >= 0 &&
+	       strcmp(peer->ws_name, sched->ws_name) == 0;
+}
+
+/*
+ * Rebuild the peers of the schedulers named as \a sched, which is added or
+ * removed. Schedulers of the same name bound to different CPTs of the same
+ * table serve the same kind of workitems, so they may run each other's.
+ * Called with cfs_wi_data::wi_group_mutex held.
+ */
+static void
+cfs_wi_sched_regroup(struct cfs_wi_sched *sched)
+{
+	struct cfs_wi_sched *member;
+	struct cfs_wi_sched *peer;
+	struct cfs_wi_peers *peers;
+	struct cfs_wi_peers *old;
+	int npeers;
+	int i;
+
+	if (sched->ws_cptab == NULL || sched->ws_cpt < 0)
+		return;
+
+	list_for_each_entry(member, &cfs_wi_data.wi_scheds, ws_list) {
+		if (member != sched && !cfs_wi_sched_grouped(sched, member))
+			continue;
+
+		npeers = 0;
+		list_for_each_entry(peer, &cfs_wi_data.wi_scheds, ws_list)
+			if (cfs_wi_sched_grouped(member, peer))
+				npeers++;
+
+		peers = NULL;
+		if (npeers > 0 && !member->ws_stopping)
+			LIBCFS_ALLOC(peers, offsetof(struct cfs_wi_peers,
+						     wp_peers[npeers]));
+		if (peers != NULL) {
+			peers->wp_npeers = 0;
+			list_for_each_entry(peer, &cfs_wi_data.wi_scheds,
+					    ws_list) {
+				unsigned int dist;
+
+				if (!cfs_wi_sched_grouped(member, peer))
+					continue;
+
+				/* insertion sort by NUMA distance */
+				dist = cfs_cpt_distance(member->ws_cptab,
+							member->ws_cpt,
+							peer->ws_cpt);
+				for (i = peers->wp_npeers; i > 0; i--) {
+					struct cfs_wi_sched *prev;
+
+					prev = peers->wp_peers[i - 1];
+					if (cfs_cpt_distance(member->ws_cptab,
+							     member->ws_cpt,
+							     prev->ws_cpt) <=
+					    dist)
+						break;
+					peers->wp_peers[i] = prev;
+				}
+				peers->wp_peers[i] = peer;
+				peers->wp_npeers++;
+			}
+		}
+
+		old = rcu_dereference_protected(member->ws_peers,
+				lockdep_is_held(&cfs_wi_data.wi_group_mutex));
+		rcu_assign_pointer(member->ws_peers, peers);
+		if (old != NULL)
+			call_rcu(&old->wp_rcu, cfs_wi_peers_free);
+	}
+}
+
 void
 cfs_wi_sched_destroy(struct cfs_wi_sched *sched)
 {
+	int n;
+
 	LASSERT(cfs_wi_data.wi_init);
 	LASSERT(!cfs_wi_data.wi_stopping);
 
@@ -306,13 +600,20 @@ cfs_wi_sched_destroy(struct cfs_wi_sched *sched)
 
 	spin_unlock(&cfs_wi_data.wi_glock);
 
+	/* no peer steals from or kicks this scheduler once this returns */
+	mutex_lock(&cfs_wi_data.wi_group_mutex);
+	cfs_wi_sched_regroup(sched);
+	mutex_unlock(&cfs_wi_data.wi_group_mutex);
+	synchronize_rcu();
+
 	wake_up_all(&sched->ws_waitq);
 
 	spin_lock(&cfs_wi_data.wi_glock);
 	{
 		int i = 2;
 
-		while (sched->ws_nthreads > 0) {
+		while (sched->ws_nthreads > 0 ||
+		       atomic_read(&sched->ws_nforeign) > 0) {
 			CDEBUG(is_power_of_2(++i / 20) ? D_WARNING : D_NET,
 			       "waiting %us for %d %s worker threads to exit\n",
 			       i / 20, sched->ws_nthreads, sched->ws_name);
@@ -324,12 +625,21 @@ cfs_wi_sched_destroy(struct cfs_wi_sched *sched)
 		}
 	}
 
-	list_del(&sched->ws_list);
+	spin_unlock(&cfs_wi_data.wi_glock);
 
+	mutex_lock(&cfs_wi_data.wi_group_mutex);
+	spin_lock(&cfs_wi_data.wi_glock);
+	list_del(&sched->ws_list);
 	spin_unlock(&cfs_wi_data.wi_glock);
+	mutex_unlock(&cfs_wi_data.wi_group_mutex);
 
-	LASSERT(sched->ws_nscheduled == 0);
+	for (n = 0; n < sched->ws_nrunqs; n++)
+		LASSERT(sched->ws_runqs[n].wr_nscheduled == 0);
 
+	if (sched->ws_peers != NULL)
+		call_rcu(&sched->ws_peers->wp_rcu, cfs_wi_peers_free);
+	LIBCFS_FREE(sched->ws_runqs,
+		    sched->ws_nrunqs * sizeof(sched->ws_runqs[0]));
 	LIBCFS_FREE(sched, sizeof(*sched));
 }
 EXPORT_SYMBOL(cfs_wi_sched_destroy);
@@ -339,6 +649,7 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 		    int cpt, int nthrs, struct cfs_wi_sched **sched_pp)
 {
 	struct cfs_wi_sched	*sched;
+	int			i;
 
 	LASSERT(cfs_wi_data.wi_init);
 	LASSERT(!cfs_wi_data.wi_stopping);
@@ -355,17 +666,36 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 	}
 	strlcpy(sched->ws_name, name, sizeof(sched->ws_name));
 
+	sched->ws_nrunqs = max(nthrs, 1);
+	LIBCFS_ALLOC(sched->ws_runqs,
+		     sched->ws_nrunqs * sizeof(sched->ws_runqs[0]));
+	if (sched->ws_runqs == NULL) {
+		LIBCFS_FREE(sched, sizeof(*sched));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < sched->ws_nrunqs; i++) {
+		struct cfs_wi_runq *rq = &sched->ws_runqs[i];
+
+		spin_lock_init(&rq->wr_lock);
+		INIT_LIST_HEAD(&rq->wr_runq);
+		INIT_LIST_HEAD(&rq->wr_rerunq);
+		rq->wr_sched = sched;
+	}
+
 	sched->ws_cptab = cptab;
 	sched->ws_cpt = cpt;
 
-	spin_lock_init(&sched->ws_lock);
 	init_waitqueue_head(&sched->ws_waitq);
+	atomic_set(&sched->ws_nqueued, 0);
+	atomic_set(&sched->ws_nidle, 0);
+	atomic_set(&sched->ws_nsteal, 0);
+	atomic_set(&sched->ws_nforeign, 0);
+	atomic64_set(&sched->ws_nremote, 0);
 
-	INIT_LIST_HEAD(&sched->ws_runq);
-	INIT_LIST_HEAD(&sched->ws_rerunq);
 	INIT_LIST_HEAD(&sched->ws_list);
 
-	for (; nthrs > 0; nthrs--)  {
+	for (i = 0; i < nthrs; i++)  {
 		char			name[16];
 		struct task_struct	*task;
 
@@ -388,13 +718,15 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 				 sched->ws_name, sched->ws_nthreads);
 		}
 
-		task = kthread_run(cfs_wi_scheduler, sched, name);
+		task = kthread_run(cfs_wi_scheduler, &sched->ws_runqs[i],
+				   name);
 		if (IS_ERR(task)) {
 			int rc = PTR_ERR(task);
 
 			CERROR("Failed to create thread for "
 				"WI scheduler %s: %d\n", name, rc);
 
+			mutex_lock(&cfs_wi_data.wi_group_mutex);
 			spin_lock(&cfs_wi_data.wi_glock);
 
 			/* make up for cfs_wi_sched_destroy */
@@ -402,27 +734,93 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 			sched->ws_starting--;
 
 			spin_unlock(&cfs_wi_data.wi_glock);
+			mutex_unlock(&cfs_wi_data.wi_group_mutex);
 
 			cfs_wi_sched_destroy(sched);
 			return rc;
 		}
 	}
 
+	mutex_lock(&cfs_wi_data.wi_group_mutex);
 	spin_lock(&cfs_wi_data.wi_glock);
 	list_add(&sched->ws_list, &cfs_wi_data.wi_scheds);
 	spin_unlock(&cfs_wi_data.wi_glock);
+	cfs_wi_sched_regroup(sched);
+	mutex_unlock(&cfs_wi_data.wi_group_mutex);
 
 	*sched_pp = sched;
 	return 0;
 }
 EXPORT_SYMBOL(cfs_wi_sched_create);
 
+/**
+ * Print the statistics of all schedulers into \a buf of \a len bytes.
+ * Times are in usec.
+ */
+int
+cfs_wi_stats_print(char *buf, int len)
+{
+	struct cfs_wi_sched *sched;
+	char *tmp = buf;
+	int rc;
+	int i;
+
+	rc = snprintf(tmp, len, "%-16s %4s %7s %6s %9s %12s %12s %12s %9s %9s\n",
+		      "name", "cpt", "threads", "queued", "max_depth", "run",
+		      "stolen", "remote", "avg_wait", "max_wait");
+	if (rc >= len)
+		return -E2BIG;
+	tmp += rc;
+	len -= rc;
+
+	spin_lock(&cfs_wi_data.wi_glock);
+	list_for_each_entry(sched, &cfs_wi_data.wi_scheds, ws_list) {
+		__u64 nrun = 0;
+		__u64 nstolen = 0;
+		__u64 wait_ns = 0;
+		__u64 wait_max_ns = 0;
+		int depth_max = 0;
+
+		for (i = 0; i < sched->ws_nrunqs; i++) {
+			struct cfs_wi_runq *rq = &sched->ws_runqs[i];
+
+			spin_lock(&rq->wr_lock);
+			nrun += rq->wr_nrun;
+			nstolen += rq->wr_nstolen;
+			wait_ns += rq->wr_wait_ns;
+			wait_max_ns = max(wait_max_ns, rq->wr_wait_max_ns);
+			depth_max = max(depth_max, rq->wr_depth_max);
+			spin_unlock(&rq->wr_lock);
+		}
+
+		rc = snprintf(tmp, len,
+			      "%-16s %4d %7u %6d %9d %12llu %12llu %12lld %9llu %9llu\n",
+			      sched->ws_name, sched->ws_cpt, sched->ws_nthreads,
+			      atomic_read(&sched->ws_nqueued), depth_max,
+			      nrun, nstolen,
+			      (long long)atomic64_read(&sched->ws_nremote),
+			      nrun ? div64_u64(wait_ns, nrun) / NSEC_PER_USEC : 0,
+			      div64_u64(wait_max_ns, NSEC_PER_USEC));
+		if (rc >= len) {
+			spin_unlock(&cfs_wi_data.wi_glock);
+			return -E2BIG;
+		}
+		tmp += rc;
+		len -= rc;
+	}
+	spin_unlock(&cfs_wi_data.wi_glock);
+
+	return tmp - buf;
+}
+EXPORT_SYMBOL(cfs_wi_stats_print);
+
 int
 cfs_wi_startup(void)
 {
 	memset(&cfs_wi_data, 0, sizeof(struct cfs_workitem_data));
 
 	spin_lock_init(&cfs_wi_data.wi_glock);
+	mutex_init(&cfs_wi_data.wi_group_mutex);
 	INIT_LIST_HEAD(&cfs_wi_data.wi_scheds);
 	cfs_wi_data.wi_init = 1;
 
@@ -456,10 +854,15 @@ cfs_wi_shutdown (void)
 		spin_unlock(&cfs_wi_data.wi_glock);
 	}
 
+	/* all threads are gone, no reader of the peers is left */
 	while (!list_empty(&cfs_wi_data.wi_scheds)) {
 		sched = list_entry(cfs_wi_data.wi_scheds.next,
 				       struct cfs_wi_sched, ws_list);
 		list_del(&sched->ws_list);
+		if (sched->ws_peers != NULL)
+			cfs_wi_peers_free(&sched->ws_peers->wp_rcu);
+		LIBCFS_FREE(sched->ws_runqs,
+			    sched->ws_nrunqs * sizeof(sched->ws_runqs[0]));
 		LIBCFS_FREE(sched, sizeof(*sched));
 	}
 
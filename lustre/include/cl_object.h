@@ -298,6 +298,8 @@ struct cl_layout {
 	bool		cl_is_composite;
 	/** Whether layout is a HSM released one */
 	bool		cl_is_released;
+	/** FLR state of a composite layout (LCM_FL_*) */
+	u16		cl_flr_state;
 };
 
 /**
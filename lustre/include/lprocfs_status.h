@@ -141,12 +141,21 @@ struct rename_stats {
  * squares (for multi-valued counter samples only). This allows
  * external computation of standard deviation, but involves a 64-bit
  * multiply per counter increment.
+ *
+ * LPROCFS_CNTR_HISTOGRAM indicates that the counter should also keep a
+ * log2 histogram of the sampled values. Buckets are kept per CPU and
+ * are only allocated on the CPUs that actually update the counter, so
+ * the cost is a single increment per sample. The histogram is shown by
+ * the file registered with ldebugfs_register_stats_hist(). It is only
+ * appended to the counter lines of the "stats" file when the "stats_hist"
+ * tunable is set, so the default format of that file is unchanged.
  */
 
 enum {
         LPROCFS_CNTR_EXTERNALLOCK = 0x0001,
         LPROCFS_CNTR_AVGMINMAX    = 0x0002,
         LPROCFS_CNTR_STDDEV       = 0x0004,
+	LPROCFS_CNTR_HISTOGRAM    = 0x0008,
 
         /* counter data type */
         LPROCFS_TYPE_REGS         = 0x0100,
@@ -157,10 +166,19 @@ enum {
 
 #define LC_MIN_INIT ((~(__u64)0) >> 1)
 
+/* bucket 0 counts zero samples, bucket i counts [2^(i-1), 2^i) */
+#define LPROCFS_HIST_BUCKETS	32
+
+struct lprocfs_counter_hist {
+	__u64	lh_buckets[LPROCFS_HIST_BUCKETS];
+};
+
 struct lprocfs_counter_header {
 	unsigned int		lc_config;
 	const char		*lc_name;   /* must be static */
 	const char		*lc_units;  /* must be static */
+	/* per-CPU histograms, LPROCFS_CNTR_HISTOGRAM counters only */
+	struct lprocfs_counter_hist **lc_hist;
 };
 
 struct lprocfs_counter {
@@ -405,6 +423,10 @@ struct obd_job_stats {
 	cntr_init_callback	ojs_cntr_init_fn;/* lprocfs_stats initializer */
 	unsigned short		ojs_cntr_num;	/* number of stats in struct */
 	bool			ojs_cleaning;	/* currently expiring stats */
+	atomic64_t		ojs_generation;	/* bumped by binary snapshots */
+	struct list_head	ojs_tombstones;	/* removed jobs, with ojs_lock */
+	unsigned int		ojs_tombstone_count;
+	__u64			ojs_pruned_gen;	/* last dropped tombstone gen */
 };
 
 #ifdef CONFIG_PROC_FS
@@ -472,6 +494,21 @@ extern __s64 lprocfs_read_helper(struct lprocfs_counter *lc,
 				 enum lprocfs_fields_flags field);
 u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
 			    enum lprocfs_fields_flags field);
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+				struct lprocfs_counter_hist *hist);
+
+static inline unsigned int lprocfs_hist_bucket(long amount)
+{
+	if (amount <= 0)
+		return 0;
+
+	return min_t(unsigned int, fls64(amount), LPROCFS_HIST_BUCKETS - 1);
+}
+
+static inline __u64 lprocfs_hist_bucket_start(unsigned int bucket)
+{
+	return bucket == 0 ? 0 : 1ULL << (bucket - 1);
+}
 
 extern struct lprocfs_stats *
 lprocfs_alloc_stats(unsigned int num, enum lprocfs_stats_flags flags);
@@ -517,6 +554,9 @@ extern int lprocfs_nid_stats_clear_seq_show(struct seq_file *file, void *data);
 #endif
 extern int ldebugfs_register_stats(struct dentry *parent, const char *name,
 				   struct lprocfs_stats *stats);
+extern int ldebugfs_register_stats_hist(struct dentry *parent,
+				       const char *name,
+				       struct lprocfs_stats *stats);
 extern int lprocfs_register_stats(struct proc_dir_entry *root, const char *name,
                                   struct lprocfs_stats *stats);
 
@@ -1058,6 +1098,10 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt)
 { return; }
 static inline
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+				struct lprocfs_counter_hist *hist)
+{ return; }
+static inline
 u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
 			    enum lprocfs_fields_flags field)
 { return (__u64)0; }
@@ -35,6 +35,7 @@
 
 #include <stdarg.h>
 #include <libcfs/libcfs.h>
+#include <libcfs/linux/linux-hash.h>
 #include <uapi/linux/lustre/lustre_idl.h>
 #include <lu_ref.h>
 #include <linux/percpu_counter.h>
@@ -504,7 +505,9 @@ struct lu_object_header {
 	 */
 	unsigned long		loh_flags;
 	/**
-	 * Object reference count. Protected by lu_site::ls_guard.
+	 * Object reference count. Lookups take references without locking,
+	 * a negative value means the object is being released or freed, see
+	 * lu_object_put().
 	 */
 	atomic_t		loh_ref;
 	/**
@@ -513,11 +516,13 @@ struct lu_object_header {
 	 */
 	__u32			loh_attr;
 	/**
-	 * Linkage into per-site hash table. Protected by lu_site::ls_guard.
+	 * Linkage into per-site hash table.
 	 */
-	struct hlist_node	loh_hash;
+	struct rhash_head	loh_hash;
 	/**
-	 * Linkage into per-site LRU list. Protected by lu_site::ls_guard.
+	 * Linkage into per-site LRU list. Protected by the LRU bucket lock.
+	 * Objects referenced again stay on the list until the next purge or
+	 * last lu_object_put().
 	 */
 	struct list_head	loh_lru;
 	/**
@@ -529,9 +534,16 @@ struct lu_object_header {
 	 * A list of references to this object, for debugging.
 	 */
 	struct lu_ref		loh_reference;
+	/**
+	 * Lookups walk the hash table under RCU, so memory holding the
+	 * header is released after a grace period, see
+	 * lu_object_header_free().
+	 */
+	struct rcu_head		loh_rcu;
 };
 
 struct fld;
+struct lu_site_bkt_data;
 
 enum {
 	LU_SS_CREATED		= 0,
@@ -554,13 +566,18 @@ enum {
  * lu_object.
  */
 struct lu_site {
-        /**
-         * objects hash table
-         */
-	struct cfs_hash		*ls_obj_hash;
-        /**
-         * index of bucket on hash table while purging
-         */
+	/**
+	 * objects hash table, looked up under RCU
+	 */
+	struct rhashtable	ls_obj_hash;
+	/**
+	 * LRU buckets, 1 << ls_bkt_bits of them
+	 */
+	struct lu_site_bkt_data	*ls_bkts;
+	unsigned int		ls_bkt_bits;
+	/**
+	 * index of LRU bucket while purging
+	 */
 	unsigned int		ls_purge_start;
 	/**
 	 * Top-level device for this stack.
@@ -611,6 +628,14 @@ static inline struct seq_server_site *lu_site2seq(const struct lu_site *s)
 	return s->ld_seq_site;
 }
 
+/**
+ * Return true if no objects are cached in site \a s.
+ */
+static inline bool lu_site_is_empty(const struct lu_site *s)
+{
+	return atomic_read(&s->ls_obj_hash.nelems) == 0;
+}
+
 /** \name ctors
  * Constructors/destructors.
  * @{
@@ -626,6 +651,7 @@ int  lu_device_init       (struct lu_device *d, struct lu_device_type *t);
 void lu_device_fini       (struct lu_device *d);
 int  lu_object_header_init(struct lu_object_header *h);
 void lu_object_header_fini(struct lu_object_header *h);
+void lu_object_header_free(struct lu_object_header *h);
 int  lu_object_init       (struct lu_object *o,
                            struct lu_object_header *h, struct lu_device *d);
 void lu_object_fini       (struct lu_object *o);
@@ -678,6 +704,8 @@ static inline int lu_object_is_inited(const struct lu_object_header *h)
 }
 
 void lu_object_put(const struct lu_env *env, struct lu_object *o);
+struct lu_object *lu_object_get_first(struct lu_site *s,
+				      struct lu_object_header *h);
 void lu_object_put_nocache(const struct lu_env *env, struct lu_object *o);
 void lu_object_unhash(const struct lu_env *env, struct lu_object *o);
 int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s, int nr,
@@ -1420,12 +1448,15 @@ struct lu_qos_rr {
 struct lu_svr_qos {
 	struct obd_uuid		 lsq_uuid;	/* ptlrpc's c_remote_uuid */
 	struct list_head	 lsq_svr_list;	/* link to lq_svr_list */
+	struct list_head	 lsq_tgt_list;	/* tgts on this svr */
 	__u64			 lsq_bavail;	/* total bytes avail on svr */
 	__u64			 lsq_iavail;	/* tital inode avail on svr */
 	__u64			 lsq_penalty;	/* current penalty */
 	__u64			 lsq_penalty_per_obj; /* penalty decrease
 						       * every obj*/
 	time64_t		 lsq_used;	/* last used time, seconds */
+	__u64			 lsq_alloc_seq;	/* lq_alloc_seq penalty is
+						 * decreased up to */
 	__u32			 lsq_tgt_count;	/* number of tgts on this svr */
 	__u32			 lsq_id;	/* unique svr id */
 };
@@ -1433,11 +1464,14 @@ struct lu_svr_qos {
 /* QoS data per MDT/OST */
 struct lu_tgt_qos {
 	struct lu_svr_qos	*ltq_svr;	/* svr info */
+	struct list_head	 ltq_svr_link;	/* link to lsq_tgt_list */
 	__u64			 ltq_penalty;	/* current penalty */
 	__u64			 ltq_penalty_per_obj; /* penalty decrease
 						       * every obj*/
 	__u64			 ltq_weight;	/* net weighting */
 	time64_t		 ltq_used;	/* last used time, seconds */
+	__u64			 ltq_alloc_seq;	/* lq_alloc_seq penalty is
+						 * decreased up to */
 	bool			 ltq_usable:1;	/* usable for striping */
 };
 
@@ -1504,6 +1538,8 @@ struct lu_qos {
 	unsigned int		 lq_prio_free;   /* priority for free space */
 	unsigned int		 lq_threshold_rr;/* priority for rr */
 	struct lu_qos_rr	 lq_rr;          /* round robin qos data */
+	__u64			 lq_alloc_seq;	 /* objects allocated, see
+						  * lqos_recalc_weight() */
 	unsigned long		 lq_dirty:1,     /* recalc qos data */
 				 lq_same_space:1,/* the servers all have approx.
 						  * the same space avail */
@@ -1516,7 +1552,9 @@ int lqos_del_tgt(struct lu_qos *qos, struct lu_tgt_desc *ltd);
 bool lqos_is_usable(struct lu_qos *qos, __u32 active_tgt_nr);
 int lqos_calc_penalties(struct lu_qos *qos, struct lu_tgt_descs *ltd,
 			__u32 active_tgt_nr, __u32 maxage, bool is_mdt);
-void lqos_calc_weight(struct lu_tgt_desc *tgt);
+void lqos_calc_weight(struct lu_qos *qos, struct lu_tgt_desc *tgt);
+void lqos_add_penalty(struct lu_qos *qos, struct lu_tgt_desc *tgt,
+		      __u32 active_tgt_nr);
 int lqos_recalc_weight(struct lu_qos *qos, struct lu_tgt_descs *ltd,
 		       struct lu_tgt_desc *tgt, __u32 active_tgt_nr,
 		       __u64 *total_wt);
@@ -195,6 +195,10 @@ struct lu_target {
 	struct dt_object	*lut_reply_data;
 	/** Bitmap of used slots in the reply data file */
 	unsigned long		**lut_reply_bitmap;
+	/** Per-CPT cache of reply data slots */
+	struct tgt_reply_slot_cache **lut_reply_slot_cache;
+	/** Lowest reply data slot which may be free in the bitmap */
+	atomic_t		 lut_reply_next;
 	/** target sync count, used for debug & test */
 	atomic_t		 lut_sync_count;
 
@@ -219,6 +223,19 @@ struct lu_target {
 /* number of slots in reply bitmap */
 #define LUT_REPLY_SLOTS_PER_CHUNK (1<<20)
 #define LUT_REPLY_SLOTS_MAX_CHUNKS 16
+/* number of released slots each CPT keeps for reuse */
+#define LUT_REPLY_SLOTS_CACHE 32
+
+/*
+ * Per-CPT cache of released reply data slots. They are kept here with
+ * their bit still set, so that the next request on the same CPT gets one
+ * without searching the bitmap.
+ */
+struct tgt_reply_slot_cache {
+	spinlock_t	rsc_lock;
+	int		rsc_count;
+	int		rsc_slots[LUT_REPLY_SLOTS_CACHE];
+};
 
 /**
  * Target reply data
@@ -1045,11 +1045,15 @@ struct ldlm_resource {
 	};
 
 	union {
-		/**
-		 * When the resource was considered as contended,
-		 * used only on server side.
-		 */
-		time64_t	lr_contention_time;
+		/** Contention tracking, used only on server side. */
+		struct {
+			/** When the resource was considered as contended */
+			time64_t	lr_contention_time;
+			/** Second in which lr_conflict_count was counted */
+			time64_t	lr_conflict_period;
+			/** Conflicting locks met by enqueues in that second */
+			int		lr_conflict_count;
+		};
 		/**
 		 * Associated inode, used only on client side.
 		 */
@@ -1688,6 +1692,16 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 			  enum ldlm_mode mode, __u64 *flags, void *lvb,
 			  __u32 lvb_len,
 			  const struct lustre_handle *lockh, int rc);
+int ldlm_cli_enqueue_prep(struct obd_export *exp,
+			  struct ldlm_enqueue_info *einfo,
+			  const struct ldlm_res_id *res_id,
+			  union ldlm_policy_data const *policy, __u64 flags,
+			  struct lustre_handle *lockh);
+int ldlm_cli_enqueue_reply_fini(struct obd_export *exp,
+				struct ldlm_reply *reply, enum ldlm_type type,
+				__u8 with_policy, enum ldlm_mode mode,
+				__u64 *flags, const struct lustre_handle *lockh,
+				int rc);
 int ldlm_cli_enqueue_local(const struct lu_env *env,
 			   struct ldlm_namespace *ns,
 			   const struct ldlm_res_id *res_id,
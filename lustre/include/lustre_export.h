@@ -427,6 +427,20 @@ static inline bool imp_connect_shortio(struct obd_import *imp)
 	return ocd->ocd_connect_flags & OBD_CONNECT_SHORTIO;
 }
 
+static inline bool imp_connect_multiobj_brw(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return ocd->ocd_connect_flags2 & OBD_CONNECT2_MULTIOBJ_BRW;
+}
+
+static inline bool imp_connect_batch_destroy(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return ocd->ocd_connect_flags2 & OBD_CONNECT2_BATCH_DESTROY;
+}
+
 static inline __u64 exp_connect_ibits(struct obd_export *exp)
 {
 	struct obd_connect_data *ocd;
@@ -465,6 +479,21 @@ static inline int exp_connect_lock_convert(struct obd_export *exp)
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_LOCK_CONVERT);
 }
 
+static inline int exp_connect_multiobj_brw(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_MULTIOBJ_BRW);
+}
+
+static inline int exp_connect_batch_destroy(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_DESTROY);
+}
+
+static inline int exp_connect_batch_getattr(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_GETATTR);
+}
+
 extern struct obd_export *class_conn2export(struct lustre_handle *conn);
 
 static inline int exp_connect_archive_id_array(struct obd_export *exp)
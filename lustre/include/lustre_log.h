@@ -258,6 +258,14 @@ struct llog_operations {
 	int (*lop_add)(const struct lu_env *env, struct llog_handle *lgh,
 		       struct llog_rec_hdr *rec, struct llog_cookie *cookie,
 		       struct thandle *th);
+	/**
+	 * Start asynchronous reads of the beginning of the plain llog
+	 * \a logid of catalog \a cathandle, which is going to be processed
+	 * next. Optional, only a hint.
+	 */
+	void (*lop_prefetch)(const struct lu_env *env,
+			     struct llog_handle *cathandle,
+			     struct llog_logid *logid);
 };
 
 /* In-memory descriptor for a log object or log catalog */
@@ -275,6 +283,7 @@ struct llog_handle {
 	int			 lgh_last_idx;
 	struct rw_semaphore	 lgh_last_sem;
 	__u64			 lgh_cur_offset; /* used for test only */
+	__u64			 lgh_ra_offset; /* end of read-ahead window */
 	struct llog_ctxt	*lgh_ctxt;
 	union {
 		struct plain_handle_data	 phd;
@@ -108,6 +108,12 @@
 #define DT_DEF_BRW_SIZE		(4 * ONE_MB_BRW_SIZE)
 #define DT_MAX_BRW_PAGES	(DT_MAX_BRW_SIZE >> PAGE_SHIFT)
 #define OFD_MAX_BRW_SIZE	(1U << LNET_MTU_BITS)
+/* maximum number of objects in one OBD_CONNECT2_MULTIOBJ_BRW write */
+#define PTLRPC_MAX_BRW_OBJS	32
+/* maximum number of objects in one OBD_CONNECT2_BATCH_DESTROY destroy */
+#define PTLRPC_MAX_DESTROY_OBJS	512
+/* maximum number of names in one OBD_CONNECT2_BATCH_GETATTR intent getattr */
+#define MDS_MAX_BATCH_GETATTR	64
 
 /* When PAGE_SIZE is a constant, we can check our arithmetic here with cpp! */
 #if ((PTLRPC_MAX_BRW_PAGES & (PTLRPC_MAX_BRW_PAGES - 1)) != 0)
@@ -468,7 +474,8 @@
 /**
  * OST_IO_MAXREQSIZE ~=
  * 	lustre_msg + ptlrpc_body + obdo + obd_ioobj +
- * 	DT_MAX_BRW_PAGES * niobuf_remote
+ * 	DT_MAX_BRW_PAGES * niobuf_remote +
+ * 	(PTLRPC_MAX_BRW_OBJS - 1) * (obdo + obd_ioobj)
  *
  * - single object with 16 pages is 512 bytes
  * - OST_IO_MAXREQSIZE must be at least 1 page of cookies plus some spillover
@@ -481,7 +488,10 @@
 				    sizeof(struct niobuf_remote)))
 #define _OST_MAXREQSIZE_SUM ((unsigned long)(_OST_MAXREQSIZE_BASE +	  \
 				   sizeof(struct niobuf_remote) *	  \
-				   (DT_MAX_BRW_PAGES - 1)))
+				   (DT_MAX_BRW_PAGES - 1) +		  \
+				   (sizeof(struct obdo) +		  \
+				    sizeof(struct obd_ioobj)) *		  \
+				   (PTLRPC_MAX_BRW_OBJS - 1)))
 /**
  * FIEMAP request can be 4K+ for now
  */
@@ -1652,6 +1662,12 @@ struct ptlrpc_service_ops {
  */
 #define PTLRPC_SVC_HP_RATIO 10
 
+/**
+ * Seconds between rebalancing the thread limits of service partitions
+ * according to their request queue depth, 0 disables it
+ */
+#define PTLRPC_SVC_REBALANCE	5
+
 /**
  * Definition of PortalRPC service.
  * The service is listening on a particular portal (like tcp port)
@@ -1674,6 +1690,10 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/** seconds between rebalancing threads of partitions, 0 disables */
+	int				srv_nthrs_rebalance;
+	/** time of the next rebalancing, protected by srv_lock */
+	time64_t			srv_rebalance_next;
 	/** Root of debugfs dir tree for this service */
 	struct dentry		       *srv_debugfs_entry;
         /** Pointer to statistic data for this service */
@@ -1755,6 +1775,14 @@ struct ptlrpc_service_part {
 	int				scp_nthrs_starting;
 	/** # running threads */
 	int				scp_nthrs_running;
+	/**
+	 * limit of threads number of this partition, it starts from
+	 * srv_nthrs_cpt_limit and is moved between partitions by
+	 * ptlrpc_svc_rebalance(), protected by srv_lock
+	 */
+	int				scp_nthrs_limit;
+	/** average # of queued requests in 1/16, protected by srv_lock */
+	unsigned int			scp_qdepth_avg;
 	/** service threads list */
 	struct list_head		scp_threads;
 
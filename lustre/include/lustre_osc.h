@@ -122,8 +122,16 @@ struct osc_device {
 	/* configuration item(s) */
 	time64_t		od_contention_time;
 	int			od_lockless_truncate;
+	/* largest lock extent done lockless on contended objects */
+	unsigned int		od_max_nolock_bytes;
 };
 
+/* Default values for the "contention_seconds" and "max_nolock_bytes"
+ * tunables. Objects only become contended once the server is allowed to
+ * refuse locks by its ldlm.namespaces.*.max_nolock_bytes tunable. */
+#define OSC_DEFAULT_CONTENTION_SECONDS	NS_DEFAULT_CONTENTION_SECONDS
+#define OSC_DEFAULT_MAX_NOLOCK_BYTES	(32 * 1024)
+
 struct osc_extent;
 
 /**
@@ -550,6 +558,9 @@ struct osc_page {
 
 struct osc_brw_async_args {
 	struct obdo		*aa_oa;
+	/* obdos of the other objects of a multi-object write */
+	struct obdo		*aa_oas;
+	u32			 aa_obj_count;
 	int			 aa_requested_nob;
 	int			 aa_nio_count;
 	u32			 aa_page_count;
@@ -612,6 +623,8 @@ int osc_cache_wait_range(const struct lu_env *env, struct osc_object *obj,
 int osc_io_unplug0(const struct lu_env *env, struct client_obd *cli,
 		   struct osc_object *osc, int async);
 void osc_wake_cache_waiters(struct client_obd *cli);
+void osc_cache_credits_sync(struct client_obd *cli, bool drain);
+unsigned long osc_cache_credits_pages(struct client_obd *cli);
 
 static inline int osc_io_unplug_async(const struct lu_env *env,
 				      struct client_obd *cli,
@@ -272,6 +272,10 @@ extern struct req_msg_field RMF_LDLM_INTENT;
 extern struct req_msg_field RMF_LAYOUT_INTENT;
 extern struct req_msg_field RMF_MDT_MD;
 extern struct req_msg_field RMF_DEFAULT_MDT_MD;
+extern struct req_msg_field RMF_BATCH_GETATTR;
+extern struct req_msg_field RMF_BATCH_NAMES;
+extern struct req_msg_field RMF_BATCH_GETATTR_REP;
+extern struct req_msg_field RMF_BATCH_MD;
 extern struct req_msg_field RMF_REC_REINT;
 extern struct req_msg_field RMF_EADATA;
 extern struct req_msg_field RMF_EAVALS;
@@ -321,7 +325,9 @@ extern struct req_msg_field RMF_RCS;
 extern struct req_msg_field RMF_FIEMAP_KEY;
 extern struct req_msg_field RMF_FIEMAP_VAL;
 extern struct req_msg_field RMF_OST_ID;
+extern struct req_msg_field RMF_OST_IDS;
 extern struct req_msg_field RMF_SHORT_IO;
+extern struct req_msg_field RMF_OBDO;
 
 /* MGS config read message format */
 extern struct req_msg_field RMF_MGS_CONFIG_BODY;
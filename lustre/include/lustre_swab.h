@@ -83,6 +83,8 @@ void lustre_swab_ldlm_resource_desc(struct ldlm_resource_desc *r);
 void lustre_swab_ldlm_lock_desc(struct ldlm_lock_desc *l);
 void lustre_swab_ldlm_request(struct ldlm_request *rq);
 void lustre_swab_ldlm_reply(struct ldlm_reply *r);
+void lustre_swab_mdt_batch_getattr(struct mdt_batch_getattr *mbg);
+void lustre_swab_mdt_batch_getattr_rep(struct mdt_batch_getattr_rep *mbgr);
 void lustre_swab_mgs_target_info(struct mgs_target_info *oinfo);
 void lustre_swab_mgs_nidtbl_entry(struct mgs_nidtbl_entry *oinfo);
 void lustre_swab_mgs_config_body(struct mgs_config_body *body);
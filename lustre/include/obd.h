@@ -170,6 +170,22 @@ enum obd_cl_sem_lock_class {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/*
+ * Dirty pages and grant moved in batches from the accounting of a client_obd
+ * to one CPU partition, so that pages can be dirtied from it without taking
+ * cl_loi_list_lock. They are still counted in cl_dirty_pages, obd_dirty_pages
+ * and cl_reserved_grant, so the totals reported to the server are unchanged.
+ */
+struct client_cache_credit {
+	spinlock_t		ccr_lock;
+	/* dirty pages not used yet */
+	unsigned long		ccr_dirty_pages;
+	/* grant not used yet */
+	unsigned long		ccr_grant;
+	/* grant used by dirty pages, not moved into cl_dirty_grant yet */
+	unsigned long		ccr_dirty_grant;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -225,6 +241,8 @@ struct client_obd {
 	 * grant before trying to dirty a page and unreserve the rest.
 	 * See osc_{reserve|unreserve}_grant for details. */
 	long			cl_reserved_grant;
+	/* per-CPT dirty page and grant credits, see osc_enter_cache_fast() */
+	struct client_cache_credit **cl_cache_credits;
 	struct list_head	cl_cache_waiters; /* waiting for cache/grant */
 	time64_t		cl_next_shrink_grant;	/* seconds */
 	struct list_head	cl_grant_chain;
@@ -269,6 +287,8 @@ struct client_obd {
 	u32			cl_max_pages_per_rpc;
 	u32			cl_max_rpcs_in_flight;
 	u32			cl_max_short_io_bytes;
+	/* max objects in a write RPC, see OBD_CONNECT2_MULTIOBJ_BRW */
+	u32			cl_max_objs_per_rpc;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
@@ -462,6 +482,11 @@ struct niobuf_local {
 
 struct tgt_thread_big_cache {
 	struct niobuf_local	local[PTLRPC_MAX_BRW_PAGES];
+	/* per-object state of a multi-object BRW write */
+	int			obj_order[PTLRPC_MAX_BRW_OBJS];
+	int			obj_rnb[PTLRPC_MAX_BRW_OBJS];
+	int			obj_lnb[PTLRPC_MAX_BRW_OBJS];
+	int			obj_npages[PTLRPC_MAX_BRW_OBJS];
 };
 
 #define LUSTRE_FLD_NAME         "fld"
@@ -932,6 +957,13 @@ struct md_enqueue_info {
 	struct ldlm_enqueue_info	mi_einfo;
 	md_enqueue_cb_t			mi_cb;
 	void			       *mi_cbdata;
+	/* other names of mi_dir sent in the same IT_GETATTR RPC, linked to the
+	 * mi_batch of the first one (OBD_CONNECT2_BATCH_GETATTR) */
+	struct list_head		mi_batch;
+	/* reply body and layout of a batched name, mi_body is NULL for the
+	 * first name, whose ones are in the RPC reply as usual */
+	struct mdt_body		       *mi_body;
+	struct lu_buf			mi_layout;
 };
 
 struct obd_ops {
@@ -38,6 +38,8 @@
 
 int obd_t10_cksum_speed(const char *obd_name,
 			enum cksum_types cksum_type);
+int obd_dif_init(void);
+void obd_dif_fini(void);
 
 static inline unsigned char cksum_obd2cfs(enum cksum_types cksum_type)
 {
@@ -141,6 +143,14 @@ int obd_page_dif_generate_buffer(const char *obd_name, struct page *page,
 				 __u16 *guard_start, int guard_number,
 				 int *used_number, int sector_size,
 				 obd_dif_csum_fn *fn);
+
+/* returns the page, offset in page and length of data page \a index */
+typedef void (obd_dif_page_fn) (void *data, int index, struct page **page,
+				__u32 *offset, __u32 *length);
+
+int obd_dif_generate_pages(const char *obd_name, struct ahash_request *req,
+			   int npages, obd_dif_page_fn *page_fn, void *data,
+			   int sector_size, obd_dif_csum_fn *fn);
 /*
  * If checksum type is one T10 checksum types, init the csum_fn and sector
  * size. Otherwise, init them to NULL/zero.
@@ -839,6 +839,13 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_LSOM		0x800ULL /* LSOM support */
 #define OBD_CONNECT2_PCC		0x1000ULL /* Persistent Client Cache */
 #define OBD_CONNECT2_ASYNC_DISCARD	0x4000ULL /* support async DoM data discard */
+#define OBD_CONNECT2_ENCRYPT		0x8000ULL /* reserved, client encryption */
+#define OBD_CONNECT2_FIDMAP		0x10000ULL /* reserved, FID mapping */
+#define OBD_CONNECT2_GETATTR_PFID	0x20000ULL /* reserved, pack parent FID */
+/* 0x40000 - 0x800000000000 are reserved for flags in use on other branches */
+#define OBD_CONNECT2_MULTIOBJ_BRW	0x1000000000000ULL /* BRW write of several objects */
+#define OBD_CONNECT2_BATCH_DESTROY	0x2000000000000ULL /* destroy of several objects */
+#define OBD_CONNECT2_BATCH_GETATTR	0x4000000000000ULL /* getattr of several names */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -900,7 +907,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_SELINUX_POLICY | \
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
-				OBD_CONNECT2_PCC)
+				OBD_CONNECT2_PCC | \
+				OBD_CONNECT2_MULTIOBJ_BRW | \
+				OBD_CONNECT2_BATCH_GETATTR)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -921,7 +930,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_GRANT_PARAM | \
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID)
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID | \
+				OBD_CONNECT2_MULTIOBJ_BRW | \
+				OBD_CONNECT2_BATCH_DESTROY)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -2540,6 +2551,29 @@ struct ldlm_reply {
 #define ldlm_flags_to_wire(flags)    ((__u32)(flags))
 #define ldlm_flags_from_wire(flags)  ((__u64)(flags))
 
+/*
+ * Extra names of an IT_GETATTR intent enqueue in RMF_BATCH_GETATTR, only sent
+ * with OBD_CONNECT2_BATCH_GETATTR. The first name is still in RMF_NAME, the
+ * other ones are NUL-terminated strings in RMF_BATCH_NAMES.
+ */
+struct mdt_batch_getattr {
+	struct lustre_handle	mbg_handle;	/* client lock handle */
+	__u32			mbg_name_off;	/* offset in RMF_BATCH_NAMES */
+	__u32			mbg_namelen;	/* without the NUL */
+};
+
+/*
+ * Reply to one mdt_batch_getattr in RMF_BATCH_GETATTR_REP. mbgr_dlm is filled
+ * as the ldlm_reply of a single intent enqueue would be, and the layout of
+ * mbgr_body.mbo_eadatasize bytes starts at mbgr_md_off in RMF_BATCH_MD.
+ */
+struct mdt_batch_getattr_rep {
+	struct ldlm_reply	mbgr_dlm;
+	struct mdt_body		mbgr_body;
+	__u32			mbgr_md_off;
+	__u32			mbgr_padding;
+};
+
 /*
  * Opcodes for mountconf (mgs and mgc)
  */
@@ -2452,6 +2452,59 @@ struct llapi_ladvise_hdr {
 
 #define LAH_COUNT_MAX	(1024)
 
+/* Binary job_stats snapshot, as read from the job_stats_bin proc file.
+ * A snapshot is one jobstats_bin_hdr followed by jbh_rec_count records
+ * of jbh_rec_size bytes each. Every record carries jbh_cntr_num counters,
+ * in the same order as they are listed in the job_stats file.
+ *
+ * Writing a generation number to the file before reading makes the
+ * snapshot only contain jobs updated since the read that returned that
+ * generation. Jobs removed since then come first, as records flagged
+ * JOBSTATS_BIN_REC_REMOVED with no counters. If the removals are too old
+ * to be reported, the snapshot is a full one instead, and
+ * JOBSTATS_BIN_FL_FULL is set so that the reader can drop the jobs it no
+ * longer sees.
+ */
+#define JOBSTATS_BIN_MAGIC	0x10B57A75
+#define JOBSTATS_BIN_VERSION	1
+
+enum jobstats_bin_flags {
+	JOBSTATS_BIN_FL_FULL	= 0x0001,	/* all jobs are listed */
+};
+
+enum jobstats_bin_rec_flags {
+	JOBSTATS_BIN_REC_REMOVED = 0x0001,	/* job was removed */
+};
+
+struct jobstats_bin_hdr {
+	__u32	jbh_magic;		/* JOBSTATS_BIN_MAGIC */
+	__u16	jbh_version;		/* JOBSTATS_BIN_VERSION */
+	__u16	jbh_flags;		/* enum jobstats_bin_flags */
+	__u32	jbh_rec_size;		/* size of one record in bytes */
+	__u32	jbh_rec_count;		/* number of records that follow */
+	__u32	jbh_cntr_num;		/* counters per record */
+	__u32	jbh_padding;
+	__u64	jbh_generation;		/* write back for a delta read */
+	__s64	jbh_snapshot_time;	/* seconds */
+};
+
+struct jobstats_bin_cntr {
+	__u64	jbc_count;
+	__u64	jbc_min;
+	__u64	jbc_max;
+	__u64	jbc_sum;
+	__u64	jbc_sumsquare;
+};
+
+struct jobstats_bin_rec {
+	char			 jbr_jobid[LUSTRE_JOBID_SIZE];
+	__s64			 jbr_timestamp;	/* last update, seconds */
+	__u64			 jbr_generation;	/* generation of last update */
+	__u32			 jbr_flags;	/* enum jobstats_bin_rec_flags */
+	__u32			 jbr_padding;
+	struct jobstats_bin_cntr jbr_cntrs[0];
+};
+
 /* Shared key */
 enum sk_crypt_alg {
 	SK_CRYPT_INVALID	= -1,
@@ -2528,6 +2581,7 @@ struct lu_heat {
 enum lu_pcc_type {
 	LU_PCC_NONE = 0,
 	LU_PCC_READWRITE,
+	LU_PCC_READONLY,
 	LU_PCC_MAX
 };
 
@@ -2538,6 +2592,8 @@ static inline const char *pcc_type2string(enum lu_pcc_type type)
 		return "none";
 	case LU_PCC_READWRITE:
 		return "readwrite";
+	case LU_PCC_READONLY:
+		return "readonly";
 	default:
 		return "fault";
 	}
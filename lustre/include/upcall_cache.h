@@ -81,6 +81,10 @@ struct md_identity {
 
 struct upcall_cache_entry {
 	struct list_head	ue_hash;
+	/* chain on upcall_cache::uc_refresh_list or uc_inflight_list */
+	struct list_head	ue_refresh;
+	/* upcall issued by uc_refresh_work, counted in uc_inflight */
+	bool			ue_inflight;
 	uint64_t		ue_key;
 	atomic_t		ue_refcount;
 	int			ue_flags;
@@ -123,7 +127,19 @@ struct upcall_cache {
 	char			uc_upcall[UC_CACHE_UPCALL_MAXPATH];
 	time64_t		uc_acquire_expire;	/* seconds */
 	time64_t		uc_entry_expire;	/* seconds */
+	/* seconds an expired entry is still used while being refreshed */
+	time64_t		uc_stale_expire;
+	/* seconds a failed upcall is remembered, 0 to retry at once */
+	time64_t		uc_neg_expire;
 	struct upcall_cache_ops	*uc_ops;
+	/* entries waiting for their upcall, issued by uc_refresh_work */
+	struct list_head	uc_refresh_list;
+	/* entries whose upcall uc_refresh_work issued, awaiting downcall */
+	struct list_head	uc_inflight_list;
+	int			uc_inflight;
+	/* upcalls uc_refresh_work keeps in flight at most, 0 for no limit */
+	int			uc_inflight_max;
+	struct delayed_work	uc_refresh_work;
 };
 
 struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
@@ -145,6 +161,7 @@ static inline void upcall_cache_flush_all(struct upcall_cache *cache)
 }
 
 void upcall_cache_flush_one(struct upcall_cache *cache, __u64 key, void *args);
+int upcall_cache_prefetch(struct upcall_cache *cache, __u64 key, void *args);
 struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 				       struct upcall_cache_ops *ops);
 void upcall_cache_cleanup(struct upcall_cache *cache);
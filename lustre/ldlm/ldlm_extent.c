@@ -324,6 +324,30 @@ static int ldlm_check_contention(struct ldlm_lock *lock, int contended_locks)
 		     ldlm_res_to_ns(res)->ns_contention_time;
 }
 
+/**
+ * Account the conflicts met by an enqueue into the per-second conflict
+ * count of the resource.
+ *
+ * Clients writing small records to disjoint areas of a shared object
+ * only conflict with one or two expanded locks per enqueue, but do it
+ * over and over again. Such lock ping-pong is contention as well, even
+ * if no single enqueue meets more than ns_contended_locks conflicts.
+ */
+static void ldlm_extent_contention_account(struct ldlm_resource *res,
+					   int contended_locks)
+{
+	time64_t now = ktime_get_seconds();
+
+	if (res->lr_conflict_period != now) {
+		res->lr_conflict_period = now;
+		res->lr_conflict_count = 0;
+	}
+	res->lr_conflict_count += contended_locks;
+
+	if (res->lr_conflict_count > ldlm_res_to_ns(res)->ns_contended_locks)
+		res->lr_contention_time = now;
+}
+
 struct ldlm_extent_compat_args {
 	struct list_head *work_list;
 	struct ldlm_lock *lock;
@@ -838,6 +862,9 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 			GOTO(out_rpc_list, rc = rc2);
 	}
 
+	if (contended_locks > 0)
+		ldlm_extent_contention_account(res, contended_locks);
+
 	if (rc + rc2 == 2) {
 		ldlm_extent_policy(res, lock, flags);
 		ldlm_resource_unlink_lock(lock);
@@ -435,6 +435,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
 
 	cli->cl_max_short_io_bytes = OBD_MAX_SHORT_IO_BYTES;
+	cli->cl_max_objs_per_rpc = PTLRPC_MAX_BRW_OBJS;
 
 	/*
 	 * set cl_chunkbits default value to PAGE_SHIFT,
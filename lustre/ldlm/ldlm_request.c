@@ -584,79 +584,21 @@ static void failed_lock_cleanup(struct ldlm_namespace *ns,
 }
 
 /**
- * Finishing portion of client lock enqueue code.
- *
- * Called after receiving reply from server.
+ * Apply the server reply \a reply of an enqueue to the client lock \a lock:
+ * remote handle, flags and, if the server changed them, mode, resource and
+ * policy of the lock.
  */
-int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
-			  enum ldlm_type type, __u8 with_policy,
-			  enum ldlm_mode mode, __u64 *flags, void *lvb,
-			  __u32 lvb_len, const struct lustre_handle *lockh,
-			  int rc)
+static int ldlm_cli_enqueue_reply(struct obd_export *exp,
+				  struct ldlm_lock *lock,
+				  struct ldlm_reply *reply,
+				  enum ldlm_type type, __u8 with_policy,
+				  int is_replay, __u64 *flags)
 {
 	struct ldlm_namespace *ns = exp->exp_obd->obd_namespace;
-	const struct lu_env *env = NULL;
-	int is_replay = *flags & LDLM_FL_REPLAY;
-	struct ldlm_lock *lock;
-	struct ldlm_reply *reply;
-	int cleanup_phase = 1;
+	int rc;
 
 	ENTRY;
 
-	if (req && req->rq_svc_thread)
-		env = req->rq_svc_thread->t_env;
-
-	lock = ldlm_handle2lock(lockh);
-	/* ldlm_cli_enqueue is holding a reference on this lock. */
-	if (!lock) {
-		LASSERT(type == LDLM_FLOCK);
-		RETURN(-ENOLCK);
-	}
-
-	LASSERTF(ergo(lvb_len != 0, lvb_len == lock->l_lvb_len),
-		 "lvb_len = %d, l_lvb_len = %d\n", lvb_len, lock->l_lvb_len);
-
-	if (rc != ELDLM_OK) {
-		LASSERT(!is_replay);
-		LDLM_DEBUG(lock, "client-side enqueue END (%s)",
-			   rc == ELDLM_LOCK_ABORTED ? "ABORTED" : "FAILED");
-
-		if (rc != ELDLM_LOCK_ABORTED)
-			GOTO(cleanup, rc);
-	}
-
-	/* Before we return, swab the reply */
-	reply = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REP);
-	if (reply == NULL)
-		GOTO(cleanup, rc = -EPROTO);
-
-	if (lvb_len > 0) {
-		int size = 0;
-
-		size = req_capsule_get_size(&req->rq_pill, &RMF_DLM_LVB,
-					    RCL_SERVER);
-		if (size < 0) {
-			LDLM_ERROR(lock, "Fail to get lvb_len, rc = %d", size);
-			GOTO(cleanup, rc = size);
-		} else if (unlikely(size > lvb_len)) {
-			LDLM_ERROR(lock,
-				   "Replied LVB is larger than expectation, expected = %d, replied = %d",
-				   lvb_len, size);
-			GOTO(cleanup, rc = -EINVAL);
-		}
-		lvb_len = size;
-	}
-
-	if (rc == ELDLM_LOCK_ABORTED) {
-		if (lvb_len > 0 && lvb != NULL)
-			rc = ldlm_fill_lvb(lock, &req->rq_pill, RCL_SERVER,
-					   lvb, lvb_len);
-		GOTO(cleanup, rc = rc ? : ELDLM_LOCK_ABORTED);
-	}
-
-	/* lock enqueued on the server */
-	cleanup_phase = 0;
-
 	lock_res_and_lock(lock);
 	/* Key change rehash lock in per-export hash with new key */
 	if (exp->exp_lock_hash) {
@@ -706,7 +648,7 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 			rc = ldlm_lock_change_resource(ns, lock,
 					&reply->lock_desc.l_resource.lr_name);
 			if (rc || lock->l_resource == NULL)
-				GOTO(cleanup, rc = -ENOMEM);
+				RETURN(-ENOMEM);
 			LDLM_DEBUG(lock, "client-side enqueue, new resource");
 		}
 
@@ -730,6 +672,88 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 		LDLM_DEBUG(lock, "enqueue reply includes blocking AST");
 	}
 
+	RETURN(0);
+}
+
+/**
+ * Finishing portion of client lock enqueue code.
+ *
+ * Called after receiving reply from server.
+ */
+int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
+			  enum ldlm_type type, __u8 with_policy,
+			  enum ldlm_mode mode, __u64 *flags, void *lvb,
+			  __u32 lvb_len, const struct lustre_handle *lockh,
+			  int rc)
+{
+	struct ldlm_namespace *ns = exp->exp_obd->obd_namespace;
+	const struct lu_env *env = NULL;
+	int is_replay = *flags & LDLM_FL_REPLAY;
+	struct ldlm_lock *lock;
+	struct ldlm_reply *reply;
+	int cleanup_phase = 1;
+
+	ENTRY;
+
+	if (req && req->rq_svc_thread)
+		env = req->rq_svc_thread->t_env;
+
+	lock = ldlm_handle2lock(lockh);
+	/* ldlm_cli_enqueue is holding a reference on this lock. */
+	if (!lock) {
+		LASSERT(type == LDLM_FLOCK);
+		RETURN(-ENOLCK);
+	}
+
+	LASSERTF(ergo(lvb_len != 0, lvb_len == lock->l_lvb_len),
+		 "lvb_len = %d, l_lvb_len = %d\n", lvb_len, lock->l_lvb_len);
+
+	if (rc != ELDLM_OK) {
+		LASSERT(!is_replay);
+		LDLM_DEBUG(lock, "client-side enqueue END (%s)",
+			   rc == ELDLM_LOCK_ABORTED ? "ABORTED" : "FAILED");
+
+		if (rc != ELDLM_LOCK_ABORTED)
+			GOTO(cleanup, rc);
+	}
+
+	/* Before we return, swab the reply */
+	reply = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REP);
+	if (reply == NULL)
+		GOTO(cleanup, rc = -EPROTO);
+
+	if (lvb_len > 0) {
+		int size = 0;
+
+		size = req_capsule_get_size(&req->rq_pill, &RMF_DLM_LVB,
+					    RCL_SERVER);
+		if (size < 0) {
+			LDLM_ERROR(lock, "Fail to get lvb_len, rc = %d", size);
+			GOTO(cleanup, rc = size);
+		} else if (unlikely(size > lvb_len)) {
+			LDLM_ERROR(lock,
+				   "Replied LVB is larger than expectation, expected = %d, replied = %d",
+				   lvb_len, size);
+			GOTO(cleanup, rc = -EINVAL);
+		}
+		lvb_len = size;
+	}
+
+	if (rc == ELDLM_LOCK_ABORTED) {
+		if (lvb_len > 0 && lvb != NULL)
+			rc = ldlm_fill_lvb(lock, &req->rq_pill, RCL_SERVER,
+					   lvb, lvb_len);
+		GOTO(cleanup, rc = rc ? : ELDLM_LOCK_ABORTED);
+	}
+
+	/* lock enqueued on the server */
+	cleanup_phase = 0;
+
+	rc = ldlm_cli_enqueue_reply(exp, lock, reply, type, with_policy,
+				    is_replay, flags);
+	if (rc)
+		GOTO(cleanup, rc);
+
 	/*
 	 * If the lock has already been granted by a completion AST, don't
 	 * clobber the LVB with an older one.
@@ -784,6 +808,55 @@ cleanup:
 }
 EXPORT_SYMBOL(ldlm_cli_enqueue_fini);
 
+/**
+ * Finish a client lock enqueue whose reply \a reply was not the DLM reply of
+ * the RPC, e.g. one entry of a batched intent getattr reply. The lock was
+ * created by ldlm_cli_enqueue_prep(), both its references are dropped here.
+ */
+int ldlm_cli_enqueue_reply_fini(struct obd_export *exp,
+				struct ldlm_reply *reply, enum ldlm_type type,
+				__u8 with_policy, enum ldlm_mode mode,
+				__u64 *flags, const struct lustre_handle *lockh,
+				int rc)
+{
+	struct ldlm_namespace *ns = exp->exp_obd->obd_namespace;
+	struct ldlm_lock *lock;
+
+	ENTRY;
+
+	lock = ldlm_handle2lock(lockh);
+	if (!lock)
+		RETURN(-ENOLCK);
+
+	if (rc != ELDLM_OK) {
+		LDLM_DEBUG(lock, "client-side enqueue END (FAILED)");
+		GOTO(cleanup, rc = rc > 0 ? -EIO : rc);
+	}
+
+	rc = ldlm_cli_enqueue_reply(exp, lock, reply, type, with_policy, 0,
+				    flags);
+	if (rc)
+		GOTO(cleanup, rc);
+
+	rc = ldlm_lock_enqueue(NULL, ns, &lock, NULL, flags);
+	if (lock->l_completion_ast != NULL) {
+		int err = lock->l_completion_ast(lock, *flags, NULL);
+
+		if (!rc)
+			rc = err;
+	}
+
+	LDLM_DEBUG(lock, "client-side enqueue END");
+	EXIT;
+cleanup:
+	if (rc)
+		failed_lock_cleanup(ns, lock, mode);
+	LDLM_LOCK_PUT(lock);
+	LDLM_LOCK_RELEASE(lock);
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_cli_enqueue_reply_fini);
+
 /**
  * Estimate number of lock handles that would fit into request of given
  * size.  PAGE_SIZE-512 is to allow TCP/IP and LNET headers to fit into
@@ -933,6 +1006,84 @@ struct ptlrpc_request *ldlm_enqueue_pack(struct obd_export *exp, int lvb_len)
 }
 EXPORT_SYMBOL(ldlm_enqueue_pack);
 
+static struct ldlm_lock *
+ldlm_cli_lock_create(struct ldlm_namespace *ns,
+		     struct ldlm_enqueue_info *einfo,
+		     const struct ldlm_res_id *res_id,
+		     union ldlm_policy_data const *policy, __u32 lvb_len,
+		     enum lvb_type lvb_type, struct lustre_handle *lockh)
+{
+	const struct ldlm_callback_suite cbs = {
+		.lcs_completion = einfo->ei_cb_cp,
+		.lcs_blocking	= einfo->ei_cb_bl,
+		.lcs_glimpse	= einfo->ei_cb_gl
+	};
+	struct ldlm_lock *lock;
+
+	lock = ldlm_lock_create(ns, res_id, einfo->ei_type, einfo->ei_mode,
+				&cbs, einfo->ei_cbdata, lvb_len, lvb_type);
+	if (IS_ERR(lock))
+		return lock;
+
+	if (einfo->ei_cb_created)
+		einfo->ei_cb_created(lock);
+
+	/* for the local lock, add the reference */
+	ldlm_lock_addref_internal(lock, einfo->ei_mode);
+	ldlm_lock2handle(lock, lockh);
+	if (policy != NULL)
+		lock->l_policy_data = *policy;
+
+	if (einfo->ei_type == LDLM_EXTENT) {
+		/* extent lock without policy is a bug */
+		if (policy == NULL)
+			LBUG();
+
+		lock->l_req_extent = policy->l_extent;
+	}
+
+	return lock;
+}
+
+static void ldlm_cli_lock_init(struct obd_export *exp, struct ldlm_lock *lock,
+			       struct ldlm_enqueue_info *einfo, __u64 flags)
+{
+	lock->l_conn_export = exp;
+	lock->l_export = NULL;
+	lock->l_blocking_ast = einfo->ei_cb_bl;
+	lock->l_flags |= (flags & (LDLM_FL_NO_LRU | LDLM_FL_EXCL |
+				   LDLM_FL_ATOMIC_CB));
+	lock->l_activity = ktime_get_real_seconds();
+}
+
+/**
+ * Create the client lock of an enqueue carried to the server by another RPC,
+ * e.g. the extra names of a batched intent getattr. The lock keeps the
+ * references ldlm_cli_enqueue() would keep until ldlm_cli_enqueue_fini(), they
+ * are dropped by ldlm_cli_enqueue_reply_fini().
+ */
+int ldlm_cli_enqueue_prep(struct obd_export *exp,
+			  struct ldlm_enqueue_info *einfo,
+			  const struct ldlm_res_id *res_id,
+			  union ldlm_policy_data const *policy, __u64 flags,
+			  struct lustre_handle *lockh)
+{
+	struct ldlm_lock *lock;
+
+	ENTRY;
+
+	lock = ldlm_cli_lock_create(exp->exp_obd->obd_namespace, einfo, res_id,
+				    policy, 0, LVB_T_NONE, lockh);
+	if (IS_ERR(lock))
+		RETURN(PTR_ERR(lock));
+
+	ldlm_cli_lock_init(exp, lock, einfo, flags);
+	LDLM_DEBUG(lock, "client-side batched enqueue START, flags %#llx",
+		   flags);
+	RETURN(0);
+}
+EXPORT_SYMBOL(ldlm_cli_enqueue_prep);
+
 /**
  * Client-side lock enqueue.
  *
@@ -974,43 +1125,16 @@ int ldlm_cli_enqueue(struct obd_export *exp, struct ptlrpc_request **reqp,
 		LDLM_DEBUG(lock, "client-side enqueue START");
 		LASSERT(exp == lock->l_conn_export);
 	} else {
-		const struct ldlm_callback_suite cbs = {
-			.lcs_completion = einfo->ei_cb_cp,
-			.lcs_blocking	= einfo->ei_cb_bl,
-			.lcs_glimpse	= einfo->ei_cb_gl
-		};
-		lock = ldlm_lock_create(ns, res_id, einfo->ei_type,
-					einfo->ei_mode, &cbs, einfo->ei_cbdata,
-					lvb_len, lvb_type);
+		lock = ldlm_cli_lock_create(ns, einfo, res_id, policy, lvb_len,
+					    lvb_type, lockh);
 		if (IS_ERR(lock))
 			RETURN(PTR_ERR(lock));
 
-		if (einfo->ei_cb_created)
-			einfo->ei_cb_created(lock);
-
-		/* for the local lock, add the reference */
-		ldlm_lock_addref_internal(lock, einfo->ei_mode);
-		ldlm_lock2handle(lock, lockh);
-		if (policy != NULL)
-			lock->l_policy_data = *policy;
-
-		if (einfo->ei_type == LDLM_EXTENT) {
-			/* extent lock without policy is a bug */
-			if (policy == NULL)
-				LBUG();
-
-			lock->l_req_extent = policy->l_extent;
-		}
 		LDLM_DEBUG(lock, "client-side enqueue START, flags %#llx",
 			   *flags);
 	}
 
-	lock->l_conn_export = exp;
-	lock->l_export = NULL;
-	lock->l_blocking_ast = einfo->ei_cb_bl;
-	lock->l_flags |= (*flags & (LDLM_FL_NO_LRU | LDLM_FL_EXCL |
-				    LDLM_FL_ATOMIC_CB));
-	lock->l_activity = ktime_get_real_seconds();
+	ldlm_cli_lock_init(exp, lock, einfo, *flags);
 
 	/* lock not sent to server yet */
 	if (reqp == NULL || *reqp == NULL) {
@@ -46,6 +46,7 @@ static void lfsck_bookmark_le_to_cpu(struct lfsck_bookmark *des,
 	des->lb_param = le16_to_cpu(src->lb_param);
 	des->lb_speed_limit = le32_to_cpu(src->lb_speed_limit);
 	des->lb_async_windows = le16_to_cpu(src->lb_async_windows);
+	des->lb_assistant_threads = le16_to_cpu(src->lb_assistant_threads);
 	fid_le_to_cpu(&des->lb_lpf_fid, &src->lb_lpf_fid);
 	fid_le_to_cpu(&des->lb_last_fid, &src->lb_last_fid);
 }
@@ -58,6 +59,7 @@ void lfsck_bookmark_cpu_to_le(struct lfsck_bookmark *des,
 	des->lb_param = cpu_to_le16(src->lb_param);
 	des->lb_speed_limit = cpu_to_le32(src->lb_speed_limit);
 	des->lb_async_windows = cpu_to_le16(src->lb_async_windows);
+	des->lb_assistant_threads = cpu_to_le16(src->lb_assistant_threads);
 	fid_cpu_to_le(&des->lb_lpf_fid, &src->lb_lpf_fid);
 	fid_cpu_to_le(&des->lb_last_fid, &src->lb_last_fid);
 }
@@ -148,6 +150,7 @@ static int lfsck_bookmark_init(const struct lu_env *env,
 	mb->lb_magic = LFSCK_BOOKMARK_MAGIC;
 	mb->lb_version = LFSCK_VERSION_V2;
 	mb->lb_async_windows = LFSCK_ASYNC_WIN_DEFAULT;
+	mb->lb_assistant_threads = LFSCK_ASSISTANT_THREADS_DEFAULT;
 	mutex_lock(&lfsck->li_mutex);
 	rc = lfsck_bookmark_store(env, lfsck);
 	mutex_unlock(&lfsck->li_mutex);
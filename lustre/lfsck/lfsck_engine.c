@@ -1146,6 +1146,156 @@ static inline bool lfsck_assistant_req_empty(struct lfsck_assistant_data *lad)
 	return empty;
 }
 
+/* Take the oldest request in lad_req_list that nobody is handling. The
+ * request stays in the list until it is done, so the head of the list is
+ * always the oldest unfinished request which la_fill_pos() depends on. */
+static struct lfsck_assistant_req *
+lfsck_assistant_req_claim(struct lfsck_assistant_data *lad)
+{
+	struct lfsck_assistant_req *lar;
+
+	spin_lock(&lad->lad_lock);
+	list_for_each_entry(lar, &lad->lad_req_list, lar_list) {
+		if (!lar->lar_busy) {
+			lar->lar_busy = true;
+			spin_unlock(&lad->lad_lock);
+
+			return lar;
+		}
+	}
+	spin_unlock(&lad->lad_lock);
+
+	return NULL;
+}
+
+static bool lfsck_assistant_req_claimable(struct lfsck_assistant_data *lad)
+{
+	struct lfsck_assistant_req *lar;
+	bool claimable = false;
+
+	spin_lock(&lad->lad_lock);
+	list_for_each_entry(lar, &lad->lad_req_list, lar_list) {
+		if (!lar->lar_busy) {
+			claimable = true;
+			break;
+		}
+	}
+	spin_unlock(&lad->lad_lock);
+
+	return claimable;
+}
+
+static void lfsck_assistant_req_done(const struct lu_env *env,
+				     struct lfsck_component *com,
+				     struct lfsck_assistant_req *lar)
+{
+	struct lfsck_assistant_data	*lad	 = com->lc_data;
+	struct lfsck_bookmark		*bk	 =
+					&com->lc_lfsck->li_bookmark_ram;
+	bool				 wakeup	 = false;
+	bool				 empty;
+
+	spin_lock(&lad->lad_lock);
+	list_del_init(&lar->lar_list);
+	lad->lad_prefetched--;
+	/* Wake up the main engine thread only when the list
+	 * is empty or half of the prefetched items have been
+	 * handled to avoid too frequent thread schedule. */
+	if (lad->lad_prefetched <= (bk->lb_async_windows / 2))
+		wakeup = true;
+	empty = list_empty(&lad->lad_req_list);
+	spin_unlock(&lad->lad_lock);
+	if (wakeup)
+		wake_up_all(&com->lc_lfsck->li_thread.t_ctl_waitq);
+
+	/* The assistant thread may be waiting for the workers to drain
+	 * the list before the post or double scan. */
+	if (empty && atomic_read(&lad->lad_workers) > 0)
+		wake_up_all(&lad->lad_thread.t_ctl_waitq);
+
+	lad->lad_ops->la_req_fini(env, lar);
+}
+
+/**
+ * The worker thread helping the LFSCK assistant thread.
+ *
+ * It handles the requests in lad_req_list in parallel with the assistant
+ * thread and the other workers. The assistant thread does all the other
+ * things: the post, the double scan, the notification and the cleanup.
+ * The worker exits when the assistant sets LAD_STOP_WORKERS.
+ *
+ * \param[in] args	the lfsck_thread_args for this worker
+ *
+ * \retval		0 on success
+ * \retval		negative error number on failure
+ */
+int lfsck_assistant_worker(void *args)
+{
+	struct lfsck_thread_args	  *lta	   = args;
+	struct lu_env			  *env	   = &lta->lta_env;
+	struct lfsck_component		  *com     = lta->lta_com;
+	struct lfsck_instance		  *lfsck   = lta->lta_lfsck;
+	struct lfsck_bookmark		  *bk	   = &lfsck->li_bookmark_ram;
+	struct lfsck_assistant_data	  *lad     = com->lc_data;
+	struct ptlrpc_thread		  *athread = &lad->lad_thread;
+	struct lfsck_assistant_req	  *lar;
+	struct l_wait_info		   lwi     = { 0 };
+	int				   rc      = 0;
+
+	while (1) {
+		l_wait_event(athread->t_ctl_waitq,
+			     lfsck_assistant_req_claimable(lad) ||
+			     test_bit(LAD_STOP_WORKERS, &lad->lad_flags) ||
+			     test_bit(LAD_EXIT, &lad->lad_flags),
+			     &lwi);
+
+		if (test_bit(LAD_STOP_WORKERS, &lad->lad_flags) ||
+		    test_bit(LAD_EXIT, &lad->lad_flags))
+			break;
+
+		while (!test_bit(LAD_STOP_WORKERS, &lad->lad_flags) &&
+		       !test_bit(LAD_EXIT, &lad->lad_flags) &&
+		       (lar = lfsck_assistant_req_claim(lad)) != NULL) {
+			rc = lad->lad_ops->la_handler_p1(env, com, lar);
+			lfsck_assistant_req_done(env, com, lar);
+			if (rc < 0 && bk->lb_param & LPF_FAILOUT) {
+				spin_lock(&lad->lad_lock);
+				if (lad->lad_assistant_status == 0)
+					lad->lad_assistant_status = rc;
+				spin_unlock(&lad->lad_lock);
+				wake_up_all(&athread->t_ctl_waitq);
+				GOTO(out, rc);
+			}
+		}
+	}
+
+out:
+	CDEBUG(D_LFSCK, "%s: %s LFSCK assistant worker exit: rc = %d\n",
+	       lfsck_lfsck2name(lfsck), lad->lad_name, rc);
+
+	/* Hold the component reference via "lta" until the assistant
+	 * thread has been woken up. */
+	if (atomic_dec_and_test(&lad->lad_workers))
+		wake_up_all(&athread->t_ctl_waitq);
+	lfsck_thread_args_fini(lta);
+
+	return rc;
+}
+
+static void lfsck_assistant_stop_workers(struct lfsck_assistant_data *lad)
+{
+	struct l_wait_info lwi = { 0 };
+
+	if (atomic_read(&lad->lad_workers) == 0)
+		return;
+
+	set_bit(LAD_STOP_WORKERS, &lad->lad_flags);
+	wake_up_all(&lad->lad_thread.t_ctl_waitq);
+	l_wait_event(lad->lad_thread.t_ctl_waitq,
+		     atomic_read(&lad->lad_workers) == 0,
+		     &lwi);
+}
+
 /**
  * Query the LFSCK status from the instatnces on remote servers.
  *
@@ -1613,50 +1763,38 @@ int lfsck_assistant_engine(void *args)
 	spin_unlock(&lad->lad_lock);
 	wake_up_all(&mthread->t_ctl_waitq);
 
-	while (1) {
-		while (!list_empty(&lad->lad_req_list)) {
-			bool wakeup = false;
+	if (lad->lad_parallel && bk->lb_assistant_threads > 1)
+		lfsck_start_assistant_workers(com,
+					      bk->lb_assistant_threads - 1);
 
+	while (1) {
+		while ((lar = lfsck_assistant_req_claim(lad)) != NULL) {
 			if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags) ||
 				     !thread_is_running(mthread)))
 				GOTO(cleanup, rc = lad->lad_post_result);
 
-			lar = list_entry(lad->lad_req_list.next,
-					 struct lfsck_assistant_req,
-					 lar_list);
-			/* Only the lfsck_assistant_engine thread itself can
-			 * remove the "lar" from the head of the list, LFSCK
-			 * engine thread only inserts other new "lar" at the
-			 * end of the list. So it is safe to handle current
-			 * "lar" without the spin_lock. */
 			rc = lao->la_handler_p1(env, com, lar);
-			spin_lock(&lad->lad_lock);
-			list_del_init(&lar->lar_list);
-			lad->lad_prefetched--;
-			/* Wake up the main engine thread only when the list
-			 * is empty or half of the prefetched items have been
-			 * handled to avoid too frequent thread schedule. */
-			if (lad->lad_prefetched <= (bk->lb_async_windows / 2))
-				wakeup = true;
-			spin_unlock(&lad->lad_lock);
-			if (wakeup)
-				wake_up_all(&mthread->t_ctl_waitq);
-
-			lao->la_req_fini(env, lar);
+			lfsck_assistant_req_done(env, com, lar);
 			if (rc < 0 && bk->lb_param & LPF_FAILOUT)
 				GOTO(cleanup, rc);
 		}
 
 		l_wait_event(athread->t_ctl_waitq,
-			     !lfsck_assistant_req_empty(lad) ||
+			     lfsck_assistant_req_claimable(lad) ||
+			     lad->lad_assistant_status < 0 ||
 			     test_bit(LAD_EXIT, &lad->lad_flags) ||
-			     test_bit(LAD_TO_POST, &lad->lad_flags) ||
-			     test_bit(LAD_TO_DOUBLE_SCAN, &lad->lad_flags),
+			     (lfsck_assistant_req_empty(lad) &&
+			      (test_bit(LAD_TO_POST, &lad->lad_flags) ||
+			       test_bit(LAD_TO_DOUBLE_SCAN, &lad->lad_flags))),
 			     &lwi);
 
 		if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags)))
 			GOTO(cleanup, rc = lad->lad_post_result);
 
+		/* Some worker failed under LPF_FAILOUT mode. */
+		if (unlikely(lad->lad_assistant_status < 0))
+			GOTO(cleanup, rc = lad->lad_assistant_status);
+
 		if (!list_empty(&lad->lad_req_list))
 			continue;
 
@@ -1664,6 +1802,10 @@ int lfsck_assistant_engine(void *args)
 			CDEBUG(D_LFSCK, "%s: %s LFSCK assistant thread post\n",
 			       lfsck_lfsck2name(lfsck), lad->lad_name);
 
+			/* The first-stage scanning is done, the workers have
+			 * nothing more to handle. */
+			lfsck_assistant_stop_workers(lad);
+
 			if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags)))
 				GOTO(cleanup, rc = lad->lad_post_result);
 
@@ -1755,6 +1897,9 @@ p2_next:
 	}
 
 cleanup:
+	/* The requests in handling are only released by their workers. */
+	lfsck_assistant_stop_workers(lad);
+
 	/* Cleanup the unfinished requests. */
 	spin_lock(&lad->lad_lock);
 	if (rc < 0)
@@ -45,6 +45,8 @@
 #include <lustre_linkea.h>
 
 #define LFSCK_CHECKPOINT_INTERVAL	60
+#define LFSCK_ASSISTANT_THREADS_DEFAULT	1
+#define LFSCK_ASSISTANT_THREADS_MAX	32
 
 enum lfsck_flags {
 	/* Finish the first cycle scanning. */
@@ -91,8 +93,9 @@ struct lfsck_bookmark {
 	/* The windows size for async requests pipeline. */
 	__u16	lb_async_windows;
 
-	/* For 64-bits aligned. */
-	__u16	lb_padding;
+	/* How many threads verify the requests of the assistant engine,
+	 * 0 is the same as 1 (no parallel workers). */
+	__u16	lb_assistant_threads;
 
 	/* The FID for .lustre/lost+found/MDTxxxx */
 	struct lu_fid	lb_lpf_fid;
@@ -772,6 +775,8 @@ struct lfsck_thread_args {
 struct lfsck_assistant_req {
 	struct list_head		 lar_list;
 	struct lfsck_assistant_object	*lar_parent;
+	/* claimed by one of the assistant threads, protected by lad_lock */
+	bool				 lar_busy;
 };
 
 struct lfsck_namespace_req {
@@ -850,10 +855,14 @@ struct lfsck_assistant_data {
 
 	__u32					 lad_touch_gen;
 	int					 lad_prefetched;
+	/* parallel worker threads helping the assistant thread */
+	atomic_t				 lad_workers;
 	int					 lad_assistant_status;
 	int					 lad_post_result;
 	unsigned long				 lad_flags;
 	bool					 lad_advance_lock;
+	/* la_handler_p1 can be called by several threads concurrently */
+	bool					 lad_parallel;
 };
 enum {
 	LAD_TO_POST = 0,
@@ -861,6 +870,7 @@ enum {
 	LAD_IN_DOUBLE_SCAN = 2,
 	LAD_EXIT = 3,
 	LAD_INCOMPLETE = 4,
+	LAD_STOP_WORKERS = 5,
 };
 
 #define LFSCK_TMPBUF_LEN	64
@@ -974,6 +984,7 @@ int lfsck_async_request(const struct lu_env *env, struct obd_export *exp,
 			ptlrpc_interpterer_t interpterer,
 			void *args, int request);
 int lfsck_query_all(const struct lu_env *env, struct lfsck_component *com);
+void lfsck_start_assistant_workers(struct lfsck_component *com, int count);
 int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 			  struct lfsck_start_param *lsp);
 int lfsck_checkpoint_generic(const struct lu_env *env,
@@ -1003,6 +1014,7 @@ int lfsck_open_dir(const struct lu_env *env,
 		   struct lfsck_instance *lfsck, __u64 cookie);
 int lfsck_master_engine(void *args);
 int lfsck_assistant_engine(void *args);
+int lfsck_assistant_worker(void *args);
 
 /* lfsck_bookmark.c */
 void lfsck_bookmark_cpu_to_le(struct lfsck_bookmark *des,
@@ -5510,7 +5510,8 @@ static int lfsck_layout_scan_stripes(const struct lu_env *env,
 		}
 
 		list_add_tail(&llr->llr_lar.lar_list, &lad->lad_req_list);
-		if (lad->lad_prefetched == 0)
+		/* Some assistant thread may be idle. */
+		if (lad->lad_prefetched <= atomic_read(&lad->lad_workers))
 			wakeup = true;
 
 		lad->lad_prefetched++;
@@ -6813,6 +6814,7 @@ struct lfsck_assistant_operations lfsck_layout_assistant_ops = {
 int lfsck_layout_setup(const struct lu_env *env, struct lfsck_instance *lfsck)
 {
 	struct lfsck_component	*com;
+	struct lfsck_assistant_data *lad;
 	struct lfsck_layout	*lo;
 	struct dt_object	*root = NULL;
 	struct dt_object	*obj;
@@ -6832,12 +6834,16 @@ int lfsck_layout_setup(const struct lu_env *env, struct lfsck_instance *lfsck)
 	com->lc_type = LFSCK_TYPE_LAYOUT;
 	if (lfsck->li_master) {
 		com->lc_ops = &lfsck_layout_master_ops;
-		com->lc_data = lfsck_assistant_data_init(
-				&lfsck_layout_assistant_ops,
-				LFSCK_LAYOUT);
-		if (com->lc_data == NULL)
+		lad = lfsck_assistant_data_init(&lfsck_layout_assistant_ops,
+						LFSCK_LAYOUT);
+		if (lad == NULL)
 			GOTO(out, rc = -ENOMEM);
 
+		/* Each request verifies one OST-object independently, they
+		 * can be handled by several assistant threads in parallel. */
+		lad->lad_parallel = true;
+		com->lc_data = lad;
+
 		for (i = 0; i < LFSCK_STF_COUNT; i++)
 			mutex_init(&com->lc_sub_trace_objs[i].lsto_mutex);
 	} else {
@@ -2524,6 +2524,46 @@ again:
 	RETURN(rc);
 }
 
+/**
+ * Start the worker threads for the LFSCK assistant thread.
+ *
+ * Failing to start some worker is not fatal, the assistant thread and
+ * the started workers will handle all the requests.
+ *
+ * \param[in] com	the LFSCK component
+ * \param[in] count	how many workers to be started
+ */
+void lfsck_start_assistant_workers(struct lfsck_component *com, int count)
+{
+	struct lfsck_instance		*lfsck	= com->lc_lfsck;
+	struct lfsck_assistant_data	*lad	= com->lc_data;
+	struct lfsck_thread_args	*lta;
+	struct task_struct		*task;
+	int				 i;
+
+	for (i = 0; i < count; i++) {
+		lta = lfsck_thread_args_init(lfsck, com, NULL);
+		if (IS_ERR(lta))
+			break;
+
+		atomic_inc(&lad->lad_workers);
+		task = kthread_run(lfsck_assistant_worker, lta, "%s_%02d",
+				   lad->lad_name, i + 1);
+		if (IS_ERR(task)) {
+			CDEBUG(D_LFSCK, "%s: cannot start LFSCK assistant "
+			       "worker for %s: rc = %ld\n",
+			       lfsck_lfsck2name(lfsck), lad->lad_name,
+			       PTR_ERR(task));
+			atomic_dec(&lad->lad_workers);
+			lfsck_thread_args_fini(lta);
+			break;
+		}
+	}
+
+	CDEBUG(D_LFSCK, "%s: started %d LFSCK assistant workers for %s\n",
+	       lfsck_lfsck2name(lfsck), i, lad->lad_name);
+}
+
 int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 			  struct lfsck_start_param *lsp)
 {
@@ -2540,6 +2580,7 @@ int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 	lad->lad_post_result = 0;
 	lad->lad_flags = 0;
 	lad->lad_advance_lock = false;
+	atomic_set(&lad->lad_workers, 0);
 	thread_set_flags(athread, 0);
 
 	lta = lfsck_thread_args_init(lfsck, com, lsp);
@@ -2886,6 +2927,70 @@ int lfsck_set_windows(struct dt_device *key, unsigned int val)
 }
 EXPORT_SYMBOL(lfsck_set_windows);
 
+int lfsck_get_assistant_threads(char *buf, struct dt_device *key)
+{
+	struct lu_env		env;
+	struct lfsck_instance  *lfsck;
+	int			rc;
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_MD_THREAD | LCT_DT_THREAD);
+	if (rc != 0)
+		RETURN(rc);
+
+	lfsck = lfsck_instance_find(key, true, false);
+	if (likely(lfsck != NULL)) {
+		rc = sprintf(buf, "%u\n",
+			     max_t(__u16, 1,
+				   lfsck->li_bookmark_ram.lb_assistant_threads));
+		lfsck_instance_put(&env, lfsck);
+	} else {
+		rc = -ENXIO;
+	}
+
+	lu_env_fini(&env);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(lfsck_get_assistant_threads);
+
+/* The new value takes effect from the next LFSCK run. */
+int lfsck_set_assistant_threads(struct dt_device *key, unsigned int val)
+{
+	struct lu_env		env;
+	struct lfsck_instance  *lfsck;
+	int			rc;
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_MD_THREAD | LCT_DT_THREAD);
+	if (rc != 0)
+		RETURN(rc);
+
+	lfsck = lfsck_instance_find(key, true, false);
+	if (likely(lfsck != NULL)) {
+		if (val < 1 || val > LFSCK_ASSISTANT_THREADS_MAX) {
+			CWARN("%s: invalid assistant threads count, the valid "
+			      "range is [1 - %u].\n",
+			      lfsck_lfsck2name(lfsck),
+			      LFSCK_ASSISTANT_THREADS_MAX);
+			rc = -EINVAL;
+		} else if (lfsck->li_bookmark_ram.lb_assistant_threads != val) {
+			mutex_lock(&lfsck->li_mutex);
+			lfsck->li_bookmark_ram.lb_assistant_threads = val;
+			rc = lfsck_bookmark_store(&env, lfsck);
+			mutex_unlock(&lfsck->li_mutex);
+		}
+		lfsck_instance_put(&env, lfsck);
+	} else {
+		rc = -ENXIO;
+	}
+
+	lu_env_fini(&env);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(lfsck_set_assistant_threads);
+
 int lfsck_dump(struct seq_file *m, struct dt_device *key, enum lfsck_type type)
 {
 	struct lu_env		env;
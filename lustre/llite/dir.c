@@ -177,6 +177,229 @@ void ll_release_page(struct inode *inode, struct page *page,
 	put_page(page);
 }
 
+static void ll_dir_snapshot_free(struct ll_dir_snapshot *snap)
+{
+	struct ll_dir_snapshot_entry *entry;
+	struct hlist_node *next;
+	int i;
+
+	for (i = 0; i < LL_DIR_SNAP_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(entry, next, &snap->lds_hash[i],
+					  ldse_hash) {
+			hlist_del(&entry->ldse_hash);
+			OBD_FREE(entry, sizeof(*entry) + entry->ldse_namelen);
+		}
+	}
+	OBD_FREE_PTR(snap);
+}
+
+static void ll_dir_snapshot_free_rcu(struct rcu_head *head)
+{
+	ll_dir_snapshot_free(container_of(head, struct ll_dir_snapshot,
+					  lds_rcu));
+}
+
+static bool ll_dir_snapshot_find(struct ll_dir_snapshot *snap,
+				 const struct qstr *name)
+{
+	struct ll_dir_snapshot_entry *entry;
+	unsigned int hash = ll_full_name_hash(NULL, name->name, name->len);
+
+	hlist_for_each_entry(entry,
+			     &snap->lds_hash[hash & (LL_DIR_SNAP_HASH_SIZE - 1)],
+			     ldse_hash) {
+		if (entry->ldse_namehash == hash &&
+		    entry->ldse_namelen == name->len &&
+		    memcmp(entry->ldse_name, name->name, name->len) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Read all the pages of \a dir and hash the names in them. The pages are
+ * read under the dir UPDATE lock, the caller checks it was not lost since.
+ */
+static struct ll_dir_snapshot *ll_dir_snapshot_build(struct inode *dir,
+						     unsigned int max)
+{
+	struct ll_dir_snapshot *snap;
+	struct ll_dir_snapshot_entry *entry;
+	struct md_op_data *op_data;
+	struct ll_dir_chain chain;
+	struct page *page;
+	__u64 pos = 0;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR(snap);
+	if (snap == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+	for (i = 0; i < LL_DIR_SNAP_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&snap->lds_hash[i]);
+
+	op_data = ll_prep_md_op_data(NULL, dir, dir, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, dir);
+	if (IS_ERR(op_data))
+		GOTO(out_free, rc = PTR_ERR(op_data));
+
+	ll_dir_chain_init(&chain);
+	while (pos != MDS_DIR_END_OFF) {
+		struct lu_dirpage *dp;
+		struct lu_dirent *ent;
+
+		page = ll_get_dir_page(dir, op_data, pos, &chain);
+		if (IS_ERR(page))
+			GOTO(out_chain, rc = PTR_ERR(page));
+
+		dp = page_address(page);
+		for (ent = lu_dirent_start(dp); ent != NULL && rc == 0;
+		     ent = lu_dirent_next(ent)) {
+			int namelen = le16_to_cpu(ent->lde_namelen);
+
+			if (namelen == 0 || le64_to_cpu(ent->lde_hash) < pos)
+				continue;
+
+			if (snap->lds_count >= max) {
+				rc = -EFBIG;
+				break;
+			}
+
+			OBD_ALLOC(entry, sizeof(*entry) + namelen);
+			if (entry == NULL) {
+				rc = -ENOMEM;
+				break;
+			}
+			memcpy(entry->ldse_name, ent->lde_name, namelen);
+			entry->ldse_namelen = namelen;
+			entry->ldse_namehash = ll_full_name_hash(NULL,
+								 entry->ldse_name,
+								 namelen);
+			hlist_add_head(&entry->ldse_hash,
+				       &snap->lds_hash[entry->ldse_namehash &
+						       (LL_DIR_SNAP_HASH_SIZE - 1)]);
+			snap->lds_count++;
+		}
+
+		pos = le64_to_cpu(dp->ldp_hash_end);
+		ll_release_page(dir, page,
+				le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
+		if (rc)
+			GOTO(out_chain, rc);
+	}
+	EXIT;
+out_chain:
+	ll_dir_chain_fini(&chain);
+	ll_finish_md_op_data(op_data);
+out_free:
+	if (rc) {
+		ll_dir_snapshot_free(snap);
+		snap = ERR_PTR(rc);
+	}
+
+	return snap;
+}
+
+/**
+ * Check whether \a name exists in \a dir without asking the MDT. The
+ * snapshot of \a dir is built once enough negative lookups were sent to
+ * the MDT since the dir UPDATE lock was last lost.
+ *
+ * \retval 1	\a name is not in \a dir
+ * \retval 0	unknown, the MDT has to be asked
+ */
+int ll_dir_snapshot_lookup(struct inode *dir, const struct qstr *name)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	unsigned int max = ll_i2sbi(dir)->ll_dir_snap_max;
+	struct ll_dir_snapshot *snap;
+	unsigned int seq;
+	int rc = 0;
+
+	if (max == 0 || ll_dir_striped(dir))
+		return 0;
+
+	rcu_read_lock();
+	snap = rcu_dereference(lli->lli_dir_snap);
+	if (snap != NULL)
+		rc = !ll_dir_snapshot_find(snap, name);
+	rcu_read_unlock();
+	if (snap != NULL)
+		return rc;
+
+	spin_lock(&lli->lli_lock);
+	if (lli->lli_dir_snap_misses < LL_DIR_SNAP_MISSES ||
+	    lli->lli_dir_snap_building || lli->lli_dir_snap_toobig ||
+	    lli->lli_dir_snap != NULL) {
+		spin_unlock(&lli->lli_lock);
+		return 0;
+	}
+	lli->lli_dir_snap_building = 1;
+	seq = lli->lli_dir_snap_seq;
+	spin_unlock(&lli->lli_lock);
+
+	snap = ll_dir_snapshot_build(dir, max);
+
+	spin_lock(&lli->lli_lock);
+	lli->lli_dir_snap_building = 0;
+	if (seq != lli->lli_dir_snap_seq) {
+		/* the UPDATE lock was lost while reading the pages */
+		spin_unlock(&lli->lli_lock);
+		if (!IS_ERR(snap))
+			ll_dir_snapshot_free(snap);
+		return 0;
+	}
+	if (IS_ERR(snap)) {
+		if (PTR_ERR(snap) == -EFBIG)
+			lli->lli_dir_snap_toobig = 1;
+		spin_unlock(&lli->lli_lock);
+		CDEBUG(D_INODE, "%s: no snapshot of "DFID": rc = %ld\n",
+		       ll_i2sbi(dir)->ll_fsname, PFID(ll_inode2fid(dir)),
+		       PTR_ERR(snap));
+		return 0;
+	}
+	CDEBUG(D_INODE, "%s: snapshot of "DFID" with %u names\n",
+	       ll_i2sbi(dir)->ll_fsname, PFID(ll_inode2fid(dir)),
+	       snap->lds_count);
+	rcu_assign_pointer(lli->lli_dir_snap, snap);
+	rc = !ll_dir_snapshot_find(snap, name);
+	spin_unlock(&lli->lli_lock);
+
+	return rc;
+}
+
+/* a negative lookup in \a dir was sent to the MDT */
+void ll_dir_snapshot_miss(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+
+	spin_lock(&lli->lli_lock);
+	if (lli->lli_dir_snap_misses < LL_DIR_SNAP_MISSES)
+		lli->lli_dir_snap_misses++;
+	spin_unlock(&lli->lli_lock);
+}
+
+/* the UPDATE lock of \a dir is lost, drop its snapshot */
+void ll_dir_snapshot_destroy(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_dir_snapshot *snap;
+
+	spin_lock(&lli->lli_lock);
+	lli->lli_dir_snap_seq++;
+	lli->lli_dir_snap_misses = 0;
+	lli->lli_dir_snap_toobig = 0;
+	snap = lli->lli_dir_snap;
+	RCU_INIT_POINTER(lli->lli_dir_snap, NULL);
+	spin_unlock(&lli->lli_lock);
+
+	if (snap != NULL)
+		call_rcu(&snap->lds_rcu, ll_dir_snapshot_free_rcu);
+}
+
 /**
  * return IF_* type for given lu_dirent entry.
  * IF_* flag shld be converted to particular OS file type in
@@ -1678,8 +1678,8 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	 * data has been removed from the Lustre file system), at this
 	 * time, fallback to the normal read path may read the wrong
 	 * data.
-	 * TODO: for RO-PCC (readonly PCC), fall back to normal read
-	 * path: read data from data copy on OSTs.
+	 * For RO-PCC (readonly PCC), pcc_file_read_iter() falls back to
+	 * the normal read path itself: read data from data copy on OSTs.
 	 */
 	result = pcc_file_read_iter(iocb, to, &cached);
 	if (cached)
@@ -169,6 +169,15 @@ struct ll_inode_info {
 			struct lmv_stripe_md		*lli_lsm_md;
 			/* directory default LMV */
 			struct lmv_stripe_md		*lli_default_lsm_md;
+			/* names in the directory, valid while an UPDATE lock
+			 * is cached, protected by lli_lock and RCU */
+			struct ll_dir_snapshot		*lli_dir_snap;
+			/* bumped whenever the UPDATE lock is lost */
+			unsigned int			lli_dir_snap_seq;
+			/* negative lookups sent to MDT since then */
+			unsigned int			lli_dir_snap_misses;
+			unsigned int			lli_dir_snap_building:1,
+							lli_dir_snap_toobig:1;
 		};
 
 		/* for non-directory */
@@ -577,6 +586,8 @@ struct ll_sb_info {
 	unsigned int		  ll_sa_running_max;/* max concurrent
 						     * statahead instances */
 	unsigned int		  ll_sa_max;     /* max statahead RPCs */
+	unsigned int		  ll_sa_batch_max;/* max names batched in one
+						   * statahead RPC */
 	atomic_t		  ll_sa_total;   /* statahead thread started
 						  * count */
 	atomic_t		  ll_sa_wrong;   /* statahead thread stopped for
@@ -597,6 +608,9 @@ struct ll_sb_info {
 	/* maximum relative age of cached statfs results */
 	unsigned int		  ll_statfs_max_age;
 
+	/* max names in a directory snapshot, 0 to disable */
+	unsigned int		  ll_dir_snap_max;
+
 	struct kset		  ll_kset;	/* sysfs object */
 	struct completion	  ll_kobj_unregister;
 
@@ -860,6 +874,34 @@ struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 			     __u64 offset, struct ll_dir_chain *chain);
 void ll_release_page(struct inode *inode, struct page *page, bool remove);
 
+/*
+ * Snapshot of the names of a directory, built from its pages to answer
+ * negative lookups locally. It is dropped with the dir UPDATE lock.
+ */
+#define LL_DIR_SNAP_DEF		4096
+#define LL_DIR_SNAP_MAX		65536
+/* negative lookups sent to the MDT before a snapshot is built */
+#define LL_DIR_SNAP_MISSES	4
+#define LL_DIR_SNAP_HASH_BITS	8
+#define LL_DIR_SNAP_HASH_SIZE	(1 << LL_DIR_SNAP_HASH_BITS)
+
+struct ll_dir_snapshot_entry {
+	struct hlist_node	ldse_hash;
+	unsigned int		ldse_namehash;
+	int			ldse_namelen;
+	char			ldse_name[0];
+};
+
+struct ll_dir_snapshot {
+	struct rcu_head		lds_rcu;
+	unsigned int		lds_count;
+	struct hlist_head	lds_hash[LL_DIR_SNAP_HASH_SIZE];
+};
+
+int ll_dir_snapshot_lookup(struct inode *dir, const struct qstr *name);
+void ll_dir_snapshot_miss(struct inode *dir);
+void ll_dir_snapshot_destroy(struct inode *dir);
+
 /* llite/namei.c */
 extern const struct inode_operations ll_special_inode_operations;
 
@@ -995,6 +1037,8 @@ int ll_show_options(struct seq_file *seq, struct dentry *dentry);
 int ll_show_options(struct seq_file *seq, struct vfsmount *vfs);
 #endif
 void ll_dirty_page_discard_warn(struct page *page, int ioret);
+int ll_prep_inode_md(struct inode **inode, struct lustre_md *md,
+		     struct super_block *sb, struct lookup_intent *it);
 int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
 		  struct super_block *, struct lookup_intent *);
 int ll_obd_statfs(struct inode *inode, void __user *arg);
@@ -1224,6 +1268,9 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RPC_DEF           32
 #define LL_SA_RPC_MAX           512
 
+#define LL_SA_BATCH_DEF		16
+#define LL_SA_BATCH_MAX		MDS_MAX_BATCH_GETATTR
+
 /* XXX: If want to support more concurrent statahead instances,
  *	please consider to decentralize the RPC lists attached
  *	on related import, such as imp_{sending,delayed}_list.
@@ -1271,6 +1318,10 @@ struct ll_statahead_info {
 	struct list_head	sai_interim_entries; /* entries which got async
 						      * stat reply, but not
 						      * instantiated */
+	struct list_head	sai_retry_entries; /* batched entries to stat
+						    * alone */
+	struct md_enqueue_info *sai_batch;	/* stats to send in one RPC */
+	unsigned int		sai_batch_count; /* names in sai_batch */
 	struct list_head	sai_entries;    /* completed entries */
 	struct list_head	sai_agls;	/* AGLs to be sent */
 	struct list_head	sai_cache[LL_SA_CACHE_SIZE];
@@ -143,6 +143,8 @@ static struct ll_sb_info *ll_init_sbi(void)
 	/* metadata statahead is enabled by default */
 	sbi->ll_sa_running_max = LL_SA_RUNNING_DEF;
 	sbi->ll_sa_max = LL_SA_RPC_DEF;
+	sbi->ll_sa_batch_max = LL_SA_BATCH_DEF;
+	sbi->ll_dir_snap_max = LL_DIR_SNAP_DEF;
 	atomic_set(&sbi->ll_sa_total, 0);
 	atomic_set(&sbi->ll_sa_wrong, 0);
 	atomic_set(&sbi->ll_sa_running, 0);
@@ -258,7 +260,9 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				   OBD_CONNECT2_INC_XID |
 				   OBD_CONNECT2_LSOM |
 				   OBD_CONNECT2_ASYNC_DISCARD |
-				   OBD_CONNECT2_PCC;
+				   OBD_CONNECT2_PCC |
+				   OBD_CONNECT2_MULTIOBJ_BRW |
+				   OBD_CONNECT2_BATCH_GETATTR;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -466,7 +470,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 #endif
 
 	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
-				   OBD_CONNECT2_INC_XID;
+				   OBD_CONNECT2_INC_XID |
+				   OBD_CONNECT2_MULTIOBJ_BRW;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -991,6 +996,11 @@ void ll_lli_init(struct ll_inode_info *lli)
 		lli->lli_opendir_pid = 0;
 		lli->lli_sa_enabled = 0;
 		init_rwsem(&lli->lli_lsm_sem);
+		lli->lli_dir_snap = NULL;
+		lli->lli_dir_snap_seq = 0;
+		lli->lli_dir_snap_misses = 0;
+		lli->lli_dir_snap_building = 0;
+		lli->lli_dir_snap_toobig = 0;
 	} else {
 		mutex_init(&lli->lli_size_mutex);
 		lli->lli_symlink_name = NULL;
@@ -1631,10 +1641,12 @@ void ll_clear_inode(struct inode *inode)
 #endif
 	lli->lli_inode_magic = LLI_INODE_DEAD;
 
-	if (S_ISDIR(inode->i_mode))
+	if (S_ISDIR(inode->i_mode)) {
+		ll_dir_snapshot_destroy(inode);
 		ll_dir_clear_lsm_md(inode);
-	else if (S_ISREG(inode->i_mode) && !is_bad_inode(inode))
+	} else if (S_ISREG(inode->i_mode) && !is_bad_inode(inode)) {
 		LASSERT(list_empty(&lli->lli_agl_list));
+	}
 
 	/*
 	 * XXX This has to be done before lsm is freed below, because
@@ -2509,11 +2521,15 @@ void ll_open_cleanup(struct super_block *sb, struct ptlrpc_request *open_req)
 	EXIT;
 }
 
-int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
-		  struct super_block *sb, struct lookup_intent *it)
+/**
+ * Instantiate or update *\a inode from the attributes in \a md, which are
+ * freed by the caller.
+ */
+int ll_prep_inode_md(struct inode **inode, struct lustre_md *md_p,
+		     struct super_block *sb, struct lookup_intent *it)
 {
 	struct ll_sb_info *sbi = NULL;
-	struct lustre_md md = { NULL };
+	struct lustre_md md = *md_p;
 	bool default_lmv_deleted = false;
 	int rc;
 
@@ -2521,10 +2537,6 @@ int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
 
 	LASSERT(*inode || sb);
 	sbi = sb ? ll_s2sbi(sb) : ll_i2sbi(*inode);
-	rc = md_get_lustre_md(sbi->ll_md_exp, req, sbi->ll_dt_exp,
-			      sbi->ll_md_exp, &md);
-	if (rc != 0)
-		GOTO(out, rc);
 
 	/*
 	 * clear default_lmv only if intent_getattr reply doesn't contain it.
@@ -2603,6 +2615,31 @@ int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
 
 	GOTO(out, rc = 0);
 
+out:
+	*md_p = md;
+
+	return rc;
+}
+
+int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
+		  struct super_block *sb, struct lookup_intent *it)
+{
+	struct ll_sb_info *sbi = NULL;
+	struct lustre_md md = { NULL };
+	int rc;
+
+	ENTRY;
+
+	LASSERT(*inode || sb);
+	sbi = sb ? ll_s2sbi(sb) : ll_i2sbi(*inode);
+	rc = md_get_lustre_md(sbi->ll_md_exp, req, sbi->ll_dt_exp,
+			      sbi->ll_md_exp, &md);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	rc = ll_prep_inode_md(inode, &md, sb, it);
+
+	EXIT;
 out:
 	/* cleanup will be done if necessary */
 	md_free_lustre_md(sbi->ll_md_exp, &md);
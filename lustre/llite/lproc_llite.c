@@ -793,6 +793,80 @@ static ssize_t statahead_max_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_max);
 
+static ssize_t statahead_batch_max_show(struct kobject *kobj,
+					struct attribute *attr,
+					char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_sa_batch_max);
+}
+
+static ssize_t statahead_batch_max_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer,
+					 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_SA_BATCH_MAX) {
+		CERROR("Bad statahead_batch_max value %lu. Valid values are in the range [0, %d]\n",
+		       val, LL_SA_BATCH_MAX);
+		return -ERANGE;
+	}
+
+	/* 0 or 1 sends one getattr per RPC */
+	sbi->ll_sa_batch_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_batch_max);
+
+static ssize_t dir_snapshot_max_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_dir_snap_max);
+}
+
+static ssize_t dir_snapshot_max_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_DIR_SNAP_MAX) {
+		CERROR("Bad dir_snapshot_max value %lu. Valid values are in the range [0, %d]\n",
+		       val, LL_DIR_SNAP_MAX);
+		return -ERANGE;
+	}
+
+	/* 0 sends all negative lookups to the MDT */
+	sbi->ll_dir_snap_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(dir_snapshot_max);
+
 static ssize_t statahead_agl_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -1505,6 +1579,8 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_stats_track_gid.attr,
 	&lustre_attr_statahead_running_max.attr,
 	&lustre_attr_statahead_max.attr,
+	&lustre_attr_statahead_batch_max.attr,
+	&lustre_attr_dir_snapshot_max.attr,
 	&lustre_attr_statahead_agl.attr,
 	&lustre_attr_lazystatfs.attr,
 	&lustre_attr_statfs_max_age.attr,
@@ -307,6 +307,7 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 		CDEBUG(D_INODE, "invalidating inode "DFID" lli = %p, "
 		       "pfid  = "DFID"\n", PFID(ll_inode2fid(inode)),
 		       lli, PFID(&lli->lli_pfid));
+		ll_dir_snapshot_destroy(inode);
 		truncate_inode_pages(inode->i_mapping, 0);
 
 		if (unlikely(!fid_is_zero(&lli->lli_pfid))) {
@@ -699,6 +700,7 @@ static int ll_lookup_it_finish(struct ptlrpc_request *request,
 			d_lustre_revalidate(*de);
 			ll_intent_release(&parent_it);
 		}
+		ll_dir_snapshot_miss(parent);
 	}
 
 	GOTO(out, rc = 0);
@@ -754,6 +756,35 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 	    dentry->d_sb->s_flags & SB_RDONLY)
 		RETURN(ERR_PTR(-EROFS));
 
+	/* the name is not in the dir snapshot, valid under its UPDATE lock */
+	if (!(it->it_op & IT_CREAT) &&
+	    it->it_op & (IT_LOOKUP | IT_GETATTR | IT_OPEN) &&
+	    ll_dir_snapshot_lookup(parent, &dentry->d_name) == 1) {
+		struct lookup_intent parent_it = {
+					.it_op = IT_GETATTR,
+					.it_lock_handle = 0 };
+
+		/* hold the UPDATE lock so that it can't be cancelled before
+		 * the dentry is valid, as ll_lookup_it_finish() does, then
+		 * check the snapshot was not dropped in the meantime */
+		if (md_revalidate_lock(ll_i2mdexp(parent), &parent_it,
+				       &ll_i2info(parent)->lli_fid, NULL)) {
+			retval = NULL;
+			if (ll_dir_snapshot_lookup(parent,
+						   &dentry->d_name) == 1) {
+				retval = ll_splice_alias(NULL, dentry);
+				if (!IS_ERR(retval))
+					d_lustre_revalidate(retval);
+			}
+			ll_intent_release(&parent_it);
+
+			if (IS_ERR(retval))
+				RETURN(retval);
+			if (retval != NULL)
+				RETURN(retval == save ? NULL : retval);
+		}
+	}
+
 	if (it->it_op & IT_CREAT)
 		opc = LUSTRE_OPC_CREATE;
 	else
@@ -1013,6 +1044,7 @@ static int ll_atomic_open(struct inode *dir, struct dentry *dentry,
 			item.pm_projid = ll_i2info(dir)->lli_projid;
 			item.pm_name = &dentry->d_name;
 			dataset = pcc_dataset_match_get(&sbi->ll_pcc_super,
+							LU_PCC_READWRITE,
 							&item);
 			pca.pca_dataset = dataset;
 		}
@@ -82,6 +82,29 @@
  * SSDs. RO-PCC is based on the same framework as RW-PCC, expect
  * that no HSM mechanism is used.
  *
+ * Following is what will happen in different conditions for RO-PCC:
+ *
+ * > When file is being opened for read
+ *
+ * If the file matches the auto caching rule of a PCC backend with a
+ * read-only attach id (roid) and it is not cached yet, a background work
+ * item is queued to copy the file data into the local cache. The open and
+ * the reads issued meanwhile are served from OSTs as usual.
+ *
+ * > When the background fill completes
+ *
+ * If the layout generation of the file has not changed while copying,
+ * the copy is attached in readonly mode. Subsequent read-only opens are
+ * served from the local cache.
+ *
+ * > When the file is modified on any client
+ *
+ * Only the mirrored files in the FLR read-only state are cached, so any
+ * write or truncate must first change the layout state on the MDT. This
+ * revokes the layout lock on every client and invalidates all RO-PCC
+ * copies of the file; reads fall back to OSTs until the file is filled
+ * into the cache again.
+ *
  * The main advantages to use this SSD cache on the Lustre clients via PCC
  * is that:
  * - The I/O stack becomes much simpler for the cached data, as there is no
@@ -125,6 +148,12 @@ int pcc_super_init(struct pcc_super *super)
 	init_rwsem(&super->pccs_rw_sem);
 	INIT_LIST_HEAD(&super->pccs_datasets);
 
+	super->pccs_fill_wq = alloc_workqueue("ll-pcc-fill-wq", WQ_UNBOUND, 0);
+	if (!super->pccs_fill_wq) {
+		put_cred(super->pccs_cred);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -658,14 +687,21 @@ pcc_cond_match(struct pcc_match_rule *rule, struct pcc_matcher *matcher)
 }
 
 struct pcc_dataset*
-pcc_dataset_match_get(struct pcc_super *super, struct pcc_matcher *matcher)
+pcc_dataset_match_get(struct pcc_super *super, enum lu_pcc_type type,
+		      struct pcc_matcher *matcher)
 {
 	struct pcc_dataset *dataset;
 	struct pcc_dataset *selected = NULL;
 
 	down_read(&super->pccs_rw_sem);
 	list_for_each_entry(dataset, &super->pccs_datasets, pccd_linkage) {
-		if (!(dataset->pccd_flags & PCC_DATASET_RWPCC))
+		if (type == LU_PCC_READWRITE &&
+		    !(dataset->pccd_flags & PCC_DATASET_RWPCC))
+			continue;
+
+		if (type == LU_PCC_READONLY &&
+		    (dataset->pccd_roid == 0 ||
+		     !(dataset->pccd_flags & PCC_DATASET_ROPCC)))
 			continue;
 
 		if (pcc_cond_match(&dataset->pccd_rule, matcher)) {
@@ -676,8 +712,8 @@ pcc_dataset_match_get(struct pcc_super *super, struct pcc_matcher *matcher)
 	}
 	up_read(&super->pccs_rw_sem);
 	if (selected)
-		CDEBUG(D_CACHE, "PCC create, matched %s - %d:%d:%d:%s\n",
-		       dataset->pccd_rule.pmr_conds_str,
+		CDEBUG(D_CACHE, "PCC %s, matched %s - %d:%d:%d:%s\n",
+		       pcc_type2string(type), selected->pccd_rule.pmr_conds_str,
 		       matcher->pm_uid, matcher->pm_gid,
 		       matcher->pm_projid, matcher->pm_name->name);
 
@@ -762,6 +798,9 @@ pcc_dataset_get(struct pcc_super *super, enum lu_pcc_type type, __u32 id)
 		if (type == LU_PCC_READWRITE && (dataset->pccd_rwid != id ||
 		    !(dataset->pccd_flags & PCC_DATASET_RWPCC)))
 			continue;
+		if (type == LU_PCC_READONLY && (dataset->pccd_roid != id ||
+		    !(dataset->pccd_flags & PCC_DATASET_ROPCC)))
+			continue;
 		atomic_inc(&dataset->pccd_refcount);
 		selected = dataset;
 		break;
@@ -809,6 +848,7 @@ pcc_dataset_dump(struct pcc_dataset *dataset, struct seq_file *m)
 {
 	seq_printf(m, "%s:\n", dataset->pccd_pathname);
 	seq_printf(m, "  rwid: %u\n", dataset->pccd_rwid);
+	seq_printf(m, "  roid: %u\n", dataset->pccd_roid);
 	seq_printf(m, "  flags: %x\n", dataset->pccd_flags);
 	seq_printf(m, "  autocache: %s\n", dataset->pccd_rule.pmr_conds_str);
 }
@@ -841,6 +881,8 @@ static void pcc_remove_datasets(struct pcc_super *super)
 
 void pcc_super_fini(struct pcc_super *super)
 {
+	/* Wait for the RO-PCC fills in flight, they hold dataset refs */
+	destroy_workqueue(super->pccs_fill_wq);
 	pcc_remove_datasets(super);
 	put_cred(super->pccs_cred);
 }
@@ -1166,6 +1208,10 @@ static int pcc_try_dataset_attach(struct inode *inode, __u32 gen,
 	    !(dataset->pccd_flags & PCC_DATASET_RWPCC))
 		RETURN(0);
 
+	if (type == LU_PCC_READONLY &&
+	    !(dataset->pccd_flags & PCC_DATASET_ROPCC))
+		RETURN(0);
+
 	OBD_ALLOC(pathname, PATH_MAX);
 	if (pathname == NULL)
 		RETURN(-ENOMEM);
@@ -1255,7 +1301,11 @@ static int pcc_try_datasets_attach(struct inode *inode, __u32 gen,
 	RETURN(rc);
 }
 
-static int pcc_try_open_attach(struct inode *inode, bool *cached)
+static void pcc_readonly_fill_try(struct inode *inode, struct file *file,
+				  __u32 gen);
+
+static int pcc_try_open_attach(struct inode *inode, struct file *file,
+			       bool *cached)
 {
 	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
 	struct cl_layout clt = {
@@ -1284,9 +1334,19 @@ static int pcc_try_open_attach(struct inode *inode, bool *cached)
 	if (rc)
 		RETURN(rc);
 
-	if (clt.cl_is_released)
+	if (clt.cl_is_released) {
 		rc = pcc_try_datasets_attach(inode, clt.cl_layout_gen,
 					     LU_PCC_READWRITE, cached);
+	} else if (clt.cl_flr_state == LCM_FL_RDONLY) {
+		/*
+		 * Any write to a mirrored file in read-only state changes its
+		 * layout first, so the layout lock protects RO-PCC copies.
+		 */
+		rc = pcc_try_datasets_attach(inode, clt.cl_layout_gen,
+					     LU_PCC_READONLY, cached);
+		if (!rc && !*cached && !ll_i2pcci(inode))
+			pcc_readonly_fill_try(inode, file, clt.cl_layout_gen);
+	}
 
 	RETURN(rc);
 }
@@ -1315,7 +1375,7 @@ int pcc_file_open(struct inode *inode, struct file *file)
 		GOTO(out_unlock, rc = 0);
 
 	if (!pcci || !pcc_inode_has_layout(pcci)) {
-		rc = pcc_try_open_attach(inode, &cached);
+		rc = pcc_try_open_attach(inode, file, &cached);
 		if (rc < 0 || !cached)
 			GOTO(out_unlock, rc);
 
@@ -1323,6 +1383,11 @@ int pcc_file_open(struct inode *inode, struct file *file)
 			pcci = ll_i2pcci(inode);
 	}
 
+	/* Writers go to OSTs, which will invalidate the RO-PCC copy */
+	if (pcci->pcci_type == LU_PCC_READONLY &&
+	    (file->f_flags & O_ACCMODE) != O_RDONLY)
+		GOTO(out_unlock, rc = 0);
+
 	pcc_inode_get(pcci);
 	WARN_ON(pccf->pccf_file);
 
@@ -1472,6 +1537,14 @@ ssize_t pcc_file_read_iter(struct kiocb *iocb,
 	result = __pcc_file_read_iter(iocb, iter);
 	iocb->ki_filp = file;
 
+	/* RO-PCC copy is clean, fall back to read the data from OSTs */
+	if (result < 0 && pccf->pccf_type == LU_PCC_READONLY) {
+		CDEBUG(D_CACHE, DFID" RO-PCC read failed, fall back: rc = %zd\n",
+		       PFID(&ll_i2info(inode)->lli_fid), result);
+		*cached = false;
+		result = 0;
+	}
+
 	pcc_io_fini(inode);
 	RETURN(result);
 }
@@ -1572,10 +1645,17 @@ int pcc_inode_setattr(struct inode *inode, struct iattr *attr,
 	if (!*cached)
 		RETURN(0);
 
+	pcci = ll_i2pcci(inode);
+	/* Attributes of RO-PCC files are always changed on Lustre */
+	if (pcci->pcci_type == LU_PCC_READONLY) {
+		pcc_io_fini(inode);
+		*cached = false;
+		RETURN(0);
+	}
+
 	attr2.ia_valid = attr->ia_valid & (ATTR_SIZE | ATTR_ATIME |
 			 ATTR_ATIME_SET | ATTR_MTIME | ATTR_MTIME_SET |
 			 ATTR_CTIME | ATTR_UID | ATTR_GID);
-	pcci = ll_i2pcci(inode);
 	pcc_dentry = pcci->pcci_path.dentry;
 	inode_lock(pcc_dentry->d_inode);
 	old_cred = override_creds(pcc_super_cred(inode->i_sb));
@@ -1608,6 +1688,13 @@ int pcc_inode_getattr(struct inode *inode, bool *cached)
 	if (!*cached)
 		RETURN(0);
 
+	/* i_blocks of RO-PCC files must come from OSTs */
+	if (ll_i2pcci(inode)->pcci_type == LU_PCC_READONLY) {
+		pcc_io_fini(inode);
+		*cached = false;
+		RETURN(0);
+	}
+
 	old_cred = override_creds(pcc_super_cred(inode->i_sb));
 	rc = ll_vfs_getattr(&ll_i2pcci(inode)->pcci_path, &stat);
 	revert_creds(old_cred);
@@ -2363,6 +2450,152 @@ out_unlock:
 	RETURN(rc);
 }
 
+static void pcc_readonly_fill_work(struct work_struct *wq)
+{
+	struct pcc_fill_work *work = container_of(wq, struct pcc_fill_work,
+						  pfw_work);
+	struct pcc_dataset *dataset = work->pfw_dataset;
+	struct file *file = work->pfw_file;
+	struct inode *inode = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	__u32 gen = work->pfw_layout_gen;
+	const struct cred *old_cred;
+	struct pcc_inode *pcci;
+	struct dentry *dentry;
+	struct file *pcc_filp;
+	struct path path;
+	__u32 gen2;
+	int rc;
+
+	ENTRY;
+
+	old_cred = override_creds(pcc_super_cred(inode->i_sb));
+	rc = __pcc_inode_create(dataset, &lli->lli_fid, &dentry);
+	if (rc)
+		GOTO(out_attaching, rc);
+
+	path.mnt = dataset->pccd_path.mnt;
+	path.dentry = dentry;
+#ifdef HAVE_DENTRY_OPEN_USE_PATH
+	pcc_filp = dentry_open(&path, O_TRUNC | O_WRONLY | O_LARGEFILE,
+			       current_cred());
+#else
+	pcc_filp = dentry_open(path.dentry, path.mnt,
+			       O_TRUNC | O_WRONLY | O_LARGEFILE,
+			       current_cred());
+#endif
+	if (IS_ERR_OR_NULL(pcc_filp))
+		GOTO(out_dentry, rc = pcc_filp == NULL ? -EINVAL :
+					PTR_ERR(pcc_filp));
+
+	rc = pcc_inode_store_ugpid(dentry, inode->i_uid, inode->i_gid);
+	if (rc)
+		GOTO(out_fput, rc);
+
+	rc = pcc_copy_data(file, pcc_filp);
+	if (rc)
+		GOTO(out_fput, rc);
+
+	pcc_inode_lock(inode);
+	/* Any write while copying changes the layout of the file */
+	rc = ll_layout_refresh(inode, &gen2);
+	if (!rc && gen2 != gen) {
+		CDEBUG(D_CACHE, DFID" layout changed from %d to %d.\n",
+		       PFID(&lli->lli_fid), gen, gen2);
+		rc = -ESTALE;
+	}
+	if (rc)
+		GOTO(out_unlock, rc);
+
+	pcci = ll_i2pcci(inode);
+	LASSERT(!pcci);
+	OBD_SLAB_ALLOC_PTR_GFP(pcci, pcc_inode_slab, GFP_NOFS);
+	if (pcci == NULL)
+		GOTO(out_unlock, rc = -ENOMEM);
+
+	pcc_inode_init(pcci, lli);
+	pcc_inode_attach_init(dataset, pcci, dentry, LU_PCC_READONLY);
+	rc = pcc_layout_xattr_set(pcci, gen);
+	if (rc) {
+		(void) pcc_inode_remove(inode, pcci->pcci_path.dentry);
+		pcc_inode_put(pcci);
+		pcc_inode_unlock(inode);
+		fput(pcc_filp);
+		GOTO(out_attaching, rc);
+	}
+
+	pcc_layout_gen_set(pcci, gen);
+	CDEBUG(D_CACHE, DFID" RO-PCC filled with L.Gen %d\n",
+	       PFID(&lli->lli_fid), gen);
+out_unlock:
+	pcc_inode_unlock(inode);
+out_fput:
+	fput(pcc_filp);
+out_dentry:
+	if (rc) {
+		(void) pcc_inode_remove(inode, dentry);
+		dput(dentry);
+	}
+out_attaching:
+	revert_creds(old_cred);
+	if (rc)
+		CDEBUG(D_CACHE, DFID" RO-PCC fill failed: rc = %d\n",
+		       PFID(&lli->lli_fid), rc);
+
+	pcc_inode_lock(inode);
+	lli->lli_pcc_state &= ~PCC_STATE_FL_ATTACHING;
+	pcc_inode_unlock(inode);
+
+	pcc_dataset_put(dataset);
+	fput(file);
+	OBD_FREE_PTR(work);
+	EXIT;
+}
+
+/*
+ * Queue a background copy of a file opened for read into the first PCC
+ * backend whose RO-PCC rule matches it.
+ * Must be called with pcc inode lock held.
+ */
+static void pcc_readonly_fill_try(struct inode *inode, struct file *file,
+				  __u32 gen)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	struct pcc_fill_work *work;
+	struct pcc_dataset *dataset;
+	struct pcc_matcher item;
+
+	ENTRY;
+
+	if ((file->f_flags & O_ACCMODE) != O_RDONLY ||
+	    file->f_flags & O_DIRECT)
+		RETURN_EXIT;
+
+	item.pm_uid = from_kuid(&init_user_ns, inode->i_uid);
+	item.pm_gid = from_kgid(&init_user_ns, inode->i_gid);
+	item.pm_projid = lli->lli_projid;
+	item.pm_name = &file_dentry(file)->d_name;
+	dataset = pcc_dataset_match_get(super, LU_PCC_READONLY, &item);
+	if (dataset == NULL)
+		RETURN_EXIT;
+
+	OBD_ALLOC_PTR(work);
+	if (work == NULL) {
+		pcc_dataset_put(dataset);
+		RETURN_EXIT;
+	}
+
+	work->pfw_file = get_file(file);
+	work->pfw_dataset = dataset;
+	work->pfw_layout_gen = gen;
+	lli->lli_pcc_state |= PCC_STATE_FL_ATTACHING;
+
+	INIT_WORK(&work->pfw_work, pcc_readonly_fill_work);
+	queue_work(super->pccs_fill_wq, &work->pfw_work);
+	EXIT;
+}
+
 static int pcc_hsm_remove(struct inode *inode)
 {
 	struct hsm_user_request *hur;
@@ -2427,6 +2660,18 @@ int pcc_ioctl_detach(struct inode *inode, __u32 opt)
 			hsm_remove = true;
 
 		__pcc_layout_invalidate(pcci);
+		pcc_inode_put(pcci);
+	} else if (pcci->pcci_type == LU_PCC_READONLY) {
+		__pcc_layout_invalidate(pcci);
+
+		if (opt == PCC_DETACH_OPT_UNCACHE) {
+			const struct cred *old_cred;
+
+			old_cred = override_creds(pcc_super_cred(inode->i_sb));
+			(void) pcc_inode_remove(inode, pcci->pcci_path.dentry);
+			revert_creds(old_cred);
+		}
+
 		pcc_inode_put(pcci);
 	}
 
@@ -36,6 +36,7 @@
 #include <linux/fs.h>
 #include <linux/seq_file.h>
 #include <linux/mm.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/lustre/lustre_user.h>
 
 extern struct kmem_cache *pcc_inode_slab;
@@ -120,6 +121,8 @@ struct pcc_super {
 	struct list_head	 pccs_datasets;
 	/* creds of process who forced instantiation of super block */
 	const struct cred	*pccs_cred;
+	/* Workqueue filling RO-PCC copies in the background */
+	struct workqueue_struct	*pccs_fill_wq;
 };
 
 struct pcc_inode {
@@ -146,6 +149,17 @@ struct pcc_inode {
 	wait_queue_head_t	 pcci_waitq;
 };
 
+/* Asynchronous RO-PCC fill of a Lustre file into a PCC backend */
+struct pcc_fill_work {
+	struct work_struct	 pfw_work;
+	/* Lustre file the data is copied from, with a reference held */
+	struct file		*pfw_file;
+	/* PCC backend the copy is stored in */
+	struct pcc_dataset	*pfw_dataset;
+	/* Layout generation the copy is valid for */
+	__u32			 pfw_layout_gen;
+};
+
 struct pcc_file {
 	/* Opened cache file */
 	struct file		*pccf_file;
@@ -214,6 +228,7 @@ int pcc_inode_create(struct super_block *sb, struct pcc_dataset *dataset,
 int pcc_inode_create_fini(struct pcc_dataset *dataset, struct inode *inode,
 			   struct dentry *pcc_dentry);
 struct pcc_dataset *pcc_dataset_match_get(struct pcc_super *super,
+					  enum lu_pcc_type type,
 					  struct pcc_matcher *matcher);
 void pcc_dataset_put(struct pcc_dataset *dataset);
 void pcc_inode_free(struct inode *inode);
@@ -80,6 +80,9 @@ struct sa_entry {
 	struct qstr		se_qstr;
 	/* entry fid */
 	struct lu_fid		se_fid;
+	/* stat is batched in the RPC of another entry, or must not be */
+	unsigned int		se_batched:1,
+				se_nobatch:1;
 };
 
 static unsigned int sai_generation = 0;
@@ -144,10 +147,11 @@ static inline int sa_sent_full(struct ll_statahead_info *sai)
 	return atomic_read(&sai->sai_cache_count) >= sai->sai_max;
 }
 
-/* got async stat replies */
+/* got async stat replies, or batched stats to resend */
 static inline int sa_has_callback(struct ll_statahead_info *sai)
 {
-	return !list_empty(&sai->sai_interim_entries);
+	return !list_empty(&sai->sai_interim_entries) ||
+	       !list_empty(&sai->sai_retry_entries);
 }
 
 static inline int agl_list_empty(struct ll_statahead_info *sai)
@@ -371,6 +375,7 @@ sa_prep_data(struct inode *dir, struct inode *child, struct sa_entry *entry)
 		op_data->op_fid2 = entry->se_fid;
 
 	minfo->mi_it.it_op = IT_GETATTR;
+	INIT_LIST_HEAD(&minfo->mi_batch);
 	minfo->mi_dir = igrab(dir);
 	minfo->mi_cb = ll_statahead_interpret;
 	minfo->mi_cbdata = entry;
@@ -468,6 +473,7 @@ static struct ll_statahead_info *ll_sai_alloc(struct dentry *dentry)
 	init_waitqueue_head(&sai->sai_agl_thread.t_ctl_waitq);
 
 	INIT_LIST_HEAD(&sai->sai_interim_entries);
+	INIT_LIST_HEAD(&sai->sai_retry_entries);
 	INIT_LIST_HEAD(&sai->sai_entries);
 	INIT_LIST_HEAD(&sai->sai_agls);
 
@@ -607,6 +613,9 @@ static void ll_agl_trigger(struct inode *inode, struct ll_statahead_info *sai)
         CDEBUG(D_READA, "Handling (init) async glimpse: inode = "
 	       DFID", idx = %llu\n", PFID(&lli->lli_fid), index);
 
+	/* AGL is not batched like the statahead getattrs: the glimpses go to
+	 * the OSTs of the file, one DLM enqueue per stripe, and they are
+	 * already CEF_NONBLOCK, so this thread does not wait for them. */
         cl_agl(inode);
         lli->lli_agl_index = 0;
 	lli->lli_glimpse_time = ktime_get();
@@ -642,7 +651,10 @@ static void sa_instantiate(struct ll_statahead_info *sai,
 	minfo = entry->se_minfo;
 	it = &minfo->mi_it;
 	req = entry->se_req;
-	body = req_capsule_server_get(&req->rq_pill, &RMF_MDT_BODY);
+	/* a batched stat is not replied in RMF_MDT_BODY */
+	body = minfo->mi_body;
+	if (body == NULL)
+		body = req_capsule_server_get(&req->rq_pill, &RMF_MDT_BODY);
 	if (body == NULL)
 		GOTO(out, rc = -EFAULT);
 
@@ -662,7 +674,16 @@ static void sa_instantiate(struct ll_statahead_info *sai,
 	if (rc != 1)
 		GOTO(out, rc = -EAGAIN);
 
-	rc = ll_prep_inode(&child, req, dir->i_sb, it);
+	if (minfo->mi_body != NULL) {
+		struct lustre_md md = {
+			.body = minfo->mi_body,
+			.layout = minfo->mi_layout,
+		};
+
+		rc = ll_prep_inode_md(&child, &md, dir->i_sb, it);
+	} else {
+		rc = ll_prep_inode(&child, req, dir->i_sb, it);
+	}
 	if (rc)
 		GOTO(out, rc);
 
@@ -685,17 +706,23 @@ out:
 	sa_make_ready(sai, entry, rc);
 }
 
-/* once there are async stat replies, instantiate sa_entry from replies */
+static int sa_lookup(struct inode *dir, struct sa_entry *entry);
+
+/*
+ * once there are async stat replies, instantiate sa_entry from replies, and
+ * resend the batched stats the MDT did not handle.
+ */
 static void sa_handle_callback(struct ll_statahead_info *sai)
 {
+	struct inode *dir = sai->sai_dentry->d_inode;
 	struct ll_inode_info *lli;
+	struct sa_entry *entry;
+	int rc;
 
-	lli = ll_i2info(sai->sai_dentry->d_inode);
+	lli = ll_i2info(dir);
 
 	spin_lock(&lli->lli_sa_lock);
-	while (sa_has_callback(sai)) {
-		struct sa_entry *entry;
-
+	while (!list_empty(&sai->sai_interim_entries)) {
 		entry = list_entry(sai->sai_interim_entries.next,
 				   struct sa_entry, se_list);
 		list_del_init(&entry->se_list);
@@ -704,6 +731,23 @@ static void sa_handle_callback(struct ll_statahead_info *sai)
 		sa_instantiate(sai, entry);
 		spin_lock(&lli->lli_sa_lock);
 	}
+
+	while (!list_empty(&sai->sai_retry_entries)) {
+		entry = list_entry(sai->sai_retry_entries.next,
+				   struct sa_entry, se_list);
+		list_del_init(&entry->se_list);
+		spin_unlock(&lli->lli_sa_lock);
+
+		/* no new RPC once inflight RPCs are drained at exit */
+		rc = -EAGAIN;
+		if (thread_is_running(&sai->sai_thread))
+			rc = sa_lookup(dir, entry);
+		if (rc != 0)
+			sa_make_ready(sai, entry, rc);
+		else
+			sai->sai_sent++;
+		spin_lock(&lli->lli_sa_lock);
+	}
 	spin_unlock(&lli->lli_sa_lock);
 }
 
@@ -736,6 +780,22 @@ static int ll_statahead_interpret(struct ptlrpc_request *req,
 	CDEBUG(D_READA, "sa_entry %.*s rc %d\n",
 	       entry->se_qstr.len, entry->se_qstr.name, rc);
 
+	/* the MDT did not stat this name with the batch, send it alone */
+	if (rc != 0 && rc != -ENOENT && rc != -EREMOTE && entry->se_batched) {
+		entry->se_batched = 0;
+		entry->se_nobatch = 1;
+		ll_intent_release(it);
+		sa_fini_data(minfo);
+
+		spin_lock(&lli->lli_sa_lock);
+		list_add_tail(&entry->se_list, &sai->sai_retry_entries);
+		sai->sai_replied++;
+		wake_up(&sai->sai_thread.t_ctl_waitq);
+		spin_unlock(&lli->lli_sa_lock);
+
+		RETURN(rc);
+	}
+
 	if (rc != 0) {
 		ll_intent_release(it);
 		sa_fini_data(minfo);
@@ -775,6 +835,52 @@ static int ll_statahead_interpret(struct ptlrpc_request *req,
 	RETURN(rc);
 }
 
+/* send the stats batched by sa_batch_add() */
+static void sa_batch_flush(struct ll_statahead_info *sai)
+{
+	struct md_enqueue_info *minfo = sai->sai_batch;
+	int rc;
+
+	if (minfo == NULL)
+		return;
+
+	sai->sai_batch = NULL;
+	sai->sai_batch_count = 0;
+
+	/* the batched names are called back even on failure */
+	rc = md_intent_getattr_async(ll_i2mdexp(minfo->mi_dir), minfo);
+	if (rc < 0)
+		ll_statahead_interpret(NULL, minfo, rc);
+}
+
+/*
+ * Queue the stat of \a minfo to be sent in one RPC with the other names of
+ * the directory, return false if it should be sent alone.
+ */
+static bool sa_batch_add(struct inode *dir, struct md_enqueue_info *minfo)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ll_statahead_info *sai = ll_i2info(dir)->lli_sai;
+	struct sa_entry *entry = minfo->mi_cbdata;
+
+	if (sbi->ll_sa_batch_max < 2 || entry->se_nobatch ||
+	    !(exp_connect_flags2(sbi->ll_md_exp) & OBD_CONNECT2_BATCH_GETATTR) ||
+	    ll_dir_striped(dir))
+		return false;
+
+	if (sai->sai_batch == NULL) {
+		sai->sai_batch = minfo;
+	} else {
+		entry->se_batched = 1;
+		list_add_tail(&minfo->mi_batch, &sai->sai_batch->mi_batch);
+	}
+
+	if (++sai->sai_batch_count >= sbi->ll_sa_batch_max)
+		sa_batch_flush(sai);
+
+	return true;
+}
+
 /* async stat for file not found in dcache */
 static int sa_lookup(struct inode *dir, struct sa_entry *entry)
 {
@@ -786,6 +892,9 @@ static int sa_lookup(struct inode *dir, struct sa_entry *entry)
 	if (IS_ERR(minfo))
 		RETURN(PTR_ERR(minfo));
 
+	if (sa_batch_add(dir, minfo))
+		RETURN(0);
+
 	rc = md_intent_getattr_async(ll_i2mdexp(dir), minfo);
 	if (rc < 0)
 		sa_fini_data(minfo);
@@ -1099,6 +1208,8 @@ static int ll_statahead_thread(void *arg)
 
 			/* wait for spare statahead window */
 			do {
+				if (sa_sent_full(sai))
+					sa_batch_flush(sai);
 				l_wait_event(sa_thread->t_ctl_waitq,
 					     !sa_sent_full(sai) ||
 					     sa_has_callback(sai) ||
@@ -1129,6 +1240,9 @@ static int ll_statahead_thread(void *arg)
 			sa_statahead(parent, name, namelen, &fid);
 		}
 
+		/* don't hold batched stats while reading the next page */
+		sa_batch_flush(sai);
+
 		pos = le64_to_cpu(dp->ldp_hash_end);
 		ll_release_page(dir, page,
 				le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
@@ -1585,7 +1585,7 @@ static struct lu_tgt_desc *lmv_locate_tgt_qos(struct lmv_obd *lmv, __u32 *mdt)
 			continue;
 
 		tgt->ltd_qos.ltq_usable = 1;
-		lqos_calc_weight(tgt);
+		lqos_calc_weight(&lmv->lmv_qos, tgt);
 		total_weight += tgt->ltd_qos.ltq_weight;
 	}
 
@@ -3453,39 +3453,72 @@ int lmv_clear_open_replay_data(struct obd_export *exp,
 	RETURN(md_clear_open_replay_data(tgt->ltd_exp, och));
 }
 
+/* fail the names batched with \a minfo, see mdc_intent_getattr_async() */
+static void lmv_batch_getattr_abort(struct md_enqueue_info *minfo, int rc)
+{
+	struct md_enqueue_info *extra;
+	struct md_enqueue_info *next;
+
+	list_for_each_entry_safe(extra, next, &minfo->mi_batch, mi_batch) {
+		list_del_init(&extra->mi_batch);
+		extra->mi_cb(NULL, extra, rc);
+	}
+}
+
 int lmv_intent_getattr_async(struct obd_export *exp,
 			     struct md_enqueue_info *minfo)
 {
 	struct md_op_data *op_data = &minfo->mi_data;
 	struct obd_device *obd = exp->exp_obd;
 	struct lmv_obd *lmv = &obd->u.lmv;
+	struct md_enqueue_info *extra;
+	struct md_enqueue_info *next;
 	struct lmv_tgt_desc *ptgt;
 	struct lmv_tgt_desc *ctgt;
+	struct lmv_tgt_desc *tgt;
 	int rc;
 
 	ENTRY;
 
 	if (!fid_is_sane(&op_data->op_fid2))
-		RETURN(-EINVAL);
+		GOTO(out_batch, rc = -EINVAL);
 
 	ptgt = lmv_locate_tgt(lmv, op_data);
 	if (IS_ERR(ptgt))
-		RETURN(PTR_ERR(ptgt));
+		GOTO(out_batch, rc = PTR_ERR(ptgt));
 
 	ctgt = lmv_fid2tgt(lmv, &op_data->op_fid1);
 	if (IS_ERR(ctgt))
-		RETURN(PTR_ERR(ctgt));
+		GOTO(out_batch, rc = PTR_ERR(ctgt));
 
 	/*
 	 * remote object needs two RPCs to lookup and getattr, considering the
 	 * complexity don't support statahead for now.
 	 */
 	if (ctgt != ptgt)
-		RETURN(-EREMOTE);
+		GOTO(out_batch, rc = -EREMOTE);
+
+	/* batched names must be handled by the same MDT */
+	list_for_each_entry_safe(extra, next, &minfo->mi_batch, mi_batch) {
+		if (fid_is_sane(&extra->mi_data.op_fid2)) {
+			tgt = lmv_locate_tgt(lmv, &extra->mi_data);
+			if (tgt == ptgt)
+				continue;
+			rc = IS_ERR(tgt) ? PTR_ERR(tgt) : -EREMOTE;
+		} else {
+			rc = -EINVAL;
+		}
+		list_del_init(&extra->mi_batch);
+		extra->mi_cb(NULL, extra, rc);
+	}
 
 	rc = md_intent_getattr_async(ptgt->ltd_exp, minfo);
 
 	RETURN(rc);
+
+out_batch:
+	lmv_batch_getattr_abort(minfo, rc);
+	RETURN(rc);
 }
 
 int lmv_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
@@ -1782,7 +1782,7 @@ static struct lu_device *lod_device_free(const struct lu_env *env,
 	ENTRY;
 
 	if (atomic_read(&lu->ld_ref) > 0 &&
-	    !cfs_hash_is_empty(lu->ld_site->ls_obj_hash)) {
+	    !lu_site_is_empty(lu->ld_site)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_ERROR, NULL);
 		lu_site_print(env, lu->ld_site, &msgdata, lu_cdebug_printer);
 	}
@@ -1980,6 +1980,13 @@ static void lod_key_fini(const struct lu_context *ctx,
 		OBD_FREE(info->lti_comp_idx,
 			 info->lti_comp_size * sizeof(u32));
 
+	if (info->lti_qos_size > 0) {
+		OBD_FREE_LARGE(info->lti_qos_tree,
+			       (info->lti_qos_size * 2 + 1) * sizeof(__u64));
+		OBD_FREE_LARGE(info->lti_qos_idx,
+			       info->lti_qos_size * 2 * sizeof(__u32));
+	}
+
 	lod_avoid_guide_fini(&info->lti_avoid);
 
 	OBD_FREE_PTR(info);
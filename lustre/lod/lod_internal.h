@@ -88,6 +88,22 @@ struct lod_avoid_guide {
 	__u32			lag_ost_avail;
 };
 
+/*
+ * Fenwick tree of the QoS weights of all the OSTs, indexed by OST index + 1.
+ * It is rebuilt under lq_rw_sem held for write, and updated by the creates
+ * under lq_rw_sem held for read and lqt_lock, see lod_alloc_qos().
+ */
+struct lod_qos_tree {
+	spinlock_t		 lqt_lock;
+	__u64			*lqt_tree;
+	__u64			*lqt_weight;	/* weight in the tree per OST */
+	__u64			 lqt_total;	/* total weight in the tree */
+	__u32			 lqt_size;	/* number of OST slots */
+	__u32			 lqt_good;	/* OSTs usable at rebuild */
+	__u64			 lqt_seq;	/* lq_alloc_seq at rebuild */
+	bool			 lqt_valid;
+};
+
 struct lod_device {
 	struct dt_device      lod_dt_dev;
 	struct obd_export    *lod_child_exp;
@@ -124,6 +140,7 @@ struct lod_device {
 	 */
 	/* QoS info per LOD */
 	struct lu_qos	      lod_qos; /* qos info per lod */
+	struct lod_qos_tree   lod_qos_tree; /* weights of all the OSTs */
 
 	/* OST pool data */
 	struct ost_pool		lod_pool_info; /* all OSTs in a packed array */
@@ -375,6 +392,12 @@ struct lod_thread_info {
 	struct lu_attr			lti_layout_attr;
 	/* object allocation avoid guide info */
 	struct lod_avoid_guide		lti_avoid;
+	/* QoS allocation: Fenwick tree of the candidate OST weights followed
+	 * by the weights, and the candidate OST indices followed by the
+	 * rejected ones, see lod_alloc_qos() */
+	__u64				*lti_qos_tree;
+	__u32				*lti_qos_idx;
+	__u32				lti_qos_size;
 };
 
 extern const struct lu_device_operations lod_lu_ops;
@@ -677,6 +700,7 @@ __u16 lod_comp_entry_stripe_count(struct lod_object *lo,
 __u16 lod_get_stripe_count(struct lod_device *lod, struct lod_object *lo,
 			   __u16 stripe_count, bool overstriping);
 void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod);
+void lod_qos_tree_fini(struct lod_qos_tree *lqt);
 
 /* lproc_lod.c */
 int lod_procfs_init(struct lod_device *lod);
@@ -213,7 +213,9 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_VERSION |
 					   OBD_CONNECT_PINGLESS |
 					   OBD_CONNECT_LFSCK |
-					   OBD_CONNECT_BULK_MBITS;
+					   OBD_CONNECT_BULK_MBITS |
+					   OBD_CONNECT_FLAGS2;
+		data->ocd_connect_flags2 = OBD_CONNECT2_BATCH_DESTROY;
 
 		data->ocd_group = tgt_index;
 		ltd = &lod->lod_ost_descs;
@@ -2107,6 +2109,7 @@ int lod_pools_init(struct lod_device *lod, struct lustre_cfg *lcfg)
 	/* Set up allocation policy (QoS and RR) */
 	INIT_LIST_HEAD(&lod->lod_qos.lq_svr_list);
 	init_rwsem(&lod->lod_qos.lq_rw_sem);
+	spin_lock_init(&lod->lod_qos_tree.lqt_lock);
 	lod->lod_qos.lq_dirty = 1;
 	lod->lod_qos.lq_reset = 1;
 	/* Default priority is toward free space balance */
@@ -2171,6 +2174,7 @@ int lod_pools_fini(struct lod_device *lod)
 	cfs_hash_putref(lod->lod_pools_hash_body);
 	lod_ost_pool_free(&(lod->lod_qos.lq_rr.lqr_pool));
 	lod_ost_pool_free(&lod->lod_pool_info);
+	lod_qos_tree_fini(&lod->lod_qos_tree);
 
 	RETURN(0);
 }
@@ -1122,6 +1122,420 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Make sure the per-thread QoS candidate buffers can hold \a count OSTs.
+ *
+ * \param[in] info	LOD thread info
+ * \param[in] count	number of candidate OSTs
+ *
+ * \retval 0		on success
+ * \retval -ENOMEM	on allocation failure
+ */
+static int lod_qos_tree_resize(struct lod_thread_info *info, __u32 count)
+{
+	__u64 *tree;
+	__u32 *idx;
+	__u32 size;
+
+	if (count <= info->lti_qos_size)
+		return 0;
+
+	size = roundup_pow_of_two(count);
+	OBD_ALLOC_LARGE(tree, (size * 2 + 1) * sizeof(*tree));
+	if (tree == NULL)
+		return -ENOMEM;
+	OBD_ALLOC_LARGE(idx, size * 2 * sizeof(*idx));
+	if (idx == NULL) {
+		OBD_FREE_LARGE(tree, (size * 2 + 1) * sizeof(*tree));
+		return -ENOMEM;
+	}
+
+	if (info->lti_qos_size > 0) {
+		OBD_FREE_LARGE(info->lti_qos_tree,
+			       (info->lti_qos_size * 2 + 1) * sizeof(*tree));
+		OBD_FREE_LARGE(info->lti_qos_idx,
+			       info->lti_qos_size * 2 * sizeof(*idx));
+	}
+	info->lti_qos_tree = tree;
+	info->lti_qos_idx = idx;
+	info->lti_qos_size = size;
+
+	return 0;
+}
+
+/*
+ * The weights of the QoS candidates are kept in a Fenwick tree (1-based,
+ * tree[i] holds the sum of the weights in (i - lowbit(i), i]), so that a
+ * weighted random pick and taking a picked OST out of the draw are both
+ * O(log N) instead of a walk over all the OSTs of the pool.
+ */
+static void lod_qos_tree_build(__u64 *tree, __u32 count)
+{
+	__u32 i, j;
+
+	for (i = 1; i <= count; i++) {
+		j = i + (i & -i);
+		if (j <= count)
+			tree[j] += tree[i];
+	}
+}
+
+static void lod_qos_tree_add(__u64 *tree, __u32 count, __u32 pos, __u64 wt)
+{
+	for (; pos <= count; pos += pos & -pos)
+		tree[pos] += wt;
+}
+
+static void lod_qos_tree_sub(__u64 *tree, __u32 count, __u32 pos, __u64 wt)
+{
+	for (; pos <= count; pos += pos & -pos)
+		tree[pos] -= wt;
+}
+
+/* find the first position where the sum of the weights exceeds \a rand */
+static __u32 lod_qos_tree_find(__u64 *tree, __u32 count, __u64 rand)
+{
+	__u32 pos = 0;
+	__u32 step;
+
+	for (step = rounddown_pow_of_two(count); step > 0; step >>= 1) {
+		if (pos + step <= count && tree[pos + step] <= rand) {
+			pos += step;
+			rand -= tree[pos];
+		}
+	}
+
+	return pos + 1;
+}
+
+/* the penalties decay is applied to the QoS tree in this many steps per
+ * ld_active_tgt_count allocations, see lod_qos_tree_stale() */
+#define LOD_QOS_DECAY_STEPS	8
+/* OSTs drawn from the QoS tree which can't be used for the object before
+ * lod_alloc_qos() falls back to a tree of the candidates */
+#define LOD_QOS_MAX_REJECTS	16
+/* candidate OST out of the draw of lod_alloc_qos() */
+#define LOD_QOS_EXCLUDED	0x80000000U
+
+/**
+ * Free the QoS tree of all the OSTs.
+ *
+ * \param[in] lqt	QoS tree
+ */
+void lod_qos_tree_fini(struct lod_qos_tree *lqt)
+{
+	if (lqt->lqt_size == 0)
+		return;
+
+	OBD_FREE_LARGE(lqt->lqt_tree, (lqt->lqt_size + 1) * sizeof(__u64));
+	OBD_FREE_LARGE(lqt->lqt_weight, lqt->lqt_size * sizeof(__u64));
+	lqt->lqt_tree = NULL;
+	lqt->lqt_weight = NULL;
+	lqt->lqt_size = 0;
+	lqt->lqt_valid = false;
+}
+
+/**
+ * Check whether the QoS tree has to be rebuilt.
+ *
+ * This is the case when the penalties have to be recalculated, when OSTs
+ * were added, and when the penalties of the OSTs not used since the last
+ * rebuild have decayed by 1/LOD_QOS_DECAY_STEPS of the maximum penalty,
+ * but not before at least two objects were allocated from the tree.
+ *
+ * \param[in] lod	LOD device
+ *
+ * \retval true		the tree has to be rebuilt
+ * \retval false	the tree can be used as is
+ */
+static bool lod_qos_tree_stale(struct lod_device *lod)
+{
+	struct lod_qos_tree *lqt = &lod->lod_qos_tree;
+
+	/* with fewer than LOD_QOS_DECAY_STEPS OSTs, still let a few objects
+	 * be allocated from the tree instead of rebuilding it every time */
+	return !lqt->lqt_valid || lod->lod_qos.lq_dirty ||
+	       lqt->lqt_size < lod->lod_osts_size ||
+	       lod->lod_qos.lq_alloc_seq - lqt->lqt_seq >
+	       max_t(__u32, 1, lod->lod_desc.ld_active_tgt_count /
+			       LOD_QOS_DECAY_STEPS);
+}
+
+/**
+ * Rebuild the QoS tree of all the OSTs.
+ *
+ * Recalculate the penalties if needed, then check all the OSTs and put the
+ * weights of the usable ones in the tree. Called with lq_rw_sem held for
+ * write.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lod	LOD device
+ *
+ * \retval 0		on success
+ * \retval -EAGAIN	weighted allocation isn't needed
+ * \retval -ENOMEM	on allocation failure
+ */
+static int lod_qos_tree_refresh(const struct lu_env *env,
+				struct lod_device *lod)
+{
+	struct lod_qos_tree *lqt = &lod->lod_qos_tree;
+	struct obd_statfs *sfs = &lod_env_info(env)->lti_osfs;
+	struct ost_pool *osts = &lod->lod_pool_info;
+	struct lod_tgt_desc *ost;
+	__u32 size = lod->lod_osts_size;
+	unsigned int i;
+	int rc;
+
+	ENTRY;
+
+	lqt->lqt_valid = false;
+
+	rc = lqos_calc_penalties(&lod->lod_qos, &lod->lod_ost_descs,
+				 lod->lod_desc.ld_active_tgt_count,
+				 lod->lod_desc.ld_qos_maxage, false);
+	if (rc)
+		RETURN(rc);
+
+	if (lqt->lqt_size < size) {
+		__u64 *tree;
+		__u64 *weight;
+
+		OBD_ALLOC_LARGE(tree, (size + 1) * sizeof(*tree));
+		if (tree == NULL)
+			RETURN(-ENOMEM);
+		OBD_ALLOC_LARGE(weight, size * sizeof(*weight));
+		if (weight == NULL) {
+			OBD_FREE_LARGE(tree, (size + 1) * sizeof(*tree));
+			RETURN(-ENOMEM);
+		}
+		lod_qos_tree_fini(lqt);
+		lqt->lqt_tree = tree;
+		lqt->lqt_weight = weight;
+		lqt->lqt_size = size;
+	} else {
+		memset(lqt->lqt_tree, 0, (lqt->lqt_size + 1) * sizeof(__u64));
+		memset(lqt->lqt_weight, 0, lqt->lqt_size * sizeof(__u64));
+	}
+
+	lqt->lqt_total = 0;
+	lqt->lqt_good = 0;
+	for (i = 0; i < osts->op_count; i++) {
+		__u32 idx = osts->op_array[i];
+
+		if (!cfs_bitmap_check(lod->lod_ost_bitmap, idx))
+			continue;
+
+		ost = OST_TGT(lod, idx);
+		ost->ltd_qos.ltq_usable = 0;
+
+		/* this OSP doesn't feel well */
+		if (lod_statfs_and_check(env, lod, idx, sfs))
+			continue;
+
+		if (sfs->os_state & OS_STATE_DEGRADED)
+			continue;
+
+		ost->ltd_qos.ltq_usable = 1;
+		lqos_calc_weight(&lod->lod_qos, ost);
+		lqt->lqt_weight[idx] = ost->ltd_qos.ltq_weight;
+		lqt->lqt_tree[idx + 1] = ost->ltd_qos.ltq_weight;
+		lqt->lqt_total += ost->ltd_qos.ltq_weight;
+		lqt->lqt_good++;
+	}
+	lod_qos_tree_build(lqt->lqt_tree, lqt->lqt_size);
+	lqt->lqt_seq = lod->lod_qos.lq_alloc_seq;
+	lqt->lqt_valid = true;
+
+	QOS_DEBUG("%s: QoS tree of %u good osts, total weight %llu\n",
+		  lod2obd(lod)->obd_name, lqt->lqt_good, lqt->lqt_total);
+
+	RETURN(0);
+}
+
+/* set the weight of \a ost in the QoS tree, called with lqt_lock held */
+static void lod_qos_tree_set(struct lod_qos_tree *lqt,
+			     struct lod_tgt_desc *ost)
+{
+	__u32 idx = ost->ltd_index;
+	__u64 old = lqt->lqt_weight[idx];
+	__u64 wt = ost->ltd_qos.ltq_weight;
+
+	if (wt > old)
+		lod_qos_tree_add(lqt->lqt_tree, lqt->lqt_size, idx + 1,
+				 wt - old);
+	else if (wt < old)
+		lod_qos_tree_sub(lqt->lqt_tree, lqt->lqt_size, idx + 1,
+				 old - wt);
+	lqt->lqt_total += wt - old;
+	lqt->lqt_weight[idx] = wt;
+}
+
+/**
+ * Account a new object on \a ost in the QoS tree.
+ *
+ * The OST and its server are penalized, so the weights of all the OSTs of
+ * that server are updated in the tree. The penalties of the other OSTs
+ * decay lazily and the tree is rebuilt from time to time to take this into
+ * account, see lod_qos_tree_stale(). Called with lq_rw_sem held for read.
+ *
+ * \param[in] lod	LOD device
+ * \param[in] ost	OST where a new object was placed
+ */
+static void lod_qos_tree_used(struct lod_device *lod, struct lod_tgt_desc *ost)
+{
+	struct lod_qos_tree *lqt = &lod->lod_qos_tree;
+	struct lu_tgt_qos *ltq;
+
+	spin_lock(&lqt->lqt_lock);
+	lqos_add_penalty(&lod->lod_qos, ost,
+			 lod->lod_desc.ld_active_tgt_count);
+	list_for_each_entry(ltq, &ost->ltd_qos.ltq_svr->lsq_tgt_list,
+			    ltq_svr_link) {
+		if (!ltq->ltq_usable)
+			continue;
+
+		ost = container_of(ltq, struct lod_tgt_desc, ltd_qos);
+		lqos_calc_weight(&lod->lod_qos, ost);
+		lod_qos_tree_set(lqt, ost);
+	}
+	spin_unlock(&lqt->lqt_lock);
+}
+
+/**
+ * Draw an OST from the QoS tree, larger-weighted OSTs more often.
+ *
+ * \param[in] lqt	QoS tree
+ *
+ * \retval		index of the OST
+ * \retval -1		all the weights are 0
+ */
+static int lod_qos_tree_draw(struct lod_qos_tree *lqt)
+{
+	int idx = -1;
+
+	spin_lock(&lqt->lqt_lock);
+	if (lqt->lqt_total > 0)
+		idx = lod_qos_tree_find(lqt->lqt_tree, lqt->lqt_size,
+				lu_prandom_u64_max(lqt->lqt_total)) - 1;
+	spin_unlock(&lqt->lqt_lock);
+
+	return idx;
+}
+
+/**
+ * Build the tree of the usable OSTs of \a osts in the per-thread buffers.
+ *
+ * This is used for pools and wide stripes, where the OSTs drawn from the
+ * QoS tree of all the OSTs would be rejected too often. The weights are
+ * copied from the QoS tree. Called with lq_rw_sem held for read.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in] lod		LOD device
+ * \param[in] osts		pool of the candidate OSTs
+ * \param[out] total_weight	total weight of the candidates
+ *
+ * \retval		number of candidate OSTs
+ * \retval -ENOMEM	on allocation failure
+ */
+static int lod_qos_cands_build(const struct lu_env *env,
+			       struct lod_device *lod, struct ost_pool *osts,
+			       __u64 *total_weight)
+{
+	struct lod_thread_info *info = lod_env_info(env);
+	struct lod_qos_tree *lqt = &lod->lod_qos_tree;
+	__u64 *tree;
+	__u64 *weight;
+	__u32 *cands;
+	__u32 good = 0;
+	unsigned int i;
+	int rc;
+
+	rc = lod_qos_tree_resize(info, osts->op_count);
+	if (rc)
+		return rc;
+
+	tree = info->lti_qos_tree;
+	weight = tree + info->lti_qos_size + 1;
+	cands = info->lti_qos_idx;
+
+	*total_weight = 0;
+	spin_lock(&lqt->lqt_lock);
+	for (i = 0; i < osts->op_count; i++) {
+		__u32 idx = osts->op_array[i];
+
+		if (!cfs_bitmap_check(lod->lod_ost_bitmap, idx) ||
+		    !OST_TGT(lod, idx)->ltd_qos.ltq_usable)
+			continue;
+
+		cands[good] = idx;
+		weight[good] = lqt->lqt_weight[idx];
+		*total_weight += weight[good];
+		good++;
+		tree[good] = weight[good - 1];
+	}
+	spin_unlock(&lqt->lqt_lock);
+	lod_qos_tree_build(tree, good);
+
+	return good;
+}
+
+/**
+ * Check whether an OST drawn by lod_alloc_qos() can take the next stripe
+ * of the object, and declare the stripe object on it.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lo	LOD object
+ * \param[in] lod_comp	layout component
+ * \param[in] idx	OST index
+ * \param[in] th	transaction handle
+ *
+ * \retval		declared object
+ * \retval ERR_PTR	the OST can't be used for this stripe
+ */
+static struct dt_object *lod_qos_try_ost(const struct lu_env *env,
+					 struct lod_object *lo,
+					 struct lod_layout_component *lod_comp,
+					 __u32 idx, struct thandle *th)
+{
+	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	struct obd_statfs *sfs = &lod_env_info(env)->lti_osfs;
+	struct lod_avoid_guide *lag = &lod_env_info(env)->lti_avoid;
+	struct dt_object *o;
+	int rc;
+
+	/* the OST state may have changed since the QoS tree was built */
+	rc = lod_statfs_and_check(env, lod, idx, sfs);
+	if (rc == 0 && sfs->os_state & OS_STATE_DEGRADED)
+		rc = -EAGAIN;
+	if (rc) {
+		lod->lod_qos.lq_dirty = 1;
+		return ERR_PTR(rc);
+	}
+
+	/* Fail Check before osc_precreate() is called
+	   so we can only 'fail' single OSC. */
+	if (OBD_FAIL_CHECK(OBD_FAIL_MDS_OSC_PRECREATE) && idx == 0)
+		return ERR_PTR(-ENOSPC);
+
+	if (lod_should_avoid_ost(lo, lag, idx))
+		return ERR_PTR(-EAGAIN);
+
+	/*
+	 * do not put >1 objects on a single OST, except for
+	 * overstriping
+	 */
+	if (lod_comp_is_ost_used(env, lo, idx) &&
+	    !(lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING))
+		return ERR_PTR(-EEXIST);
+
+	o = lod_qos_declare_object_on(env, lod, idx, th);
+	if (IS_ERR(o))
+		QOS_DEBUG("can't declare object on #%u: %d\n",
+			  idx, (int) PTR_ERR(o));
+
+	return o;
+}
+
 /**
  * Allocate a striping using an algorithm with weights.
  *
@@ -1139,10 +1553,13 @@ out:
  * No concurrent allocation is allowed on the object and this must be ensured
  * by the caller. All the internal structures are protected by the function.
  *
- * The algorithm has two steps: find available OSTs and calculate their
- * weights, then select the OSTs with their weights used as the probability.
- * An OST with a higher weight is proportionately more likely to be selected
- * than one with a lower weight.
+ * The weights of all the OSTs are kept in a shared tree, which is rebuilt
+ * under lq_rw_sem held for write when they have to be recalculated. The
+ * allocations hold lq_rw_sem for read, draw the OSTs from the shared tree
+ * with their weights used as the probability, and update the weights of the
+ * servers they use in it. An OST with a higher weight is proportionately
+ * more likely to be selected than one with a lower weight. Pools and wide
+ * stripes draw from a per-thread tree of the candidate OSTs instead.
  *
  * \param[in] env		execution environment for this thread
  * \param[in] lo		LOD object
@@ -1163,16 +1580,21 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 {
 	struct lod_layout_component *lod_comp;
 	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
-	struct obd_statfs *sfs = &lod_env_info(env)->lti_osfs;
 	struct lod_avoid_guide *lag = &lod_env_info(env)->lti_avoid;
-	struct lod_tgt_desc *ost;
+	struct lod_thread_info *info = lod_env_info(env);
+	struct lod_qos_tree *lqt = &lod->lod_qos_tree;
 	struct dt_object *o;
 	__u64 total_weight = 0;
 	struct pool_desc *pool = NULL;
 	struct ost_pool *osts;
 	unsigned int i;
+	__u64 *tree;
+	__u64 *weight;
+	__u32 *cands = NULL;
+	__u32 *rejected;
+	__u32 nrejected;
+	__u32 ncands = 0;
 	__u32 nfound, good_osts, stripe_count, stripe_count_min;
-	bool overstriped = false;
 	int stripes_per_ost = 1;
 	int rc = 0;
 	ENTRY;
@@ -1202,8 +1624,21 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		stripes_per_ost =
 			(lod_comp->llc_stripe_count - 1)/osts->op_count + 1;
 
-	/* Do actual allocation, use write lock here. */
-	down_write(&lod->lod_qos.lq_rw_sem);
+	/* Allocations only read the QoS tree, the write lock is taken to
+	 * rebuild it when the weights have to be recalculated. */
+	down_read(&lod->lod_qos.lq_rw_sem);
+	if (lod_qos_tree_stale(lod)) {
+		up_read(&lod->lod_qos.lq_rw_sem);
+		down_write(&lod->lod_qos.lq_rw_sem);
+		if (!lqos_is_usable(&lod->lod_qos,
+				    lod->lod_desc.ld_active_tgt_count))
+			rc = -EAGAIN;
+		else if (lod_qos_tree_stale(lod))
+			rc = lod_qos_tree_refresh(env, lod);
+		downgrade_write(&lod->lod_qos.lq_rw_sem);
+		if (rc)
+			GOTO(out, rc);
+	}
 
 	/*
 	 * Check again, while we were sleeping on @lq_rw_sem things could
@@ -1212,45 +1647,19 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (!lqos_is_usable(&lod->lod_qos, lod->lod_desc.ld_active_tgt_count))
 		GOTO(out, rc = -EAGAIN);
 
-	rc = lqos_calc_penalties(&lod->lod_qos, &lod->lod_ost_descs,
-				 lod->lod_desc.ld_active_tgt_count,
-				 lod->lod_desc.ld_qos_maxage, false);
-	if (rc)
-		GOTO(out, rc);
-
 	rc = lod_qos_ost_in_use_clear(env, lod_comp->llc_stripe_count);
 	if (rc)
 		GOTO(out, rc);
 
-	good_osts = 0;
-	/* Find all the OSTs that are valid stripe candidates */
-	for (i = 0; i < osts->op_count; i++) {
-		if (!cfs_bitmap_check(lod->lod_ost_bitmap, osts->op_array[i]))
-			continue;
-
-		ost = OST_TGT(lod, osts->op_array[i]);
-		ost->ltd_qos.ltq_usable = 0;
-
-		rc = lod_statfs_and_check(env, lod, osts->op_array[i], sfs);
-		if (rc) {
-			/* this OSP doesn't feel well */
-			continue;
-		}
-
-		if (sfs->os_state & OS_STATE_DEGRADED)
-			continue;
-
-		/* Fail Check before osc_precreate() is called
-		   so we can only 'fail' single OSC. */
-		if (OBD_FAIL_CHECK(OBD_FAIL_MDS_OSC_PRECREATE) &&
-				   osts->op_array[i] == 0)
-			continue;
-
-		ost->ltd_qos.ltq_usable = 1;
-		lqos_calc_weight(ost);
-		total_weight += ost->ltd_qos.ltq_weight;
-
-		good_osts++;
+	if (pool == NULL) {
+		good_osts = lqt->lqt_good;
+	} else {
+		rc = lod_qos_cands_build(env, lod, osts, &total_weight);
+		if (rc < 0)
+			GOTO(out, rc);
+		good_osts = ncands = rc;
+		cands = info->lti_qos_idx;
+		rc = 0;
 	}
 
 	QOS_DEBUG("found %d good osts\n", good_osts);
@@ -1264,75 +1673,122 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (stripe_count / stripes_per_ost > good_osts)
 		stripe_count = good_osts * stripes_per_ost;
 
-	/* Find enough OSTs with weighted random allocation. */
+	/* Mostly the OSTs drawn from the QoS tree of all the OSTs can be used,
+	 * this is O(log N) per stripe. */
 	nfound = 0;
-	while (nfound < stripe_count) {
-		u64 rand, cur_weight;
+	if (cands == NULL && stripe_count * 2 <= good_osts) {
+		int rejects = 0;
 
-		cur_weight = 0;
-		rc = -ENOSPC;
+		while (nfound < stripe_count &&
+		       rejects < LOD_QOS_MAX_REJECTS) {
+			int idx = lod_qos_tree_draw(lqt);
 
-		rand = lu_prandom_u64_max(total_weight);
+			if (idx < 0)
+				break;
 
-		/* On average, this will hit larger-weighted OSTs more often.
-		 * 0-weight OSTs will always get used last (only when rand=0) */
-		for (i = 0; i < osts->op_count; i++) {
-			__u32 idx = osts->op_array[i];
+			QOS_DEBUG("stripe_count=%d nfound=%d idx=%d\n",
+				  stripe_count, nfound, idx);
 
-			if (lod_should_avoid_ost(lo, lag, idx))
+			if (lod_qos_is_ost_used(env, idx, nfound)) {
+				rejects++;
 				continue;
+			}
 
-			ost = OST_TGT(lod, idx);
-
-			if (!ost->ltd_qos.ltq_usable)
+			o = lod_qos_try_ost(env, lo, lod_comp, idx, th);
+			if (IS_ERR(o)) {
+				rejects++;
 				continue;
+			}
 
-			cur_weight += ost->ltd_qos.ltq_weight;
-			QOS_DEBUG("stripe_count=%d nfound=%d cur_weight=%llu "
-				  "rand=%llu total_weight=%llu\n",
-				  stripe_count, nfound, cur_weight, rand,
-				  total_weight);
+			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
+			lod_avoid_update(lo, lag);
+			lod_qos_ost_in_use(env, nfound, idx);
+			stripe[nfound] = o;
+			ost_indices[nfound] = idx;
+			lod_qos_tree_used(lod, OST_TGT(lod, idx));
+			nfound++;
+		}
+	}
 
-			if (cur_weight < rand)
-				continue;
+	/* Otherwise draw from a tree of the candidates, the OSTs which can't
+	 * be used for the object are taken out of it. */
+	if (nfound < stripe_count && cands == NULL) {
+		rc = lod_qos_cands_build(env, lod, osts, &total_weight);
+		if (rc >= 0) {
+			ncands = rc;
+			cands = info->lti_qos_idx;
+		}
+		rc = 0;
+	}
+	tree = info->lti_qos_tree;
+	weight = tree + info->lti_qos_size + 1;
+	rejected = info->lti_qos_idx + info->lti_qos_size;
 
-			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
-			/*
-			 * do not put >1 objects on a single OST, except for
-			 * overstriping
-			 */
-			if ((lod_comp_is_ost_used(env, lo, idx)) &&
-			    !(lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING))
-				continue;
+	while (cands != NULL && nfound < stripe_count) {
+		__u32 pos;
+		__u32 idx;
 
-			if (lod_qos_is_ost_used(env, idx, nfound)) {
-				if (lod_comp->llc_pattern &
-				    LOV_PATTERN_OVERSTRIPING)
-					overstriped = true;
-				else
-					continue;
+		rc = -ENOSPC;
+		nrejected = 0;
+
+		while (1) {
+			if (total_weight > 0) {
+				/* On average, this will hit larger-weighted
+				 * OSTs more often */
+				pos = lod_qos_tree_find(tree, ncands,
+						lu_prandom_u64_max(total_weight));
+			} else {
+				/* 0-weight OSTs always get used last */
+				for (pos = 1; pos <= ncands; pos++) {
+					if (!(cands[pos - 1] &
+					      LOD_QOS_EXCLUDED))
+						break;
+				}
+				if (pos > ncands)
+					break;
 			}
 
-			o = lod_qos_declare_object_on(env, lod, idx, th);
+			idx = cands[pos - 1];
+			LASSERT(!(idx & LOD_QOS_EXCLUDED));
+
+			QOS_DEBUG("stripe_count=%d nfound=%d idx=%d "
+				  "total_weight=%llu\n", stripe_count, nfound,
+				  idx, total_weight);
+
+			/* the OST is out of the draw for this stripe */
+			cands[pos - 1] |= LOD_QOS_EXCLUDED;
+			lod_qos_tree_sub(tree, ncands, pos, weight[pos - 1]);
+			total_weight -= weight[pos - 1];
+
+			/* and for this object, once used */
+			if (lod_qos_is_ost_used(env, idx, nfound))
+				continue;
+
+			o = lod_qos_try_ost(env, lo, lod_comp, idx, th);
 			if (IS_ERR(o)) {
-				QOS_DEBUG("can't declare object on #%u: %d\n",
-					  idx, (int) PTR_ERR(o));
+				rejected[nrejected++] = pos;
 				continue;
 			}
 
+			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
 			lod_avoid_update(lo, lag);
 			lod_qos_ost_in_use(env, nfound, idx);
 			stripe[nfound] = o;
 			ost_indices[nfound] = idx;
-			lqos_recalc_weight(&lod->lod_qos, &lod->lod_ost_descs,
-					   ost,
-					   lod->lod_desc.ld_active_tgt_count,
-					   &total_weight);
+			lod_qos_tree_used(lod, OST_TGT(lod, idx));
 			nfound++;
 			rc = 0;
 			break;
 		}
 
+		/* rejected OSTs may still be fine for the next stripes */
+		while (nrejected > 0) {
+			pos = rejected[--nrejected];
+			cands[pos - 1] &= ~LOD_QOS_EXCLUDED;
+			lod_qos_tree_add(tree, ncands, pos, weight[pos - 1]);
+			total_weight += weight[pos - 1];
+		}
+
 		if (rc) {
 			/* no OST found on this iteration, give up */
 			break;
@@ -1362,14 +1818,15 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		rc = -EAGAIN;
 	}
 
-	/* If there are enough OSTs, a component with overstriping requessted
-	 * will not actually end up overstriped.  The comp should reflect this.
+	/* Weighted allocation puts at most one stripe per OST, so a component
+	 * with overstriping requested will not actually end up overstriped.
+	 * The comp should reflect this.
 	 */
-	if (rc == 0 && !overstriped)
+	if (rc == 0)
 		lod_comp->llc_pattern &= ~LOV_PATTERN_OVERSTRIPING;
 
 out:
-	up_write(&lod->lod_qos.lq_rw_sem);
+	up_read(&lod->lod_qos.lq_rw_sem);
 
 out_nolock:
 	if (pool != NULL) {
@@ -2083,10 +2083,12 @@ static int lov_object_layout_get(const struct lu_env *env,
 	cl->cl_layout_gen = lsm->lsm_layout_gen;
 	cl->cl_dom_comp_size = 0;
 	cl->cl_is_released = lsm->lsm_is_released;
+	cl->cl_flr_state = LCM_FL_NONE;
 	if (lsm_is_composite(lsm->lsm_magic)) {
 		struct lov_stripe_md_entry *lsme = lsm->lsm_entries[0];
 
 		cl->cl_is_composite = true;
+		cl->cl_flr_state = lsm->lsm_flags & LCM_FL_FLR_MASK;
 
 		if (lsme_is_dom(lsme))
 			cl->cl_dom_comp_size = lsme->lsme_extent.e_end;
@@ -505,9 +505,15 @@ mdc_intent_getxattr_pack(struct obd_export *exp,
 	RETURN(req);
 }
 
+/*
+ * Pack an IT_GETATTR or IT_LOOKUP intent enqueue. The names of the
+ * md_enqueue_info linked to @batch, if any, are packed in RMF_BATCH_GETATTR
+ * and RMF_BATCH_NAMES for the MDT to handle them in the same RPC.
+ */
 static struct ptlrpc_request *
 mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
-			struct md_op_data *op_data, __u32 acl_bufsize)
+			struct md_op_data *op_data, __u32 acl_bufsize,
+			struct list_head *batch)
 {
 	struct ptlrpc_request *req;
 	struct obd_device *obddev = class_exp2obd(exp);
@@ -515,8 +521,11 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 		    OBD_MD_FLDIREA | OBD_MD_MEA | OBD_MD_FLACL |
 		    OBD_MD_DEFAULT_MEA;
 	struct ldlm_intent *lit;
+	struct md_enqueue_info *extra;
 	__u32 easize;
 	bool have_secctx = false;
+	int names_len = 0;
+	int count = 0;
 	int rc;
 
 	ENTRY;
@@ -526,6 +535,17 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 	if (req == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	if (batch != NULL) {
+		list_for_each_entry(extra, batch, mi_batch) {
+			names_len += extra->mi_data.op_namelen + 1;
+			count++;
+		}
+	}
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_GETATTR, RCL_CLIENT,
+			     count * sizeof(struct mdt_batch_getattr));
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_NAMES, RCL_CLIENT,
+			     names_len);
+
 	/* send name of security xattr to get upon intent */
 	if (it->it_op & (IT_LOOKUP | IT_GETATTR) &&
 	    req_capsule_has_field(&req->rq_pill, &RMF_FILE_SECCTX_NAME,
@@ -560,6 +580,31 @@ mdc_intent_getattr_pack(struct obd_export *exp, struct lookup_intent *it,
 	req_capsule_set_size(&req->rq_pill, &RMF_ACL, RCL_SERVER, acl_bufsize);
 	req_capsule_set_size(&req->rq_pill, &RMF_DEFAULT_MDT_MD, RCL_SERVER,
 			     sizeof(struct lmv_user_md));
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_GETATTR_REP, RCL_SERVER,
+			     count * sizeof(struct mdt_batch_getattr_rep));
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_MD, RCL_SERVER,
+			     count * easize);
+
+	if (count > 0) {
+		struct mdt_batch_getattr *mbg;
+		char *names;
+		int off = 0;
+
+		mbg = req_capsule_client_get(&req->rq_pill,
+					     &RMF_BATCH_GETATTR);
+		names = req_capsule_client_get(&req->rq_pill,
+					       &RMF_BATCH_NAMES);
+		list_for_each_entry(extra, batch, mi_batch) {
+			mbg->mbg_handle = extra->mi_lockh;
+			mbg->mbg_name_off = off;
+			mbg->mbg_namelen = extra->mi_data.op_namelen;
+			memcpy(names + off, extra->mi_data.op_name,
+			       mbg->mbg_namelen);
+			names[off + mbg->mbg_namelen] = '\0';
+			off += mbg->mbg_namelen + 1;
+			mbg++;
+		}
+	}
 
 	if (have_secctx) {
 		char *secctx_name;
@@ -653,6 +698,32 @@ mdc_enqueue_pack(struct obd_export *exp, int lvb_len)
         RETURN(req);
 }
 
+/* install a copy of the layout returned with the layout lock @lock */
+static int mdc_lock_set_layout(struct ldlm_lock *lock, void *lvb_data,
+			       __u32 lvb_len)
+{
+	void *lmm;
+
+	OBD_ALLOC_LARGE(lmm, lvb_len);
+	if (lmm == NULL)
+		return -ENOMEM;
+
+	memcpy(lmm, lvb_data, lvb_len);
+
+	lock_res_and_lock(lock);
+	if (lock->l_lvb_data == NULL) {
+		lock->l_lvb_type = LVB_T_LAYOUT;
+		lock->l_lvb_data = lmm;
+		lock->l_lvb_len = lvb_len;
+		lmm = NULL;
+	}
+	unlock_res_and_lock(lock);
+	if (lmm != NULL)
+		OBD_FREE_LARGE(lmm, lvb_len);
+
+	return 0;
+}
+
 static int mdc_finish_enqueue(struct obd_export *exp,
                               struct ptlrpc_request *req,
                               struct ldlm_enqueue_info *einfo,
@@ -815,28 +886,12 @@ static int mdc_finish_enqueue(struct obd_export *exp,
 
 	if (ldlm_has_layout(lock) && lvb_data != NULL &&
 	    !(lockrep->lock_flags & LDLM_FL_BLOCKED_MASK)) {
-		void *lmm;
-
 		LDLM_DEBUG(lock, "layout lock returned by: %s, lvb_len: %d",
 			ldlm_it2str(it->it_op), lvb_len);
 
-		OBD_ALLOC_LARGE(lmm, lvb_len);
-		if (lmm == NULL)
-			GOTO(out_lock, rc = -ENOMEM);
-
-		memcpy(lmm, lvb_data, lvb_len);
-
-		/* install lvb_data */
-		lock_res_and_lock(lock);
-		if (lock->l_lvb_data == NULL) {
-			lock->l_lvb_type = LVB_T_LAYOUT;
-			lock->l_lvb_data = lmm;
-			lock->l_lvb_len = lvb_len;
-			lmm = NULL;
-		}
-		unlock_res_and_lock(lock);
-		if (lmm != NULL)
-			OBD_FREE_LARGE(lmm, lvb_len);
+		rc = mdc_lock_set_layout(lock, lvb_data, lvb_len);
+		if (rc)
+			GOTO(out_lock, rc);
 	}
 
 	if (ldlm_has_dom(lock)) {
@@ -925,7 +980,8 @@ resend:
 	} else if (it->it_op & IT_OPEN) {
 		req = mdc_intent_open_pack(exp, it, op_data, acl_bufsize);
 	} else if (it->it_op & (IT_GETATTR | IT_LOOKUP)) {
-		req = mdc_intent_getattr_pack(exp, it, op_data, acl_bufsize);
+		req = mdc_intent_getattr_pack(exp, it, op_data, acl_bufsize,
+					      NULL);
 	} else if (it->it_op & IT_READDIR) {
 		req = mdc_enqueue_pack(exp, 0);
 	} else if (it->it_op & IT_LAYOUT) {
@@ -1066,13 +1122,31 @@ int mdc_enqueue(struct obd_export *exp, struct ldlm_enqueue_info *einfo,
 				op_data, lockh, extra_lock_flags);
 }
 
+/*
+ * If we already have a matching lock, then cancel the new one @lockh granted
+ * for @it and use the old one.
+ */
+static void mdc_intent_lock_match(struct lookup_intent *it,
+				  struct lustre_handle *lockh,
+				  union ldlm_policy_data *policy)
+{
+	struct lustre_handle old_lock;
+
+	memcpy(&old_lock, lockh, sizeof(*lockh));
+	if (ldlm_lock_match(NULL, LDLM_FL_BLOCK_GRANTED, NULL,
+			    LDLM_IBITS, policy, LCK_NL, &old_lock, 0)) {
+		ldlm_lock_decref_and_cancel(lockh, it->it_lock_mode);
+		memcpy(lockh, &old_lock, sizeof(old_lock));
+		it->it_lock_handle = lockh->cookie;
+	}
+}
+
 static int mdc_finish_intent_lock(struct obd_export *exp,
                                   struct ptlrpc_request *request,
                                   struct md_op_data *op_data,
                                   struct lookup_intent *it,
                                   struct lustre_handle *lockh)
 {
-        struct lustre_handle old_lock;
         struct ldlm_lock *lock;
 	int rc = 0;
 	ENTRY;
@@ -1162,13 +1236,7 @@ static int mdc_finish_intent_lock(struct obd_export *exp,
 		}
 		LDLM_LOCK_PUT(lock);
 
-                memcpy(&old_lock, lockh, sizeof(*lockh));
-                if (ldlm_lock_match(NULL, LDLM_FL_BLOCK_GRANTED, NULL,
-                                    LDLM_IBITS, &policy, LCK_NL, &old_lock, 0)) {
-			ldlm_lock_decref_and_cancel(lockh, it->it_lock_mode);
-			memcpy(lockh, &old_lock, sizeof(old_lock));
-			it->it_lock_handle = lockh->cookie;
-		}
+		mdc_intent_lock_match(it, lockh, &policy);
 	}
 
 	EXIT;
@@ -1327,6 +1395,163 @@ int mdc_intent_lock(struct obd_export *exp, struct md_op_data *op_data,
         RETURN(rc);
 }
 
+/* fail the names batched with an IT_GETATTR intent before it was sent */
+static void mdc_batch_getattr_abort(struct obd_export *exp,
+				    struct list_head *batch, int rc)
+{
+	struct md_enqueue_info *extra;
+	struct md_enqueue_info *next;
+	__u64 flags = LDLM_FL_HAS_INTENT;
+
+	list_for_each_entry_safe(extra, next, batch, mi_batch) {
+		list_del_init(&extra->mi_batch);
+		if (lustre_handle_is_used(&extra->mi_lockh)) {
+			ldlm_cli_enqueue_reply_fini(exp, NULL,
+						    extra->mi_einfo.ei_type, 1,
+						    extra->mi_einfo.ei_mode,
+						    &flags, &extra->mi_lockh,
+						    rc);
+			memset(&extra->mi_lockh, 0, sizeof(extra->mi_lockh));
+		}
+		extra->mi_cb(NULL, extra, rc);
+	}
+}
+
+/* finish the lock and intent of one name batched with an IT_GETATTR intent */
+static int mdc_batch_getattr_finish(struct obd_export *exp,
+				    struct ptlrpc_request *req,
+				    struct md_enqueue_info *extra,
+				    struct mdt_batch_getattr_rep *rep,
+				    char *md, int md_len)
+{
+	struct ldlm_enqueue_info *einfo = &extra->mi_einfo;
+	struct lookup_intent *it = &extra->mi_it;
+	struct lustre_handle *lockh = &extra->mi_lockh;
+	struct mdt_body *body;
+	struct ldlm_lock *lock;
+	union ldlm_policy_data policy;
+	__u64 flags = LDLM_FL_HAS_INTENT;
+	int rc;
+
+	ENTRY;
+
+	if (rep == NULL || !(rep->mbgr_dlm.lock_policy_res1 & DISP_IT_EXECD))
+		rc = -EAGAIN;
+	else
+		rc = ptlrpc_status_ntoh(rep->mbgr_dlm.lock_policy_res2);
+	if (rc == 0 && !lustre_handle_is_used(&rep->mbgr_dlm.lock_handle))
+		rc = -EPROTO;
+
+	rc = ldlm_cli_enqueue_reply_fini(exp, rep ? &rep->mbgr_dlm : NULL,
+					 einfo->ei_type, 1, einfo->ei_mode,
+					 &flags, lockh, rc);
+	if (rc) {
+		memset(lockh, 0, sizeof(*lockh));
+		if (rep != NULL)
+			it->it_disposition = (int)rep->mbgr_dlm.lock_policy_res1;
+		RETURN(rc);
+	}
+
+	lock = ldlm_handle2lock(lockh);
+	LASSERT(lock != NULL);
+	/* the server gives a PR lock, fix up our references */
+	if (lock->l_req_mode != einfo->ei_mode) {
+		ldlm_lock_addref(lockh, lock->l_req_mode);
+		ldlm_lock_decref(lockh, einfo->ei_mode);
+		einfo->ei_mode = lock->l_req_mode;
+	}
+
+	it->it_disposition = (int)rep->mbgr_dlm.lock_policy_res1;
+	it->it_status = 0;
+	it->it_lock_mode = einfo->ei_mode;
+	it->it_lock_handle = lockh->cookie;
+	it->it_request = req;
+
+	body = &rep->mbgr_body;
+	if (!fid_res_name_eq(&body->mbo_fid1, &lock->l_resource->lr_name))
+		GOTO(out_lock, rc = -EPROTO);
+
+	if (body->mbo_valid & OBD_MD_FLEASIZE) {
+		if (body->mbo_eadatasize == 0 ||
+		    rep->mbgr_md_off > md_len ||
+		    body->mbo_eadatasize > md_len - rep->mbgr_md_off)
+			GOTO(out_lock, rc = -EPROTO);
+
+		mdc_update_max_ea_from_body(exp, body);
+		extra->mi_layout.lb_buf = md + rep->mbgr_md_off;
+		extra->mi_layout.lb_len = body->mbo_eadatasize;
+
+		if (ldlm_has_layout(lock)) {
+			rc = mdc_lock_set_layout(lock, extra->mi_layout.lb_buf,
+						 extra->mi_layout.lb_len);
+			if (rc)
+				GOTO(out_lock, rc);
+		}
+	}
+	extra->mi_body = body;
+
+	policy = lock->l_policy_data;
+	LDLM_DEBUG(lock, "batched getattr lock, matching against this");
+	EXIT;
+out_lock:
+	LDLM_LOCK_PUT(lock);
+	if (rc == 0)
+		mdc_intent_lock_match(it, lockh, &policy);
+	return rc;
+}
+
+/*
+ * Finish the names batched with an IT_GETATTR intent by \a req, whose status
+ * is \a rc. Names not handled by the MDT are failed with -EAGAIN.
+ */
+static void mdc_batch_getattr_interpret(struct obd_export *exp,
+					struct ptlrpc_request *req,
+					struct list_head *batch, int rc)
+{
+	struct req_capsule *pill = &req->rq_pill;
+	struct mdt_batch_getattr_rep *rep = NULL;
+	struct md_enqueue_info *extra;
+	struct md_enqueue_info *next;
+	char *md = NULL;
+	int md_len = 0;
+	int count = 0;
+
+	if (rc < 0 || req->rq_repmsg == NULL) {
+		mdc_batch_getattr_abort(exp, batch, rc < 0 ? rc : -EIO);
+		return;
+	}
+
+	if (req_capsule_field_present(pill, &RMF_BATCH_GETATTR_REP,
+				      RCL_SERVER))
+		count = req_capsule_get_size(pill, &RMF_BATCH_GETATTR_REP,
+					     RCL_SERVER) / sizeof(*rep);
+	if (count > 0)
+		rep = req_capsule_server_get(pill, &RMF_BATCH_GETATTR_REP);
+	if (rep != NULL &&
+	    req_capsule_field_present(pill, &RMF_BATCH_MD, RCL_SERVER)) {
+		md_len = req_capsule_get_size(pill, &RMF_BATCH_MD, RCL_SERVER);
+		if (md_len > 0)
+			md = req_capsule_server_get(pill, &RMF_BATCH_MD);
+		if (md == NULL)
+			md_len = 0;
+	}
+
+	list_for_each_entry_safe(extra, next, batch, mi_batch) {
+		list_del_init(&extra->mi_batch);
+		rc = mdc_batch_getattr_finish(exp, req, extra,
+					      count > 0 ? rep : NULL,
+					      md, md_len);
+		CDEBUG(D_DLMTRACE, "batched getattr %.*s: rc = %d\n",
+		       (int)extra->mi_data.op_namelen, extra->mi_data.op_name,
+		       rc);
+		extra->mi_cb(req, extra, rc);
+		if (count > 0) {
+			count--;
+			rep++;
+		}
+	}
+}
+
 static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 					      struct ptlrpc_request *req,
 					      void *args, int rc)
@@ -1339,6 +1564,8 @@ static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 	struct lustre_handle *lockh;
 	struct obd_device *obddev;
 	struct ldlm_reply *lockrep;
+	struct list_head batch;
+	int rpc_rc;
 	__u64 flags = LDLM_FL_HAS_INTENT;
 	ENTRY;
 
@@ -1347,9 +1574,14 @@ static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 
         obddev = class_exp2obd(exp);
 
+	/* minfo may be freed by its callback */
+	INIT_LIST_HEAD(&batch);
+	list_splice_init(&minfo->mi_batch, &batch);
+
 	obd_put_request_slot(&obddev->u.cli);
         if (OBD_FAIL_CHECK(OBD_FAIL_MDC_GETATTR_ENQUEUE))
                 rc = -ETIMEDOUT;
+	rpc_rc = rc;
 
         rc = ldlm_cli_enqueue_fini(exp, req, einfo->ei_type, 1, einfo->ei_mode,
                                    &flags, NULL, 0, lockh, rc);
@@ -1374,9 +1606,17 @@ static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 
 out:
         minfo->mi_cb(req, minfo, rc);
+	if (!list_empty(&batch))
+		mdc_batch_getattr_interpret(exp, req, &batch, rpc_rc);
         return 0;
 }
 
+/**
+ * Send an async IT_GETATTR or IT_LOOKUP intent for \a minfo. The md_enqueue_info
+ * linked to minfo->mi_batch are other names of the same directory, sent in the
+ * same RPC if the MDT supports OBD_CONNECT2_BATCH_GETATTR. Their mi_cb is
+ * always called, even if an error is returned for \a minfo itself.
+ */
 int mdc_intent_getattr_async(struct obd_export *exp,
 			     struct md_enqueue_info *minfo)
 {
@@ -1385,6 +1625,7 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	struct ptlrpc_request   *req;
 	struct mdc_getattr_args *ga;
 	struct obd_device       *obddev = class_exp2obd(exp);
+	struct md_enqueue_info  *extra;
 	struct ldlm_res_id       res_id;
 	union ldlm_policy_data policy = {
 				.l_inodebits = { MDS_INODELOCK_LOOKUP |
@@ -1398,17 +1639,34 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 		PFID(&op_data->op_fid1), ldlm_it2str(it->it_op), it->it_flags);
 
 	fid_build_reg_res_name(&op_data->op_fid1, &res_id);
+
+	if (!list_empty(&minfo->mi_batch) &&
+	    (it->it_op != IT_GETATTR ||
+	     !(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_GETATTR)))
+		mdc_batch_getattr_abort(exp, &minfo->mi_batch, -EOPNOTSUPP);
+
+	/* the locks of batched names are enqueued by the same RPC */
+	list_for_each_entry(extra, &minfo->mi_batch, mi_batch) {
+		if (extra->mi_einfo.ei_cb_gl == NULL)
+			extra->mi_einfo.ei_cb_gl = mdc_ldlm_glimpse_ast;
+		rc = ldlm_cli_enqueue_prep(exp, &extra->mi_einfo, &res_id,
+					   &policy, flags, &extra->mi_lockh);
+		if (rc < 0)
+			GOTO(out_batch, rc);
+	}
+
 	/* If the MDT return -ERANGE because of large ACL, then the sponsor
 	 * of the async getattr RPC will handle that by itself. */
 	req = mdc_intent_getattr_pack(exp, it, op_data,
-				      LUSTRE_POSIX_ACL_MAX_SIZE_OLD);
+				      LUSTRE_POSIX_ACL_MAX_SIZE_OLD,
+				      &minfo->mi_batch);
 	if (IS_ERR(req))
-		RETURN(PTR_ERR(req));
+		GOTO(out_batch, rc = PTR_ERR(req));
 
 	rc = obd_get_request_slot(&obddev->u.cli);
 	if (rc != 0) {
 		ptlrpc_req_finished(req);
-		RETURN(rc);
+		GOTO(out_batch, rc);
 	}
 
 	/* With Data-on-MDT the glimpse callback is needed too.
@@ -1423,7 +1681,7 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	if (rc < 0) {
 		obd_put_request_slot(&obddev->u.cli);
 		ptlrpc_req_finished(req);
-		RETURN(rc);
+		GOTO(out_batch, rc);
 	}
 
 	ga = ptlrpc_req_async_args(ga, req);
@@ -1434,4 +1692,8 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	ptlrpcd_add_req(req);
 
 	RETURN(0);
+
+out_batch:
+	mdc_batch_getattr_abort(exp, &minfo->mi_batch, rc);
+	RETURN(rc);
 }
@@ -2378,6 +2378,34 @@ static void mdt_preset_secctx_size(struct mdt_thread_info *info)
 
 }
 
+/*
+ * Pre-set the reply buffers of the names batched with an IT_GETATTR intent, see
+ * mdt_intent_getattr_batch(). An empty batch is returned to a client sending
+ * more names than MDS_MAX_BATCH_GETATTR.
+ */
+static void mdt_preset_batch_getattr_size(struct mdt_thread_info *info)
+{
+	struct req_capsule *pill = info->mti_pill;
+	int count = 0;
+
+	if (!req_capsule_has_field(pill, &RMF_BATCH_GETATTR_REP, RCL_SERVER))
+		return;
+
+	if (exp_connect_batch_getattr(info->mti_exp) &&
+	    req_capsule_field_present(pill, &RMF_BATCH_GETATTR, RCL_CLIENT))
+		count = req_capsule_get_size(pill, &RMF_BATCH_GETATTR,
+					     RCL_CLIENT) /
+			sizeof(struct mdt_batch_getattr);
+	if (count > MDS_MAX_BATCH_GETATTR)
+		count = 0;
+
+	req_capsule_set_size(pill, &RMF_BATCH_GETATTR_REP, RCL_SERVER,
+			     count * sizeof(struct mdt_batch_getattr_rep));
+	req_capsule_set_size(pill, &RMF_BATCH_MD, RCL_SERVER,
+			     min_t(int, count * info->mti_mdt->mdt_max_mdsize,
+				   MDS_REG_MAXREPSIZE));
+}
+
 static int mdt_reint_internal(struct mdt_thread_info *info,
                               struct mdt_lock_handle *lhc,
                               __u32 op)
@@ -3663,6 +3691,7 @@ static int mdt_unpack_req_pack_rep(struct mdt_thread_info *info,
 					     LUSTRE_POSIX_ACL_MAX_SIZE_OLD);
 
 		mdt_preset_secctx_size(info);
+		mdt_preset_batch_getattr_size(info);
 
 		rc = req_capsule_server_pack(pill);
 		if (rc)
@@ -3799,6 +3828,38 @@ static int mdt_intent_brw(enum ldlm_intent_flags it_opc,
 			       lockp, flags);
 }
 
+/*
+ * Turn the local lock @new_lock into a lock of the client of @exp, which knows
+ * it by @remote. The local reader and writer references are dropped without
+ * triggering a possible blocking AST. Called with the lock resource locked,
+ * the caller adds the lock to the export lock hash.
+ */
+static void mdt_lock_give_nolock(struct ldlm_lock *new_lock,
+				 struct obd_export *exp,
+				 ldlm_blocking_callback blocking,
+				 ldlm_completion_callback completion,
+				 const struct lustre_handle *remote)
+{
+	while (new_lock->l_readers > 0) {
+		lu_ref_del(&new_lock->l_reference, "reader", new_lock);
+		lu_ref_del(&new_lock->l_reference, "user", new_lock);
+		new_lock->l_readers--;
+	}
+	while (new_lock->l_writers > 0) {
+		lu_ref_del(&new_lock->l_reference, "writer", new_lock);
+		lu_ref_del(&new_lock->l_reference, "user", new_lock);
+		new_lock->l_writers--;
+	}
+
+	new_lock->l_export = class_export_lock_get(exp, new_lock);
+	new_lock->l_blocking_ast = blocking;
+	new_lock->l_completion_ast = completion;
+	if (ldlm_has_dom(new_lock))
+		new_lock->l_glimpse_ast = ldlm_server_glimpse_ast;
+	new_lock->l_remote_handle = *remote;
+	new_lock->l_flags &= ~LDLM_FL_LOCAL;
+}
+
 int mdt_intent_lock_replace(struct mdt_thread_info *info,
 			    struct ldlm_lock **lockp,
 			    struct mdt_lock_handle *lh,
@@ -3862,27 +3923,8 @@ int mdt_intent_lock_replace(struct mdt_thread_info *info,
          * Fixup the lock to be given to the client.
          */
         lock_res_and_lock(new_lock);
-        /* Zero new_lock->l_readers and new_lock->l_writers without triggering
-         * possible blocking AST. */
-        while (new_lock->l_readers > 0) {
-                lu_ref_del(&new_lock->l_reference, "reader", new_lock);
-                lu_ref_del(&new_lock->l_reference, "user", new_lock);
-                new_lock->l_readers--;
-        }
-        while (new_lock->l_writers > 0) {
-                lu_ref_del(&new_lock->l_reference, "writer", new_lock);
-                lu_ref_del(&new_lock->l_reference, "user", new_lock);
-                new_lock->l_writers--;
-        }
-
-        new_lock->l_export = class_export_lock_get(req->rq_export, new_lock);
-        new_lock->l_blocking_ast = lock->l_blocking_ast;
-        new_lock->l_completion_ast = lock->l_completion_ast;
-	if (ldlm_has_dom(new_lock))
-		new_lock->l_glimpse_ast = ldlm_server_glimpse_ast;
-        new_lock->l_remote_handle = lock->l_remote_handle;
-        new_lock->l_flags &= ~LDLM_FL_LOCAL;
-
+	mdt_lock_give_nolock(new_lock, req->rq_export, lock->l_blocking_ast,
+			     lock->l_completion_ast, &lock->l_remote_handle);
         unlock_res_and_lock(new_lock);
 
         cfs_hash_add(new_lock->l_export->exp_lock_hash,
@@ -3991,6 +4033,267 @@ static int mdt_intent_getxattr(enum ldlm_intent_flags it_opc,
 	RETURN(rc);
 }
 
+/*
+ * Get the attributes of one name batched with an IT_GETATTR intent, and grant
+ * the client lock described by @mbg. The layout of a regular file is packed at
+ * @md + *md_used, within the @md_len bytes of RMF_BATCH_MD.
+ *
+ * Only what can be done at once is done here, the client sends the name in
+ * its own intent when -EAGAIN is returned: e.g. the child lock can't be
+ * granted right away, the child is a directory, remote or has an ACL.
+ */
+static int mdt_batch_getattr_one(struct mdt_thread_info *info,
+				 const struct mdt_batch_getattr *mbg,
+				 const char *names, int names_len,
+				 struct mdt_batch_getattr_rep *rep,
+				 char *md, int md_len, int *md_used)
+{
+	const struct lu_env *env = info->mti_env;
+	struct obd_export *exp = info->mti_exp;
+	struct mdt_object *parent = info->mti_object;
+	struct mdt_lock_handle *lhp = &info->mti_lh[MDT_LH_PARENT];
+	struct mdt_lock_handle *lhc = &info->mti_lh[MDT_LH_CHILD];
+	struct lu_fid *child_fid = &info->mti_tmp_fid1;
+	struct lu_name *lname = &info->mti_name;
+	struct ldlm_reply *dlm = &rep->mbgr_dlm;
+	struct mdt_body *body = &rep->mbgr_body;
+	struct md_attr *ma = &info->mti_attr;
+	struct mdt_object *child;
+	struct ldlm_lock *lock;
+	__u64 ibits = 0;
+	__u64 trybits;
+	int rc;
+
+	ENTRY;
+
+	if (mbg->mbg_name_off >= names_len ||
+	    mbg->mbg_namelen >= names_len - mbg->mbg_name_off)
+		RETURN(-EPROTO);
+
+	lname->ln_name = names + mbg->mbg_name_off;
+	lname->ln_namelen = mbg->mbg_namelen;
+	if (!lu_name_is_valid(lname))
+		RETURN(-EPROTO);
+
+	mdt_set_disposition(NULL, dlm, DISP_IT_EXECD | DISP_LOOKUP_EXECD);
+
+	mdt_lock_pdo_init(lhp, LCK_PR, lname);
+	rc = mdt_object_lock(info, parent, lhp, MDS_INODELOCK_UPDATE);
+	if (rc)
+		RETURN(rc);
+
+	fid_zero(child_fid);
+	rc = mdo_lookup(env, mdt_object_child(parent), lname, child_fid,
+			&info->mti_spec);
+	if (rc == -ENOENT)
+		mdt_set_disposition(NULL, dlm, DISP_LOOKUP_NEG);
+	if (rc)
+		GOTO(out_parent, rc);
+
+	mdt_set_disposition(NULL, dlm, DISP_LOOKUP_POS);
+	if (lu_fid_eq(child_fid, mdt_object_fid(parent)))
+		GOTO(out_parent, rc = -EAGAIN);
+
+	child = mdt_object_find(env, info->mti_mdt, child_fid);
+	if (IS_ERR(child))
+		GOTO(out_parent, rc = PTR_ERR(child));
+
+	if (!mdt_object_exists(child))
+		GOTO(out_child, rc = -ENOENT);
+
+	/* striping and default striping of directories are not batched */
+	if (mdt_object_remote(child) ||
+	    S_ISDIR(lu_object_attr(&child->mot_obj)))
+		GOTO(out_child, rc = -EAGAIN);
+
+	/* a resent RPC may have granted this lock already */
+	lock = cfs_hash_lookup(exp->exp_lock_hash, (void *)&mbg->mbg_handle);
+	if (lock == NULL) {
+		mdt_lock_handle_init(lhc);
+		mdt_lock_reg_init(lhc, LCK_PR);
+		trybits = MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE |
+			  MDS_INODELOCK_PERM;
+		if (S_ISREG(lu_object_attr(&child->mot_obj)) &&
+		    !OBD_FAIL_CHECK(OBD_FAIL_MDS_NO_LL_GETATTR) &&
+		    exp_connect_layout(exp))
+			trybits |= MDS_INODELOCK_LAYOUT;
+
+		rc = mdt_object_lock_try(info, child, lhc, &ibits, trybits,
+					 false);
+		if (rc)
+			GOTO(out_child, rc);
+		if (!lustre_handle_is_used(&lhc->mlh_reg_lh))
+			GOTO(out_child, rc = -EAGAIN);
+		if ((ibits & (MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE)) !=
+		    (MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE))
+			GOTO(out_lock, rc = -EAGAIN);
+	} else {
+		ibits = lock->l_policy_data.l_inodebits.bits;
+		if (!fid_res_name_eq(child_fid, &lock->l_resource->lr_name))
+			GOTO(out_lock, rc = -EAGAIN);
+	}
+
+	ma->ma_valid = 0;
+	ma->ma_need = MA_INODE | MA_HSM;
+	ma->ma_lmm = NULL;
+	ma->ma_lmm_size = 0;
+	if (S_ISREG(lu_object_attr(&child->mot_obj)) &&
+	    (ibits & MDS_INODELOCK_LAYOUT)) {
+		if (*md_used >= md_len)
+			GOTO(out_lock, rc = -EOVERFLOW);
+		ma->ma_lmm = (struct lov_mds_md *)(md + *md_used);
+		ma->ma_lmm_size = md_len - *md_used;
+		ma->ma_need |= MA_LOV;
+	}
+
+	info->mti_som_valid = 0;
+	rc = mdt_attr_get_complex(info, child, ma);
+	if (info->mti_big_lmm_used) {
+		/* the layout doesn't fit in what is left of RMF_BATCH_MD */
+		info->mti_big_lmm_used = 0;
+		rc = rc ?: -EOVERFLOW;
+	}
+	if (rc)
+		GOTO(out_lock, rc);
+	if (!(ma->ma_valid & MA_INODE))
+		GOTO(out_lock, rc = -EFAULT);
+	if ((ma->ma_valid & MA_LOV) && !exp_connect_overstriping(exp) &&
+	    mdt_lmm_is_overstriping(ma->ma_lmm))
+		GOTO(out_lock, rc = -EAGAIN);
+
+#ifdef CONFIG_LUSTRE_FS_POSIX_ACL
+	if (exp_connect_flags(exp) & OBD_CONNECT_ACL) {
+		rc = mo_xattr_get(env, mdt_object_child(child), &LU_BUF_NULL,
+				  XATTR_NAME_ACL_ACCESS);
+		if (rc == -ENODATA) {
+			body->mbo_aclsize = 0;
+			body->mbo_valid |= OBD_MD_FLACL;
+		} else if (rc != -EOPNOTSUPP) {
+			/* ACL entries are only packed by a single getattr */
+			GOTO(out_lock, rc = rc < 0 ? rc : -EAGAIN);
+		}
+		rc = 0;
+	}
+#endif
+
+	if (ma->ma_valid & MA_HSM) {
+		body->mbo_valid |= OBD_MD_TSTATE;
+		if ((ma->ma_hsm.mh_flags & HS_RELEASED) &&
+		    mdt_hsm_restore_is_running(info, mdt_object_fid(child)))
+			body->mbo_t_state = MS_RESTORE;
+	}
+
+	mdt_pack_attr2body(info, body, &ma->ma_attr, mdt_object_fid(child));
+	info->mti_som_valid = 0;
+
+	if (ma->ma_valid & MA_LOV) {
+		body->mbo_eadatasize = ma->ma_lmm_size;
+		body->mbo_valid |= OBD_MD_FLEASIZE;
+		rep->mbgr_md_off = *md_used;
+	}
+
+	if (lock == NULL) {
+		lock = ldlm_handle2lock(&lhc->mlh_reg_lh);
+		LASSERT(lock != NULL);
+
+		lock_res_and_lock(lock);
+		if (ldlm_is_ast_sent(lock)) {
+			/* a conflicting lock is waiting already */
+			unlock_res_and_lock(lock);
+			GOTO(out_lock, rc = -EAGAIN);
+		}
+		mdt_lock_give_nolock(lock, exp, ldlm_server_blocking_ast,
+				     ldlm_server_completion_ast,
+				     &mbg->mbg_handle);
+		unlock_res_and_lock(lock);
+
+		cfs_hash_add(exp->exp_lock_hash, &lock->l_remote_handle,
+			     &lock->l_exp_hash);
+		lhc->mlh_reg_lh.cookie = 0;
+	}
+
+	LDLM_DEBUG(lock, "Returning batched lock to client");
+	ldlm_lock2desc(lock, &dlm->lock_desc);
+	ldlm_lock2handle(lock, &dlm->lock_handle);
+	dlm->lock_flags = ldlm_flags_to_wire(LDLM_FL_LOCK_CHANGED);
+	*md_used += cfs_size_round(body->mbo_eadatasize);
+
+	EXIT;
+out_lock:
+	if (lock != NULL)
+		LDLM_LOCK_PUT(lock);
+	if (lustre_handle_is_used(&lhc->mlh_reg_lh))
+		mdt_object_unlock(info, child, lhc, 1);
+out_child:
+	mdt_object_put(env, child);
+out_parent:
+	mdt_object_unlock(info, parent, lhp, 1);
+	return rc;
+}
+
+/*
+ * Handle the names batched by a client with OBD_CONNECT2_BATCH_GETATTR after
+ * the one of an IT_GETATTR intent, in the same parent directory. The status of
+ * each name is returned in its mdt_batch_getattr_rep, a name which was not
+ * looked up at all has no DISP_IT_EXECD disposition.
+ */
+static int mdt_intent_getattr_batch(struct mdt_thread_info *info)
+{
+	struct req_capsule *pill = info->mti_pill;
+	struct mdt_object *parent = info->mti_object;
+	const struct mdt_batch_getattr *mbg;
+	struct mdt_batch_getattr_rep *rep;
+	const char *names;
+	char *md;
+	int names_len;
+	int md_len = 0;
+	int md_used = 0;
+	int count;
+	int i;
+	int rc;
+
+	ENTRY;
+
+	count = req_capsule_get_size(pill, &RMF_BATCH_GETATTR_REP,
+				     RCL_SERVER) / sizeof(*rep);
+	if (count == 0)
+		RETURN(0);
+
+	rep = req_capsule_server_get(pill, &RMF_BATCH_GETATTR_REP);
+	if (rep == NULL)
+		RETURN(-EPROTO);
+	memset(rep, 0, count * sizeof(*rep));
+
+	mbg = req_capsule_client_get(pill, &RMF_BATCH_GETATTR);
+	names = req_capsule_client_get(pill, &RMF_BATCH_NAMES);
+	names_len = req_capsule_get_size(pill, &RMF_BATCH_NAMES, RCL_CLIENT);
+	if (mbg == NULL || names == NULL || names_len <= 0)
+		GOTO(out, rc = -EPROTO);
+
+	if (parent == NULL || !mdt_object_exists(parent) ||
+	    mdt_object_remote(parent) ||
+	    !S_ISDIR(lu_object_attr(&parent->mot_obj)) ||
+	    info->mti_exp->exp_lock_hash == NULL)
+		GOTO(out, rc = 0);
+
+	md = req_capsule_server_get(pill, &RMF_BATCH_MD);
+	md_len = req_capsule_get_size(pill, &RMF_BATCH_MD, RCL_SERVER);
+
+	for (i = 0; i < count; i++) {
+		rc = mdt_batch_getattr_one(info, &mbg[i], names, names_len,
+					   &rep[i], md, md_len, &md_used);
+		rep[i].mbgr_dlm.lock_policy_res2 = ptlrpc_status_hton(rc);
+		CDEBUG(D_INODE, "%s: batched getattr %d/%d: rc = %d\n",
+		       mdt_obd_name(info->mti_mdt), i + 1, count, rc);
+	}
+	rc = 0;
+	EXIT;
+out:
+	req_capsule_shrink(pill, &RMF_BATCH_MD, min(md_used, md_len),
+			   RCL_SERVER);
+	return rc;
+}
+
 static int mdt_intent_getattr(enum ldlm_intent_flags it_opc,
                               struct mdt_thread_info *info,
                               struct ldlm_lock **lockp,
@@ -4035,6 +4338,12 @@ static int mdt_intent_getattr(enum ldlm_intent_flags it_opc,
         ldlm_rep = req_capsule_server_get(info->mti_pill, &RMF_DLM_REP);
         mdt_set_disposition(info, ldlm_rep, DISP_IT_EXECD);
 
+	if (it_opc == IT_GETATTR && !info->mti_cross_ref) {
+		rc = mdt_intent_getattr_batch(info);
+		if (rc)
+			GOTO(out_ucred, rc);
+	}
+
 	/* Get lock from request for possible resent case. */
 	mdt_intent_fixup_resent(info, *lockp, lhc, flags);
 
@@ -5761,6 +6070,14 @@ static int mdt_object_init(const struct lu_env *env, struct lu_object *o,
         RETURN(rc);
 }
 
+static void mdt_object_free_rcu(struct rcu_head *head)
+{
+	struct mdt_object *mo = container_of(head, struct mdt_object,
+					     mot_header.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(mo, mdt_object_kmem);
+}
+
 static void mdt_object_free(const struct lu_env *env, struct lu_object *o)
 {
         struct mdt_object *mo = mdt_obj(o);
@@ -5776,7 +6093,8 @@ static void mdt_object_free(const struct lu_env *env, struct lu_object *o)
 
 	lu_object_fini(o);
 	lu_object_header_fini(h);
-	OBD_SLAB_FREE_PTR(mo, mdt_object_kmem);
+	/* lu_site lookups may still see the header until a grace period */
+	call_rcu(&h->loh_rcu, mdt_object_free_rcu);
 
 	EXIT;
 }
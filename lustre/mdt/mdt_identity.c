@@ -211,6 +211,52 @@ void mdt_flush_identity(struct upcall_cache *cache, int uid)
                 upcall_cache_flush_one(cache, (__u64)uid, NULL);
 }
 
+/* at most this many uids are prefetched by one identity_warm write */
+#define MDT_IDENTITY_WARM_MAX	65536
+
+/*
+ * Start the upcalls of the uids in \a buf in the background, e.g.
+ * "[0-999,5000]", so the users don't wait for the upcall on their first
+ * request. Set it as a permanent parameter to warm the cache at MDT start.
+ */
+int mdt_identity_warm(struct upcall_cache *cache, char *buf)
+{
+	struct cfs_expr_list *el;
+	struct cfs_range_expr *expr;
+	__u64 total = 0;
+	__u64 uid;
+	int rc;
+	ENTRY;
+
+	if (is_identity_get_disabled(cache))
+		RETURN(-EINVAL);
+
+	buf = strim(buf);
+	rc = cfs_expr_list_parse(buf, strlen(buf), 0, U32_MAX - 1, &el);
+	if (rc)
+		RETURN(rc);
+
+	list_for_each_entry(expr, &el->el_exprs, re_link)
+		total += (expr->re_hi - expr->re_lo) / expr->re_stride + 1;
+	if (total > MDT_IDENTITY_WARM_MAX)
+		GOTO(out, rc = -E2BIG);
+
+	list_for_each_entry(expr, &el->el_exprs, re_link) {
+		for (uid = expr->re_lo; uid <= expr->re_hi;
+		     uid += expr->re_stride) {
+			rc = upcall_cache_prefetch(cache, uid, NULL);
+			if (rc)
+				GOTO(out, rc);
+		}
+	}
+	CDEBUG(D_INFO, "%s: prefetching %llu identities\n",
+	       cache->uc_name, total);
+	EXIT;
+out:
+	cfs_expr_list_free(el);
+	return rc;
+}
+
 /*
  * If there is LNET_NID_ANY in perm[i].mp_nid,
  * it must be perm[0].mp_nid, and act as default perm.
@@ -985,6 +985,8 @@ void mdt_identity_put(struct upcall_cache *, struct md_identity *);
 
 void mdt_flush_identity(struct upcall_cache *, int);
 
+int mdt_identity_warm(struct upcall_cache *, char *);
+
 __u32 mdt_identity_get_perm(struct md_identity *, lnet_nid_t);
 
 /* mdt/mdt_recovery.c */
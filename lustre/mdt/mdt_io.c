@@ -537,7 +537,9 @@ int mdt_obd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 	struct mdt_thread_info *info = tsi2mdt_info(tsi);
 	struct lu_attr *la = &info->mti_attr.ma_attr;
 	struct mdt_device *mdt = mdt_dev(exp->exp_obd->obd_lu_dev);
+	struct lu_fid *fid = &tsi->tsi_fid;
 	struct mdt_object *mo;
+	bool multi;
 	char *jobid;
 	int rc = 0;
 
@@ -551,15 +553,28 @@ int mdt_obd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 	if (!oa || objcount != 1 || obj->ioo_bufcnt == 0) {
 		CERROR("%s: bad parameters %p/%i/%i\n",
 		       exp->exp_obd->obd_name, oa, objcount, obj->ioo_bufcnt);
-		rc = -EPROTO;
+		GOTO(out, rc = -EPROTO);
+	}
+
+	/* A write may have several objects, see tgt_brw_preprw(), so the
+	 * object is given by its ioobj and is referenced until commit, like
+	 * on OFD. Only the data of small DoM files is batched this way, their
+	 * open/create and close remain separate MDT requests. */
+	multi = cmd == OBD_BRW_WRITE && exp_connect_multiobj_brw(exp);
+	if (multi) {
+		fid = &info->mti_tmp_fid1;
+		rc = ostid_to_fid(fid, &obj->ioo_oid, 0);
+		if (rc)
+			GOTO(out, rc);
 	}
 
-	mo = mdt_object_find(env, mdt, &tsi->tsi_fid);
+	mo = mdt_object_find(env, mdt, fid);
 	if (IS_ERR(mo))
 		GOTO(out, rc = PTR_ERR(mo));
 
 	LASSERT(info->mti_object == NULL);
-	info->mti_object = mo;
+	if (!multi)
+		info->mti_object = mo;
 
 	if (cmd == OBD_BRW_WRITE) {
 		la_from_obdo(la, oa, OBD_MD_FLGETATTR);
@@ -742,10 +757,26 @@ int mdt_obd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 	struct mdt_thread_info *info = mdt_th_info(env);
 	struct mdt_device *mdt = mdt_dev(exp->exp_obd->obd_lu_dev);
 	struct mdt_object *mo = info->mti_object;
-	struct lu_attr *la = &info->mti_attr.ma_attr;
+	struct lu_attr *la;
 	__u64 valid;
 	int rc = 0;
 
+	if (cmd == OBD_BRW_WRITE && exp_connect_multiobj_brw(exp)) {
+		/* the previous object may have finished @info */
+		info = tsi2mdt_info(tgt_ses_info(env));
+		rc = ostid_to_fid(&info->mti_tmp_fid1, &obj->ioo_oid, 0);
+		if (rc)
+			RETURN(rc);
+		mo = mdt_object_find(env, mdt, &info->mti_tmp_fid1);
+		if (IS_ERR(mo))
+			RETURN(PTR_ERR(mo));
+		/* pair to mdt_object_find() in mdt_obd_preprw() */
+		mdt_object_put(env, mo);
+		/* put by mdt_thread_info_fini() */
+		info->mti_object = mo;
+	}
+	la = &info->mti_attr.ma_attr;
+
 	LASSERT(mo);
 
 	if (cmd == OBD_BRW_WRITE) {
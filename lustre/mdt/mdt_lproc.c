@@ -272,6 +272,111 @@ static ssize_t identity_acquire_expire_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(identity_acquire_expire);
 
+static ssize_t identity_stale_expire_show(struct kobject *kobj,
+					  struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lld\n",
+			 mdt->mdt_identity_cache->uc_stale_expire);
+}
+
+/* seconds an expired identity is still used while it is refreshed */
+static ssize_t identity_stale_expire_store(struct kobject *kobj,
+					   struct attribute *attr,
+					   const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	time64_t val;
+	int rc;
+
+	rc = kstrtoll(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > INT_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_stale_expire = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(identity_stale_expire);
+
+static ssize_t identity_negative_expire_show(struct kobject *kobj,
+					     struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lld\n",
+			 mdt->mdt_identity_cache->uc_neg_expire);
+}
+
+/* seconds a failed identity upcall is remembered */
+static ssize_t identity_negative_expire_store(struct kobject *kobj,
+					      struct attribute *attr,
+					      const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	time64_t val;
+	int rc;
+
+	rc = kstrtoll(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > INT_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_neg_expire = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(identity_negative_expire);
+
+static ssize_t identity_inflight_max_show(struct kobject *kobj,
+					  struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n",
+			 mdt->mdt_identity_cache->uc_inflight_max);
+}
+
+/* background identity upcalls awaiting their downcall at most, 0 no limit */
+static ssize_t identity_inflight_max_store(struct kobject *kobj,
+					   struct attribute *attr,
+					   const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_inflight_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(identity_inflight_max);
+
 static ssize_t identity_upcall_show(struct kobject *kobj,
 				    struct attribute *attr, char *buf)
 {
@@ -339,6 +444,27 @@ static ssize_t identity_flush_store(struct kobject *kobj,
 }
 LUSTRE_WO_ATTR(identity_flush);
 
+static ssize_t identity_warm_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	char *kbuf;
+	int rc;
+
+	kbuf = kstrndup(buffer, count, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	rc = mdt_identity_warm(mdt->mdt_identity_cache, kbuf);
+	kfree(kbuf);
+
+	return rc ? rc : count;
+}
+LUSTRE_WO_ATTR(identity_warm);
+
 static ssize_t
 lprocfs_identity_info_seq_write(struct file *file, const char __user *buffer,
 				size_t count, void *data)
@@ -1045,8 +1171,12 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_num_exports.attr,
 	&lustre_attr_identity_expire.attr,
 	&lustre_attr_identity_acquire_expire.attr,
+	&lustre_attr_identity_stale_expire.attr,
+	&lustre_attr_identity_negative_expire.attr,
+	&lustre_attr_identity_inflight_max.attr,
 	&lustre_attr_identity_upcall.attr,
 	&lustre_attr_identity_flush.attr,
+	&lustre_attr_identity_warm.attr,
 	&lustre_attr_evict_tgt_nids.attr,
 	&lustre_attr_enable_remote_dir.attr,
 	&lustre_attr_enable_remote_dir_gid.attr,
@@ -1426,7 +1426,7 @@ err_ns:
 	obd->obd_namespace = NULL;
 err_ops:
 	lu_site_purge(env, mgs2lu_dev(mgs)->ld_site, ~0);
-	if (!cfs_hash_is_empty(mgs2lu_dev(mgs)->ld_site->ls_obj_hash)) {
+	if (!lu_site_is_empty(mgs2lu_dev(mgs)->ld_site)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_OTHER, NULL);
 		lu_site_print(env, mgs2lu_dev(mgs)->ld_site, &msgdata,
 				lu_cdebug_printer);
@@ -1481,6 +1481,14 @@ static int mgs_object_init(const struct lu_env *env, struct lu_object *o,
 	return rc;
 }
 
+static void mgs_object_free_rcu(struct rcu_head *head)
+{
+	struct mgs_object *obj = container_of(head, struct mgs_object,
+					      mgo_header.loh_rcu);
+
+	OBD_FREE_PTR(obj);
+}
+
 static void mgs_object_free(const struct lu_env *env, struct lu_object *o)
 {
 	struct mgs_object *obj = lu2mgs_obj(o);
@@ -1488,7 +1496,7 @@ static void mgs_object_free(const struct lu_env *env, struct lu_object *o)
 
 	dt_object_fini(&obj->mgo_obj);
 	lu_object_header_fini(h);
-	OBD_FREE_PTR(obj);
+	call_rcu(&h->loh_rcu, mgs_object_free_rcu);
 }
 
 static int mgs_object_print(const struct lu_env *env, void *cookie,
@@ -1602,7 +1610,7 @@ static struct lu_device *mgs_device_fini(const struct lu_env *env,
 	obd->obd_namespace = NULL;
 
 	lu_site_purge(env, d->ld_site, ~0);
-	if (!cfs_hash_is_empty(d->ld_site->ls_obj_hash)) {
+	if (!lu_site_is_empty(d->ld_site)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_OTHER, NULL);
 		lu_site_print(env, d->ld_site, &msgdata, lu_cdebug_printer);
 	}
@@ -1754,6 +1762,8 @@ static int __init mgs_init(void)
 static void __exit mgs_exit(void)
 {
 	class_unregister_type(LUSTRE_MGS_NAME);
+	/* wait for mgs_object_free_rcu() callbacks */
+	rcu_barrier();
 }
 
 MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
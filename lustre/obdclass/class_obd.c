@@ -42,6 +42,7 @@
 
 #include <obd_support.h>
 #include <obd_class.h>
+#include <obd_cksum.h>
 #include <uapi/linux/lnet/lnetctl.h>
 #include <lustre_debug.h>
 #include <lustre_kernelcomm.h>
@@ -71,6 +72,9 @@ unsigned int obd_dump_on_eviction;
 EXPORT_SYMBOL(obd_dump_on_eviction);
 unsigned int obd_lbug_on_eviction;
 EXPORT_SYMBOL(obd_lbug_on_eviction);
+/* append the histograms of LPROCFS_CNTR_HISTOGRAM counters to "stats" */
+unsigned int obd_stats_hist;
+EXPORT_SYMBOL(obd_stats_hist);
 unsigned long obd_max_dirty_pages;
 EXPORT_SYMBOL(obd_max_dirty_pages);
 atomic_long_t obd_dirty_pages;
@@ -669,10 +673,14 @@ static int __init obdclass_init(void)
 	if (err)
 		goto cleanup_caches;
 
-	err = lu_global_init();
+	err = obd_dif_init();
 	if (err)
 		goto cleanup_class_procfs;
 
+	err = lu_global_init();
+	if (err)
+		goto cleanup_obd_dif;
+
 	err = cl_global_init();
 	if (err != 0)
 		goto cleanup_lu_global;
@@ -728,6 +736,9 @@ cleanup_cl_global:
 cleanup_lu_global:
 	lu_global_fini();
 
+cleanup_obd_dif:
+	obd_dif_fini();
+
 cleanup_class_procfs:
 	class_procfs_clean();
 
@@ -796,6 +807,7 @@ static void __exit obdclass_exit(void)
 #endif /* HAVE_SERVER_SUPPORT */
 	cl_global_fini();
 	lu_global_fini();
+	obd_dif_fini();
 
 	obd_cleanup_caches();
 
@@ -80,6 +80,401 @@ int obd_page_dif_generate_buffer(const char *obd_name, struct page *page,
 }
 EXPORT_SYMBOL(obd_page_dif_generate_buffer);
 
+/*
+ * Guard tags of different sectors are independent of each other, so the
+ * guards of a large bulk RPC can be generated by several threads at once.
+ * Only the final hash over the (ordered) guard buffer has to be serial,
+ * and that is a small fraction of the work since it only covers two bytes
+ * per sector.
+ */
+static int obd_dif_threads = 2;
+module_param(obd_dif_threads, int, 0444);
+MODULE_PARM_DESC(obd_dif_threads, "Number of T10-PI guard worker threads per CPU partition, 0 to disable");
+
+static int obd_dif_parallel_pages = 64;
+module_param(obd_dif_parallel_pages, int, 0644);
+MODULE_PARM_DESC(obd_dif_parallel_pages, "Minimum pages in a bulk RPC to generate T10-PI guards in parallel, 0 to disable");
+
+/* number of pages handed to a guard worker at once */
+#define OBD_DIF_CHUNK_PAGES	32
+
+struct obd_dif_sched {
+	struct cfs_wi_sched	*ods_sched;
+	int			 ods_nthreads;
+	/* guard buffer of the serial path, see obd_dif_generate_serial() */
+	struct mutex		 ods_guard_mutex;
+	struct page		*ods_guard_page;
+};
+
+static struct obd_dif_sched *obd_dif_scheds;
+
+/* a run of data pages whose guards are stored contiguously in one page */
+struct obd_dif_chunk {
+	int			 odc_start;
+	int			 odc_count;
+	int			 odc_gpage;
+	int			 odc_offset;
+};
+
+struct obd_dif_gpage {
+	struct page		*odg_page;
+	__u16			*odg_guards;
+	int			 odg_used;
+};
+
+struct obd_dif_job {
+	const char		*odj_name;
+	obd_dif_page_fn		*odj_page_fn;
+	void			*odj_data;
+	int			 odj_npages;
+	obd_dif_csum_fn		*odj_fn;
+	int			 odj_sector_size;
+	struct obd_dif_chunk	*odj_chunks;
+	int			 odj_nchunks;
+	struct obd_dif_gpage	*odj_gpages;
+	int			 odj_ngpages;
+	/* next chunk to be processed */
+	atomic_t		 odj_next;
+	/* the submitter plus the helpers not finished yet */
+	atomic_t		 odj_pending;
+	struct completion	 odj_done;
+	int			 odj_rc;
+};
+
+struct obd_dif_helper {
+	struct cfs_workitem	 odh_wi;
+	struct obd_dif_job	*odh_job;
+};
+
+/* number of guards obd_page_dif_generate_buffer() produces for a page */
+static inline int obd_dif_guard_count(__u32 offset, __u32 length,
+				      int sector_size)
+{
+	if (length == 0)
+		return 0;
+
+	return DIV_ROUND_UP(offset + length, sector_size) -
+	       offset / sector_size;
+}
+
+/*
+ * Split the pages into chunks of at most \a chunk_pages pages, never letting
+ * the guards of one chunk straddle two guard pages. When the job arrays are
+ * not allocated yet only the number of chunks and guard pages is counted.
+ */
+static void obd_dif_job_layout(struct obd_dif_job *job, int chunk_pages)
+{
+	const int guard_number = PAGE_SIZE / sizeof(__u16);
+	struct obd_dif_chunk *chunk = NULL;
+	int nchunks = 0;
+	int gpage = 0;
+	int count = 0;
+	int used = 0;
+	int i;
+
+	for (i = 0; i < job->odj_npages; i++) {
+		struct page *page;
+		__u32 offset;
+		__u32 length;
+		int guards;
+
+		job->odj_page_fn(job->odj_data, i, &page, &offset, &length);
+		guards = obd_dif_guard_count(offset, length,
+					     job->odj_sector_size);
+		if (used + guards > guard_number) {
+			if (job->odj_gpages)
+				job->odj_gpages[gpage].odg_used = used;
+			gpage++;
+			used = 0;
+			count = 0;
+		}
+
+		if (count == 0 || count == chunk_pages) {
+			if (job->odj_chunks) {
+				chunk = &job->odj_chunks[nchunks];
+				chunk->odc_start = i;
+				chunk->odc_count = 0;
+				chunk->odc_gpage = gpage;
+				chunk->odc_offset = used;
+			}
+			nchunks++;
+			count = 0;
+		}
+
+		if (chunk)
+			chunk->odc_count++;
+		count++;
+		used += guards;
+	}
+
+	if (job->odj_gpages)
+		job->odj_gpages[gpage].odg_used = used;
+	job->odj_nchunks = nchunks;
+	job->odj_ngpages = gpage + 1;
+}
+
+static int obd_dif_chunk_generate(struct obd_dif_job *job,
+				  struct obd_dif_chunk *chunk)
+{
+	struct obd_dif_gpage *gpage = &job->odj_gpages[chunk->odc_gpage];
+	int guard_number = PAGE_SIZE / sizeof(__u16) - chunk->odc_offset;
+	__u16 *guards = gpage->odg_guards + chunk->odc_offset;
+	int used;
+	int rc;
+	int i;
+
+	for (i = chunk->odc_start;
+	     i < chunk->odc_start + chunk->odc_count; i++) {
+		struct page *page;
+		__u32 offset;
+		__u32 length;
+
+		job->odj_page_fn(job->odj_data, i, &page, &offset, &length);
+		rc = obd_page_dif_generate_buffer(job->odj_name, page, offset,
+						  length, guards, guard_number,
+						  &used, job->odj_sector_size,
+						  job->odj_fn);
+		if (rc)
+			return rc;
+
+		guards += used;
+		guard_number -= used;
+	}
+
+	return 0;
+}
+
+static void obd_dif_job_run(struct obd_dif_job *job)
+{
+	int i;
+
+	while ((i = atomic_inc_return(&job->odj_next) - 1) <
+	       job->odj_nchunks) {
+		int rc;
+
+		if (READ_ONCE(job->odj_rc))
+			break;
+
+		rc = obd_dif_chunk_generate(job, &job->odj_chunks[i]);
+		if (rc)
+			cmpxchg(&job->odj_rc, 0, rc);
+	}
+}
+
+static int obd_dif_helper_action(struct cfs_workitem *wi)
+{
+	struct obd_dif_helper *odh = container_of(wi, struct obd_dif_helper,
+						  odh_wi);
+	struct obd_dif_job *job = odh->odh_job;
+
+	obd_dif_job_run(job);
+	if (atomic_dec_and_test(&job->odj_pending))
+		complete(&job->odj_done);
+
+	/* the submitter may free the workitem as soon as it is woken up */
+	return 1;
+}
+
+/*
+ * Generate the guards of the pages one after the other in a single guard
+ * page, adding it to the hash whenever it is full. This is used for the
+ * RPCs below obd_dif_parallel_pages, so the guard page of the CPU partition
+ * is used instead of allocating one. Only when another thread of the same
+ * partition is using it is a page allocated.
+ */
+static int obd_dif_generate_serial(const char *obd_name,
+				   struct ahash_request *req, int npages,
+				   obd_dif_page_fn *page_fn, void *data,
+				   int sector_size, obd_dif_csum_fn *fn)
+{
+	const int guard_number = PAGE_SIZE / sizeof(__u16);
+	struct obd_dif_sched *ods = NULL;
+	struct page *gpage = NULL;
+	__u16 *guards;
+	int used_number = 0;
+	int rc = 0;
+	int i;
+
+	if (obd_dif_scheds != NULL) {
+		ods = &obd_dif_scheds[cfs_cpt_current(cfs_cpt_table, 0)];
+		if (ods->ods_guard_page != NULL &&
+		    mutex_trylock(&ods->ods_guard_mutex))
+			gpage = ods->ods_guard_page;
+		else
+			ods = NULL;
+	}
+	if (gpage == NULL) {
+		gpage = alloc_page(GFP_KERNEL);
+		if (gpage == NULL)
+			return -ENOMEM;
+	}
+	guards = kmap(gpage);
+
+	for (i = 0; i < npages; i++) {
+		struct page *page;
+		__u32 offset;
+		__u32 length;
+		int used;
+
+		page_fn(data, i, &page, &offset, &length);
+		if (used_number + obd_dif_guard_count(offset, length,
+						      sector_size) >
+		    guard_number) {
+			rc = cfs_crypto_hash_update_page(req, gpage, 0,
+					used_number * sizeof(*guards));
+			if (rc)
+				break;
+			used_number = 0;
+		}
+
+		rc = obd_page_dif_generate_buffer(obd_name, page, offset,
+						  length,
+						  guards + used_number,
+						  guard_number - used_number,
+						  &used, sector_size, fn);
+		if (rc)
+			break;
+		used_number += used;
+	}
+	if (rc == 0 && used_number != 0)
+		rc = cfs_crypto_hash_update_page(req, gpage, 0,
+						 used_number * sizeof(*guards));
+
+	kunmap(gpage);
+	if (ods != NULL)
+		mutex_unlock(&ods->ods_guard_mutex);
+	else
+		__free_page(gpage);
+
+	return rc;
+}
+
+/**
+ * Generate T10-PI guards of a set of pages and feed them to a hash
+ *
+ * The guards are computed for every page in order, exactly as a loop over
+ * obd_page_dif_generate_buffer() would do, and the resulting guard buffer is
+ * added to \a req. If the request is large enough, chunks of pages are
+ * handed to the guard worker threads of the current CPU partition while the
+ * calling thread works on the remaining chunks, so the result does not
+ * depend on how the work was split. Smaller requests are done by the
+ * calling thread without allocating anything.
+ *
+ * \param[in] obd_name		name of the OBD device, for error messages
+ * \param[in] req		hash the guards are added to
+ * \param[in] npages		number of data pages
+ * \param[in] page_fn		returns page, offset and length of a page index
+ * \param[in] data		opaque argument of \a page_fn
+ * \param[in] sector_size	T10-PI sector size
+ * \param[in] fn		guard function
+ *
+ * \retval			0 on success
+ * \retval			negative errno on failure
+ */
+int obd_dif_generate_pages(const char *obd_name, struct ahash_request *req,
+			   int npages, obd_dif_page_fn *page_fn, void *data,
+			   int sector_size, obd_dif_csum_fn *fn)
+{
+	struct obd_dif_job job = {
+		.odj_name	 = obd_name,
+		.odj_page_fn	 = page_fn,
+		.odj_data	 = data,
+		.odj_npages	 = npages,
+		.odj_fn		 = fn,
+		.odj_sector_size = sector_size,
+	};
+	struct obd_dif_helper *helpers = NULL;
+	struct obd_dif_sched *ods;
+	int chunk_pages = OBD_DIF_CHUNK_PAGES;
+	int nhelpers;
+	int rc = 0;
+	int i;
+
+	if (npages == 0)
+		return 0;
+
+	if (obd_dif_scheds == NULL || obd_dif_parallel_pages <= 0 ||
+	    npages < obd_dif_parallel_pages)
+		return obd_dif_generate_serial(obd_name, req, npages, page_fn,
+					       data, sector_size, fn);
+
+	ods = &obd_dif_scheds[cfs_cpt_current(cfs_cpt_table, 1)];
+	if (ods->ods_nthreads == 0)
+		return obd_dif_generate_serial(obd_name, req, npages, page_fn,
+					       data, sector_size, fn);
+
+	obd_dif_job_layout(&job, chunk_pages);
+	OBD_ALLOC(job.odj_chunks, job.odj_nchunks * sizeof(*job.odj_chunks));
+	if (job.odj_chunks == NULL)
+		return -ENOMEM;
+
+	OBD_ALLOC(job.odj_gpages, job.odj_ngpages * sizeof(*job.odj_gpages));
+	if (job.odj_gpages == NULL)
+		GOTO(out_chunks, rc = -ENOMEM);
+
+	for (i = 0; i < job.odj_ngpages; i++) {
+		job.odj_gpages[i].odg_page = alloc_page(GFP_KERNEL);
+		if (job.odj_gpages[i].odg_page == NULL)
+			GOTO(out_gpages, rc = -ENOMEM);
+		job.odj_gpages[i].odg_guards =
+			kmap(job.odj_gpages[i].odg_page);
+	}
+
+	/* now fill in the chunks and the number of guards per page */
+	obd_dif_job_layout(&job, chunk_pages);
+
+	nhelpers = min(job.odj_nchunks - 1, ods->ods_nthreads);
+	if (nhelpers > 0) {
+		OBD_ALLOC(helpers, nhelpers * sizeof(*helpers));
+		if (helpers == NULL)
+			nhelpers = 0;
+	}
+
+	atomic_set(&job.odj_next, 0);
+	atomic_set(&job.odj_pending, nhelpers + 1);
+	init_completion(&job.odj_done);
+	for (i = 0; i < nhelpers; i++) {
+		helpers[i].odh_job = &job;
+		cfs_wi_init(&helpers[i].odh_wi, obd_dif_helper_action);
+		cfs_wi_schedule(ods->ods_sched, &helpers[i].odh_wi);
+	}
+
+	obd_dif_job_run(&job);
+	/* all the chunks are taken, so don't wait for the helpers which did
+	 * not start yet, e.g. because the worker threads are busy */
+	for (i = 0; i < nhelpers; i++)
+		if (cfs_wi_deschedule(ods->ods_sched, &helpers[i].odh_wi))
+			atomic_dec(&job.odj_pending);
+	if (!atomic_dec_and_test(&job.odj_pending))
+		wait_for_completion(&job.odj_done);
+
+	rc = job.odj_rc;
+	for (i = 0; i < job.odj_ngpages && rc == 0; i++) {
+		if (job.odj_gpages[i].odg_used == 0)
+			continue;
+
+		rc = cfs_crypto_hash_update_page(req,
+				job.odj_gpages[i].odg_page, 0,
+				job.odj_gpages[i].odg_used * sizeof(__u16));
+	}
+
+	if (helpers != NULL)
+		OBD_FREE(helpers, nhelpers * sizeof(*helpers));
+out_gpages:
+	for (i = 0; i < job.odj_ngpages; i++) {
+		if (job.odj_gpages[i].odg_page == NULL)
+			break;
+		kunmap(job.odj_gpages[i].odg_page);
+		__free_page(job.odj_gpages[i].odg_page);
+	}
+	OBD_FREE(job.odj_gpages, job.odj_ngpages * sizeof(*job.odj_gpages));
+out_chunks:
+	OBD_FREE(job.odj_chunks, job.odj_nchunks * sizeof(*job.odj_chunks));
+
+	return rc;
+}
+EXPORT_SYMBOL(obd_dif_generate_pages);
+
 static int __obd_t10_performance_test(const char *obd_name,
 				      enum cksum_types cksum_type,
 				      struct page *data_page,
@@ -158,6 +553,52 @@ out:
 	return rc;
 }
 
+static void obd_t10_performance_page(void *data, int index,
+				     struct page **page, __u32 *offset,
+				     __u32 *length)
+{
+	*page = data;
+	*offset = 0;
+	*length = PAGE_SIZE;
+}
+
+/* same as __obd_t10_performance_test(), using the guard worker threads */
+static int __obd_t10_parallel_performance_test(const char *obd_name,
+					       enum cksum_types cksum_type,
+					       struct page *data_page,
+					       int page_number)
+{
+	unsigned char cfs_alg = cksum_obd2cfs(OBD_CKSUM_T10_TOP);
+	struct ahash_request *req;
+	obd_dif_csum_fn *fn = NULL;
+	unsigned int bufsize;
+	int sector_size = 0;
+	__u32 cksum;
+	int rc;
+	int rc2;
+
+	obd_t10_cksum2dif(cksum_type, &fn, &sector_size);
+	if (!fn)
+		return -EINVAL;
+
+	req = cfs_crypto_hash_init(cfs_alg, NULL, 0);
+	if (IS_ERR(req)) {
+		rc = PTR_ERR(req);
+		CERROR("%s: unable to initialize checksum hash %s: rc = %d\n",
+		       obd_name, cfs_crypto_hash_name(cfs_alg), rc);
+		return rc;
+	}
+
+	rc = obd_dif_generate_pages(obd_name, req, page_number,
+				    obd_t10_performance_page, data_page,
+				    sector_size, fn);
+
+	bufsize = sizeof(cksum);
+	rc2 = cfs_crypto_hash_final(req, (unsigned char *)&cksum, &bufsize);
+
+	return rc ? rc : rc2;
+}
+
 /**
  *  Array of T10PI checksum algorithm speed in MByte per second
  */
@@ -235,6 +676,32 @@ static void obd_t10_performance_test(const char *obd_name,
 			break;
 	}
 	end = jiffies;
+
+	/*
+	 * The speed used to select the checksum type is the single thread
+	 * one, so that it stays comparable with cfs_crypto_performance_test().
+	 * Only report what the guard worker threads achieve on a 4MB RPC.
+	 */
+	if (rc == 0 && obd_dif_scheds != NULL && obd_dif_threads > 0) {
+		unsigned long pstart;
+		unsigned long pend;
+		unsigned long pcount;
+		int rc2 = 0;
+
+		for (pstart = jiffies,
+		     pend = pstart + cfs_time_seconds(1) / 4, pcount = 0;
+		     time_before(jiffies, pend) && rc2 == 0; pcount++)
+			rc2 = __obd_t10_parallel_performance_test(obd_name,
+					cksum_type, page, (4 << 20) / PAGE_SIZE);
+		pend = jiffies;
+		if (rc2 == 0 && pend != pstart)
+			CDEBUG(D_CONFIG, "%s: T10 checksum algorithm %s "
+			       "parallel speed = %lu MB/s\n", obd_name,
+			       obd_t10_cksum_name(index),
+			       ((pcount * (4 << 20) /
+				 jiffies_to_msecs(pend - pstart)) * 1000) /
+			       (1024 * 1024));
+	}
 	__free_page(page);
 out:
 	if (rc) {
@@ -275,3 +742,63 @@ int obd_t10_cksum_speed(const char *obd_name,
 #endif /* !CONFIG_CRC_T10DIF */
 }
 EXPORT_SYMBOL(obd_t10_cksum_speed);
+
+void obd_dif_fini(void)
+{
+#if IS_ENABLED(CONFIG_CRC_T10DIF)
+	int ncpts = cfs_cpt_number(cfs_cpt_table);
+	int i;
+
+	if (obd_dif_scheds == NULL)
+		return;
+
+	for (i = 0; i < ncpts; i++) {
+		if (obd_dif_scheds[i].ods_sched != NULL)
+			cfs_wi_sched_destroy(obd_dif_scheds[i].ods_sched);
+		if (obd_dif_scheds[i].ods_guard_page != NULL)
+			__free_page(obd_dif_scheds[i].ods_guard_page);
+	}
+	OBD_FREE(obd_dif_scheds, ncpts * sizeof(*obd_dif_scheds));
+	obd_dif_scheds = NULL;
+#endif /* CONFIG_CRC_T10DIF */
+}
+
+int obd_dif_init(void)
+{
+#if IS_ENABLED(CONFIG_CRC_T10DIF)
+	int ncpts = cfs_cpt_number(cfs_cpt_table);
+	int rc;
+	int i;
+
+	OBD_ALLOC(obd_dif_scheds, ncpts * sizeof(*obd_dif_scheds));
+	if (obd_dif_scheds == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < ncpts; i++) {
+		/* the submitting thread takes its share of the work too */
+		int nthrs = min(obd_dif_threads,
+				cfs_cpt_weight(cfs_cpt_table, i) - 1);
+
+		mutex_init(&obd_dif_scheds[i].ods_guard_mutex);
+		obd_dif_scheds[i].ods_guard_page = alloc_page(GFP_KERNEL);
+		if (obd_dif_scheds[i].ods_guard_page == NULL) {
+			obd_dif_fini();
+			return -ENOMEM;
+		}
+
+		if (nthrs <= 0)
+			continue;
+
+		rc = cfs_wi_sched_create("obd_dif", cfs_cpt_table, i, nthrs,
+					 &obd_dif_scheds[i].ods_sched);
+		if (rc != 0) {
+			CERROR("obdclass: cannot start T10-PI guard threads "
+			       "on CPT %d: rc = %d\n", i, rc);
+			obd_dif_fini();
+			return rc;
+		}
+		obd_dif_scheds[i].ods_nthreads = nthrs;
+	}
+#endif /* CONFIG_CRC_T10DIF */
+	return 0;
+}
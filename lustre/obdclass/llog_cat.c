@@ -840,6 +840,57 @@ static int llog_cat_process_common(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Read ahead the plain llog following \a rec in the catalog.
+ *
+ * Catalog records have a fixed size and the chunk holding \a rec is still
+ * in the buffer of llog_process_thread(), with the file offset of \a rec
+ * saved in the lgi_cookie. Look for the next live record in that chunk and
+ * let the llog backend start reading its plain llog, which overlaps with
+ * the processing of the current one. Nothing is done when the next record
+ * is in another chunk, it will be found when that chunk is processed.
+ *
+ * \param[in] env	execution environment
+ * \param[in] cat_llh	llog handle of the catalog
+ * \param[in] rec	catalog record being processed
+ */
+static void llog_cat_prefetch_next(const struct lu_env *env,
+				   struct llog_handle *cat_llh,
+				   struct llog_rec_hdr *rec)
+{
+	struct llog_log_hdr *llh = cat_llh->lgh_hdr;
+	struct llog_logid_rec *lir;
+	struct llog_rec_hdr *next;
+	__u32 chunk_size = llh->llh_hdr.lrh_len;
+	__u32 left;
+
+	if (env == NULL || cat_llh->lgh_logops->lop_prefetch == NULL)
+		return;
+
+	left = chunk_size -
+	       (llog_info(env)->lgi_cookie.lgc_offset & (chunk_size - 1));
+	if (left < rec->lrh_len)
+		return;
+	left -= rec->lrh_len;
+
+	for (next = llog_rec_hdr_next(rec); left >= sizeof(*lir);
+	     left -= sizeof(*lir), next = llog_rec_hdr_next(next)) {
+		if (LLOG_REC_HDR_NEEDS_SWABBING(next) ||
+		    next->lrh_type != LLOG_LOGID_MAGIC ||
+		    next->lrh_len != sizeof(*lir) ||
+		    next->lrh_index <= rec->lrh_index ||
+		    next->lrh_index >= LLOG_HDR_BITMAP_SIZE(llh))
+			return;
+
+		if (ext2_test_bit(next->lrh_index, LLOG_HDR_BITMAP(llh))) {
+			lir = container_of(next, typeof(*lir), lid_hdr);
+			cat_llh->lgh_logops->lop_prefetch(env, cat_llh,
+							  &lir->lid_id);
+			return;
+		}
+	}
+}
+
 static int llog_cat_process_cb(const struct lu_env *env,
 			       struct llog_handle *cat_llh,
 			       struct llog_rec_hdr *rec, void *data)
@@ -849,6 +900,9 @@ static int llog_cat_process_cb(const struct lu_env *env,
 	int rc;
 
 	ENTRY;
+	if (rec->lrh_index >= d->lpd_startcat)
+		llog_cat_prefetch_next(env, cat_llh, rec);
+
 	rc = llog_cat_process_common(env, cat_llh, rec, &llh);
 	if (rc)
 		GOTO(out, rc);
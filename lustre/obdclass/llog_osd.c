@@ -857,6 +857,91 @@ static void changelog_block_trim_ext(struct llog_rec_hdr *hdr,
 	} while ((char *)hdr <= (char *)last_hdr);
 }
 
+/* number of chunks to read ahead of the current one */
+#define LLOG_READAHEAD_CHUNKS	8
+
+/**
+ * Start asynchronous reads of the llog chunks following \a offset.
+ *
+ * llog processing reads one chunk at a time and waits for each read, so
+ * ask the OSD to bring in the next LLOG_READAHEAD_CHUNKS chunks while
+ * the records of the current one are being handled. A new window is
+ * only issued once half of the previous one has been consumed.
+ *
+ * \param[in] env	execution environment
+ * \param[in] loghandle	llog handle of the current llog
+ * \param[in] offset	offset of the chunk about to be read
+ * \param[in] size	current llog size
+ */
+static void llog_osd_readahead(const struct lu_env *env,
+			       struct llog_handle *loghandle, __u64 offset,
+			       __u64 size)
+{
+	struct dt_object *o = loghandle->lgh_obj;
+	__u32 chunk_size = loghandle->lgh_hdr->llh_hdr.lrh_len;
+	__u64 window = (__u64)chunk_size * LLOG_READAHEAD_CHUNKS;
+	__u64 start;
+	__u64 end;
+
+	if (dt_object_remote(o) || o->do_body_ops == NULL ||
+	    o->do_body_ops->dbo_ladvise == NULL)
+		return;
+
+	offset &= ~((__u64)chunk_size - 1);
+	start = loghandle->lgh_ra_offset;
+	if (start > offset && start <= offset + window) {
+		if (start >= offset + window / 2)
+			return;
+	} else {
+		/* first read or a seek, restart the window */
+		start = offset + chunk_size;
+	}
+
+	end = min(offset + window, size);
+	if (start >= end)
+		return;
+
+	dt_ladvise(env, o, start, end, LU_LADVISE_WILLREAD);
+	loghandle->lgh_ra_offset = end;
+}
+
+/**
+ * Implementation of the llog_operations::lop_prefetch
+ *
+ * Called by catalog processing for the plain llog following the one being
+ * processed, so the reads of its header and first chunks are done by the
+ * OSD while the records of the current plain llog are handled.
+ *
+ * \param[in] env	execution environment
+ * \param[in] cathandle	llog handle of the catalog
+ * \param[in] logid	llog ID of the plain llog to read ahead
+ */
+static void llog_osd_prefetch(const struct lu_env *env,
+			      struct llog_handle *cathandle,
+			      struct llog_logid *logid)
+{
+	struct dt_object *o;
+	struct lu_fid fid;
+	__u64 window;
+
+	if (cathandle->lgh_obj == NULL || dt_object_remote(cathandle->lgh_obj))
+		return;
+
+	logid_to_fid(logid, &fid);
+	o = dt_locate(env, lu2dt_dev(cathandle->lgh_obj->do_lu.lo_dev), &fid);
+	if (IS_ERR(o))
+		return;
+
+	if (dt_object_exists(o) && !dt_object_remote(o) &&
+	    o->do_body_ops != NULL && o->do_body_ops->dbo_ladvise != NULL) {
+		/* plain llogs use the chunk size of their catalog */
+		window = (__u64)cathandle->lgh_hdr->llh_hdr.lrh_len *
+			 LLOG_READAHEAD_CHUNKS;
+		dt_ladvise(env, o, 0, window, LU_LADVISE_WILLREAD);
+	}
+	dt_object_put(env, o);
+}
+
 /**
  * Implementation of the llog_operations::lop_next_block
  *
@@ -922,6 +1007,9 @@ static int llog_osd_next_block(const struct lu_env *env,
 		llog_skip_over(loghandle, cur_offset, *cur_idx,
 			       next_idx, chunk_size, force_mini_rec);
 
+		llog_osd_readahead(env, loghandle, *cur_offset,
+				   lgi->lgi_attr.la_size);
+
 		/* read up to next llog chunk_size block */
 		lgi->lgi_buf.lb_len = chunk_size -
 				      (*cur_offset & (chunk_size - 1));
@@ -1941,6 +2029,7 @@ struct llog_operations llog_osd_ops = {
 	.lop_declare_write_rec	= llog_osd_declare_write_rec,
 	.lop_write_rec		= llog_osd_write_rec,
 	.lop_close		= llog_osd_close,
+	.lop_prefetch		= llog_osd_prefetch,
 };
 EXPORT_SYMBOL(llog_osd_ops);
 
@@ -1959,6 +2048,7 @@ struct llog_operations llog_common_cat_ops = {
 	.lop_declare_write_rec	= llog_osd_declare_write_rec,
 	.lop_write_rec		= llog_osd_write_rec,
 	.lop_close		= llog_osd_close,
+	.lop_prefetch		= llog_osd_prefetch,
 	.lop_add		= llog_cat_add_rec,
 	.lop_declare_add	= llog_cat_declare_add_rec,
 };
@@ -2098,6 +2098,157 @@ ctxt_release:
 	RETURN(rc);
 }
 
+struct llog_test_11_data {
+	int ltd_count;
+	int ltd_cat_idx;
+	int ltd_rec_idx;
+};
+
+static int test_11_check_cb(const struct lu_env *env, struct llog_handle *llh,
+			    struct llog_rec_hdr *rec, void *data)
+{
+	struct llog_test_11_data *ltd = data;
+	int cat_idx = llh->u.phd.phd_cookie.lgc_index;
+
+	if (!(llh->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN)) {
+		CERROR("log is not plain\n");
+		RETURN(-EINVAL);
+	}
+
+	/* records must come plain llog after plain llog, in order */
+	if (cat_idx < ltd->ltd_cat_idx ||
+	    (cat_idx == ltd->ltd_cat_idx &&
+	     rec->lrh_index <= ltd->ltd_rec_idx)) {
+		CERROR("record %d of log %d seen after record %d of log %d\n",
+		       rec->lrh_index, cat_idx, ltd->ltd_rec_idx,
+		       ltd->ltd_cat_idx);
+		RETURN(-ERANGE);
+	}
+	ltd->ltd_cat_idx = cat_idx;
+	ltd->ltd_rec_idx = rec->lrh_index;
+	ltd->ltd_count++;
+
+	RETURN(0);
+}
+
+static int test_11_cancel_cb(const struct lu_env *env, struct llog_handle *llh,
+			     struct llog_rec_hdr *rec, void *data)
+{
+	struct llog_test_11_data *ltd = data;
+
+	ltd->ltd_count++;
+	return LLOG_DEL_RECORD;
+}
+
+/* number of plain llogs in the catalog of test 11 */
+#define LLOG_TEST_11_LOGS	8
+
+/* Test processing of a catalog with many plain llogs, which are read ahead
+ * one by one while the previous one is processed */
+static int llog_test_11(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_test_11_data ltd;
+	struct llog_handle *cath;
+	struct llog_handle *cur;
+	struct llog_mini_rec lmr;
+	struct llog_ctxt *ctxt;
+	char name[10];
+	int rc, rc2, num_recs = 0;
+
+	ENTRY;
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	lmr.lmr_hdr.lrh_len = lmr.lmr_tail.lrt_len = LLOG_MIN_REC_SIZE;
+	lmr.lmr_hdr.lrh_type = 0xf00f00;
+
+	snprintf(name, sizeof(name), "%x", llog_test_rand + 3);
+	CWARN("11a: create a catalog log with name: %s\n", name);
+	rc = llog_open_create(env, ctxt, &cath, NULL, name);
+	if (rc) {
+		CERROR("11a: llog_create with name %s failed: %d\n", name, rc);
+		GOTO(ctxt_release, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("11a: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	/* limit plain llogs to 16 chunks so the catalog spans many of them */
+	CWARN("11b: write records into %d plain llogs\n", LLOG_TEST_11_LOGS);
+	while (cath->lgh_hdr->llh_count <= LLOG_TEST_11_LOGS) {
+		rc = llog_cat_add(env, cath, &lmr.lmr_hdr, NULL);
+		if (rc) {
+			CERROR("11b: write record failed at #%d: %d\n",
+			       num_recs + 1, rc);
+			GOTO(out, rc);
+		}
+		num_recs++;
+
+		cur = cath->u.chd.chd_current_log;
+		if (cur != NULL &&
+		    cur->lgh_max_size > LLOG_MIN_CHUNK_SIZE * 16)
+			cur->lgh_max_size = LLOG_MIN_CHUNK_SIZE * 16;
+	}
+
+	rc = verify_handle("11b", cath, LLOG_TEST_11_LOGS + 1);
+	if (rc)
+		GOTO(out, rc);
+
+	CWARN("11c: process %d records in order\n", num_recs);
+	memset(&ltd, 0, sizeof(ltd));
+	rc = llog_cat_process(env, cath, test_11_check_cb, &ltd, 0, 0);
+	if (rc) {
+		CERROR("11c: process with test_11_check_cb failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	if (ltd.ltd_count != num_recs) {
+		CERROR("11c: processed %d records from %d total\n",
+		       ltd.ltd_count, num_recs);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	CWARN("11d: process the catalog starting from log 3\n");
+	memset(&ltd, 0, sizeof(ltd));
+	rc = llog_cat_process(env, cath, test_11_check_cb, &ltd, 3, 0);
+	if (rc) {
+		CERROR("11d: process with test_11_check_cb failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	if (ltd.ltd_count == 0 || ltd.ltd_count >= num_recs) {
+		CERROR("11d: processed %d records from %d total\n",
+		       ltd.ltd_count, num_recs);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	CWARN("11e: cancel all records\n");
+	memset(&ltd, 0, sizeof(ltd));
+	rc = llog_cat_process(env, cath, test_11_cancel_cb, &ltd, 0, 0);
+	if (rc) {
+		CERROR("11e: process with test_11_cancel_cb failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	if (ltd.ltd_count != num_recs) {
+		CERROR("11e: cancelled %d records from %d total\n",
+		       ltd.ltd_count, num_recs);
+		GOTO(out, rc = -EINVAL);
+	}
+
+out:
+	CWARN("11f: put newly-created catalog\n");
+	rc2 = llog_cat_close(env, cath);
+	if (rc2) {
+		CERROR("11f: close log %s failed: %d\n", name, rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	RETURN(rc);
+}
+
 /*
  * -------------------------------------------------------------------------
  * Tests above, boring obd functions below
@@ -2156,6 +2307,10 @@ static int llog_run_tests(const struct lu_env *env, struct obd_device *obd)
 	if (rc)
 		GOTO(cleanup, rc);
 
+	rc = llog_test_11(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
 cleanup:
 	err = llog_destroy(env, llh);
 	if (err)
@@ -58,6 +58,14 @@ static int ls_object_init(const struct lu_env *env, struct lu_object *o,
 	RETURN(0);
 }
 
+static void ls_object_free_rcu(struct rcu_head *head)
+{
+	struct ls_object *obj = container_of(head, struct ls_object,
+					     ls_header.loh_rcu);
+
+	OBD_FREE_PTR(obj);
+}
+
 static void ls_object_free(const struct lu_env *env, struct lu_object *o)
 {
 	struct ls_object	*obj = lu2ls_obj(o);
@@ -65,7 +73,7 @@ static void ls_object_free(const struct lu_env *env, struct lu_object *o)
 
 	dt_object_fini(&obj->ls_obj);
 	lu_object_header_fini(h);
-	OBD_FREE_PTR(obj);
+	call_rcu(&h->loh_rcu, ls_object_free_rcu);
 }
 
 static struct lu_object_operations ls_lu_obj_ops = {
@@ -41,6 +41,26 @@
 #include <lprocfs_status.h>
 
 #ifdef CONFIG_PROC_FS
+/*
+ * Histogram buckets for a CPU are allocated the first time that CPU
+ * updates the counter, like the per-cpu counters themselves. Stats that
+ * may be updated from interrupt context have all slots preallocated by
+ * lprocfs_counter_init().
+ */
+static void lprocfs_counter_hist_add(struct lprocfs_counter_header *header,
+				     int smp_id, long amount)
+{
+	struct lprocfs_counter_hist *hist = header->lc_hist[smp_id];
+
+	if (unlikely(!hist)) {
+		LIBCFS_ALLOC_ATOMIC(hist, sizeof(*hist));
+		if (!hist)
+			return;
+		header->lc_hist[smp_id] = hist;
+	}
+	hist->lh_buckets[lprocfs_hist_bucket(amount)]++;
+}
+
 void lprocfs_counter_add(struct lprocfs_stats *stats, int idx, long amount)
 {
 	struct lprocfs_counter		*percpu_cntr;
@@ -88,6 +108,8 @@ void lprocfs_counter_add(struct lprocfs_stats *stats, int idx, long amount)
 		if (amount > percpu_cntr->lc_max)
 			percpu_cntr->lc_max = amount;
 	}
+	if (header->lc_config & LPROCFS_CNTR_HISTOGRAM)
+		lprocfs_counter_hist_add(header, smp_id, amount);
 	lprocfs_stats_unlock(stats, LPROCFS_GET_SMP_ID, &flags);
 }
 EXPORT_SYMBOL(lprocfs_counter_add);
@@ -67,10 +67,25 @@ struct job_stat {
 	atomic_t		js_refcount;	/* num users of this struct */
 	char			js_jobid[LUSTRE_JOBID_SIZE]; /* job name + NUL*/
 	time64_t		js_timestamp;	/* seconds of most recent stat*/
+	__u64			js_generation;	/* ojs_generation at last stat */
 	struct lprocfs_stats	*js_stats;	/* per-job statistics */
 	struct obd_job_stats	*js_jobstats;	/* for accessing ojs_lock */
 };
 
+/*
+ * Removed job, kept for the delta reads of job_stats_bin. Tombstones are
+ * on ojs_tombstones in removal order, and are dropped by the jobstats
+ * cleanup or when there are more than JOB_TOMBSTONES_MAX of them.
+ */
+struct job_tombstone {
+	struct list_head	jt_list;	/* on ojs_tombstones */
+	char			jt_jobid[LUSTRE_JOBID_SIZE];
+	time64_t		jt_timestamp;	/* seconds of removal */
+	__u64			jt_generation;	/* ojs_generation at removal */
+};
+
+#define JOB_TOMBSTONES_MAX	4096
+
 static unsigned
 job_stat_hash(struct cfs_hash *hs, const void *key, unsigned mask)
 {
@@ -104,14 +119,54 @@ static void job_stat_get(struct cfs_hash *hs, struct hlist_node *hnode)
 	atomic_inc(&job->js_refcount);
 }
 
+/* drop the oldest tombstone, called with ojs_lock held for write */
+static void job_tombstone_drop(struct obd_job_stats *stats)
+{
+	struct job_tombstone *jt;
+
+	jt = list_first_entry(&stats->ojs_tombstones, struct job_tombstone,
+			      jt_list);
+	list_del(&jt->jt_list);
+	stats->ojs_tombstone_count--;
+	/* delta reads from before this must be served as full snapshots */
+	stats->ojs_pruned_gen = jt->jt_generation;
+	OBD_FREE_PTR(jt);
+}
+
 static void job_free(struct job_stat *job)
 {
+	struct obd_job_stats *stats = job->js_jobstats;
+	struct job_tombstone *jt;
+
 	LASSERT(atomic_read(&job->js_refcount) == 0);
 	LASSERT(job->js_jobstats != NULL);
 
-	write_lock(&job->js_jobstats->ojs_lock);
-	list_del_init(&job->js_list);
-	write_unlock(&job->js_jobstats->ojs_lock);
+	/* may be called under the hash bucket lock */
+	OBD_ALLOC_GFP(jt, sizeof(*jt), GFP_ATOMIC);
+
+	write_lock(&stats->ojs_lock);
+	if (!list_empty(&job->js_list)) {
+		__u64 gen = atomic64_read(&stats->ojs_generation);
+
+		list_del_init(&job->js_list);
+		if (jt != NULL) {
+			memcpy(jt->jt_jobid, job->js_jobid,
+			       sizeof(jt->jt_jobid));
+			jt->jt_timestamp = ktime_get_real_seconds();
+			jt->jt_generation = gen;
+			list_add_tail(&jt->jt_list, &stats->ojs_tombstones);
+			if (++stats->ojs_tombstone_count > JOB_TOMBSTONES_MAX)
+				job_tombstone_drop(stats);
+			jt = NULL;
+		} else {
+			/* no tombstone, delta readers have to resync */
+			stats->ojs_pruned_gen = gen;
+		}
+	}
+	write_unlock(&stats->ojs_lock);
+
+	if (jt != NULL)
+		OBD_FREE_PTR(jt);
 
 	lprocfs_free_stats(&job->js_stats);
 	OBD_FREE_PTR(job);
@@ -231,11 +286,34 @@ static void lprocfs_job_cleanup(struct obd_job_stats *stats, int before)
 			       &oldest);
 
 	write_lock(&stats->ojs_lock);
+	/* tombstones expire like the jobs, readers that are slower than
+	 * this get a full snapshot */
+	while (!list_empty(&stats->ojs_tombstones) &&
+	       list_first_entry(&stats->ojs_tombstones, struct job_tombstone,
+				jt_list)->jt_timestamp < oldest)
+		job_tombstone_drop(stats);
 	stats->ojs_cleaning = false;
 	stats->ojs_last_cleanup = ktime_get_real_seconds();
 	write_unlock(&stats->ojs_lock);
 }
 
+/*
+ * Record the current snapshot generation in \a job after updating its
+ * counters. If a snapshot bumped the generation while this was stored,
+ * store the new value, otherwise the update could be missed by both that
+ * snapshot and the next delta read.
+ */
+static void job_generation_update(struct job_stat *job)
+{
+	atomic64_t *generation = &job->js_jobstats->ojs_generation;
+	__u64 gen = atomic64_read(generation);
+
+	do {
+		job->js_generation = gen;
+		smp_mb();
+	} while ((gen = atomic64_read(generation)) != job->js_generation);
+}
+
 static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 {
 	struct job_stat *job;
@@ -254,6 +332,7 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 
 	memcpy(job->js_jobid, jobid, sizeof(job->js_jobid));
 	job->js_timestamp = ktime_get_real_seconds();
+	job->js_generation = atomic64_read(&jobs->ojs_generation);
 	job->js_jobstats = jobs;
 	INIT_HLIST_NODE(&job->js_hash);
 	INIT_LIST_HEAD(&job->js_list);
@@ -315,6 +394,7 @@ found:
 	LASSERT(stats == job->js_jobstats);
 	job->js_timestamp = ktime_get_real_seconds();
 	lprocfs_counter_add(job->js_stats, event, amount);
+	job_generation_update(job);
 
 	job_putref(job);
 
@@ -333,6 +413,7 @@ void lprocfs_job_stats_fini(struct obd_device *obd)
 	cfs_hash_putref(stats->ojs_hash);
 	stats->ojs_hash = NULL;
 	LASSERT(list_empty(&stats->ojs_list));
+	LASSERT(list_empty(&stats->ojs_tombstones));
 }
 EXPORT_SYMBOL(lprocfs_job_stats_fini);
 
@@ -571,6 +652,243 @@ static const struct file_operations lprocfs_jobstats_seq_fops = {
 	.release = lprocfs_jobstats_seq_release,
 };
 
+/*
+ * Binary export of job_stats.
+ *
+ * Formatting YAML for every job on every scrape is expensive with many
+ * active jobs, so job_stats_bin returns fixed size records instead, see
+ * struct jobstats_bin_hdr. The snapshot is taken when the file is first
+ * read, and ojs_lock is only held while the counters are copied, never
+ * while data is copied to userspace.
+ *
+ * Each snapshot bumps ojs_generation and returns the new value. Jobs
+ * record the generation of their last update, so after writing back a
+ * returned generation, the next snapshot only contains jobs updated since
+ * then. Jobs updated while a snapshot is taken are left for the next one.
+ * Removed jobs leave a tombstone with the generation of the removal, and a
+ * delta read reports the ones removed since its generation. A delta read
+ * from before the last dropped tombstone is turned into a full snapshot.
+ */
+struct jobstats_bin_snap {
+	struct obd_job_stats	*jbs_stats;
+	__u64			 jbs_since;	/* generation to read from */
+	char			*jbs_buf;	/* snapshot, NULL until read */
+	size_t			 jbs_buf_size;	/* allocated size */
+	size_t			 jbs_len;	/* used size */
+};
+
+static void jobstats_bin_snap_free(struct jobstats_bin_snap *snap)
+{
+	if (snap->jbs_buf) {
+		OBD_FREE_LARGE(snap->jbs_buf, snap->jbs_buf_size);
+		snap->jbs_buf = NULL;
+	}
+	snap->jbs_buf_size = 0;
+	snap->jbs_len = 0;
+}
+
+static bool jobstats_bin_wanted(__u64 job_gen, __u64 since, __u64 gen)
+{
+	return job_gen >= since && job_gen < gen;
+}
+
+static int jobstats_bin_snapshot(struct jobstats_bin_snap *snap)
+{
+	struct obd_job_stats *stats = snap->jbs_stats;
+	struct jobstats_bin_hdr *hdr;
+	struct jobstats_bin_rec *rec;
+	struct lprocfs_counter ret;
+	struct job_stat *job;
+	struct job_tombstone *jt;
+	unsigned int rec_size;
+	unsigned int count = 0;
+	unsigned int n = 0;
+	__u64 since = snap->jbs_since;
+	bool overflow = false;
+	__u16 flags = 0;
+	__u64 gen;
+	int i;
+
+	rec_size = offsetof(struct jobstats_bin_rec,
+			    jbr_cntrs[stats->ojs_cntr_num]);
+
+	/* jobs updated from now on belong to the next snapshot */
+	gen = atomic64_inc_return(&stats->ojs_generation);
+
+	read_lock(&stats->ojs_lock);
+	if (since == 0 || since <= stats->ojs_pruned_gen) {
+		since = 0;
+		flags |= JOBSTATS_BIN_FL_FULL;
+	}
+	list_for_each_entry(job, &stats->ojs_list, js_list)
+		if (jobstats_bin_wanted(READ_ONCE(job->js_generation),
+					since, gen))
+			count++;
+	if (!(flags & JOBSTATS_BIN_FL_FULL))
+		list_for_each_entry(jt, &stats->ojs_tombstones, jt_list)
+			if (jobstats_bin_wanted(jt->jt_generation, since, gen))
+				count++;
+	read_unlock(&stats->ojs_lock);
+
+again:
+	snap->jbs_buf_size = sizeof(*hdr) + (size_t)count * rec_size;
+	OBD_ALLOC_LARGE(snap->jbs_buf, snap->jbs_buf_size);
+	if (!snap->jbs_buf)
+		return -ENOMEM;
+
+	hdr = (struct jobstats_bin_hdr *)snap->jbs_buf;
+	rec = (struct jobstats_bin_rec *)(hdr + 1);
+	n = 0;
+
+	read_lock(&stats->ojs_lock);
+	/* removals go first, a job may be removed then created again */
+	if (!(flags & JOBSTATS_BIN_FL_FULL)) {
+		list_for_each_entry(jt, &stats->ojs_tombstones, jt_list) {
+			if (!jobstats_bin_wanted(jt->jt_generation, since, gen))
+				continue;
+			if (n == count) {
+				overflow = true;
+				break;
+			}
+
+			strlcpy(rec->jbr_jobid, jt->jt_jobid,
+				sizeof(rec->jbr_jobid));
+			rec->jbr_timestamp = jt->jt_timestamp;
+			rec->jbr_generation = jt->jt_generation;
+			rec->jbr_flags = JOBSTATS_BIN_REC_REMOVED;
+			rec = (struct jobstats_bin_rec *)((char *)rec +
+							  rec_size);
+			n++;
+		}
+	}
+	list_for_each_entry(job, &stats->ojs_list, js_list) {
+		if (overflow)
+			break;
+		if (!jobstats_bin_wanted(READ_ONCE(job->js_generation),
+					 since, gen))
+			continue;
+		/* jobs updated just before the bump may only show up now */
+		if (n == count) {
+			overflow = true;
+			break;
+		}
+
+		strlcpy(rec->jbr_jobid, job->js_jobid, sizeof(rec->jbr_jobid));
+		rec->jbr_timestamp = job->js_timestamp;
+		rec->jbr_generation = job->js_generation;
+		for (i = 0; i < stats->ojs_cntr_num; i++) {
+			struct jobstats_bin_cntr *cntr = &rec->jbr_cntrs[i];
+
+			lprocfs_stats_collect(job->js_stats, i, &ret);
+			cntr->jbc_count = ret.lc_count;
+			cntr->jbc_min = ret.lc_count ? ret.lc_min : 0;
+			cntr->jbc_max = ret.lc_max;
+			cntr->jbc_sum = ret.lc_sum;
+			cntr->jbc_sumsquare = ret.lc_sumsquare;
+		}
+		rec = (struct jobstats_bin_rec *)((char *)rec + rec_size);
+		n++;
+	}
+	read_unlock(&stats->ojs_lock);
+
+	if (overflow) {
+		jobstats_bin_snap_free(snap);
+		count += count / 2 + 16;
+		overflow = false;
+		goto again;
+	}
+
+	hdr->jbh_magic = JOBSTATS_BIN_MAGIC;
+	hdr->jbh_version = JOBSTATS_BIN_VERSION;
+	hdr->jbh_flags = flags;
+	hdr->jbh_rec_size = rec_size;
+	hdr->jbh_rec_count = n;
+	hdr->jbh_cntr_num = stats->ojs_cntr_num;
+	hdr->jbh_generation = gen;
+	hdr->jbh_snapshot_time = ktime_get_real_seconds();
+	snap->jbs_len = sizeof(*hdr) + (size_t)n * rec_size;
+
+	return 0;
+}
+
+static int lprocfs_jobstats_bin_open(struct inode *inode, struct file *file)
+{
+	struct jobstats_bin_snap *snap;
+	int rc;
+
+	rc = LPROCFS_ENTRY_CHECK(inode);
+	if (rc < 0)
+		return rc;
+
+	OBD_ALLOC_PTR(snap);
+	if (!snap)
+		return -ENOMEM;
+
+	snap->jbs_stats = PDE_DATA(inode);
+	file->private_data = snap;
+	return 0;
+}
+
+static ssize_t lprocfs_jobstats_bin_read(struct file *file, char __user *buf,
+					 size_t count, loff_t *ppos)
+{
+	struct jobstats_bin_snap *snap = file->private_data;
+	int rc;
+
+	if (snap->jbs_stats->ojs_hash == NULL)
+		return -ENODEV;
+
+	if (!snap->jbs_buf) {
+		rc = jobstats_bin_snapshot(snap);
+		if (rc)
+			return rc;
+	}
+
+	return simple_read_from_buffer(buf, count, ppos, snap->jbs_buf,
+				       snap->jbs_len);
+}
+
+/* write the generation of a previous snapshot to only read the changes */
+static ssize_t lprocfs_jobstats_bin_write(struct file *file,
+					  const char __user *buf,
+					  size_t len, loff_t *off)
+{
+	struct jobstats_bin_snap *snap = file->private_data;
+	__u64 since;
+	int rc;
+
+	rc = kstrtoull_from_user(buf, len, 0, &since);
+	if (rc)
+		return rc;
+
+	jobstats_bin_snap_free(snap);
+	snap->jbs_since = since;
+	*off = 0;
+
+	return len;
+}
+
+static int lprocfs_jobstats_bin_release(struct inode *inode, struct file *file)
+{
+	struct jobstats_bin_snap *snap = file->private_data;
+	struct obd_job_stats *stats = snap->jbs_stats;
+
+	lprocfs_job_cleanup(stats, stats->ojs_cleanup_interval);
+
+	jobstats_bin_snap_free(snap);
+	OBD_FREE_PTR(snap);
+	return 0;
+}
+
+static const struct file_operations lprocfs_jobstats_bin_fops = {
+	.owner   = THIS_MODULE,
+	.open    = lprocfs_jobstats_bin_open,
+	.read    = lprocfs_jobstats_bin_read,
+	.write   = lprocfs_jobstats_bin_write,
+	.llseek  = default_llseek,
+	.release = lprocfs_jobstats_bin_release,
+};
+
 int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 			   cntr_init_callback init_fn)
 {
@@ -610,6 +928,10 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 
 	INIT_LIST_HEAD(&stats->ojs_list);
 	rwlock_init(&stats->ojs_lock);
+	atomic64_set(&stats->ojs_generation, 0);
+	INIT_LIST_HEAD(&stats->ojs_tombstones);
+	stats->ojs_tombstone_count = 0;
+	stats->ojs_pruned_gen = 0;
 	stats->ojs_cntr_num = cntr_num;
 	stats->ojs_cntr_init_fn = init_fn;
 	stats->ojs_cleanup_interval = 600; /* 10 mins by default */
@@ -621,6 +943,13 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 		lprocfs_job_stats_fini(obd);
 		RETURN(-ENOMEM);
 	}
+
+	entry = lprocfs_add_simple(obd->obd_proc_entry, "job_stats_bin", stats,
+				   &lprocfs_jobstats_bin_fops);
+	if (IS_ERR(entry)) {
+		lprocfs_job_stats_fini(obd);
+		RETURN(-ENOMEM);
+	}
 	RETURN(0);
 }
 EXPORT_SYMBOL(lprocfs_job_stats_init);
@@ -684,6 +684,38 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
 }
 
+/** add up per-cpu histogram buckets of an LPROCFS_CNTR_HISTOGRAM counter */
+void lprocfs_stats_collect_hist(struct lprocfs_stats *stats, int idx,
+				struct lprocfs_counter_hist *hist)
+{
+	struct lprocfs_counter_header *header;
+	unsigned int num_entry;
+	unsigned long flags = 0;
+	int i;
+	int j;
+
+	memset(hist, 0, sizeof(*hist));
+
+	if (!stats)
+		return;
+
+	header = &stats->ls_cnt_header[idx];
+	if (!(header->lc_config & LPROCFS_CNTR_HISTOGRAM) || !header->lc_hist)
+		return;
+
+	num_entry = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
+	for (i = 0; i < num_entry; i++) {
+		struct lprocfs_counter_hist *percpu_hist = header->lc_hist[i];
+
+		if (!percpu_hist)
+			continue;
+		for (j = 0; j < LPROCFS_HIST_BUCKETS; j++)
+			hist->lh_buckets[j] += percpu_hist->lh_buckets[j];
+	}
+	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
+}
+EXPORT_SYMBOL(lprocfs_stats_collect_hist);
+
 static void obd_import_flags2str(struct obd_import *imp, struct seq_file *m)
 {
 	bool first = true;
@@ -786,6 +818,18 @@ static const char *obd_connect_names[] = {
 	"pcc",			/* 0x1000 */
 	"plain_layout",		/* 0x2000 */
 	"async_discard",	/* 0x4000 */
+	"encrypt",		/* 0x8000 */
+	"fidmap",		/* 0x10000 */
+	"getattr_pfid",		/* 0x20000 */
+	/* 0x40000 - 0x800000000000 are in use on other branches */
+	"unknown", "unknown", "unknown", "unknown", "unknown", "unknown",
+	"unknown", "unknown", "unknown", "unknown", "unknown", "unknown",
+	"unknown", "unknown", "unknown", "unknown", "unknown", "unknown",
+	"unknown", "unknown", "unknown", "unknown", "unknown", "unknown",
+	"unknown", "unknown", "unknown", "unknown", "unknown", "unknown",
+	"multiobj_brw",		/* 0x1000000000000 */
+	"batch_destroy",	/* 0x2000000000000 */
+	"batch_getattr",	/* 0x4000000000000 */
 	NULL
 };
 
@@ -1295,6 +1339,65 @@ int lprocfs_obd_cleanup(struct obd_device *obd)
 }
 EXPORT_SYMBOL(lprocfs_obd_cleanup);
 
+static void lprocfs_counter_hist_free(struct lprocfs_counter_header *header,
+				      unsigned int num_entry)
+{
+	unsigned int i;
+
+	if (!header->lc_hist)
+		return;
+
+	for (i = 0; i < num_entry; i++)
+		if (header->lc_hist[i])
+			LIBCFS_FREE(header->lc_hist[i],
+				    sizeof(struct lprocfs_counter_hist));
+	LIBCFS_FREE(header->lc_hist, num_entry * sizeof(header->lc_hist[0]));
+	header->lc_hist = NULL;
+}
+
+/*
+ * Set up the per-CPU histogram slots of an LPROCFS_CNTR_HISTOGRAM counter.
+ * Buckets are allocated lazily on update, except for stats that can be
+ * updated from interrupt context or that have a single shared slot.
+ */
+static int lprocfs_counter_hist_init(struct lprocfs_stats *stats,
+				     struct lprocfs_counter_header *header)
+{
+	unsigned int num_entry;
+	unsigned int i;
+
+	if (stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU)
+		num_entry = 1;
+	else
+		num_entry = num_possible_cpus();
+
+	if (!header->lc_hist) {
+		LIBCFS_ALLOC(header->lc_hist,
+			     num_entry * sizeof(header->lc_hist[0]));
+		if (!header->lc_hist)
+			return -ENOMEM;
+	}
+
+	for (i = 0; i < num_entry; i++) {
+		if (header->lc_hist[i]) {
+			memset(header->lc_hist[i], 0,
+			       sizeof(struct lprocfs_counter_hist));
+			continue;
+		}
+		if (num_entry > 1 &&
+		    !(stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE))
+			continue;
+		LIBCFS_ALLOC(header->lc_hist[i],
+			     sizeof(struct lprocfs_counter_hist));
+		if (!header->lc_hist[i]) {
+			lprocfs_counter_hist_free(header, num_entry);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
 int lprocfs_stats_alloc_one(struct lprocfs_stats *stats, unsigned int cpuid)
 {
 	struct lprocfs_counter *cntr;
@@ -1408,9 +1511,13 @@ void lprocfs_free_stats(struct lprocfs_stats **statsh)
 	for (i = 0; i < num_entry; i++)
 		if (stats->ls_percpu[i])
 			LIBCFS_FREE(stats->ls_percpu[i], percpusize);
-	if (stats->ls_cnt_header)
+	if (stats->ls_cnt_header) {
+		for (i = 0; i < stats->ls_num; i++)
+			lprocfs_counter_hist_free(&stats->ls_cnt_header[i],
+						  num_entry);
 		LIBCFS_FREE(stats->ls_cnt_header, stats->ls_num *
 					sizeof(struct lprocfs_counter_header));
+	}
 	LIBCFS_FREE(stats, offsetof(typeof(*stats), ls_percpu[num_entry]));
 }
 EXPORT_SYMBOL(lprocfs_free_stats);
@@ -1466,6 +1573,18 @@ void lprocfs_clear_stats(struct lprocfs_stats *stats)
 		}
 	}
 
+	for (j = 0; j < stats->ls_num; j++) {
+		struct lprocfs_counter_header *header;
+
+		header = &stats->ls_cnt_header[j];
+		if (!header->lc_hist)
+			continue;
+		for (i = 0; i < num_entry; i++)
+			if (header->lc_hist[i])
+				memset(header->lc_hist[i], 0,
+				       sizeof(struct lprocfs_counter_hist));
+	}
+
 	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
 }
 EXPORT_SYMBOL(lprocfs_clear_stats);
@@ -1531,6 +1650,21 @@ static int lprocfs_stats_seq_show(struct seq_file *p, void *v)
 		if (hdr->lc_config & LPROCFS_CNTR_STDDEV)
 			seq_printf(p, " %llu", ctr.lc_sumsquare);
 	}
+	/* histogram only if asked for with the "stats_hist" tunable, it goes
+	 * last so that parsers which only look at the leading fields of the
+	 * line keep working */
+	if (obd_stats_hist && (hdr->lc_config & LPROCFS_CNTR_HISTOGRAM)) {
+		struct lprocfs_counter_hist hist;
+		int i;
+
+		lprocfs_stats_collect_hist(stats, idx, &hist);
+		seq_puts(p, " hist");
+		for (i = 0; i < LPROCFS_HIST_BUCKETS; i++)
+			if (hist.lh_buckets[i])
+				seq_printf(p, " %llu:%llu",
+					   lprocfs_hist_bucket_start(i),
+					   hist.lh_buckets[i]);
+	}
 	seq_putc(p, '\n');
 	return 0;
 }
@@ -1584,6 +1718,96 @@ int ldebugfs_register_stats(struct dentry *parent, const char *name,
 }
 EXPORT_SYMBOL_GPL(ldebugfs_register_stats);
 
+/* YAML export of the histograms of LPROCFS_CNTR_HISTOGRAM counters */
+static int lprocfs_stats_hist_seq_show(struct seq_file *p, void *v)
+{
+	struct lprocfs_stats *stats = p->private;
+	struct lprocfs_counter_header *hdr;
+	struct lprocfs_counter_hist hist;
+	struct lprocfs_counter ctr;
+	int idx = *(loff_t *)v;
+	bool first = true;
+	int i;
+
+	if (idx == 0) {
+		struct timespec64 now;
+
+		ktime_get_real_ts64(&now);
+		seq_printf(p, "%-25s %llu.%09lu\n", "snapshot_time:",
+			   (s64)now.tv_sec, now.tv_nsec);
+	}
+
+	hdr = &stats->ls_cnt_header[idx];
+	if (!(hdr->lc_config & LPROCFS_CNTR_HISTOGRAM))
+		return 0;
+
+	lprocfs_stats_collect(stats, idx, &ctr);
+	if (ctr.lc_count == 0)
+		return 0;
+
+	lprocfs_stats_collect_hist(stats, idx, &hist);
+	seq_printf(p, "%s:\n  samples: %lld\n  unit: %s\n  hist: {",
+		   hdr->lc_name, ctr.lc_count, hdr->lc_units);
+	for (i = 0; i < LPROCFS_HIST_BUCKETS; i++) {
+		if (!hist.lh_buckets[i])
+			continue;
+		seq_printf(p, "%s %llu: %llu", first ? "" : ",",
+			   lprocfs_hist_bucket_start(i), hist.lh_buckets[i]);
+		first = false;
+	}
+	seq_puts(p, " }\n");
+	return 0;
+}
+
+static const struct seq_operations lprocfs_stats_hist_seq_sops = {
+	.start	= lprocfs_stats_seq_start,
+	.stop	= lprocfs_stats_seq_stop,
+	.next	= lprocfs_stats_seq_next,
+	.show	= lprocfs_stats_hist_seq_show,
+};
+
+static int lprocfs_stats_hist_seq_open(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq;
+	int rc;
+
+	rc = LPROCFS_ENTRY_CHECK(inode);
+	if (rc < 0)
+		return rc;
+
+	rc = seq_open(file, &lprocfs_stats_hist_seq_sops);
+	if (rc)
+		return rc;
+	seq = file->private_data;
+	seq->private = inode->i_private ? inode->i_private : PDE_DATA(inode);
+	return 0;
+}
+
+static const struct file_operations lprocfs_stats_hist_seq_fops = {
+	.owner   = THIS_MODULE,
+	.open    = lprocfs_stats_hist_seq_open,
+	.read    = seq_read,
+	.write   = lprocfs_stats_seq_write,
+	.llseek  = seq_lseek,
+	.release = lprocfs_seq_release,
+};
+
+int ldebugfs_register_stats_hist(struct dentry *parent, const char *name,
+				 struct lprocfs_stats *stats)
+{
+	struct dentry *entry;
+
+	LASSERT(!IS_ERR_OR_NULL(parent));
+
+	entry = debugfs_create_file(name, 0644, parent, stats,
+				    &lprocfs_stats_hist_seq_fops);
+	if (IS_ERR_OR_NULL(entry))
+		return entry ? PTR_ERR(entry) : -ENOMEM;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ldebugfs_register_stats_hist);
+
 int lprocfs_register_stats(struct proc_dir_entry *root, const char *name,
                            struct lprocfs_stats *stats)
 {
@@ -1617,6 +1841,13 @@ void lprocfs_counter_init(struct lprocfs_stats *stats, int index,
 	header->lc_name   = name;
 	header->lc_units  = units;
 
+	/* the histogram is optional, drop it rather than fail the caller */
+	if ((conf & LPROCFS_CNTR_HISTOGRAM) &&
+	    lprocfs_counter_hist_init(stats, header) != 0) {
+		CDEBUG(D_INFO, "%s: no memory for histogram\n", name);
+		header->lc_config &= ~LPROCFS_CNTR_HISTOGRAM;
+	}
+
 	num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
 	for (i = 0; i < num_cpu; ++i) {
 		if (!stats->ls_percpu[i])
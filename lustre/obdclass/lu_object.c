@@ -49,7 +49,7 @@
 #endif
 
 #include <libcfs/libcfs.h>
-#include <libcfs/libcfs_hash.h> /* hash_long() */
+#include <linux/hash.h>
 #include <libcfs/linux/linux-mem.h>
 #include <obd_class.h>
 #include <obd_support.h>
@@ -60,14 +60,21 @@
 
 struct lu_site_bkt_data {
 	/**
-	 * LRU list, updated on each access to object. Protected by
-	 * bucket lock of lu_site::ls_obj_hash.
+	 * LRU list of objects whose last reference was dropped. Protected by
+	 * lsb_lock.
 	 *
-	 * "Cold" end of LRU is lu_site::ls_lru.next. Accessed object are
-	 * moved to the lu_site::ls_lru.prev (this is due to the non-existence
-	 * of list_for_each_entry_safe_reverse()).
+	 * "Cold" end of LRU is lu_site::ls_lru.next. Released objects are
+	 * moved to the lu_site::ls_lru.prev. Objects referenced again are
+	 * not taken off the list by the lookup, they are skipped by
+	 * lu_site_purge_objects() and requeued by lu_object_put().
 	 */
 	struct list_head		lsb_lru;
+	/**
+	 * Serializes the last lu_object_put() of an object against LRU
+	 * purge and the removal of the object from the hash table.
+	 * Lookups of referenced or cached objects do not take it.
+	 */
+	spinlock_t			lsb_lock;
 	/**
 	 * Wait-queue signaled when an object in this site is ultimately
 	 * destroyed (lu_object_free()) or initialized (lu_object_start()).
@@ -80,6 +87,21 @@ struct lu_site_bkt_data {
 	wait_queue_head_t		lsb_waitq;
 };
 
+/**
+ * Values of lu_object_header::loh_ref that lookups must not increment:
+ * the last reference is being released under lu_site_bkt_data::lsb_lock,
+ * or the object was claimed for freeing by LRU purge.
+ */
+#define LU_OBJECT_REF_RELEASING	(INT_MIN / 2)
+#define LU_OBJECT_REF_DEAD	INT_MIN
+
+static const struct rhashtable_params lu_obj_hash_params = {
+	.key_len	= sizeof(struct lu_fid),
+	.key_offset	= offsetof(struct lu_object_header, loh_fid),
+	.head_offset	= offsetof(struct lu_object_header, loh_hash),
+	.automatic_shrinking = true,
+};
+
 enum {
 	LU_CACHE_PERCENT_MAX     = 50,
 	LU_CACHE_PERCENT_DEFAULT = 20
@@ -114,17 +136,64 @@ MODULE_PARM_DESC(lu_cache_nr, "Maximum number of objects in lu_object cache");
 static void lu_object_free(const struct lu_env *env, struct lu_object *o);
 static __u32 ls_stats_read(struct lprocfs_stats *stats, int idx);
 
+static inline struct lu_site_bkt_data *
+lu_site_bkt_from_fid(struct lu_site *site, const struct lu_fid *fid)
+{
+	return &site->ls_bkts[hash_32(fid_flatten32(fid), site->ls_bkt_bits)];
+}
+
 wait_queue_head_t *
 lu_site_wq_from_fid(struct lu_site *site, struct lu_fid *fid)
 {
-	struct cfs_hash_bd bd;
+	return &lu_site_bkt_from_fid(site, fid)->lsb_waitq;
+}
+EXPORT_SYMBOL(lu_site_wq_from_fid);
+
+/**
+ * Take a reference on object header \a h found in the site hash table.
+ *
+ * Called under rcu_read_lock(). Cached objects are revived without any
+ * lock, only an object whose last reference is being dropped, or which is
+ * being freed, needs the bucket lock to settle its state.
+ *
+ * \retval true	reference was taken
+ * \retval false	object is being freed and is no longer hashed
+ */
+static bool lu_object_get_rcu(struct lu_site *s, struct lu_object_header *h)
+{
 	struct lu_site_bkt_data *bkt;
+	bool got = true;
+
+	if (likely(atomic_inc_unless_negative(&h->loh_ref)))
+		return true;
+
+	bkt = lu_site_bkt_from_fid(s, &h->loh_fid);
+	spin_lock(&bkt->lsb_lock);
+	if (test_bit(LU_OBJECT_UNHASHED, &h->loh_flags))
+		got = false;
+	else
+		atomic_inc(&h->loh_ref);
+	spin_unlock(&bkt->lsb_lock);
 
-	cfs_hash_bd_get(site->ls_obj_hash, fid, &bd);
-	bkt = cfs_hash_bd_extra_get(site->ls_obj_hash, &bd);
-	return &bkt->lsb_waitq;
+	return got;
 }
-EXPORT_SYMBOL(lu_site_wq_from_fid);
+
+/**
+ * Take a reference on object \a h met while walking the hash table of site
+ * \a s with rhashtable_walk_next().
+ *
+ * \retval top-level object of \a h, referenced
+ * \retval NULL if the object is dying or being freed
+ */
+struct lu_object *lu_object_get_first(struct lu_site *s,
+				      struct lu_object_header *h)
+{
+	if (lu_object_is_dying(h) || !lu_object_get_rcu(s, h))
+		return NULL;
+
+	return lu_object_top(h);
+}
+EXPORT_SYMBOL(lu_object_get_first);
 
 /**
  * Decrease reference counter on object. If last reference is freed, return
@@ -137,7 +206,6 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	struct lu_object_header *top = o->lo_header;
 	struct lu_site *site = o->lo_dev->ld_site;
 	struct lu_object *orig = o;
-	struct cfs_hash_bd bd;
 	const struct lu_fid *fid = lu_object_fid(o);
 	bool is_dying;
 
@@ -147,8 +215,6 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 * so we should not remove it from the site.
 	 */
 	if (fid_is_zero(fid)) {
-		LASSERT(top->loh_hash.next == NULL
-			&& top->loh_hash.pprev == NULL);
 		LASSERT(list_empty(&top->loh_lru));
 		if (!atomic_dec_and_test(&top->loh_ref))
 			return;
@@ -160,11 +226,11 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 		return;
 	}
 
-	cfs_hash_bd_get(site->ls_obj_hash, &top->loh_fid, &bd);
-	bkt = cfs_hash_bd_extra_get(site->ls_obj_hash, &bd);
+	bkt = lu_site_bkt_from_fid(site, &top->loh_fid);
 
 	is_dying = lu_object_is_dying(top);
-	if (!cfs_hash_bd_dec_and_lock(site->ls_obj_hash, &bd, &top->loh_ref)) {
+	if (atomic_add_unless(&top->loh_ref, -1, 1)) {
+still_active:
 		/* at this point the object reference is dropped and lock is
 		 * not taken, so lu_object should not be touched because it
 		 * can be freed by concurrent thread. Use local variable for
@@ -180,6 +246,21 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 		return;
 	}
 
+	/*
+	 * Lookups revive cached objects without the bucket lock, so the
+	 * count may grow again while it is being dropped. Retry until either
+	 * somebody else holds a reference, or the last one is ours and the
+	 * object is marked as being released so that lookups have to wait
+	 * for the bucket lock.
+	 */
+	spin_lock(&bkt->lsb_lock);
+	while (atomic_cmpxchg(&top->loh_ref, 1, LU_OBJECT_REF_RELEASING) != 1) {
+		if (atomic_add_unless(&top->loh_ref, -1, 1)) {
+			spin_unlock(&bkt->lsb_lock);
+			goto still_active;
+		}
+	}
+
 	/*
 	 * When last reference is released, iterate over object
 	 * layers, and notify them that object is no longer busy.
@@ -195,12 +276,18 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 */
 	if (!lu_object_is_dying(top) &&
 	    (lu_object_exists(orig) || lu_object_is_cl(orig))) {
-		LASSERT(list_empty(&top->loh_lru));
-		list_add_tail(&top->loh_lru, &bkt->lsb_lru);
-		percpu_counter_inc(&site->ls_lru_len_counter);
-		CDEBUG(D_INODE, "Add %p/%p to site lru. hash: %p, bkt: %p\n",
-		       orig, top, site->ls_obj_hash, bkt);
-		cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
+		if (list_empty(&top->loh_lru)) {
+			list_add_tail(&top->loh_lru, &bkt->lsb_lru);
+			percpu_counter_inc(&site->ls_lru_len_counter);
+		} else {
+			list_move_tail(&top->loh_lru, &bkt->lsb_lru);
+		}
+		CDEBUG(D_INODE, "Add %p/%p to site lru. bkt: %p\n",
+		       orig, top, bkt);
+		/* publish the released object to lock-free lookups */
+		smp_mb();
+		atomic_set(&top->loh_ref, 0);
+		spin_unlock(&bkt->lsb_lock);
 		return;
 	}
 
@@ -208,16 +295,19 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 * If object is dying (will not be cached) then remove it
 	 * from hash table and LRU.
 	 *
-	 * This is done with hash table and LRU lists locked. As the only
-	 * way to acquire first reference to previously unreferenced
-	 * object is through hash-table lookup (lu_object_find()),
-	 * or LRU scanning (lu_site_purge()), that are done under hash-table
-	 * and LRU lock, no race with concurrent object lookup is possible
-	 * and we can safely destroy object below.
+	 * This is done with the bucket locked and the reference count
+	 * negative. Lookups that find the object in the hash table before
+	 * it is removed wait for the bucket lock, see the UNHASHED bit and
+	 * give up, so we can safely destroy object below.
 	 */
+	if (!list_empty(&top->loh_lru)) {
+		list_del_init(&top->loh_lru);
+		percpu_counter_dec(&site->ls_lru_len_counter);
+	}
 	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags))
-		cfs_hash_bd_del_locked(site->ls_obj_hash, &bd, &top->loh_hash);
-	cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
+		rhashtable_remove_fast(&site->ls_obj_hash, &top->loh_hash,
+				       lu_obj_hash_params);
+	spin_unlock(&bkt->lsb_lock);
 	/*
 	 * Object was already removed from hash and lru above, can
 	 * kill it.
@@ -247,21 +337,21 @@ void lu_object_unhash(const struct lu_env *env, struct lu_object *o)
 
 	top = o->lo_header;
 	set_bit(LU_OBJECT_HEARD_BANSHEE, &top->loh_flags);
-	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags)) {
+	if (!test_bit(LU_OBJECT_UNHASHED, &top->loh_flags)) {
 		struct lu_site *site = o->lo_dev->ld_site;
-		struct cfs_hash *obj_hash = site->ls_obj_hash;
-		struct cfs_hash_bd bd;
+		struct lu_site_bkt_data *bkt;
 
-		cfs_hash_bd_get_and_lock(obj_hash, &top->loh_fid, &bd, 1);
+		bkt = lu_site_bkt_from_fid(site, &top->loh_fid);
+		spin_lock(&bkt->lsb_lock);
 		if (!list_empty(&top->loh_lru)) {
-			struct lu_site_bkt_data *bkt;
-
 			list_del_init(&top->loh_lru);
-			bkt = cfs_hash_bd_extra_get(obj_hash, &bd);
 			percpu_counter_dec(&site->ls_lru_len_counter);
 		}
-		cfs_hash_bd_del_locked(obj_hash, &bd, &top->loh_hash);
-		cfs_hash_bd_unlock(obj_hash, &bd, 1);
+		if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags))
+			rhashtable_remove_fast(&site->ls_obj_hash,
+					       &top->loh_hash,
+					       lu_obj_hash_params);
+		spin_unlock(&bkt->lsb_lock);
 	}
 }
 EXPORT_SYMBOL(lu_object_unhash);
@@ -406,29 +496,28 @@ static void lu_object_free(const struct lu_env *env, struct lu_object *o)
 int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 			  int nr, int canblock)
 {
-        struct lu_object_header *h;
-        struct lu_object_header *temp;
-        struct lu_site_bkt_data *bkt;
-	struct cfs_hash_bd            bd;
-	struct cfs_hash_bd            bd2;
+	struct lu_object_header *h;
+	struct lu_object_header *temp;
+	struct lu_site_bkt_data *bkt;
 	struct list_head	 dispose;
 	int                      did_sth;
 	unsigned int		 start = 0;
-        int                      count;
-        int                      bnr;
+	unsigned int		 nbkt = 1U << s->ls_bkt_bits;
+	int                      count;
+	int                      bnr;
 	unsigned int             i;
 
 	if (OBD_FAIL_CHECK(OBD_FAIL_OBD_NO_LRU))
 		RETURN(0);
 
 	INIT_LIST_HEAD(&dispose);
-        /*
-         * Under LRU list lock, scan LRU list and move unreferenced objects to
-         * the dispose list, removing them from LRU and hash table.
-         */
+	/*
+	 * Under LRU list lock, scan LRU list and move unreferenced objects to
+	 * the dispose list, removing them from LRU and hash table.
+	 */
 	if (nr != ~0)
 		start = s->ls_purge_start;
-	bnr = (nr == ~0) ? -1 : nr / (int)CFS_HASH_NBKT(s->ls_obj_hash) + 1;
+	bnr = (nr == ~0) ? -1 : nr / (int)nbkt + 1;
  again:
 	/*
 	 * It doesn't make any sense to make purge threads parallel, that can
@@ -439,35 +528,40 @@ int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 	else if (mutex_trylock(&s->ls_purge_mutex) == 0)
 		goto out;
 
-        did_sth = 0;
-        cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
-                if (i < start)
-                        continue;
-                count = bnr;
-                cfs_hash_bd_lock(s->ls_obj_hash, &bd, 1);
-                bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+	did_sth = 0;
+	for (i = start; i < nbkt; i++) {
+		count = bnr;
+		bkt = &s->ls_bkts[i];
+		spin_lock(&bkt->lsb_lock);
 
 		list_for_each_entry_safe(h, temp, &bkt->lsb_lru, loh_lru) {
-			LASSERT(atomic_read(&h->loh_ref) == 0);
-
-                        cfs_hash_bd_get(s->ls_obj_hash, &h->loh_fid, &bd2);
-                        LASSERT(bd.bd_bucket == bd2.bd_bucket);
+			/*
+			 * Referenced again by a lookup since it was cached,
+			 * lu_object_put() will queue it again.
+			 */
+			if (atomic_cmpxchg(&h->loh_ref, 0,
+					   LU_OBJECT_REF_DEAD) != 0) {
+				list_del_init(&h->loh_lru);
+				percpu_counter_dec(&s->ls_lru_len_counter);
+				continue;
+			}
 
-                        cfs_hash_bd_del_locked(s->ls_obj_hash,
-                                               &bd2, &h->loh_hash);
+			set_bit(LU_OBJECT_UNHASHED, &h->loh_flags);
+			rhashtable_remove_fast(&s->ls_obj_hash, &h->loh_hash,
+					       lu_obj_hash_params);
 			list_move(&h->loh_lru, &dispose);
 			percpu_counter_dec(&s->ls_lru_len_counter);
-                        if (did_sth == 0)
-                                did_sth = 1;
+			if (did_sth == 0)
+				did_sth = 1;
 
-                        if (nr != ~0 && --nr == 0)
-                                break;
+			if (nr != ~0 && --nr == 0)
+				break;
 
-                        if (count > 0 && --count == 0)
-                                break;
+			if (count > 0 && --count == 0)
+				break;
 
 		}
-		cfs_hash_bd_unlock(s->ls_obj_hash, &bd, 1);
+		spin_unlock(&bkt->lsb_lock);
 		cond_resched();
 		/*
 		 * Free everything on the dispose list. This is safe against
@@ -481,20 +575,20 @@ int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
 			lprocfs_counter_incr(s->ls_stats, LU_SS_LRU_PURGED);
 		}
 
-                if (nr == 0)
-                        break;
-        }
+		if (nr == 0)
+			break;
+	}
 	mutex_unlock(&s->ls_purge_mutex);
 
-        if (nr != 0 && did_sth && start != 0) {
-                start = 0; /* restart from the first bucket */
-                goto again;
-        }
-        /* race on s->ls_purge_start, but nobody cares */
-        s->ls_purge_start = i % CFS_HASH_NBKT(s->ls_obj_hash);
+	if (nr != 0 && did_sth && start != 0) {
+		start = 0; /* restart from the first bucket */
+		goto again;
+	}
+	/* race on s->ls_purge_start, but nobody cares */
+	s->ls_purge_start = i % nbkt;
 
 out:
-        return nr;
+	return nr;
 }
 EXPORT_SYMBOL(lu_site_purge_objects);
 
@@ -588,7 +682,8 @@ void lu_object_header_print(const struct lu_env *env, void *cookie,
 	(*printer)(env, cookie, "header@%p[%#lx, %d, "DFID"%s%s%s]",
 		   hdr, hdr->loh_flags, atomic_read(&hdr->loh_ref),
 		   PFID(&hdr->loh_fid),
-		   hlist_unhashed(&hdr->loh_hash) ? "" : " hash",
+		   fid_is_zero(&hdr->loh_fid) ||
+		   test_bit(LU_OBJECT_UNHASHED, &hdr->loh_flags) ? "" : " hash",
 		   list_empty((struct list_head *)&hdr->loh_lru) ? \
 		   "" : " lru",
 		   hdr->loh_attr & LOHA_EXISTS ? " exist" : "");
@@ -642,37 +737,74 @@ int lu_object_invariant(const struct lu_object *o)
         return 1;
 }
 
+/**
+ * Find object with fid \a f in the site hash table and take a reference on
+ * it. No lock is taken unless the object is going away.
+ */
 static struct lu_object *htable_lookup(struct lu_site *s,
-				       struct cfs_hash_bd *bd,
-				       const struct lu_fid *f,
-				       __u64 *version)
+				       const struct lu_fid *f)
 {
-	struct lu_object_header	*h;
-	struct hlist_node *hnode;
-	__u64 ver = cfs_hash_bd_version_get(bd);
+	struct lu_object_header *h;
 
-	if (*version == ver)
+	rcu_read_lock();
+	h = rhashtable_lookup_fast(&s->ls_obj_hash, f, lu_obj_hash_params);
+	if (h == NULL) {
+		rcu_read_unlock();
+		lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_MISS);
 		return ERR_PTR(-ENOENT);
+	}
 
-	*version = ver;
-	/* cfs_hash_bd_peek_locked is a somehow "internal" function
-	 * of cfs_hash, it doesn't add refcount on object. */
-	hnode = cfs_hash_bd_peek_locked(s->ls_obj_hash, bd, (void *)f);
-	if (!hnode) {
-		lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_MISS);
+	if (!lu_object_get_rcu(s, h)) {
+		rcu_read_unlock();
+		lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_DEATH_RACE);
 		return ERR_PTR(-ENOENT);
 	}
+	rcu_read_unlock();
 
-	h = container_of0(hnode, struct lu_object_header, loh_hash);
-	cfs_hash_get(s->ls_obj_hash, hnode);
 	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_HIT);
-	if (!list_empty(&h->loh_lru)) {
-		list_del_init(&h->loh_lru);
-		percpu_counter_dec(&s->ls_lru_len_counter);
-	}
 	return lu_object_top(h);
 }
 
+/**
+ * Insert new object \a o into the site hash table.
+ *
+ * \retval NULL		\a o was inserted
+ * \retval object	referenced object with the same fid inserted by
+ *			a racing thread
+ * \retval ERR_PTR	insertion failed
+ */
+static struct lu_object *htable_insert(struct lu_site *s, struct lu_object *o)
+{
+	struct lu_object_header *h;
+
+	while (1) {
+		rcu_read_lock();
+		h = rhashtable_lookup_get_insert_fast(&s->ls_obj_hash,
+						      &o->lo_header->loh_hash,
+						      lu_obj_hash_params);
+		if (h == NULL) {
+			rcu_read_unlock();
+			return NULL;
+		}
+
+		if (!IS_ERR(h)) {
+			if (lu_object_get_rcu(s, h)) {
+				rcu_read_unlock();
+				return lu_object_top(h);
+			}
+			/* old object is gone from the table, try again */
+			rcu_read_unlock();
+			continue;
+		}
+		rcu_read_unlock();
+
+		/* the table is being resized, wait for the rehash */
+		if (PTR_ERR(h) != -ENOMEM && PTR_ERR(h) != -EBUSY)
+			return ERR_CAST(h);
+		msleep(20);
+	}
+}
+
 /**
  * Search cache for an object with the fid \a f. If such object is found,
  * return it. Otherwise, create new object, insert it into cache and return
@@ -701,7 +833,7 @@ static void lu_object_limit(const struct lu_env *env,
 	if (lu_cache_nr == LU_CACHE_NR_UNLIMITED)
 		return;
 
-	size = cfs_hash_size_get(dev->ld_site->ls_obj_hash);
+	size = atomic_read(&dev->ld_site->ls_obj_hash.nelems);
 	nr = (__u64)lu_cache_nr;
 	if (size <= nr)
 		return;
@@ -725,11 +857,8 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	struct lu_object *o;
 	struct lu_object *shadow;
 	struct lu_site *s;
-	struct cfs_hash *hs;
-	struct cfs_hash_bd bd;
 	struct lu_site_bkt_data *bkt;
 	struct l_wait_info lwi = { 0 };
-	__u64 version = 0;
 	int rc;
 
 	ENTRY;
@@ -737,14 +866,12 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	/*
 	 * This uses standard index maintenance protocol:
 	 *
-	 *     - search index under lock, and return object if found;
-	 *     - otherwise, unlock index, allocate new object;
-	 *     - lock index and search again;
-	 *     - if nothing is found (usual case), insert newly created
-	 *       object into index;
+	 *     - search index under RCU, and return object if found;
+	 *     - otherwise, allocate new object;
+	 *     - insert it unless another object with the same fid is
+	 *       already in the index;
 	 *     - otherwise (race: other thread inserted object), free
 	 *       object just allocated.
-	 *     - unlock index;
 	 *     - return object.
 	 *
 	 * For "LOC_F_NEW" case, we are sure the object is new established.
@@ -753,18 +880,13 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	 *
 	 */
 	s  = dev->ld_site;
-	hs = s->ls_obj_hash;
 
 	if (unlikely(OBD_FAIL_PRECHECK(OBD_FAIL_OBD_ZERO_NLINK_RACE)))
 		lu_site_purge(env, s, -1);
 
-	cfs_hash_bd_get(hs, f, &bd);
-	bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+	bkt = lu_site_bkt_from_fid(s, f);
 	if (!(conf && conf->loc_flags & LOC_F_NEW)) {
-		cfs_hash_bd_lock(hs, &bd, 1);
-		o = htable_lookup(s, &bd, f, &version);
-		cfs_hash_bd_unlock(hs, &bd, 1);
-
+		o = htable_lookup(s, f);
 		if (!IS_ERR(o)) {
 			if (likely(lu_object_is_inited(o->lo_header)))
 				RETURN(o);
@@ -799,16 +921,8 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 
 	CFS_RACE_WAIT(OBD_FAIL_OBD_ZERO_NLINK_RACE);
 
-	cfs_hash_bd_lock(hs, &bd, 1);
-
-	if (conf && conf->loc_flags & LOC_F_NEW)
-		shadow = ERR_PTR(-ENOENT);
-	else
-		shadow = htable_lookup(s, &bd, f, &version);
-	if (likely(PTR_ERR(shadow) == -ENOENT)) {
-		cfs_hash_bd_add_locked(hs, &bd, &o->lo_header->loh_hash);
-		cfs_hash_bd_unlock(hs, &bd, 1);
-
+	shadow = htable_insert(s, o);
+	if (likely(shadow == NULL)) {
 		/*
 		 * This may result in rather complicated operations, including
 		 * fld queries, inode loading, etc.
@@ -826,12 +940,13 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 		RETURN(o);
 	}
 
-	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_RACE);
-	cfs_hash_bd_unlock(hs, &bd, 1);
 	lu_object_free(env, o);
+	if (IS_ERR(shadow))
+		RETURN(shadow);
 
-	if (!(conf && conf->loc_flags & LOC_F_NEW) &&
-	    !lu_object_is_inited(shadow->lo_header)) {
+	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_RACE);
+
+	if (!lu_object_is_inited(shadow->lo_header)) {
 		l_wait_event(bkt->lsb_waitq,
 			     lu_object_is_inited(shadow->lo_header) ||
 			     lu_object_is_dying(shadow->lo_header), &lwi);
@@ -908,14 +1023,9 @@ struct lu_site_print_arg {
         lu_printer_t     lsp_printer;
 };
 
-static int
-lu_site_obj_print(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-		  struct hlist_node *hnode, void *data)
+static void
+lu_site_obj_print(struct lu_object_header *h, struct lu_site_print_arg *arg)
 {
-	struct lu_site_print_arg *arg = (struct lu_site_print_arg *)data;
-	struct lu_object_header  *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
 	if (!list_empty(&h->loh_layers)) {
 		const struct lu_object *o;
 
@@ -926,27 +1036,37 @@ lu_site_obj_print(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		lu_object_header_print(arg->lsp_env, arg->lsp_cookie,
 				       arg->lsp_printer, h);
 	}
-	return 0;
 }
 
 /**
  * Print all objects in \a s.
  */
 void lu_site_print(const struct lu_env *env, struct lu_site *s, void *cookie,
-                   lu_printer_t printer)
+		   lu_printer_t printer)
 {
-        struct lu_site_print_arg arg = {
-                .lsp_env     = (struct lu_env *)env,
-                .lsp_cookie  = cookie,
-                .lsp_printer = printer,
-        };
+	struct lu_site_print_arg arg = {
+		.lsp_env     = (struct lu_env *)env,
+		.lsp_cookie  = cookie,
+		.lsp_printer = printer,
+	};
+	struct lu_object_header *h;
+	struct rhashtable_iter iter;
 
-        cfs_hash_for_each(s->ls_obj_hash, lu_site_obj_print, &arg);
+	rhashtable_walk_enter(&s->ls_obj_hash, &iter);
+	rhashtable_walk_start(&iter);
+	while ((h = rhashtable_walk_next(&iter)) != NULL) {
+		if (IS_ERR(h))
+			continue;
+		lu_site_obj_print(h, &arg);
+	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
 }
 EXPORT_SYMBOL(lu_site_print);
 
 /**
- * Return desired hash table order.
+ * Return desired hash table order, the number of LRU buckets is derived
+ * from it.
  */
 static unsigned long lu_htable_order(struct lu_device *top)
 {
@@ -1003,68 +1123,6 @@ static unsigned long lu_htable_order(struct lu_device *top)
 	return clamp_t(typeof(bits), bits, LU_SITE_BITS_MIN, bits_max);
 }
 
-static unsigned lu_obj_hop_hash(struct cfs_hash *hs,
-				const void *key, unsigned mask)
-{
-	struct lu_fid  *fid = (struct lu_fid *)key;
-	__u32           hash;
-
-	hash = fid_flatten32(fid);
-	hash += (hash >> 4) + (hash << 12); /* mixing oid and seq */
-	hash = hash_long(hash, hs->hs_bkt_bits);
-
-	/* give me another random factor */
-	hash -= hash_long((unsigned long)hs, fid_oid(fid) % 11 + 3);
-
-	hash <<= hs->hs_cur_bits - hs->hs_bkt_bits;
-	hash |= (fid_seq(fid) + fid_oid(fid)) & (CFS_HASH_NBKT(hs) - 1);
-
-	return hash & mask;
-}
-
-static void *lu_obj_hop_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct lu_object_header, loh_hash);
-}
-
-static void *lu_obj_hop_key(struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	return &h->loh_fid;
-}
-
-static int lu_obj_hop_keycmp(const void *key, struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	return lu_fid_eq(&h->loh_fid, (struct lu_fid *)key);
-}
-
-static void lu_obj_hop_get(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct lu_object_header *h;
-
-	h = hlist_entry(hnode, struct lu_object_header, loh_hash);
-	atomic_inc(&h->loh_ref);
-}
-
-static void lu_obj_hop_put_locked(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-        LBUG(); /* we should never called it */
-}
-
-static struct cfs_hash_ops lu_site_hash_ops = {
-        .hs_hash        = lu_obj_hop_hash,
-        .hs_key         = lu_obj_hop_key,
-        .hs_keycmp      = lu_obj_hop_keycmp,
-        .hs_object      = lu_obj_hop_object,
-        .hs_get         = lu_obj_hop_get,
-        .hs_put_locked  = lu_obj_hop_put_locked,
-};
-
 void lu_dev_add_linkage(struct lu_site *s, struct lu_device *d)
 {
 	spin_lock(&s->ls_ld_lock);
@@ -1088,8 +1146,6 @@ EXPORT_SYMBOL(lu_dev_del_linkage);
 int lu_site_init(struct lu_site *s, struct lu_device *top)
 {
 	struct lu_site_bkt_data *bkt;
-	struct cfs_hash_bd bd;
-	char name[16];
 	unsigned long bits;
 	unsigned int i;
 	int rc;
@@ -1106,39 +1162,37 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
 	if (rc)
 		return -ENOMEM;
 
-	snprintf(name, sizeof(name), "lu_site_%s", top->ld_type->ldt_name);
-	for (bits = lu_htable_order(top);
-	     bits >= LU_SITE_BITS_MIN; bits--) {
-		s->ls_obj_hash = cfs_hash_create(name, bits, bits,
-						 bits - LU_SITE_BKT_BITS,
-						 sizeof(*bkt), 0, 0,
-						 &lu_site_hash_ops,
-						 CFS_HASH_SPIN_BKTLOCK |
-						 CFS_HASH_NO_ITEMREF |
-						 CFS_HASH_DEPTH |
-						 CFS_HASH_ASSERT_EMPTY |
-						 CFS_HASH_COUNTER);
-		if (s->ls_obj_hash != NULL)
-			break;
+	rc = rhashtable_init(&s->ls_obj_hash, &lu_obj_hash_params);
+	if (rc) {
+		CERROR("failed to create lu_site hash: rc = %d\n", rc);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
+		return rc;
 	}
 
-	if (s->ls_obj_hash == NULL) {
-		CERROR("failed to create lu_site hash with bits: %lu\n", bits);
+	bits = lu_htable_order(top);
+	s->ls_bkt_bits = bits - LU_SITE_BKT_BITS;
+	OBD_ALLOC_LARGE(s->ls_bkts, sizeof(*bkt) << s->ls_bkt_bits);
+	if (s->ls_bkts == NULL) {
+		rhashtable_destroy(&s->ls_obj_hash);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
 		return -ENOMEM;
 	}
 
-	cfs_hash_for_each_bucket(s->ls_obj_hash, &bd, i) {
-		bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
+	for (i = 0; i < 1U << s->ls_bkt_bits; i++) {
+		bkt = &s->ls_bkts[i];
 		INIT_LIST_HEAD(&bkt->lsb_lru);
+		spin_lock_init(&bkt->lsb_lock);
 		init_waitqueue_head(&bkt->lsb_waitq);
 	}
 
-        s->ls_stats = lprocfs_alloc_stats(LU_SS_LAST_STAT, 0);
-        if (s->ls_stats == NULL) {
-                cfs_hash_putref(s->ls_obj_hash);
-                s->ls_obj_hash = NULL;
-                return -ENOMEM;
-        }
+	s->ls_stats = lprocfs_alloc_stats(LU_SS_LAST_STAT, 0);
+	if (s->ls_stats == NULL) {
+		OBD_FREE_LARGE(s->ls_bkts, sizeof(*bkt) << s->ls_bkt_bits);
+		s->ls_bkts = NULL;
+		rhashtable_destroy(&s->ls_obj_hash);
+		percpu_counter_destroy(&s->ls_lru_len_counter);
+		return -ENOMEM;
+	}
 
         lprocfs_counter_init(s->ls_stats, LU_SS_CREATED,
                              0, "created", "created");
@@ -1177,12 +1231,17 @@ void lu_site_fini(struct lu_site *s)
 	list_del_init(&s->ls_linkage);
 	up_write(&lu_sites_guard);
 
+	if (s->ls_bkts == NULL)
+		return;
+
 	percpu_counter_destroy(&s->ls_lru_len_counter);
 
-        if (s->ls_obj_hash != NULL) {
-                cfs_hash_putref(s->ls_obj_hash);
-                s->ls_obj_hash = NULL;
-        }
+	LASSERTF(lu_site_is_empty(s), "site %p has %d objects cached\n",
+		 s, atomic_read(&s->ls_obj_hash.nelems));
+	rhashtable_destroy(&s->ls_obj_hash);
+	OBD_FREE_LARGE(s->ls_bkts,
+		       sizeof(struct lu_site_bkt_data) << s->ls_bkt_bits);
+	s->ls_bkts = NULL;
 
         if (s->ls_top_dev != NULL) {
                 s->ls_top_dev->ld_site = NULL;
@@ -1338,7 +1397,6 @@ int lu_object_header_init(struct lu_object_header *h)
 {
         memset(h, 0, sizeof *h);
 	atomic_set(&h->loh_ref, 1);
-	INIT_HLIST_NODE(&h->loh_hash);
 	INIT_LIST_HEAD(&h->loh_lru);
 	INIT_LIST_HEAD(&h->loh_layers);
         lu_ref_init(&h->loh_reference);
@@ -1353,11 +1411,32 @@ void lu_object_header_fini(struct lu_object_header *h)
 {
 	LASSERT(list_empty(&h->loh_layers));
 	LASSERT(list_empty(&h->loh_lru));
-	LASSERT(hlist_unhashed(&h->loh_hash));
         lu_ref_fini(&h->loh_reference);
 }
 EXPORT_SYMBOL(lu_object_header_fini);
 
+static void lu_object_header_free_rcu(struct rcu_head *head)
+{
+	struct lu_object_header *h;
+
+	h = container_of(head, struct lu_object_header, loh_rcu);
+	OBD_FREE_PTR(h);
+}
+
+/**
+ * Finalize and free compound object header allocated on its own.
+ *
+ * Lookups may still be looking at the header under RCU, so the memory is
+ * released after a grace period. Headers embedded into the top-level slice
+ * are freed the same way by ->loo_object_free() of the top device.
+ */
+void lu_object_header_free(struct lu_object_header *h)
+{
+	lu_object_header_fini(h);
+	call_rcu(&h->loh_rcu, lu_object_header_free_rcu);
+}
+EXPORT_SYMBOL(lu_object_header_free);
+
 /**
  * Given a compound object, find its slice, corresponding to the device type
  * \a dtype.
@@ -2061,8 +2140,7 @@ typedef struct lu_site_stats{
 static void lu_site_stats_get(const struct lu_site *s,
                               lu_site_stats_t *stats, int populated)
 {
-	struct cfs_hash *hs = s->ls_obj_hash;
-	struct cfs_hash_bd bd;
+	int cnt = atomic_read(&s->ls_obj_hash.nelems);
 	unsigned int i;
 	/*
 	 * percpu_counter_sum_positive() won't accept a const pointer
@@ -2070,26 +2148,20 @@ static void lu_site_stats_get(const struct lu_site *s,
 	 */
 	struct lu_site *s2 = (struct lu_site *)s;
 
-	stats->lss_busy += cfs_hash_size_get(hs) -
+	/* objects referenced again may still sit on the LRU lists, so busy
+	 * count is a lower bound */
+	stats->lss_busy += cnt -
 		percpu_counter_sum_positive(&s2->ls_lru_len_counter);
-        cfs_hash_for_each_bucket(hs, &bd, i) {
-		struct hlist_head *hhead;
-
-                cfs_hash_bd_lock(hs, &bd, 1);
-                stats->lss_total += cfs_hash_bd_count_get(&bd);
-                stats->lss_max_search = max((int)stats->lss_max_search,
-                                            cfs_hash_bd_depmax_get(&bd));
-                if (!populated) {
-                        cfs_hash_bd_unlock(hs, &bd, 1);
-                        continue;
-                }
+	stats->lss_total += cnt;
+	/* hash chains are managed by rhashtable, their length isn't known */
+	stats->lss_max_search = 0;
+	if (!populated)
+		return;
 
-                cfs_hash_bd_for_each_hlist(hs, &bd, hhead) {
-			if (!hlist_empty(hhead))
-                                stats->lss_populated++;
-                }
-                cfs_hash_bd_unlock(hs, &bd, 1);
-        }
+	for (i = 0; i < 1U << s->ls_bkt_bits; i++) {
+		if (!list_empty(&s->ls_bkts[i].lsb_lru))
+			stats->lss_populated++;
+	}
 }
 
 
@@ -2107,7 +2179,7 @@ static void lu_site_stats_get(const struct lu_site *s,
  * Using a per cpu counter is a compromise solution to concurrent access:
  * lu_object_put() can update the counter without locking the site and
  * lu_cache_shrink_count can sum the counters without locking each
- * ls_obj_hash bucket.
+ * LRU bucket.
  */
 static unsigned long lu_cache_shrink_count(struct shrinker *sk,
 					   struct shrink_control *sc)
@@ -2326,6 +2398,9 @@ void lu_global_fini(void)
 
 	rhashtable_destroy(&lu_env_rhash);
 
+	/* wait for object headers freed after an RCU grace period */
+	rcu_barrier();
+
         lu_ref_global_fini();
 }
 
@@ -2356,7 +2431,7 @@ int lu_site_stats_seq_print(const struct lu_site *s, struct seq_file *m)
 		   stats.lss_busy,
 		   stats.lss_total,
 		   stats.lss_populated,
-		   CFS_HASH_NHLIST(s->ls_obj_hash),
+		   1 << s->ls_bkt_bits,
 		   stats.lss_max_search,
 		   ls_stats_read(s->ls_stats, LU_SS_CREATED),
 		   ls_stats_read(s->ls_stats, LU_SS_CACHE_HIT),
@@ -2397,6 +2472,8 @@ EXPORT_SYMBOL(lu_kmem_init);
  */
 void lu_kmem_fini(struct lu_kmem_descr *caches)
 {
+	/* wait for objects freed after an RCU grace period */
+	rcu_barrier();
         for (; caches->ckd_cache != NULL; ++caches) {
                 if (*caches->ckd_cache != NULL) {
 			kmem_cache_destroy(*caches->ckd_cache);
@@ -2415,27 +2492,22 @@ void lu_object_assign_fid(const struct lu_env *env, struct lu_object *o,
 {
 	struct lu_site		*s = o->lo_dev->ld_site;
 	struct lu_fid		*old = &o->lo_header->loh_fid;
-	struct cfs_hash		*hs;
-	struct cfs_hash_bd	 bd;
+	int			 rc;
 
 	LASSERT(fid_is_zero(old));
+	*old = *fid;
 
-	/* supposed to be unique */
-	hs = s->ls_obj_hash;
-	cfs_hash_bd_get_and_lock(hs, (void *)fid, &bd, 1);
-#ifdef CONFIG_LUSTRE_DEBUG_EXPENSIVE_CHECK
-	{
-		__u64 version = 0;
-		struct lu_object *shadow;
-
-		shadow = htable_lookup(s, &bd, fid, &version);
-		/* supposed to be unique */
-		LASSERT(IS_ERR(shadow) && PTR_ERR(shadow) == -ENOENT);
+	while (1) {
+		rc = rhashtable_lookup_insert_fast(&s->ls_obj_hash,
+						   &o->lo_header->loh_hash,
+						   lu_obj_hash_params);
+		/* the table is being resized, wait for the rehash */
+		if (rc != -ENOMEM && rc != -EBUSY)
+			break;
+		msleep(20);
 	}
-#endif
-	*old = *fid;
-	cfs_hash_bd_add_locked(hs, &bd, &o->lo_header->loh_hash);
-	cfs_hash_bd_unlock(hs, &bd, 1);
+	/* supposed to be unique */
+	LASSERTF(rc == 0, "failed to hash "DFID": rc = %d\n", PFID(fid), rc);
 }
 EXPORT_SYMBOL(lu_object_assign_fid);
 
@@ -99,13 +99,17 @@ int lqos_add_tgt(struct lu_qos *qos, struct lu_tgt_desc *ltd)
 		       sizeof(svr->lsq_uuid));
 		++id;
 		svr->lsq_id = id;
+		svr->lsq_alloc_seq = qos->lq_alloc_seq;
+		INIT_LIST_HEAD(&svr->lsq_tgt_list);
 	} else {
 		/* Assume we have to move this one */
 		list_del(&svr->lsq_svr_list);
 	}
 
 	svr->lsq_tgt_count++;
+	list_add_tail(&ltd->ltd_qos.ltq_svr_link, &svr->lsq_tgt_list);
 	ltd->ltd_qos.ltq_svr = svr;
+	ltd->ltd_qos.ltq_alloc_seq = qos->lq_alloc_seq;
 
 	CDEBUG(D_OTHER, "add tgt %s to server %s (%d targets)\n",
 	       obd_uuid2str(&ltd->ltd_uuid), obd_uuid2str(&svr->lsq_uuid),
@@ -158,6 +162,7 @@ int lqos_del_tgt(struct lu_qos *qos, struct lu_tgt_desc *ltd)
 	if (!svr)
 		GOTO(out, rc = -ENOENT);
 
+	list_del_init(&ltd->ltd_qos.ltq_svr_link);
 	svr->lsq_tgt_count--;
 	if (svr->lsq_tgt_count == 0) {
 		CDEBUG(D_OTHER, "removing server %s\n",
@@ -222,6 +227,42 @@ static inline __u64 tgt_statfs_iavail(struct lu_tgt_desc *tgt)
 	return tgt->ltd_statfs.os_ffree;
 }
 
+/* decrease \a penalty by \a per_obj \a count times, down to 0 */
+static inline __u64 lqos_penalty_sub(__u64 penalty, __u64 per_obj,
+				     __u64 count)
+{
+	if (per_obj == 0 || count == 0)
+		return penalty;
+	if (count > div64_u64(penalty, per_obj))
+		return 0;
+	return penalty - per_obj * count;
+}
+
+/*
+ * Every allocation decreases the penalty of all servers and targets by
+ * their penalty per object. Rather than walking all of them each time,
+ * lqos_recalc_weight() only bumps lq_alloc_seq and the decreases are
+ * applied here the next time the server or target is looked at.
+ */
+static void lqos_svr_penalty_sync(struct lu_qos *qos, struct lu_svr_qos *svr)
+{
+	svr->lsq_penalty = lqos_penalty_sub(svr->lsq_penalty,
+					    svr->lsq_penalty_per_obj,
+					    qos->lq_alloc_seq -
+					    svr->lsq_alloc_seq);
+	svr->lsq_alloc_seq = qos->lq_alloc_seq;
+}
+
+static void lqos_tgt_penalty_sync(struct lu_qos *qos, struct lu_tgt_qos *ltq)
+{
+	ltq->ltq_penalty = lqos_penalty_sub(ltq->ltq_penalty,
+					    ltq->ltq_penalty_per_obj,
+					    qos->lq_alloc_seq -
+					    ltq->ltq_alloc_seq);
+	ltq->ltq_alloc_seq = qos->lq_alloc_seq;
+	lqos_svr_penalty_sync(qos, ltq->ltq_svr);
+}
+
 /**
  * Calculate penalties per-tgt and per-server
  *
@@ -290,6 +331,9 @@ int lqos_calc_penalties(struct lu_qos *qos, struct lu_tgt_descs *ltd,
 		if (!tgt->ltd_active)
 			continue;
 
+		/* apply pending decreases before penalty per obj changes */
+		lqos_tgt_penalty_sync(qos, &tgt->ltd_qos);
+
 		/* when inode is counted, bavail >> 16 to avoid overflow */
 		ba = tgt_statfs_bavail(tgt);
 		if (is_mdt)
@@ -355,6 +399,8 @@ int lqos_calc_penalties(struct lu_qos *qos, struct lu_tgt_descs *ltd,
 	 * prio * bavail * iavail / server_tgts / (num_svr - 1) / 2
 	 */
 	list_for_each_entry(svr, &qos->lq_svr_list, lsq_svr_list) {
+		lqos_svr_penalty_sync(qos, svr);
+
 		ba = svr->lsq_bavail;
 		ia = svr->lsq_iavail;
 		svr->lsq_penalty_per_obj = prio_wide * ba  * ia >> 8;
@@ -411,13 +457,16 @@ EXPORT_SYMBOL(lqos_is_usable);
  * The final tgt weight is bavail >> 16 * iavail >> 8 minus the tgt and server
  * penalties.  See lqos_calc_ppts() for how penalties are calculated.
  *
+ * \param[in] qos	lu_qos
  * \param[in] tgt	target descriptor
  */
-void lqos_calc_weight(struct lu_tgt_desc *tgt)
+void lqos_calc_weight(struct lu_qos *qos, struct lu_tgt_desc *tgt)
 {
 	struct lu_tgt_qos *ltq = &tgt->ltd_qos;
 	__u64 temp, temp2;
 
+	lqos_tgt_penalty_sync(qos, ltq);
+
 	temp = (tgt_statfs_bavail(tgt) >> 16) * (tgt_statfs_iavail(tgt) >> 8);
 	temp2 = ltq->ltq_penalty + ltq->ltq_svr->lsq_penalty;
 	if (temp < temp2)
@@ -428,36 +477,23 @@ void lqos_calc_weight(struct lu_tgt_desc *tgt)
 EXPORT_SYMBOL(lqos_calc_weight);
 
 /**
- * Re-calculate weights.
+ * Penalize a target used for a new object.
  *
- * The function is called when some target was used for a new object. In
- * this case we should re-calculate all the weights to keep new allocations
- * balanced well.
+ * The target and its server get the maximum penalty, and the penalties of
+ * all the others are decreased by their penalty per object. The latter is
+ * done lazily by lqos_calc_weight(), so this is O(1).
  *
  * \param[in] qos		lu_qos
- * \param[in] ltd		lu_tgt_descs
  * \param[in] tgt		target where a new object was placed
  * \param[in] active_tgt_nr	active tgt number
- * \param[out] total_wt	new total weight for the pool
- *
- * \retval		0
  */
-int lqos_recalc_weight(struct lu_qos *qos, struct lu_tgt_descs *ltd,
-		       struct lu_tgt_desc *tgt, __u32 active_tgt_nr,
-		       __u64 *total_wt)
+void lqos_add_penalty(struct lu_qos *qos, struct lu_tgt_desc *tgt,
+		      __u32 active_tgt_nr)
 {
-	struct lu_tgt_qos *ltq;
-	struct lu_svr_qos *svr;
-
-	ENTRY;
-
-	ltq = &tgt->ltd_qos;
-	LASSERT(ltq);
-
-	/* Don't allocate on this device anymore, until the next alloc_qos */
-	ltq->ltq_usable = 0;
+	struct lu_tgt_qos *ltq = &tgt->ltd_qos;
+	struct lu_svr_qos *svr = ltq->ltq_svr;
 
-	svr = ltq->ltq_svr;
+	lqos_tgt_penalty_sync(qos, ltq);
 
 	/*
 	 * Decay old penalty by half (we're adding max penalty, and don't
@@ -473,42 +509,50 @@ int lqos_recalc_weight(struct lu_qos *qos, struct lu_tgt_descs *ltd,
 	ltq->ltq_penalty += ltq->ltq_penalty_per_obj * active_tgt_nr;
 	svr->lsq_penalty += svr->lsq_penalty_per_obj * active_tgt_nr;
 
-	/* Decrease all MDS penalties */
-	list_for_each_entry(svr, &qos->lq_svr_list, lsq_svr_list) {
-		if (svr->lsq_penalty < svr->lsq_penalty_per_obj)
-			svr->lsq_penalty = 0;
-		else
-			svr->lsq_penalty -= svr->lsq_penalty_per_obj;
-	}
+	/* Decrease all server and tgt penalties, this one included */
+	qos->lq_alloc_seq++;
 
-	*total_wt = 0;
-	/* Decrease all tgt penalties */
-	ltd_foreach_tgt(ltd, tgt) {
-		if (!tgt->ltd_active)
-			continue;
+	CDEBUG(D_OTHER, "recalc tgt %d avail=%llu tgtppo=%llu tgtp=%llu "
+	       "svrppo=%llu svrp=%llu\n", tgt->ltd_index,
+	       tgt_statfs_bavail(tgt) >> 10,
+	       ltq->ltq_penalty_per_obj >> 10,
+	       ltq->ltq_penalty >> 10,
+	       svr->lsq_penalty_per_obj >> 10,
+	       svr->lsq_penalty >> 10);
+}
+EXPORT_SYMBOL(lqos_add_penalty);
 
-		if (ltq->ltq_penalty < ltq->ltq_penalty_per_obj)
-			ltq->ltq_penalty = 0;
-		else
-			ltq->ltq_penalty -= ltq->ltq_penalty_per_obj;
-
-		lqos_calc_weight(tgt);
-
-		/* Recalc the total weight of usable osts */
-		if (ltq->ltq_usable)
-			*total_wt += ltq->ltq_weight;
-
-		CDEBUG(D_OTHER, "recalc tgt %d usable=%d avail=%llu"
-			  " tgtppo=%llu tgtp=%llu svrppo=%llu"
-			  " svrp=%llu wt=%llu\n",
-			  tgt->ltd_index, ltq->ltq_usable,
-			  tgt_statfs_bavail(tgt) >> 10,
-			  ltq->ltq_penalty_per_obj >> 10,
-			  ltq->ltq_penalty >> 10,
-			  ltq->ltq_svr->lsq_penalty_per_obj >> 10,
-			  ltq->ltq_svr->lsq_penalty >> 10,
-			  ltq->ltq_weight >> 10);
-	}
+/**
+ * Re-calculate weights.
+ *
+ * The function is called when some target was used for a new object. The
+ * target is not used again for this allocation, and is penalized by
+ * lqos_add_penalty(). The weights of the other targets are only refreshed
+ * on the next allocation.
+ *
+ * \param[in] qos		lu_qos
+ * \param[in] ltd		lu_tgt_descs
+ * \param[in] tgt		target where a new object was placed
+ * \param[in] active_tgt_nr	active tgt number
+ * \param[in,out] total_wt	total weight of the usable targets, the
+ *				weight of \a tgt is taken out of it
+ *
+ * \retval		0
+ */
+int lqos_recalc_weight(struct lu_qos *qos, struct lu_tgt_descs *ltd,
+		       struct lu_tgt_desc *tgt, __u32 active_tgt_nr,
+		       __u64 *total_wt)
+{
+	struct lu_tgt_qos *ltq = &tgt->ltd_qos;
+
+	ENTRY;
+
+	/* Don't allocate on this device anymore, until the next alloc_qos */
+	if (ltq->ltq_usable)
+		*total_wt -= min(*total_wt, ltq->ltq_weight);
+	ltq->ltq_usable = 0;
+
+	lqos_add_penalty(qos, tgt, active_tgt_nr);
 
 	RETURN(0);
 }
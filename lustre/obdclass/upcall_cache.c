@@ -50,6 +50,7 @@ static struct upcall_cache_entry *alloc_entry(struct upcall_cache *cache,
 
 	UC_CACHE_SET_NEW(entry);
 	INIT_LIST_HEAD(&entry->ue_hash);
+	INIT_LIST_HEAD(&entry->ue_refresh);
 	entry->ue_key = key;
 	atomic_set(&entry->ue_refcount, 0);
 	init_waitqueue_head(&entry->ue_waitq);
@@ -102,11 +103,28 @@ static inline void get_entry(struct upcall_cache_entry *entry)
 	atomic_inc(&entry->ue_refcount);
 }
 
+/* a negative entry remembers a failed upcall until ue_expire */
+static inline bool is_negative_entry(struct upcall_cache_entry *entry)
+{
+	return UC_CACHE_IS_INVALID(entry) && !UC_CACHE_IS_EXPIRED(entry) &&
+	       entry->ue_expire != 0;
+}
+
+/* a stale entry is expired, but still used until it is refreshed */
+static inline bool is_stale_entry(struct upcall_cache *cache,
+				  struct upcall_cache_entry *entry,
+				  time64_t now)
+{
+	return UC_CACHE_IS_VALID(entry) && now >= entry->ue_expire &&
+	       now < entry->ue_expire + cache->uc_stale_expire;
+}
+
 static inline void put_entry(struct upcall_cache *cache,
 			     struct upcall_cache_entry *entry)
 {
 	if (atomic_dec_and_test(&entry->ue_refcount) &&
-	    (UC_CACHE_IS_INVALID(entry) || UC_CACHE_IS_EXPIRED(entry))) {
+	    ((UC_CACHE_IS_INVALID(entry) && !is_negative_entry(entry)) ||
+	     UC_CACHE_IS_EXPIRED(entry))) {
 		free_entry(cache, entry);
 	}
 }
@@ -116,7 +134,11 @@ static int check_unlink_entry(struct upcall_cache *cache,
 {
 	time64_t now = ktime_get_seconds();
 
-	if (UC_CACHE_IS_VALID(entry) && now < entry->ue_expire)
+	if (UC_CACHE_IS_VALID(entry) &&
+	    now < entry->ue_expire + cache->uc_stale_expire)
+		return 0;
+
+	if (is_negative_entry(entry) && now < entry->ue_expire)
 		return 0;
 
 	if (UC_CACHE_IS_ACQUIRING(entry)) {
@@ -126,7 +148,7 @@ static int check_unlink_entry(struct upcall_cache *cache,
 
 		UC_CACHE_SET_EXPIRED(entry);
 		wake_up_all(&entry->ue_waitq);
-	} else if (!UC_CACHE_IS_INVALID(entry)) {
+	} else if (!UC_CACHE_IS_INVALID(entry) || entry->ue_expire != 0) {
 		UC_CACHE_SET_EXPIRED(entry);
 	}
 
@@ -143,12 +165,151 @@ static inline int refresh_entry(struct upcall_cache *cache,
 	return cache->uc_ops->do_upcall(cache, entry);
 }
 
+/*
+ * Link new \a entry for \a head and hand its upcall over to uc_refresh_work,
+ * nobody waits for it. It goes after the entry it replaces, so that one
+ * keeps being found until the downcall. Called with the cache lock held.
+ */
+static void queue_refresh_entry(struct upcall_cache *cache,
+				struct list_head *head,
+				struct upcall_cache_entry *entry)
+{
+	LASSERT(UC_CACHE_IS_NEW(entry));
+
+	list_add_tail(&entry->ue_hash, head);
+	UC_CACHE_SET_ACQUIRING(entry);
+	UC_CACHE_CLEAR_NEW(entry);
+	/* doesn't expire while queued, set when the upcall is issued */
+	entry->ue_acquire_expire = 0;
+	/* reference for uc_refresh_list */
+	get_entry(entry);
+	list_add_tail(&entry->ue_refresh, &cache->uc_refresh_list);
+	schedule_delayed_work(&cache->uc_refresh_work, 0);
+}
+
+/*
+ * The upcall uc_refresh_work issued for \a entry is answered, failed or
+ * given up, it no longer counts against uc_inflight_max. Called with the
+ * cache lock held.
+ */
+static void refresh_done(struct upcall_cache *cache,
+			 struct upcall_cache_entry *entry)
+{
+	if (!entry->ue_inflight)
+		return;
+
+	entry->ue_inflight = false;
+	list_del_init(&entry->ue_refresh);
+	cache->uc_inflight--;
+	put_entry(cache, entry);
+}
+
+/*
+ * The refresh of \a key failed, keep using its stale entries but don't try
+ * again before uc_neg_expire. ue_acquire_expire is free for this once an
+ * entry is valid. Called with the cache lock held.
+ */
+static void defer_stale_refresh(struct upcall_cache *cache, __u64 key)
+{
+	struct list_head *head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+	struct upcall_cache_entry *entry;
+
+	list_for_each_entry(entry, head, ue_hash) {
+		if (entry->ue_key == key && UC_CACHE_IS_VALID(entry))
+			entry->ue_acquire_expire = ktime_get_seconds() +
+						   cache->uc_neg_expire;
+	}
+}
+
+/*
+ * Issue the upcalls of the queued entries, keeping at most uc_inflight_max
+ * of them unanswered. The downcalls complete them as usual and reschedule
+ * the work for the rest of the queue.
+ */
+static void upcall_cache_refresh_work(struct work_struct *work)
+{
+	struct upcall_cache *cache = container_of(work, struct upcall_cache,
+						  uc_refresh_work.work);
+	struct upcall_cache_entry *entry, *next;
+	time64_t now = ktime_get_seconds();
+	time64_t left;
+	int count = 0;
+	int rc;
+
+	spin_lock(&cache->uc_lock);
+	/* don't wait any longer for upcalls that timed out or were flushed */
+	list_for_each_entry_safe(entry, next, &cache->uc_inflight_list,
+				 ue_refresh) {
+		if (UC_CACHE_IS_ACQUIRING(entry) &&
+		    !UC_CACHE_IS_EXPIRED(entry) &&
+		    now < entry->ue_acquire_expire)
+			continue;
+		CDEBUG(D_OTHER, "%s: upcall for key %llu not answered\n",
+		       cache->uc_name, entry->ue_key);
+		refresh_done(cache, entry);
+	}
+
+	while (!list_empty(&cache->uc_refresh_list)) {
+		if (cache->uc_inflight_max &&
+		    cache->uc_inflight >= cache->uc_inflight_max) {
+			/* resume on a downcall or when the oldest times out */
+			entry = list_entry(cache->uc_inflight_list.next,
+					   struct upcall_cache_entry, ue_refresh);
+			left = max_t(time64_t, 1,
+				     entry->ue_acquire_expire - now);
+			schedule_delayed_work(&cache->uc_refresh_work,
+					      cfs_time_seconds(left));
+			break;
+		}
+
+		entry = list_entry(cache->uc_refresh_list.next,
+				   struct upcall_cache_entry, ue_refresh);
+		list_del_init(&entry->ue_refresh);
+
+		/* answered, expired or flushed while queued */
+		if (!UC_CACHE_IS_ACQUIRING(entry) ||
+		    UC_CACHE_IS_EXPIRED(entry)) {
+			put_entry(cache, entry);
+			continue;
+		}
+
+		entry->ue_acquire_expire = now + cache->uc_acquire_expire;
+		/* the uc_refresh_list reference moves to uc_inflight_list */
+		list_add_tail(&entry->ue_refresh, &cache->uc_inflight_list);
+		entry->ue_inflight = true;
+		cache->uc_inflight++;
+		/* the downcall may come before the upcall returns */
+		get_entry(entry);
+
+		spin_unlock(&cache->uc_lock);
+		rc = refresh_entry(cache, entry);
+		spin_lock(&cache->uc_lock);
+		if (rc < 0) {
+			CDEBUG(D_OTHER, "%s: refresh key %llu failed: rc = %d\n",
+			       cache->uc_name, entry->ue_key, rc);
+			UC_CACHE_CLEAR_ACQUIRING(entry);
+			UC_CACHE_SET_INVALID(entry);
+			list_del_init(&entry->ue_hash);
+			wake_up_all(&entry->ue_waitq);
+			defer_stale_refresh(cache, entry->ue_key);
+			refresh_done(cache, entry);
+		}
+		put_entry(cache, entry);
+		count++;
+	}
+	CDEBUG(D_OTHER, "%s: issued %d upcalls, %d in flight\n",
+	       cache->uc_name, count, cache->uc_inflight);
+	spin_unlock(&cache->uc_lock);
+}
+
 struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
 						  __u64 key, void *args)
 {
 	struct upcall_cache_entry *entry = NULL, *new = NULL, *next;
+	struct upcall_cache_entry *stale;
 	struct list_head *head;
 	wait_queue_entry_t wait;
+	time64_t now;
 	int rc, found;
 	ENTRY;
 
@@ -157,17 +318,48 @@ struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
 	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
 find_again:
 	found = 0;
+	stale = NULL;
+	now = ktime_get_seconds();
 	spin_lock(&cache->uc_lock);
 	list_for_each_entry_safe(entry, next, head, ue_hash) {
 		/* check invalid & expired items */
 		if (check_unlink_entry(cache, entry))
 			continue;
 		if (upcall_compare(cache, entry, key, args) == 0) {
+			if (is_stale_entry(cache, entry, now)) {
+				stale = entry;
+				continue;
+			}
 			found = 1;
 			break;
 		}
 	}
 
+	/* use the stale entry until its replacement is acquired */
+	if (stale && (!found || UC_CACHE_IS_ACQUIRING(entry))) {
+		if (!found && now >= stale->ue_acquire_expire) {
+			if (!new) {
+				spin_unlock(&cache->uc_lock);
+				new = alloc_entry(cache, key, args);
+				if (!new) {
+					CERROR("fail to alloc entry\n");
+					RETURN(ERR_PTR(-ENOMEM));
+				}
+				goto find_again;
+			}
+			CDEBUG(D_OTHER, "%s: refresh stale entry %p for key %llu\n",
+			       cache->uc_name, stale, key);
+			queue_refresh_entry(cache, head, new);
+			new = NULL;
+		}
+		if (new) {
+			free_entry(cache, new);
+			new = NULL;
+		}
+		get_entry(stale);
+		GOTO(out, entry = stale);
+	}
+
 	if (!found) {
 		if (!new) {
 			spin_unlock(&cache->uc_lock);
@@ -267,6 +459,44 @@ out:
 }
 EXPORT_SYMBOL(upcall_cache_get_entry);
 
+/**
+ * Start the upcall for \a key in the background unless the cache already
+ * holds a usable entry for it, nobody waits for the result. This is used to
+ * warm the cache, the entry is found by later upcall_cache_get_entry() calls
+ * once the downcall completes it.
+ */
+int upcall_cache_prefetch(struct upcall_cache *cache, __u64 key, void *args)
+{
+	struct upcall_cache_entry *entry, *next, *new;
+	struct list_head *head;
+	time64_t now = ktime_get_seconds();
+	ENTRY;
+
+	LASSERT(cache);
+
+	new = alloc_entry(cache, key, args);
+	if (!new)
+		RETURN(-ENOMEM);
+
+	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+	spin_lock(&cache->uc_lock);
+	list_for_each_entry_safe(entry, next, head, ue_hash) {
+		if (check_unlink_entry(cache, entry))
+			continue;
+		if (upcall_compare(cache, entry, key, args) == 0 &&
+		    !is_stale_entry(cache, entry, now)) {
+			spin_unlock(&cache->uc_lock);
+			free_entry(cache, new);
+			RETURN(0);
+		}
+	}
+	queue_refresh_entry(cache, head, new);
+	spin_unlock(&cache->uc_lock);
+
+	RETURN(0);
+}
+EXPORT_SYMBOL(upcall_cache_prefetch);
+
 void upcall_cache_put_entry(struct upcall_cache *cache,
 			    struct upcall_cache_entry *entry)
 {
@@ -288,9 +518,10 @@ EXPORT_SYMBOL(upcall_cache_put_entry);
 int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 			  void *args)
 {
-	struct upcall_cache_entry *entry = NULL;
+	struct upcall_cache_entry *entry = NULL, *tmp, *next;
 	struct list_head *head;
-	int found = 0, rc = 0;
+	bool replaced = false;
+	int rc = 0;
 	ENTRY;
 
 	LASSERT(cache);
@@ -298,21 +529,24 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
 
 	spin_lock(&cache->uc_lock);
-	list_for_each_entry(entry, head, ue_hash) {
-		if (downcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			get_entry(entry);
-			break;
+	/* a refreshing entry sits next to the stale one, prefer it */
+	list_for_each_entry(tmp, head, ue_hash) {
+		if (downcall_compare(cache, tmp, key, args) == 0) {
+			if (!entry || UC_CACHE_IS_ACQUIRING(tmp))
+				entry = tmp;
+			if (UC_CACHE_IS_ACQUIRING(tmp))
+				break;
 		}
 	}
 
-	if (!found) {
+	if (!entry) {
 		CDEBUG(D_OTHER, "%s: upcall for key %llu not expected\n",
 		       cache->uc_name, key);
 		/* haven't found, it's possible */
 		spin_unlock(&cache->uc_lock);
 		RETURN(-EINVAL);
 	}
+	get_entry(entry);
 
 	if (err) {
 		CDEBUG(D_OTHER, "%s: upcall for key %llu returned %d\n",
@@ -340,18 +574,54 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 		GOTO(out, rc);
 
 	entry->ue_expire = ktime_get_seconds() + cache->uc_entry_expire;
+	entry->ue_acquire_expire = 0;
 	UC_CACHE_SET_VALID(entry);
 	CDEBUG(D_OTHER, "%s: created upcall cache entry %p for key %llu\n",
 	       cache->uc_name, entry, entry->ue_key);
+
+	/* retire the entries this one replaces */
+	list_for_each_entry_safe(tmp, next, head, ue_hash) {
+		if (tmp == entry || tmp->ue_key != entry->ue_key ||
+		    !UC_CACHE_IS_VALID(tmp))
+			continue;
+
+		UC_CACHE_SET_EXPIRED(tmp);
+		list_del_init(&tmp->ue_hash);
+		if (!atomic_read(&tmp->ue_refcount))
+			free_entry(cache, tmp);
+	}
 out:
 	if (rc) {
 		UC_CACHE_SET_INVALID(entry);
 		list_del_init(&entry->ue_hash);
+		/* remember the error, unless an older entry is still used */
+		if (err && cache->uc_neg_expire &&
+		    UC_CACHE_IS_ACQUIRING(entry)) {
+			list_for_each_entry(tmp, head, ue_hash) {
+				if (tmp->ue_key == entry->ue_key &&
+				    UC_CACHE_IS_VALID(tmp)) {
+					replaced = true;
+					break;
+				}
+			}
+			if (!replaced) {
+				entry->ue_expire = ktime_get_seconds() +
+						   cache->uc_neg_expire;
+				list_add(&entry->ue_hash, head);
+			} else {
+				defer_stale_refresh(cache, entry->ue_key);
+			}
+		}
 	}
 	UC_CACHE_CLEAR_ACQUIRING(entry);
+	if (entry->ue_inflight) {
+		refresh_done(cache, entry);
+		if (!list_empty(&cache->uc_refresh_list))
+			mod_delayed_work(system_wq, &cache->uc_refresh_work, 0);
+	}
 	spin_unlock(&cache->uc_lock);
 	wake_up_all(&entry->ue_waitq);
-	put_entry(cache, entry);
+	upcall_cache_put_entry(cache, entry);
 
 	RETURN(rc);
 }
@@ -383,21 +653,17 @@ EXPORT_SYMBOL(upcall_cache_flush);
 void upcall_cache_flush_one(struct upcall_cache *cache, __u64 key, void *args)
 {
 	struct list_head *head;
-	struct upcall_cache_entry *entry;
-	int found = 0;
+	struct upcall_cache_entry *entry, *next;
 	ENTRY;
 
 	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
 
 	spin_lock(&cache->uc_lock);
-	list_for_each_entry(entry, head, ue_hash) {
-		if (upcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			break;
-		}
-	}
+	/* a stale entry and its replacement may both be there */
+	list_for_each_entry_safe(entry, next, head, ue_hash) {
+		if (upcall_compare(cache, entry, key, args) != 0)
+			continue;
 
-	if (found) {
 		CWARN("%s: flush entry %p: key %llu, ref %d, fl %x, "
 		      "cur %lld, ex %lld/%lld\n",
 		      cache->uc_name, entry, entry->ue_key,
@@ -427,11 +693,17 @@ struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 	init_rwsem(&cache->uc_upcall_rwsem);
 	for (i = 0; i < UC_CACHE_HASH_SIZE; i++)
 		INIT_LIST_HEAD(&cache->uc_hashtable[i]);
+	INIT_LIST_HEAD(&cache->uc_refresh_list);
+	INIT_LIST_HEAD(&cache->uc_inflight_list);
+	INIT_DELAYED_WORK(&cache->uc_refresh_work, upcall_cache_refresh_work);
 	strlcpy(cache->uc_name, name, sizeof(cache->uc_name));
 	/* upcall pathname proc tunable */
 	strlcpy(cache->uc_upcall, upcall, sizeof(cache->uc_upcall));
 	cache->uc_entry_expire = 20 * 60;
 	cache->uc_acquire_expire = 30;
+	cache->uc_stale_expire = 5 * 60;
+	cache->uc_neg_expire = 60;
+	cache->uc_inflight_max = 32;
 	cache->uc_ops = ops;
 
 	RETURN(cache);
@@ -440,8 +712,26 @@ EXPORT_SYMBOL(upcall_cache_init);
 
 void upcall_cache_cleanup(struct upcall_cache *cache)
 {
+	struct upcall_cache_entry *entry;
+
 	if (!cache)
 		return;
+
+	cancel_delayed_work_sync(&cache->uc_refresh_work);
+	spin_lock(&cache->uc_lock);
+	while (!list_empty(&cache->uc_refresh_list)) {
+		entry = list_entry(cache->uc_refresh_list.next,
+				   struct upcall_cache_entry, ue_refresh);
+		list_del_init(&entry->ue_refresh);
+		put_entry(cache, entry);
+	}
+	while (!list_empty(&cache->uc_inflight_list)) {
+		entry = list_entry(cache->uc_inflight_list.next,
+				   struct upcall_cache_entry, ue_refresh);
+		refresh_done(cache, entry);
+	}
+	spin_unlock(&cache->uc_lock);
+
 	upcall_cache_flush_all(cache);
 	LIBCFS_FREE(cache, sizeof(*cache));
 }
@@ -250,7 +250,7 @@ static void ofd_stack_fini(const struct lu_env *env, struct ofd_device *m,
 	}
 
 	lu_site_purge(env, top->ld_site, ~0);
-	if (!cfs_hash_is_empty(top->ld_site->ls_obj_hash)) {
+	if (!lu_site_is_empty(top->ld_site)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_OTHER, NULL);
 		lu_site_print(env, top->ld_site, &msgdata, lu_cdebug_printer);
 	}
@@ -449,6 +449,14 @@ static int ofd_object_init(const struct lu_env *env, struct lu_object *o,
 	RETURN(rc);
 }
 
+static void ofd_object_free_rcu(struct rcu_head *head)
+{
+	struct ofd_object *of = container_of(head, struct ofd_object,
+					     ofo_header.loh_rcu);
+
+	OBD_SLAB_FREE_PTR(of, ofd_object_kmem);
+}
+
 /**
  * Implementation of lu_object_operations::loo_object_free.
  *
@@ -470,7 +478,8 @@ static void ofd_object_free(const struct lu_env *env, struct lu_object *o)
 
 	lu_object_fini(o);
 	lu_object_header_fini(h);
-	OBD_SLAB_FREE_PTR(of, ofd_object_kmem);
+	/* lu_site lookups may still see the header until a grace period */
+	call_rcu(&h->loh_rcu, ofd_object_free_rcu);
 	EXIT;
 }
 
@@ -1741,12 +1750,112 @@ out_sem:
 	return rc;
 }
 
+/**
+ * Account the result of the destroy of one object of OST_DESTROY RPC.
+ *
+ * \param[in] ofd	OFD device
+ * \param[in] fid	FID of the object
+ * \param[in] lrc	result of the destroy of this object
+ * \param[in,out] rc	result of the RPC, -ENOENT is reported only if
+ *			nothing else failed
+ */
+static void ofd_destroy_result(struct ofd_device *ofd,
+			       const struct lu_fid *fid, int lrc, int *rc)
+{
+	if (lrc == -ENOENT) {
+		CDEBUG(D_INODE,
+		       "%s: destroying non-existent object "DFID"\n",
+		       ofd_name(ofd), PFID(fid));
+		/* rewrite rc with -ENOENT only if it is 0 */
+		if (*rc == 0)
+			*rc = lrc;
+	} else if (lrc != 0) {
+		CERROR("%s: error destroying object "DFID": %d\n",
+		       ofd_name(ofd), PFID(fid), lrc);
+		*rc = lrc;
+	}
+}
+
+/**
+ * Destroy the objects of a batched OST_DESTROY RPC.
+ *
+ * All the objects are destroyed together by ofd_destroy_by_fids(), which
+ * splits them into transactions only as the journal credits require.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] fid	FID of the first object, from RMF_OST_BODY
+ * \param[in] oids	IDs of the other objects, from RMF_OST_IDS
+ * \param[in] nr	number of IDs in \a oids
+ * \param[out] rcs	result of each object, the first one included
+ *
+ * \retval		0 if any object was destroyed
+ * \retval		negative value on error
+ */
+static int ofd_destroy_batch(struct tgt_session_info *tsi,
+			     const struct lu_fid *fid,
+			     const struct ost_id *oids, int nr, __u32 *rcs)
+{
+	struct ofd_device	*ofd = ofd_exp(tsi->tsi_exp);
+	struct lu_fid		*fids;
+	int			*lrcs;
+	int			 destroyed = 0;
+	int			 i;
+	int			 rc = 0;
+
+	ENTRY;
+
+	OBD_ALLOC_LARGE(fids, (nr + 1) * sizeof(*fids));
+	if (fids == NULL)
+		RETURN(-ENOMEM);
+	OBD_ALLOC_LARGE(lrcs, (nr + 1) * sizeof(*lrcs));
+	if (lrcs == NULL)
+		GOTO(out_fids, rc = -ENOMEM);
+
+	fids[0] = *fid;
+	for (i = 0; i < nr; i++) {
+		rc = ostid_to_fid(&fids[i + 1], &oids[i],
+				  ofd->ofd_lut.lut_lsd.lsd_osd_index);
+		if (unlikely(rc != 0))
+			GOTO(out, rc = -EPROTO);
+	}
+
+	rc = ofd_destroy_by_fids(tsi->tsi_env, ofd, fids, nr + 1, lrcs);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	for (i = 0; i < nr + 1; i++) {
+		ofd_destroy_result(ofd, &fids[i], lrcs[i], &rc);
+		if (lrcs[i] == 0)
+			destroyed++;
+		rcs[i] = lrcs[i];
+	}
+
+	/* the failed objects are reported in rcs */
+	if (destroyed > 0)
+		rc = 0;
+	EXIT;
+out:
+	OBD_FREE_LARGE(lrcs, (nr + 1) * sizeof(*lrcs));
+out_fids:
+	OBD_FREE_LARGE(fids, (nr + 1) * sizeof(*fids));
+	return rc;
+}
+
 /**
  * OFD request handler for OST_DESTROY RPC.
  *
  * This is OFD-specific part of request handling. It destroys data objects
  * related to destroyed object on MDT.
  *
+ * With OBD_CONNECT2_BATCH_DESTROY the MDT may pack the IDs of more objects
+ * in RMF_OST_IDS. They are all checked before any object is destroyed, then
+ * the objects share one transaction, or a few if the journal credits need,
+ * and the reply transno is the one of the last transaction. The result of
+ * each object is returned in RMF_RCS, and the MDT cancels only the llog
+ * records of the objects which were destroyed or don't exist. The RPC
+ * succeeds if any object was destroyed, as an error must not come with a
+ * transno.
+ *
  * \param[in] tsi	target session environment for this request
  *
  * \retval		0 if successful
@@ -1759,8 +1868,12 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 	struct ofd_device	*ofd = ofd_exp(tsi->tsi_exp);
 	struct ofd_thread_info	*fti = tsi2ofd_info(tsi);
 	struct lu_fid		*fid = &fti->fti_fid;
+	struct ost_id		*oids = NULL;
+	__u32			*rcs = NULL;
 	u64			 oid;
 	u32			 count;
+	int			 nr = 0;
+	int			 i;
 	int			 rc = 0;
 
 	ENTRY;
@@ -1792,25 +1905,46 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 	else
 		count = 1; /* default case - single destroy */
 
-	CDEBUG(D_HA, "%s: Destroy object "DOSTID" count %d\n", ofd_name(ofd),
-	       POSTID(&body->oa.o_oi), count);
+	if (req_capsule_field_present(tsi->tsi_pill, &RMF_OST_IDS,
+				      RCL_CLIENT))
+		nr = req_capsule_get_size(tsi->tsi_pill, &RMF_OST_IDS,
+					  RCL_CLIENT) / sizeof(*oids);
+	if (nr > 0) {
+		if (count > 1 || nr >= PTLRPC_MAX_DESTROY_OBJS ||
+		    !exp_connect_batch_destroy(tsi->tsi_exp))
+			GOTO(out, rc = -EPROTO);
+
+		oids = req_capsule_client_get(tsi->tsi_pill, &RMF_OST_IDS);
+		if (oids == NULL)
+			GOTO(out, rc = -EFAULT);
+
+		for (i = 0; i < nr; i++) {
+			u64 seq = ostid_seq(&oids[i]);
+
+			if (unlikely(ostid_id(&oids[i]) == 0 ||
+				     !(fid_seq_is_idif(seq) ||
+				       fid_seq_is_mdt0(seq) ||
+				       fid_seq_is_norm(seq))))
+				GOTO(out, rc = -EPROTO);
+		}
 
-	while (count > 0) {
+		rcs = req_capsule_server_sized_get(tsi->tsi_pill, &RMF_RCS,
+						   (nr + 1) * sizeof(*rcs));
+		if (rcs == NULL)
+			GOTO(out, rc = -EPROTO);
+	}
+
+	CDEBUG(D_HA, "%s: Destroy object "DOSTID" count %d batch %d\n",
+	       ofd_name(ofd), POSTID(&body->oa.o_oi), count, nr);
+
+	if (nr > 0)
+		rc = ofd_destroy_batch(tsi, fid, oids, nr, rcs);
+
+	while (nr == 0 && count > 0) {
 		int lrc;
 
 		lrc = ofd_destroy_by_fid(tsi->tsi_env, ofd, fid, 0);
-		if (lrc == -ENOENT) {
-			CDEBUG(D_INODE,
-			       "%s: destroying non-existent object "DFID"\n",
-			       ofd_name(ofd), PFID(fid));
-			/* rewrite rc with -ENOENT only if it is 0 */
-			if (rc == 0)
-				rc = lrc;
-		} else if (lrc != 0) {
-			CERROR("%s: error destroying object "DFID": %d\n",
-			       ofd_name(ofd), PFID(fid), lrc);
-			rc = lrc;
-		}
+		ofd_destroy_result(ofd, fid, lrc, &rc);
 
 		count--;
 		oid++;
@@ -290,6 +290,8 @@ int ofd_fiemap_get(const struct lu_env *env, struct ofd_device *ofd,
 extern struct obd_ops ofd_obd_ops;
 int ofd_destroy_by_fid(const struct lu_env *env, struct ofd_device *ofd,
 		       const struct lu_fid *fid, int orphan);
+int ofd_destroy_by_fids(const struct lu_env *env, struct ofd_device *ofd,
+			const struct lu_fid *fids, int nr, int *rcs);
 int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	       struct obd_statfs *osfs, time64_t max_age, __u32 flags);
 int ofd_obd_disconnect(struct obd_export *exp);
@@ -368,6 +370,8 @@ int ofd_object_punch(const struct lu_env *env, struct ofd_object *fo,
 		     __u64 start, __u64 end, struct lu_attr *la,
 		     struct obdo *oa);
 int ofd_destroy(const struct lu_env *, struct ofd_object *, int);
+void ofd_destroy_objects(const struct lu_env *env, struct ofd_device *ofd,
+			 struct ofd_object **fos, int nr, int *rcs);
 int ofd_attr_get(const struct lu_env *env, struct ofd_object *fo,
 		 struct lu_attr *la);
 int ofd_attr_handle_id(const struct lu_env *env, struct ofd_object *fo,
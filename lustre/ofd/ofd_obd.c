@@ -1021,6 +1021,87 @@ int ofd_destroy_by_fid(const struct lu_env *env, struct ofd_device *ofd,
 	RETURN(rc);
 }
 
+/**
+ * Destroy several OFD objects by their FIDs.
+ *
+ * This is ofd_destroy_by_fid() for a batch of objects: the local locks
+ * discarding the cached data of every object are taken first, then the
+ * objects are destroyed by ofd_destroy_objects() with as few transactions
+ * as the journal credits allow.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] fids	FIDs of the objects
+ * \param[in] nr	number of objects
+ * \param[out] rcs	result of each object, as of ofd_destroy_by_fid()
+ *
+ * etval		0 if the objects were looked up
+ * etval		-ENOMEM if the batch couldn't be allocated
+ */
+int ofd_destroy_by_fids(const struct lu_env *env, struct ofd_device *ofd,
+			const struct lu_fid *fids, int nr, int *rcs)
+{
+	struct ofd_thread_info *info = ofd_info(env);
+	struct lustre_handle lockh;
+	union ldlm_policy_data policy = { .l_extent = { 0, OBD_OBJECT_EOF } };
+	struct ofd_object **fos;
+	__u64 flags;
+	int *dcs;
+	int i, n;
+	int rc;
+
+	ENTRY;
+
+	OBD_ALLOC_LARGE(fos, nr * sizeof(*fos));
+	if (fos == NULL)
+		RETURN(-ENOMEM);
+	OBD_ALLOC_LARGE(dcs, nr * sizeof(*dcs));
+	if (dcs == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0, n = 0; i < nr; i++) {
+		struct ofd_object *fo;
+
+		fo = ofd_object_find_exists(env, ofd, &fids[i]);
+		if (IS_ERR(fo)) {
+			rcs[i] = PTR_ERR(fo);
+			continue;
+		}
+
+		/* see ofd_destroy_by_fid() */
+		flags = LDLM_FL_AST_DISCARD_DATA;
+		ost_fid_build_resid(&fids[i], &info->fti_resid);
+		rc = ldlm_cli_enqueue_local(env, ofd->ofd_namespace,
+					    &info->fti_resid, LDLM_EXTENT,
+					    &policy, LCK_PW, &flags,
+					    ldlm_blocking_ast,
+					    ldlm_completion_ast, NULL, NULL, 0,
+					    LVB_T_NONE, NULL, &lockh);
+		if (rc == ELDLM_OK)
+			ldlm_lock_decref(&lockh, LCK_PW);
+
+		rcs[i] = 0;
+		fos[n++] = fo;
+	}
+
+	ofd_destroy_objects(env, ofd, fos, n, dcs);
+
+	/* put the results of the looked up objects back in place */
+	for (i = 0, n = 0; i < nr; i++) {
+		if (rcs[i] != 0)
+			continue;
+		rcs[i] = dcs[n];
+		ofd_object_put(env, fos[n]);
+		n++;
+	}
+	rc = 0;
+
+	OBD_FREE_LARGE(dcs, nr * sizeof(*dcs));
+out:
+	OBD_FREE_LARGE(fos, nr * sizeof(*fos));
+	RETURN(rc);
+}
+
 /**
  * Implementation of obd_ops::o_destroy.
  *
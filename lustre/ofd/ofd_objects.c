@@ -942,6 +942,108 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Destroy several OFD objects in as few transactions as possible.
+ *
+ * The objects are destroyed in transactions of up to
+ * ofd_device::ofd_precreate_batch objects, the limit which keeps the same
+ * number of object creations within the journal credits. A transaction
+ * which failed to start fails all of its objects.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] fos	objects to destroy
+ * \param[in] nr	number of objects in  fos
+ * \param[out] rcs	result of each object, -ENOENT if it doesn't exist
+ */
+void ofd_destroy_objects(const struct lu_env *env, struct ofd_device *ofd,
+			 struct ofd_object **fos, int nr, int *rcs)
+{
+	struct thandle	*th;
+	int		 i, j, end;
+	int		 rc;
+	int		 rc2;
+
+	ENTRY;
+
+	for (i = 0; i < nr; i = end) {
+		bool any = false;
+
+		end = min(nr, i + max(ofd->ofd_precreate_batch, 1));
+		for (j = i; j < end; j++) {
+			rcs[j] = ofd_object_exists(fos[j]) ? 0 : -ENOENT;
+			if (rcs[j] == 0)
+				any = true;
+		}
+		/* no transno must come with -ENOENT, see osp_sync_interpret() */
+		if (!any)
+			continue;
+
+		th = ofd_trans_create(env, ofd);
+		if (IS_ERR(th)) {
+			for (j = i; j < end; j++) {
+				if (rcs[j] == 0)
+					rcs[j] = PTR_ERR(th);
+			}
+			continue;
+		}
+
+		rc = 0;
+		for (j = i; j < end; j++) {
+			if (rcs[j] != 0)
+				continue;
+
+			rc = dt_declare_ref_del(env, ofd_object_child(fos[j]),
+						th);
+			if (rc < 0)
+				GOTO(stop, rc);
+
+			rc = dt_declare_destroy(env, ofd_object_child(fos[j]),
+						th);
+			if (rc < 0)
+				GOTO(stop, rc);
+		}
+
+		rc = ofd_trans_start(env, ofd, NULL, th);
+		if (rc)
+			GOTO(stop, rc);
+
+		for (j = i; j < end; j++) {
+			struct ofd_object *fo = fos[j];
+
+			if (rcs[j] != 0)
+				continue;
+
+			ofd_write_lock(env, fo);
+			if (!ofd_object_exists(fo)) {
+				ofd_write_unlock(env, fo);
+				rcs[j] = -ENOENT;
+				continue;
+			}
+
+			tgt_fmd_drop(ofd_info(env)->fti_exp,
+				     &fo->ofo_header.loh_fid);
+
+			dt_ref_del(env, ofd_object_child(fo), th);
+			dt_destroy(env, ofd_object_child(fo), th);
+			ofd_write_unlock(env, fo);
+		}
+stop:
+		rc2 = ofd_trans_stop(env, ofd, th, rc);
+		if (rc2)
+			CERROR("%s failed to stop transaction: %d\n",
+			       ofd_name(ofd), rc2);
+		if (!rc)
+			rc = rc2;
+		for (j = i; rc != 0 && j < end; j++) {
+			if (rcs[j] == 0)
+				rcs[j] = rc;
+		}
+	}
+
+	EXIT;
+}
+
 /**
  * Get OFD object attributes.
  *
@@ -176,6 +176,7 @@ static ssize_t max_dirty_mb_store(struct kobject *kobj,
 
 	spin_lock(&cli->cl_loi_list_lock);
 	cli->cl_dirty_max_pages = pages_number;
+	osc_cache_credits_sync(cli, true);
 	osc_wake_cache_waiters(cli);
 	spin_unlock(&cli->cl_loi_list_lock);
 
@@ -261,7 +262,9 @@ static ssize_t cur_dirty_bytes_show(struct kobject *kobj,
 	ssize_t len;
 
 	spin_lock(&cli->cl_loi_list_lock);
-	len = sprintf(buf, "%lu\n", cli->cl_dirty_pages << PAGE_SHIFT);
+	len = sprintf(buf, "%lu\n",
+		      (cli->cl_dirty_pages - osc_cache_credits_pages(cli)) <<
+		      PAGE_SHIFT);
 	spin_unlock(&cli->cl_loi_list_lock);
 
 	return len;
@@ -580,6 +583,74 @@ static ssize_t lockless_truncate_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lockless_truncate);
 
+static ssize_t max_nolock_bytes_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct osc_device *od = obd2osc_dev(obd);
+
+	return sprintf(buf, "%u\n", od->od_max_nolock_bytes);
+}
+
+static ssize_t max_nolock_bytes_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct osc_device *od = obd2osc_dev(obd);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	od->od_max_nolock_bytes = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_nolock_bytes);
+
+static ssize_t max_objs_per_rpc_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_max_objs_per_rpc);
+}
+
+static ssize_t max_objs_per_rpc_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct client_obd *cli = &obd->u.cli;
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > PTLRPC_MAX_BRW_OBJS)
+		return -ERANGE;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	cli->cl_max_objs_per_rpc = val;
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_objs_per_rpc);
+
 static ssize_t destroys_in_flight_show(struct kobject *kobj,
 				       struct attribute *attr,
 				       char *buf)
@@ -960,6 +1031,8 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_grant_shrink_interval.attr,
 	&lustre_attr_lockless_truncate.attr,
 	&lustre_attr_max_dirty_mb.attr,
+	&lustre_attr_max_nolock_bytes.attr,
+	&lustre_attr_max_objs_per_rpc.attr,
 	&lustre_attr_max_rpcs_in_flight.attr,
 	&lustre_attr_short_io_bytes.attr,
 	&lustre_attr_resend_count.attr,
@@ -1463,6 +1463,7 @@ static void __osc_unreserve_grant(struct client_obd *cli,
 	 * one chunk, we can save more grant by adding a new chunk */
 	cli->cl_reserved_grant -= reserved;
 	if (unused > reserved) {
+		osc_cache_credits_sync(cli, false);
 		cli->cl_avail_grant += reserved;
 		cli->cl_lost_grant  += unused - reserved;
 		cli->cl_dirty_grant -= unused - reserved;
@@ -1512,6 +1513,10 @@ static void osc_free_grant(struct client_obd *cli, unsigned int nr_pages,
 	spin_lock(&cli->cl_loi_list_lock);
 	atomic_long_sub(nr_pages, &obd_dirty_pages);
 	cli->cl_dirty_pages -= nr_pages;
+	/* give back the credits once everything dirty is written, so that
+	 * an idle client does not keep dirty page and grant budget */
+	osc_cache_credits_sync(cli, cli->cl_dirty_pages ==
+				    osc_cache_credits_pages(cli));
 	cli->cl_lost_grant += lost_grant;
 	cli->cl_dirty_grant -= dirty_grant;
 	if (cli->cl_avail_grant < grant && cli->cl_lost_grant >= grant) {
@@ -1575,6 +1580,180 @@ out:
 	return rc;
 }
 
+/* dirty pages and chunks of grant moved into a per-CPT credit at once */
+#define OSC_CREDIT_PAGES	32
+#define OSC_CREDIT_CHUNKS	8
+
+/* caller must hold loi_list_lock and ccr_lock */
+static void osc_credit_refill(struct client_obd *cli,
+			      struct client_cache_credit *ccr,
+			      unsigned int bytes)
+{
+	unsigned long grant;
+
+	if (ccr->ccr_dirty_pages == 0 &&
+	    cli->cl_dirty_pages + OSC_CREDIT_PAGES <= cli->cl_dirty_max_pages) {
+		if (atomic_long_add_return(OSC_CREDIT_PAGES,
+					   &obd_dirty_pages) <=
+		    obd_max_dirty_pages) {
+			cli->cl_dirty_pages += OSC_CREDIT_PAGES;
+			ccr->ccr_dirty_pages = OSC_CREDIT_PAGES;
+			osc_update_next_shrink(cli);
+		} else {
+			atomic_long_sub(OSC_CREDIT_PAGES, &obd_dirty_pages);
+		}
+	}
+
+	/* leave at least as much grant to the other CPTs */
+	grant = max_t(unsigned long, bytes, OSC_CREDIT_CHUNKS *
+		      ((1 << cli->cl_chunkbits) + cli->cl_grant_extent_tax));
+	if (ccr->ccr_grant < bytes && cli->cl_avail_grant >= 2 * grant) {
+		cli->cl_avail_grant -= grant;
+		cli->cl_reserved_grant += grant;
+		ccr->ccr_grant += grant;
+	}
+}
+
+/* caller must hold ccr_lock */
+static int osc_credit_get(struct client_cache_credit *ccr,
+			  struct osc_async_page *oap, unsigned int bytes)
+{
+	struct brw_page *pga = &oap->oap_brw_page;
+
+	if (ccr->ccr_dirty_pages == 0 || ccr->ccr_grant < bytes)
+		return 0;
+
+	LASSERT(!(pga->flag & OBD_BRW_FROM_GRANT));
+	ccr->ccr_dirty_pages--;
+	ccr->ccr_grant -= bytes;
+	pga->flag |= OBD_BRW_FROM_GRANT;
+	return 1;
+}
+
+/**
+ * Lockless version of osc_enter_cache_try(): dirty @oap and reserve @bytes
+ * of grant from the credits of the current CPT, which are refilled in
+ * batches from the accounting of @cli. As the credits are counted there
+ * already, the page and grant are freed by the usual functions.
+ *
+ * Only used when the server tracks grant by extents (GRANT_PARAM), so that
+ * the grant reserved by the credits is reported correctly.
+ */
+static int osc_enter_cache_fast(struct client_obd *cli,
+				struct osc_async_page *oap, unsigned int bytes)
+{
+	struct client_cache_credit *ccr;
+	int rc;
+
+	if (cli->cl_cache_credits == NULL ||
+	    !list_empty(&cli->cl_cache_waiters) ||
+	    cli->cl_dirty_max_pages == 0 || cli->cl_ar.ar_force_sync ||
+	    oap->oap_obj->oo_oinfo->loi_ar.ar_force_sync ||
+	    !OCD_HAS_FLAG(&cli->cl_import->imp_connect_data, GRANT_PARAM) ||
+	    OBD_FAIL_PRECHECK(OBD_FAIL_OSC_NO_GRANT))
+		return 0;
+
+	ccr = cli->cl_cache_credits[cfs_cpt_current(cfs_cpt_table, 0)];
+	spin_lock(&ccr->ccr_lock);
+	rc = osc_credit_get(ccr, oap, bytes);
+	spin_unlock(&ccr->ccr_lock);
+	if (rc)
+		return rc;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	if (list_empty(&cli->cl_cache_waiters)) {
+		spin_lock(&ccr->ccr_lock);
+		osc_credit_refill(cli, ccr, bytes);
+		rc = osc_credit_get(ccr, oap, bytes);
+		spin_unlock(&ccr->ccr_lock);
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return rc;
+}
+
+/**
+ * Lockless version of osc_unreserve_grant() for the grant reserved by
+ * osc_enter_cache_fast().
+ */
+static void osc_unreserve_grant_fast(struct client_obd *cli,
+				     unsigned int reserved,
+				     unsigned int unused)
+{
+	struct client_cache_credit *ccr;
+
+	if (unused > reserved) {
+		osc_unreserve_grant(cli, reserved, unused);
+		return;
+	}
+
+	ccr = cli->cl_cache_credits[cfs_cpt_current(cfs_cpt_table, 0)];
+	spin_lock(&ccr->ccr_lock);
+	ccr->ccr_grant += unused;
+	ccr->ccr_dirty_grant += reserved - unused;
+	spin_unlock(&ccr->ccr_lock);
+}
+
+/**
+ * Return the dirty pages of the per-CPT credits not used by any page yet.
+ * They are counted in cl_dirty_pages, but are not dirty.
+ *
+ * caller must hold loi_list_lock
+ */
+unsigned long osc_cache_credits_pages(struct client_obd *cli)
+{
+	struct client_cache_credit *ccr;
+	unsigned long pages = 0;
+	int i;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+	if (cli->cl_cache_credits == NULL)
+		return 0;
+
+	cfs_percpt_for_each(ccr, i, cli->cl_cache_credits) {
+		spin_lock(&ccr->ccr_lock);
+		pages += ccr->ccr_dirty_pages;
+		spin_unlock(&ccr->ccr_lock);
+	}
+
+	return pages;
+}
+EXPORT_SYMBOL(osc_cache_credits_pages);
+
+/**
+ * Move the grant used by the pages dirtied from the per-CPT credits into
+ * cl_dirty_grant, and give back the unused credits if @drain is set.
+ *
+ * caller must hold loi_list_lock
+ */
+void osc_cache_credits_sync(struct client_obd *cli, bool drain)
+{
+	struct client_cache_credit *ccr;
+	int i;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+	if (cli->cl_cache_credits == NULL)
+		return;
+
+	cfs_percpt_for_each(ccr, i, cli->cl_cache_credits) {
+		spin_lock(&ccr->ccr_lock);
+		cli->cl_reserved_grant -= ccr->ccr_dirty_grant;
+		cli->cl_dirty_grant += ccr->ccr_dirty_grant;
+		ccr->ccr_dirty_grant = 0;
+		if (drain) {
+			atomic_long_sub(ccr->ccr_dirty_pages,
+					&obd_dirty_pages);
+			cli->cl_dirty_pages -= ccr->ccr_dirty_pages;
+			ccr->ccr_dirty_pages = 0;
+			cli->cl_reserved_grant -= ccr->ccr_grant;
+			cli->cl_avail_grant += ccr->ccr_grant;
+			ccr->ccr_grant = 0;
+		}
+		spin_unlock(&ccr->ccr_lock);
+	}
+}
+EXPORT_SYMBOL(osc_cache_credits_sync);
+
 static int ocw_granted(struct client_obd *cli, struct osc_cache_waiter *ocw)
 {
 	int rc;
@@ -1606,6 +1785,11 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 
 	OSC_DUMP_GRANT(D_CACHE, cli, "need:%d\n", bytes);
 
+	if (osc_enter_cache_fast(cli, oap, bytes)) {
+		OSC_DUMP_GRANT(D_CACHE, cli, "granted from CPT credit\n");
+		RETURN(0);
+	}
+
 	spin_lock(&cli->cl_loi_list_lock);
 
 	/* force the caller to try sync io.  this can jump the list
@@ -1624,6 +1808,15 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 		GOTO(out, rc = 0);
 	}
 
+	/* the credits of other CPTs may be what is missing, get them back
+	 * only now rather than on every miss of osc_enter_cache_fast() */
+	osc_cache_credits_sync(cli, true);
+	if (list_empty(&cli->cl_cache_waiters) &&
+	    osc_enter_cache_try(cli, oap, bytes, 0)) {
+		OSC_DUMP_GRANT(D_CACHE, cli, "granted from CPT credits\n");
+		GOTO(out, rc = 0);
+	}
+
 	/* We can get here for two reasons: too many dirty pages in cache, or
 	 * run out of grants. In both cases we should write dirty pages out.
 	 * Adding a cache waiter will trigger urgent write-out no matter what
@@ -1702,6 +1895,9 @@ void osc_wake_cache_waiters(struct client_obd *cli)
 	struct osc_cache_waiter *ocw;
 
 	ENTRY;
+	if (!list_empty(&cli->cl_cache_waiters))
+		osc_cache_credits_sync(cli, true);
+
 	list_for_each_safe(l, tmp, &cli->cl_cache_waiters) {
 		ocw = list_entry(l, struct osc_cache_waiter, ocw_entry);
 
@@ -2017,38 +2213,32 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 6. Above steps exit if there is no space in this RPC.
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct extent_rpc_data *data)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	struct extent_rpc_data data = {
-		.erd_rpc_list	= rpclist,
-		.erd_page_count	= 0,
-		.erd_max_pages	= cli->cl_max_pages_per_rpc,
-		.erd_max_chunks	= osc_max_write_chunks(cli),
-		.erd_max_extents = 256,
-	};
+	unsigned int page_count = data->erd_page_count;
 
 	LASSERT(osc_object_is_locked(obj));
 	while (!list_empty(&obj->oo_hp_exts)) {
 		ext = list_entry(obj->oo_hp_exts.next, struct osc_extent,
 				 oe_link);
 		LASSERT(ext->oe_state == OES_CACHE);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
-		EASSERT(ext->oe_nr_pages <= data.erd_max_pages, ext);
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			goto out;
+		EASSERT(ext->oe_nr_pages <= data->erd_max_pages, ext);
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		goto out;
 
 	while (!list_empty(&obj->oo_urgent_exts)) {
 		ext = list_entry(obj->oo_urgent_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			goto out;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		goto out;
 
 	/* One key difference between full extents and other extents: full
 	 * extents can usually only be added if the rpclist was empty, so if we
@@ -2058,11 +2248,11 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	while (!list_empty(&obj->oo_full_exts)) {
 		ext = list_entry(obj->oo_full_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
+		if (!try_to_add_extent_for_io(cli, ext, data))
 			break;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		goto out;
 
 	ext = first_extent(obj);
 	while (ext != NULL) {
@@ -2073,12 +2263,210 @@ static unsigned int get_write_extents(struct osc_object *obj,
 			continue;
 		}
 
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			goto out;
 
 		ext = next_extent(ext);
 	}
-	return data.erd_page_count;
+out:
+	/* only count the pages of this object, @data may have others */
+	return data->erd_page_count - page_count;
+}
+
+#define list_to_obj(list, item) ({					      \
+	struct list_head *__tmp = (list)->next;				      \
+	list_del_init(__tmp);					      \
+	list_entry(__tmp, struct osc_object, oo_##item);		      \
+})
+
+/*
+ * Take the next object with pages ready to be written from the ready list,
+ * with a reference. Objects with blocked locks are not taken, they are sent
+ * by their own RPCs.
+ */
+static struct osc_object *osc_next_write_obj(struct client_obd *cli)
+{
+	struct osc_object *osc = NULL;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	if (!list_empty(&cli->cl_loi_ready_list)) {
+		osc = list_to_obj(&cli->cl_loi_ready_list, ready_item);
+		cl_object_get(osc2cl(osc));
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return osc;
+}
+
+static bool osc_rpc_has_obj(struct list_head *rpclist, struct osc_object *osc)
+{
+	struct osc_extent *ext;
+
+	list_for_each_entry(ext, rpclist, oe_link) {
+		if (ext->oe_obj == osc)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Add the cached writes of other objects into the write RPC being built in
+ * @data, when the server supports OBD_CONNECT2_MULTIOBJ_BRW. This saves RPCs
+ * when many small files are written: each object then only needs a niobuf
+ * and an obdo, instead of a whole RPC.
+ *
+ * Only the writes with grants and without server side locking are batched,
+ * and the extents are grouped by object in the RPC.
+ *
+ * \retval the number of objects in the RPC
+ */
+static int osc_add_write_objs(const struct lu_env *env, struct client_obd *cli,
+			      struct extent_rpc_data *data)
+{
+	struct osc_extent *first;
+	struct osc_extent *ext;
+	struct osc_object *osc;
+	unsigned int page_count;
+	int nr_objs = 1;
+	int tries;
+	ENTRY;
+
+	first = list_first_entry(data->erd_rpc_list, struct osc_extent,
+				 oe_link);
+	if (cli->cl_import == NULL ||
+	    !imp_connect_multiobj_brw(cli->cl_import) ||
+	    first->oe_srvlock || first->oe_grants == 0)
+		RETURN(nr_objs);
+
+	for (tries = cli->cl_max_objs_per_rpc; tries > 0; tries--) {
+		if (nr_objs >= cli->cl_max_objs_per_rpc ||
+		    data->erd_page_count >= data->erd_max_pages ||
+		    data->erd_max_extents == 0)
+			break;
+
+		osc = osc_next_write_obj(cli);
+		if (osc == NULL)
+			break;
+
+		/* the ready list was walked through */
+		if (osc_rpc_has_obj(data->erd_rpc_list, osc)) {
+			osc_list_maint(cli, osc);
+			cl_object_put(env, osc2cl(osc));
+			break;
+		}
+
+		page_count = 0;
+		osc_object_lock(osc);
+		if (list_empty(&osc->oo_hp_exts) &&
+		    osc_makes_rpc(cli, osc, OBD_BRW_WRITE))
+			page_count = get_write_extents(osc, data);
+		if (page_count > 0) {
+			osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
+			list_for_each_entry_reverse(ext, data->erd_rpc_list,
+						    oe_link) {
+				if (ext->oe_obj != osc)
+					break;
+				LASSERT(ext->oe_state == OES_CACHE ||
+					ext->oe_state == OES_LOCK_DONE);
+				if (ext->oe_state == OES_CACHE)
+					osc_extent_state_set(ext, OES_LOCKING);
+				else
+					osc_extent_state_set(ext, OES_RPC);
+			}
+			nr_objs++;
+		}
+		osc_object_unlock(osc);
+
+		osc_list_maint(cli, osc);
+		cl_object_put(env, osc2cl(osc));
+	}
+
+	CDEBUG(D_CACHE, "%s: %d objects, %u pages in write RPC\n",
+	       cli_name(cli), nr_objs, data->erd_page_count);
+	RETURN(nr_objs);
+}
+
+/*
+ * Move the extents of the first object of @rpclist to @seg, and tell if
+ * the first page of this object starts, or its last page ends, in the
+ * middle of a page.
+ */
+static void osc_rpc_obj_cut(struct list_head *rpclist, struct list_head *seg,
+			    bool *head, bool *tail)
+{
+	struct osc_async_page *oap;
+	struct osc_async_page *first = NULL;
+	struct osc_async_page *last = NULL;
+	struct osc_extent *ext;
+	struct osc_extent *tmp;
+	struct osc_object *osc;
+
+	osc = list_first_entry(rpclist, struct osc_extent, oe_link)->oe_obj;
+	list_for_each_entry_safe(ext, tmp, rpclist, oe_link) {
+		if (ext->oe_obj != osc)
+			break;
+
+		list_move_tail(&ext->oe_link, seg);
+		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
+			if (first == NULL || oap->oap_obj_off < first->oap_obj_off)
+				first = oap;
+			if (last == NULL || oap->oap_obj_off > last->oap_obj_off)
+				last = oap;
+		}
+	}
+	*head = first->oap_page_off != 0;
+	*tail = last->oap_page_off + last->oap_count != PAGE_SIZE;
+}
+
+/**
+ * Build the write RPCs of @rpclist which has extents of several objects.
+ *
+ * Only the first page of a bulk may start, and only its last page may end,
+ * in the middle of a page. The objects are ordered so that the one with a
+ * partial last page, usually the end of a small file, comes last, and the
+ * list is split into several RPCs where a gap would still be in the bulk.
+ */
+static int osc_build_write_rpcs(const struct lu_env *env,
+				struct client_obd *cli,
+				struct list_head *rpclist)
+{
+	/* objects with partial head, full ones, partial tail, both */
+	static const int order[] = { 1, 0, 2, 3 };
+	struct list_head objs[4];
+	struct list_head seg = LIST_HEAD_INIT(seg);
+	struct list_head cur = LIST_HEAD_INIT(cur);
+	bool head, tail, prev_tail = false;
+	int i, rc2, rc = 0;
+	ENTRY;
+
+	for (i = 0; i < ARRAY_SIZE(objs); i++)
+		INIT_LIST_HEAD(&objs[i]);
+
+	while (!list_empty(rpclist)) {
+		osc_rpc_obj_cut(rpclist, &seg, &head, &tail);
+		list_splice_tail_init(&seg, &objs[head | tail << 1]);
+	}
+	for (i = 0; i < ARRAY_SIZE(order); i++)
+		list_splice_tail_init(&objs[order[i]], rpclist);
+
+	while (!list_empty(rpclist)) {
+		osc_rpc_obj_cut(rpclist, &seg, &head, &tail);
+		if (!list_empty(&cur) && (prev_tail || head)) {
+			rc2 = osc_build_rpc(env, cli, &cur, OBD_BRW_WRITE);
+			LASSERT(list_empty(&cur));
+			if (rc == 0)
+				rc = rc2;
+		}
+		list_splice_tail_init(&seg, &cur);
+		prev_tail = tail;
+	}
+	if (!list_empty(&cur)) {
+		rc2 = osc_build_rpc(env, cli, &cur, OBD_BRW_WRITE);
+		LASSERT(list_empty(&cur));
+		if (rc == 0)
+			rc = rc2;
+	}
+	RETURN(rc);
 }
 
 static int
@@ -2090,14 +2478,24 @@ __must_hold(osc)
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
+	struct extent_rpc_data data = {
+		.erd_rpc_list	= &rpclist,
+		.erd_page_count	= 0,
+		.erd_max_pages	= cli->cl_max_pages_per_rpc,
+		.erd_max_chunks	= osc_max_write_chunks(cli),
+		.erd_max_extents = 256,
+	};
 	unsigned int page_count = 0;
 	int srvlock = 0;
+	int nr_objs = 1;
+	bool hp;
 	int rc = 0;
 	ENTRY;
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	hp = !list_empty(&osc->oo_hp_exts);
+	page_count = get_write_extents(osc, &data);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
@@ -2118,6 +2516,10 @@ __must_hold(osc)
 	 * lock order is page lock -> object lock. */
 	osc_object_unlock(osc);
 
+	/* HP extents are sent alone to cancel the blocked lock quickly */
+	if (!hp)
+		nr_objs = osc_add_write_objs(env, cli, &data);
+
 	list_for_each_entry_safe(ext, tmp, &rpclist, oe_link) {
 		if (ext->oe_state == OES_LOCKING) {
 			rc = osc_extent_make_ready(env, ext);
@@ -2137,7 +2539,10 @@ __must_hold(osc)
 
 	if (!list_empty(&rpclist)) {
 		LASSERT(page_count > 0);
-		rc = osc_build_rpc(env, cli, &rpclist, OBD_BRW_WRITE);
+		if (nr_objs > 1)
+			rc = osc_build_write_rpcs(env, cli, &rpclist);
+		else
+			rc = osc_build_rpc(env, cli, &rpclist, OBD_BRW_WRITE);
 		LASSERT(list_empty(&rpclist));
 	}
 
@@ -2196,12 +2601,6 @@ __must_hold(osc)
 	RETURN(rc);
 }
 
-#define list_to_obj(list, item) ({					      \
-	struct list_head *__tmp = (list)->next;				      \
-	list_del_init(__tmp);					      \
-	list_entry(__tmp, struct osc_object, oo_##item);		      \
-})
-
 /* This is called by osc_check_rpcs() to find which objects have pages that
  * we could be sending.  These lists are maintained by osc_makes_rpc(). */
 static struct osc_object *osc_next_obj(struct client_obd *cli)
@@ -2370,6 +2769,7 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 	u32    brw_flags = OBD_BRW_ASYNC;
 	int    cmd = OBD_BRW_WRITE;
 	int    need_release = 0;
+	bool   fast = false;
 	int    rc = 0;
 	ENTRY;
 
@@ -2439,9 +2839,15 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 		if (ext->oe_end >= index)
 			grants = 0;
 
-		/* it doesn't need any grant to dirty this page */
-		spin_lock(&cli->cl_loi_list_lock);
-		rc = osc_enter_cache_try(cli, oap, grants, 0);
+		/* it doesn't need any grant to dirty this page, and mostly
+		 * the CPT credits are enough without cl_loi_list_lock */
+		fast = osc_enter_cache_fast(cli, oap, grants);
+		if (fast) {
+			rc = 1;
+		} else {
+			spin_lock(&cli->cl_loi_list_lock);
+			rc = osc_enter_cache_try(cli, oap, grants, 0);
+		}
 		if (rc == 0) { /* try failed */
 			grants = 0;
 			need_release = 1;
@@ -2455,11 +2861,17 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 			} else {
 				OSC_EXTENT_DUMP(D_CACHE, ext,
 						"expanded for %lu.\n", index);
-				osc_unreserve_grant_nolock(cli, grants, tmp);
+				if (fast)
+					osc_unreserve_grant_fast(cli, grants,
+								 tmp);
+				else
+					osc_unreserve_grant_nolock(cli, grants,
+								   tmp);
 				grants = 0;
 			}
 		}
-		spin_unlock(&cli->cl_loi_list_lock);
+		if (!fast)
+			spin_unlock(&cli->cl_loi_list_lock);
 		rc = 0;
 	} else if (ext != NULL) {
 		/* index is located outside of active extent */
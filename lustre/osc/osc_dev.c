@@ -225,6 +225,8 @@ static struct lu_device *osc_device_alloc(const struct lu_env *env,
                 RETURN(ERR_PTR(rc));
         }
         od->od_exp = obd->obd_self_export;
+	od->od_contention_time = OSC_DEFAULT_CONTENTION_SECONDS;
+	od->od_max_nolock_bytes = OSC_DEFAULT_MAX_NOLOCK_BYTES;
         RETURN(d);
 }
 
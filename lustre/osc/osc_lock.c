@@ -789,10 +789,23 @@ static void osc_lock_build_einfo(const struct lu_env *env,
  * - if the io lock request type ci_lockreq;
  * - send the enqueue rpc to ost to make the further decision;
  * - special treat to truncate lockless lock
- *
- *  Additional policy can be implemented here, e.g., never do lockless-io
- *  for large extents.
+ * - lockless io on contended objects only for extents up to
+ *   osc_device::od_max_nolock_bytes, larger ones are enqueued and let the
+ *   server decide, as the lock is worth caching for them.
  */
+static bool osc_lock_nolock_size(struct osc_lock *ols,
+				 const struct osc_device *osd)
+{
+	struct cl_lock_descr *descr = &ols->ols_cl.cls_lock->cll_descr;
+	struct cl_object *obj = ols->ols_cl.cls_obj;
+
+	if (descr->cld_end == CL_PAGE_EOF)
+		return false;
+
+	return cl_offset(obj, descr->cld_end - descr->cld_start + 1) <=
+	       osd->od_max_nolock_bytes;
+}
+
 void osc_lock_to_lockless(const struct lu_env *env,
 			  struct osc_lock *ols, int force)
 {
@@ -822,7 +835,8 @@ void osc_lock_to_lockless(const struct lu_env *env,
 					 OBD_CONNECT_SRVLOCK);
 		if (io->ci_lockreq == CILR_NEVER ||
 		    /* lockless IO */
-		    (ols->ols_locklessable && osc_object_is_contended(oob)) ||
+		    (ols->ols_locklessable && osc_lock_nolock_size(ols, osd) &&
+		     osc_object_is_contended(oob)) ||
 		    /* lockless truncate */
 		    (cl_io_is_trunc(io) && osd->od_lockless_truncate &&
 		     (ocd->ocd_connect_flags & OBD_CONNECT_TRUNCLOCK))) {
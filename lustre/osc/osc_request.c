@@ -595,6 +595,8 @@ static int osc_destroy(const struct lu_env *env, struct obd_export *exp,
                 RETURN(-ENOMEM);
         }
 
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_IDS, RCL_CLIENT, 0);
+	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER, 0);
         rc = ldlm_prep_elc_req(exp, req, LUSTRE_OST_VERSION, OST_DESTROY,
                                0, &cancels, count);
         if (rc) {
@@ -641,6 +643,7 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
 
 	oa->o_valid |= bits;
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_cache_credits_sync(cli, false);
 	if (OCD_HAS_FLAG(&cli->cl_import->imp_connect_data, GRANT_PARAM))
 		oa->o_dirty = cli->cl_dirty_grant;
 	else
@@ -964,6 +967,7 @@ void osc_init_grant(struct client_obd *cli, struct obd_connect_data *ocd)
 	 * left EVICTED state, then cl_dirty_pages must be 0 already.
 	 */
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_cache_credits_sync(cli, true);
 	cli->cl_avail_grant = ocd->ocd_grant;
 	if (cli->cl_import->imp_state != LUSTRE_IMP_EVICTED) {
 		cli->cl_avail_grant -= cli->cl_reserved_grant;
@@ -1109,6 +1113,25 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
 }
 
 #if IS_ENABLED(CONFIG_CRC_T10DIF)
+struct osc_dif_pages {
+	struct brw_page	**odp_pga;
+	/* bytes used in the last page, which can be short for reads */
+	unsigned int	  odp_last_count;
+	int		  odp_count;
+};
+
+static void osc_dif_page(void *data, int index, struct page **page,
+			 __u32 *offset, __u32 *length)
+{
+	struct osc_dif_pages *odp = data;
+	struct brw_page *pg = odp->odp_pga[index];
+
+	*page = pg->pg;
+	*offset = pg->off & ~PAGE_MASK;
+	*length = index == odp->odp_count - 1 ? odp->odp_last_count :
+						pg->count;
+}
+
 static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 				   size_t pg_count, struct brw_page **pga,
 				   int opc, obd_dif_csum_fn *fn,
@@ -1118,83 +1141,51 @@ static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 	struct ahash_request *req;
 	/* Used Adler as the default checksum type on top of DIF tags */
 	unsigned char cfs_alg = cksum_obd2cfs(OBD_CKSUM_T10_TOP);
-	struct page *__page;
-	unsigned char *buffer;
-	__u16 *guard_start;
+	struct osc_dif_pages odp = { .odp_pga = pga };
 	unsigned int bufsize;
-	int guard_number;
-	int used_number = 0;
-	int used;
 	u32 cksum;
 	int rc = 0;
-	int i = 0;
 
 	LASSERT(pg_count > 0);
 
-	__page = alloc_page(GFP_KERNEL);
-	if (__page == NULL)
-		return -ENOMEM;
+	while (nob > 0 && odp.odp_count < pg_count) {
+		struct brw_page *pg = pga[odp.odp_count];
+
+		odp.odp_last_count = pg->count > nob ? nob : pg->count;
+		nob -= pg->count;
+		odp.odp_count++;
+	}
 
 	req = cfs_crypto_hash_init(cfs_alg, NULL, 0);
 	if (IS_ERR(req)) {
 		rc = PTR_ERR(req);
 		CERROR("%s: unable to initialize checksum hash %s: rc = %d\n",
 		       obd_name, cfs_crypto_hash_name(cfs_alg), rc);
-		GOTO(out, rc);
+		return rc;
 	}
 
-	buffer = kmap(__page);
-	guard_start = (__u16 *)buffer;
-	guard_number = PAGE_SIZE / sizeof(*guard_start);
-	while (nob > 0 && pg_count > 0) {
-		unsigned int count = pga[i]->count > nob ? nob : pga[i]->count;
-
-		/* corrupt the data before we compute the checksum, to
-		 * simulate an OST->client data error */
-		if (unlikely(i == 0 && opc == OST_READ &&
-			     OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_RECEIVE))) {
-			unsigned char *ptr = kmap(pga[i]->pg);
-			int off = pga[i]->off & ~PAGE_MASK;
-
-			memcpy(ptr + off, "bad1", min_t(typeof(nob), 4, nob));
-			kunmap(pga[i]->pg);
-		}
-
-		/*
-		 * The left guard number should be able to hold checksums of a
-		 * whole page
-		 */
-		rc = obd_page_dif_generate_buffer(obd_name, pga[i]->pg,
-						  pga[i]->off & ~PAGE_MASK,
-						  count,
-						  guard_start + used_number,
-						  guard_number - used_number,
-						  &used, sector_size,
-						  fn);
-		if (rc)
-			break;
-
-		used_number += used;
-		if (used_number == guard_number) {
-			cfs_crypto_hash_update_page(req, __page, 0,
-				used_number * sizeof(*guard_start));
-			used_number = 0;
-		}
+	/* corrupt the data before we compute the checksum, to
+	 * simulate an OST->client data error */
+	if (unlikely(odp.odp_count > 0 && opc == OST_READ &&
+		     OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_RECEIVE))) {
+		unsigned char *ptr = kmap(pga[0]->pg);
+		int off = pga[0]->off & ~PAGE_MASK;
 
-		nob -= pga[i]->count;
-		pg_count--;
-		i++;
+		memcpy(ptr + off, "bad1", min_t(unsigned int, 4,
+						odp.odp_count > 1 ?
+						pga[0]->count :
+						odp.odp_last_count));
+		kunmap(pga[0]->pg);
 	}
-	kunmap(__page);
-	if (rc)
-		GOTO(out, rc);
 
-	if (used_number != 0)
-		cfs_crypto_hash_update_page(req, __page, 0,
-			used_number * sizeof(*guard_start));
+	/* large RPCs have their guards generated by the obd_dif threads */
+	rc = obd_dif_generate_pages(obd_name, req, odp.odp_count,
+				    osc_dif_page, &odp, sector_size, fn);
 
 	bufsize = sizeof(cksum);
 	cfs_crypto_hash_final(req, (unsigned char *)&cksum, &bufsize);
+	if (rc)
+		return rc;
 
 	/* For sending we only compute the wrong checksum instead
 	 * of corrupting the data so it is still correct on a redo */
@@ -1202,9 +1193,8 @@ static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 		cksum++;
 
 	*check_sum = cksum;
-out:
-	__free_page(__page);
-	return rc;
+
+	return 0;
 }
 #else /* !CONFIG_CRC_T10DIF */
 #define obd_dif_ip_fn NULL
@@ -1290,8 +1280,18 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 	RETURN(rc);
 }
 
+static inline bool osc_brw_same_obj(struct brw_page *p1, struct brw_page *p2)
+{
+	return brw_page2oap(p1)->oap_obj == brw_page2oap(p2)->oap_obj;
+}
+
+/*
+ * Pages of a multi-object write are grouped by object, @oa describes the
+ * object of the first group and @oas the @obj_count - 1 other ones.
+ */
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
+		     struct obdo *oas, u32 obj_count,
 		     u32 page_count, struct brw_page **pga,
 		     struct ptlrpc_request **reqp, int resend)
 {
@@ -1300,7 +1300,8 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct ost_body         *body;
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
-	int niocount, i, requested_nob, opc, rc, short_io_size = 0;
+	struct obdo		*wire_oas = NULL;
+	int niocount, i, j, requested_nob, opc, rc, short_io_size = 0;
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
@@ -1325,16 +1326,21 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         if (req == NULL)
                 RETURN(-ENOMEM);
 
-        for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
-                        niocount++;
-        }
+	LASSERT(obj_count == 1 || opc == OST_WRITE);
+	for (niocount = i = 1; i < page_count; i++) {
+		if (!can_merge_pages(pga[i - 1], pga[i]) ||
+		    (obj_count > 1 && !osc_brw_same_obj(pga[i - 1], pga[i])))
+			niocount++;
+	}
 
-        pill = &req->rq_pill;
-        req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
-        req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
-                             niocount * sizeof(*niobuf));
+	pill = &req->rq_pill;
+	req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
+			     obj_count * sizeof(*ioobj));
+	req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
+			     niocount * sizeof(*niobuf));
+	if (opc == OST_WRITE)
+		req_capsule_set_size(pill, &RMF_OBDO, RCL_CLIENT,
+				     (obj_count - 1) * sizeof(*oas));
 
 	for (i = 0; i < page_count; i++)
 		short_io_size += pga[i]->count;
@@ -1397,7 +1403,20 @@ no_bulk:
 	body->oa.o_gid = oa->o_gid;
 
 	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
+	ioobj->ioo_bufcnt = 0;
+
+	if (obj_count > 1) {
+		wire_oas = req_capsule_client_get(pill, &RMF_OBDO);
+		LASSERT(wire_oas != NULL);
+		for (j = 1; j < obj_count; j++) {
+			lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+					     &wire_oas[j - 1], &oas[j - 1]);
+			wire_oas[j - 1].o_uid = oas[j - 1].o_uid;
+			wire_oas[j - 1].o_gid = oas[j - 1].o_gid;
+			obdo_to_ioobj(&oas[j - 1], &ioobj[j]);
+			ioobj[j].ioo_bufcnt = 0;
+		}
+	}
 	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
 	 * that might be send for this request.  The actual number is decided
 	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
@@ -1425,9 +1444,11 @@ no_bulk:
 
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
-        for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
-                struct brw_page *pg = pga[i];
+	for (requested_nob = i = j = 0; i < page_count; i++, niobuf++) {
+		struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
+		bool new_obj = i > 0 && obj_count > 1 &&
+			       !osc_brw_same_obj(pg_prev, pg);
 
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
@@ -1438,7 +1459,9 @@ no_bulk:
 			  ergo(i == page_count - 1, poff == 0)),
 			 "i: %d/%d pg: %p off: %llu, count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+		if (new_obj)
+			j++;
+		LASSERTF(i == 0 || new_obj || pg->off > pg_prev->off,
 			 "i %d p_c %u pg %p [pri %lu ind %lu] off %llu"
 			 " prev_pg %p [pri %lu ind %lu] off %llu\n",
                          i, page_count,
@@ -1461,16 +1484,18 @@ no_bulk:
 		}
 		requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
-                        niobuf--;
+		if (i > 0 && !new_obj && can_merge_pages(pg_prev, pg)) {
+			niobuf--;
 			niobuf->rnb_len += pg->count;
 		} else {
 			niobuf->rnb_offset = pg->off;
 			niobuf->rnb_len    = pg->count;
 			niobuf->rnb_flags  = pg->flag;
-                }
-                pg_prev = pg;
-        }
+			ioobj[j].ioo_bufcnt++;
+		}
+		pg_prev = pg;
+	}
+	LASSERT(j == obj_count - 1);
 
         LASSERTF((void *)(niobuf - niocount) ==
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
@@ -1484,6 +1509,15 @@ no_bulk:
                         body->oa.o_flags = 0;
                 }
                 body->oa.o_flags |= OBD_FL_RECOV_RESEND;
+
+		/* grant of every object was accounted on the first send */
+		for (j = 1; j < obj_count; j++) {
+			if ((wire_oas[j - 1].o_valid & OBD_MD_FLFLAGS) == 0) {
+				wire_oas[j - 1].o_valid |= OBD_MD_FLFLAGS;
+				wire_oas[j - 1].o_flags = 0;
+			}
+			wire_oas[j - 1].o_flags |= OBD_FL_RECOV_RESEND;
+		}
         }
 
         if (osc_should_shrink_grant(cli))
@@ -1548,6 +1582,8 @@ no_bulk:
 
 	aa = ptlrpc_req_async_args(aa, req);
 	aa->aa_oa = oa;
+	aa->aa_oas = oas;
+	aa->aa_obj_count = obj_count;
 	aa->aa_requested_nob = requested_nob;
 	aa->aa_nio_count = niocount;
 	aa->aa_page_count = page_count;
@@ -1718,6 +1754,25 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 	return 1;
 }
 
+/*
+ * The obdos of the objects but the first one of a multi-object write, which
+ * carry their attributes and over-quota flags, or NULL if the reply has none.
+ */
+static struct obdo *osc_brw_rep_oas(struct ptlrpc_request *req,
+				    struct osc_brw_async_args *aa)
+{
+	struct req_capsule *pill = &req->rq_pill;
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) != OST_WRITE ||
+	    aa->aa_obj_count < 2 ||
+	    !req_capsule_field_present(pill, &RMF_OBDO, RCL_SERVER) ||
+	    req_capsule_get_size(pill, &RMF_OBDO, RCL_SERVER) !=
+	    (aa->aa_obj_count - 1) * sizeof(struct obdo))
+		return NULL;
+
+	return req_capsule_server_get(pill, &RMF_OBDO);
+}
+
 /* Note rc enters this function as number of bytes transferred */
 static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 {
@@ -1727,7 +1782,9 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 	const struct lnet_process_id *peer =
 		&req->rq_import->imp_connection->c_peer;
 	struct ost_body *body;
+	struct obdo *repoas;
 	u32 client_cksum = 0;
+	u32 j;
 
 	ENTRY;
 
@@ -1757,6 +1814,18 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 				       body->oa.o_flags);
 	}
 
+	repoas = osc_brw_rep_oas(req, aa);
+	for (j = 0; repoas != NULL && j < aa->aa_obj_count - 1; j++) {
+		if (repoas[j].o_valid & OBD_MD_FLALLQUOTA) {
+			unsigned qid[LL_MAXQUOTAS] = {
+					repoas[j].o_uid, repoas[j].o_gid,
+					repoas[j].o_projid };
+
+			osc_quota_setdq(cli, req->rq_xid, qid,
+					repoas[j].o_valid, repoas[j].o_flags);
+		}
+	}
+
 	osc_update_grant(cli, body);
 
 	if (rc < 0)
@@ -1916,9 +1985,19 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 		rc = 0;
 	}
 out:
-	if (rc >= 0)
+	if (rc >= 0) {
 		lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
 				     aa->aa_oa, &body->oa);
+		/* without them, the other objects' attributes are kept */
+		for (j = 0; j < aa->aa_obj_count - 1; j++) {
+			if (repoas != NULL)
+				lustre_get_wire_obdo(
+					&req->rq_import->imp_connect_data,
+					&aa->aa_oas[j], &repoas[j]);
+			else
+				aa->aa_oas[j].o_valid = 0;
+		}
+	}
 
 	RETURN(rc);
 }
@@ -1937,7 +2016,8 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
-				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
+				  aa->aa_cli, aa->aa_oa, aa->aa_oas,
+				  aa->aa_obj_count, aa->aa_page_count,
 				  aa->aa_ppga, &new_req, 1);
         if (rc)
                 RETURN(rc);
@@ -2032,6 +2112,57 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/* update attributes of the object of @last, its last page in the RPC */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct osc_async_page *last)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+	unsigned long valid = 0;
+
+	cl_object_attr_lock(obj);
+	if (oa != NULL && oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa != NULL && oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
 static int brw_interpret(const struct lu_env *env,
 			 struct ptlrpc_request *req, void *args, int rc)
 {
@@ -2073,58 +2204,30 @@ static int brw_interpret(const struct lu_env *env,
 	}
 
 	if (rc == 0) {
-		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
 		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
-		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
-		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
+		u32 i, j;
+
+		/* the pages of each object follow those of the previous one */
+		for (i = 0, j = 0; i < aa->aa_page_count; i++) {
+			last = brw_page2oap(aa->aa_ppga[i]);
+			if (i + 1 < aa->aa_page_count &&
+			    osc_brw_same_obj(aa->aa_ppga[i],
+					     aa->aa_ppga[i + 1]))
+				continue;
+
+			osc_brw_update_attr(env, req, j == 0 ? aa->aa_oa :
+					    &aa->aa_oas[j - 1], last);
+			j++;
 		}
-
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
+		LASSERT(j == aa->aa_obj_count);
 	}
 	OBD_SLAB_FREE_PTR(aa->aa_oa, osc_obdo_kmem);
 	aa->aa_oa = NULL;
+	if (aa->aa_oas != NULL) {
+		OBD_FREE_LARGE(aa->aa_oas,
+			       (aa->aa_obj_count - 1) * sizeof(*aa->aa_oas));
+		aa->aa_oas = NULL;
+	}
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0)
 		osc_inc_unstable_pages(req);
@@ -2177,10 +2280,40 @@ static void brw_commit(struct ptlrpc_request *req)
 	}
 }
 
+/*
+ * Set the request attributes of each object of @ext_list, of the first one
+ * into @oa and of the other ones into @oas.
+ */
+static void osc_brw_req_attr_set(const struct lu_env *env,
+				 struct list_head *ext_list,
+				 struct cl_req_attr *crattr, u64 flags,
+				 struct obdo *oa, struct obdo *oas)
+{
+	struct osc_object *obj = NULL;
+	struct osc_extent *ext;
+	struct osc_async_page *oap;
+	int i = 0;
+
+	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj == obj)
+			continue;
+
+		obj = ext->oe_obj;
+		oap = list_first_entry(&ext->oe_pages, struct osc_async_page,
+				       oap_pending_item);
+		crattr->cra_flags = flags;
+		crattr->cra_page = oap2cl_page(oap);
+		crattr->cra_oa = i == 0 ? oa : &oas[i - 1];
+		cl_req_attr_set(env, osc2cl(obj), crattr);
+		i++;
+	}
+}
+
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
- * Extents in the list must be in OES_RPC state.
+ * Extents in the list must be in OES_RPC state. A write RPC may have the
+ * extents of several objects, which must then be grouped by object.
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -2190,8 +2323,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct brw_page			**pga = NULL;
 	struct osc_brw_async_args	*aa = NULL;
 	struct obdo			*oa = NULL;
+	struct obdo			*oas = NULL;
+	struct obdo			*obj_oa = NULL;
 	struct osc_async_page		*oap;
-	struct osc_object		*obj = NULL;
+	struct osc_object		*cur = NULL;
 	struct cl_req_attr		*crattr = NULL;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
@@ -2201,10 +2336,9 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	bool				soft_sync = false;
 	bool				interrupted = false;
 	bool				ndelay = false;
-	int				i;
-	int				grant = 0;
+	int				i, j;
+	u32				obj_count = 0;
 	int				rc;
-	__u32				layout_version = 0;
 	struct list_head		rpc_list = LIST_HEAD_INIT(rpc_list);
 	struct ost_body			*body;
 	ENTRY;
@@ -2214,12 +2348,13 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	list_for_each_entry(ext, ext_list, oe_link) {
 		LASSERT(ext->oe_state == OES_RPC);
 		mem_tight |= ext->oe_memalloc;
-		grant += ext->oe_grants;
 		page_count += ext->oe_nr_pages;
-		layout_version = MAX(layout_version, ext->oe_layout_version);
-		if (obj == NULL)
-			obj = ext->oe_obj;
+		if (ext->oe_obj != cur) {
+			cur = ext->oe_obj;
+			obj_count++;
+		}
 	}
+	LASSERT(obj_count == 1 || cmd == OBD_BRW_WRITE);
 
 	soft_sync = osc_over_unstable_soft_limit(cli);
 	if (mem_tight)
@@ -2233,8 +2368,21 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (oa == NULL)
 		GOTO(out, rc = -ENOMEM);
 
+	if (obj_count > 1) {
+		OBD_ALLOC_LARGE(oas, (obj_count - 1) * sizeof(*oas));
+		if (oas == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
+
 	i = 0;
+	cur = NULL;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj != cur) {
+			/* page offsets are checked per object */
+			cur = ext->oe_obj;
+			starting_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -2269,24 +2417,42 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	crattr = &osc_env_info(env)->oti_req_attr;
 	memset(crattr, 0, sizeof(*crattr));
 	crattr->cra_type = (cmd & OBD_BRW_WRITE) ? CRT_WRITE : CRT_READ;
-	crattr->cra_flags = ~0ULL;
-	crattr->cra_page = oap2cl_page(oap);
-	crattr->cra_oa = oa;
-	cl_req_attr_set(env, osc2cl(obj), crattr);
+	osc_brw_req_attr_set(env, ext_list, crattr, ~0ULL, oa, oas);
 
 	if (cmd == OBD_BRW_WRITE) {
-		oa->o_grant_used = grant;
-		if (layout_version > 0) {
-			CDEBUG(D_LAYOUT, DFID": write with layout version %u\n",
-			       PFID(&oa->o_oi.oi_fid), layout_version);
-
-			oa->o_layout_version = layout_version;
-			oa->o_valid |= OBD_MD_LAYOUT_VERSION;
+		/* grant and layout version are accounted per object */
+		i = -1;
+		cur = NULL;
+		list_for_each_entry(ext, ext_list, oe_link) {
+			if (ext->oe_obj != cur) {
+				cur = ext->oe_obj;
+				obj_oa = ++i == 0 ? oa : &oas[i - 1];
+				obj_oa->o_grant_used = 0;
+				obj_oa->o_layout_version = 0;
+			}
+			obj_oa->o_grant_used += ext->oe_grants;
+			if (ext->oe_layout_version > obj_oa->o_layout_version) {
+				CDEBUG(D_LAYOUT,
+				       DFID": write with layout version %u\n",
+				       PFID(&obj_oa->o_oi.oi_fid),
+				       ext->oe_layout_version);
+
+				obj_oa->o_layout_version =
+					ext->oe_layout_version;
+				obj_oa->o_valid |= OBD_MD_LAYOUT_VERSION;
+			}
 		}
 	}
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	/* pages of each object are sorted separately */
+	for (i = 0, j = 1; j <= page_count; j++) {
+		if (j < page_count && osc_brw_same_obj(pga[i], pga[j]))
+			continue;
+		sort_brw_pages(pga + i, j - i);
+		i = j;
+	}
+	rc = osc_brw_prep_request(cmd, cli, oa, oas, obj_count, page_count,
+				  pga, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -2311,9 +2477,11 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	 * the OST will not use BRW timestamps.  Sadly, there is no obvious
 	 * way to do this in a single call.  bug 10150 */
 	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
-	crattr->cra_oa = &body->oa;
-	crattr->cra_flags = OBD_MD_FLMTIME | OBD_MD_FLCTIME | OBD_MD_FLATIME;
-	cl_req_attr_set(env, osc2cl(obj), crattr);
+	osc_brw_req_attr_set(env, ext_list, crattr,
+			     OBD_MD_FLMTIME | OBD_MD_FLCTIME | OBD_MD_FLATIME,
+			     &body->oa, obj_count > 1 ?
+			     req_capsule_client_get(&req->rq_pill, &RMF_OBDO) :
+			     NULL);
 	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
 
 	aa = ptlrpc_req_async_args(aa, req);
@@ -2323,7 +2491,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	list_splice_init(ext_list, &aa->aa_exts);
 
 	spin_lock(&cli->cl_loi_list_lock);
-	starting_offset >>= PAGE_SHIFT;
+	starting_offset = pga[0]->off >> PAGE_SHIFT;
 	if (cmd == OBD_BRW_READ) {
 		cli->cl_r_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
@@ -2357,6 +2525,8 @@ out:
 
 		if (oa)
 			OBD_SLAB_FREE_PTR(oa, osc_obdo_kmem);
+		if (oas)
+			OBD_FREE_LARGE(oas, (obj_count - 1) * sizeof(*oas));
 		if (pga)
 			OBD_FREE(pga, sizeof(*pga) * page_count);
 		/* this should happen rarely and is pretty bad, it makes the
@@ -3088,6 +3258,7 @@ static int osc_import_event(struct obd_device *obd,
         case IMP_EVENT_DISCON: {
                 cli = &obd->u.cli;
 		spin_lock(&cli->cl_loi_list_lock);
+		osc_cache_credits_sync(cli, true);
 		cli->cl_avail_grant = 0;
 		cli->cl_lost_grant = 0;
 		spin_unlock(&cli->cl_loi_list_lock);
@@ -3211,6 +3382,17 @@ int osc_setup_common(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
 
+	cli->cl_cache_credits = cfs_percpt_alloc(cfs_cpt_table,
+					sizeof(*cli->cl_cache_credits[0]));
+	if (cli->cl_cache_credits != NULL) {
+		struct client_cache_credit *ccr;
+		int i;
+
+		cfs_percpt_for_each(ccr, i, cli->cl_cache_credits)
+			spin_lock_init(&ccr->ccr_lock);
+	}
+	/* else pages are dirtied under cl_loi_list_lock only */
+
 	cli->cl_grant_shrink_interval = GRANT_SHRINK_INTERVAL;
 	osc_update_next_shrink(cli);
 
@@ -3341,6 +3523,11 @@ int osc_cleanup_common(struct obd_device *obd)
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
 
+	if (cli->cl_cache_credits != NULL) {
+		cfs_percpt_free(cli->cl_cache_credits);
+		cli->cl_cache_credits = NULL;
+	}
+
 	rc = client_obd_cleanup(obd);
 
 	ptlrpcd_decref();
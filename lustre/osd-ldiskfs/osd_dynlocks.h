@@ -4,15 +4,26 @@
 #include <linux/list.h>
 #include <linux/wait.h>
 
+#define DYNLOCK_HASH_BITS	5
+#define DYNLOCK_HASH_SIZE	(1 << DYNLOCK_HASH_BITS)
+
 /*
- * lock's namespace:
- *   - list of locks
+ * one bucket of lock's namespace:
+ *   - list of locks hashed to this bucket
  *   - lock to protect this list
  */
+struct dynlock_bucket {
+	struct list_head	db_list;
+	spinlock_t		db_lock;
+};
+
+/*
+ * lock's namespace, the locks are hashed by value into the buckets, so
+ * that the locks on different values do not contend on one spinlock.
+ */
 struct dynlock {
 	unsigned		dl_magic;
-	struct list_head	dl_list;
-	spinlock_t		dl_list_lock;
+	struct dynlock_bucket	dl_buckets[DYNLOCK_HASH_SIZE];
 };
 
 enum dynlock_type {
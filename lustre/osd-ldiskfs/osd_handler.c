@@ -1595,10 +1595,8 @@ static void osd_object_free(const struct lu_env *env, struct lu_object *l)
 	if (obj->oo_hl_head != NULL)
 		ldiskfs_htree_lock_head_free(obj->oo_hl_head);
 	OBD_FREE_PTR(obj);
-	if (unlikely(h)) {
-		lu_object_header_fini(h);
-		OBD_FREE_PTR(h);
-	}
+	if (unlikely(h))
+		lu_object_header_free(h);
 }
 
 /*
@@ -3021,6 +3019,7 @@ static int osd_attr_set(const struct lu_env *env,
 				(const struct iam_key *)fid1,
 				(const struct iam_rec *)id, ipd);
 		osd_ipd_put(env, bag, ipd);
+		osd_oi_cache_invalidate(osd_dev(dt->do_lu.lo_dev), fid0);
 		return(rc > 0 ? 0 : rc);
 	}
 
@@ -6591,6 +6590,40 @@ static int osd_ldiskfs_filldir(void *buf,
 	RETURN(0);
 }
 
+/**
+ * Load the OI mappings of the FIDs in the freshly read dirents into the OI
+ * cache with one sorted pass, the callers (readdir-plus, statahead, LFSCK)
+ * usually locate these objects right after reading the directory.
+ */
+static void osd_it_ea_prefetch(const struct lu_env *env, struct osd_it_ea *it)
+{
+	struct osd_device *dev = osd_obj2dev(it->oie_obj);
+	struct osd_it_ea_dirent *ent = it->oie_buf;
+	struct lu_fid *fids;
+	int nr = 0;
+	int i;
+
+	if (dev->od_is_ost || dev->od_oi_cache.occ_max == 0 ||
+	    it->oie_rd_dirent < 2)
+		return;
+
+	OBD_ALLOC_LARGE(fids, sizeof(*fids) * it->oie_rd_dirent);
+	if (fids == NULL)
+		return;
+
+	for (i = 0; i < it->oie_rd_dirent; i++) {
+		if (fid_is_norm(&ent->oied_fid))
+			fids[nr++] = ent->oied_fid;
+		ent = (void *)ent +
+		      cfs_size_round(sizeof(*ent) + ent->oied_namelen);
+	}
+
+	if (nr > 1)
+		osd_oi_prefetch(osd_oti_get(env), dev, fids, nr);
+
+	OBD_FREE_LARGE(fids, sizeof(*fids) * it->oie_rd_dirent);
+}
+
 /**
  * Calls ->readdir() to load a directory entry at a time
  * and stored it in iterator's in-memory data structure.
@@ -6657,6 +6690,7 @@ static int osd_ldiskfs_it_fill(const struct lu_env *env,
 	} else {
 		it->oie_dirent = it->oie_buf;
 		it->oie_it_dirent = 1;
+		osd_it_ea_prefetch(env, it);
 	}
 
 	RETURN(rc);
@@ -7801,6 +7835,9 @@ static int osd_device_init0(const struct lu_env *env,
 
 	o->od_full_scrub_ratio = OFSR_DEFAULT;
 	o->od_full_scrub_threshold_rate = FULL_SCRUB_THRESHOLD_RATE_DEFAULT;
+	o->od_scrub_threads = OSD_SCRUB_THREADS_DEFAULT;
+	o->od_scrub_rate_limit = OSD_SCRUB_RATE_NO_LIMIT;
+	o->od_oi_cache.occ_max = OSD_OI_CACHE_MAX_DEFAULT;
 	rc = osd_mount(env, o, cfg);
 	if (rc != 0)
 		GOTO(out, rc);
@@ -7922,7 +7959,7 @@ static struct lu_device *osd_device_free(const struct lu_env *env,
 	/* XXX: make osd top device in order to release reference */
 	d->ld_site->ls_top_dev = d;
 	lu_site_purge(env, d->ld_site, -1);
-	if (!cfs_hash_is_empty(d->ld_site->ls_obj_hash)) {
+	if (!lu_site_is_empty(d->ld_site)) {
 		LIBCFS_DEBUG_MSG_DATA_DECL(msgdata, D_ERROR, NULL);
 		lu_site_print(env, d->ld_site, &msgdata, lu_cdebug_printer);
 	}
@@ -8196,11 +8233,15 @@ static int __init osd_init(void)
 	CLASSERT(sizeof(struct osd_thread_info) <= PAGE_SIZE);
 #endif
 
-	osd_oi_mod_init();
+	rc = osd_oi_mod_init();
+	if (rc)
+		return rc;
 
 	rc = lu_kmem_init(ldiskfs_caches);
-	if (rc)
+	if (rc) {
+		osd_oi_mod_fini();
 		return rc;
+	}
 
 #ifdef CONFIG_KALLSYMS
 	priv_dev_set_rdonly = (void *)kallsyms_lookup_name("dev_set_rdonly");
@@ -8212,6 +8253,7 @@ static int __init osd_init(void)
 				 LUSTRE_OSD_LDISKFS_NAME, &osd_device_type);
 	if (rc) {
 		lu_kmem_fini(ldiskfs_caches);
+		osd_oi_mod_fini();
 		return rc;
 	}
 
@@ -8240,6 +8282,7 @@ static void __exit osd_exit(void)
 	}
 	class_unregister_type(LUSTRE_OSD_LDISKFS_NAME);
 	lu_kmem_fini(ldiskfs_caches);
+	osd_oi_mod_fini();
 }
 
 MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
@@ -1018,15 +1018,16 @@ static int iam_lookup_lock(struct iam_path *path,
 }
 /*
  * Performs tree top-to-bottom traversal starting from root, and loads leaf
- * node.
+ * node locked in @lt mode.
  */
-static int iam_path_lookup(struct iam_path *path, int index)
+static int iam_path_lookup(struct iam_path *path, int index,
+			   enum dynlock_type lt)
 {
 	struct iam_leaf  *leaf;
 	int result;
 
 	leaf = &path->ip_leaf;
-	result = iam_lookup_lock(path, &leaf->il_lock, DLT_WRITE);
+	result = iam_lookup_lock(path, &leaf->il_lock, lt);
 	assert_inv(iam_path_check(path));
 	do_corr(schedule());
 	if (result == 0) {
@@ -1047,6 +1048,20 @@ static int iam_path_lookup(struct iam_path *path, int index)
 	return result;
 }
 
+/*
+ * Leaf lock mode for the iterator. Lookups share the leaf with each other
+ * and only exclude the modifications of that leaf. The iterators that
+ * modify the container, or that may be held across calls (IAM_IT_MOVE) by
+ * a thread that modifies the same container later, lock the leaf
+ * exclusively: the exclusive lock can be re-taken by its holder, while the
+ * shared one cannot be upgraded.
+ */
+static inline enum dynlock_type iam_it_lock_type(const struct iam_iterator *it)
+{
+	return it->ii_flags & (IAM_IT_MOVE | IAM_IT_WRITE) ?
+	       DLT_WRITE : DLT_READ;
+}
+
 /*
  * Common part of iam_it_{i,}get().
  */
@@ -1056,7 +1071,7 @@ static int __iam_it_get(struct iam_iterator *it, int index)
 
 	assert_corr(it_state(it) == IAM_IT_DETACHED);
 
-	result = iam_path_lookup(&it->ii_path, index);
+	result = iam_path_lookup(&it->ii_path, index, iam_it_lock_type(it));
 	if (result >= 0) {
 		int collision;
 
@@ -1477,7 +1492,7 @@ int iam_it_next(struct iam_iterator *it)
 				struct dynlock_handle *lh;
 				lh = iam_lock_htree(iam_it_container(it),
 						    path->ip_frame->leaf,
-						    DLT_WRITE);
+						    iam_it_lock_type(it));
 				if (lh != NULL) {
 					iam_leaf_fini(leaf);
 					leaf->il_lock = lh;
@@ -258,6 +258,8 @@ struct osd_device {
         struct osd_oi           **od_oi_table;
         /* total number of OI containers */
         int                       od_oi_count;
+	/* FID to inode cache in front of the OI containers */
+	struct osd_oi_cache	  od_oi_cache;
         /*
          * Fid Capability
          */
@@ -320,6 +322,10 @@ struct osd_device {
 	 * exceeds the osd_device::od_full_scrub_threshold_rate,
 	 * then trigger OI scrub to scan the whole device. */
 	__u64			 od_full_scrub_threshold_rate;
+	/* How many threads scan the device for the full speed OI scrub. */
+	int			 od_scrub_threads;
+	/* At most how many objects the OI scrub scans per second. */
+	__u64			 od_scrub_rate_limit;
 
 	/* a list of orphaned agent inodes, protected with od_osfs_lock */
 	struct list_head	 od_orphan_list;
@@ -355,6 +361,10 @@ enum osd_full_scrub_ratio {
 
 #define FULL_SCRUB_THRESHOLD_RATE_DEFAULT	60
 
+#define OSD_SCRUB_THREADS_DEFAULT	1
+#define OSD_SCRUB_THREADS_MAX		32
+#define OSD_SCRUB_RATE_NO_LIMIT		0
+
 /* There are at most 15 uid/gid/projids are affected in a transaction, and
  * that's rename case:
  * - 3 for source parent uid & gid & projid;
@@ -448,6 +458,8 @@ enum {
         LPROC_OSD_CACHE_ACCESS  = 4,
         LPROC_OSD_CACHE_HIT     = 5,
         LPROC_OSD_CACHE_MISS    = 6,
+	LPROC_OSD_OI_CACHE_HIT	= 7,
+	LPROC_OSD_OI_CACHE_MISS	= 8,
 
 #if OSD_THANDLE_STATS
         LPROC_OSD_THANDLE_STARTING,
@@ -1952,6 +1952,43 @@ static int osd_fiemap_get(const struct lu_env *env, struct dt_object *dt,
 	return rc;
 }
 
+/*
+ * Start asynchronous reads of the blocks backing [start, end) of \a inode
+ * into the buffer cache, where osd_ldiskfs_read() will find them later.
+ */
+static void osd_ldiskfs_readahead(struct inode *inode, __u64 start,
+				  __u64 end)
+{
+	struct ldiskfs_map_blocks map;
+	ldiskfs_lblk_t blk;
+	ldiskfs_lblk_t last;
+	int rc;
+	int i;
+
+	end = min_t(__u64, end, i_size_read(inode));
+	if (start >= end)
+		return;
+
+	blk = start >> inode->i_blkbits;
+	last = (end - 1) >> inode->i_blkbits;
+	while (blk <= last) {
+		map.m_lblk = blk;
+		map.m_len = last - blk + 1;
+		map.m_flags = 0;
+		rc = ldiskfs_map_blocks(NULL, inode, &map, 0);
+		if (rc < 0)
+			break;
+		if (rc == 0) { /* hole */
+			blk++;
+			continue;
+		}
+
+		for (i = 0; i < rc; i++)
+			sb_breadahead(inode->i_sb, map.m_pblk + i);
+		blk += rc;
+	}
+}
+
 static int osd_ladvise(const struct lu_env *env, struct dt_object *dt,
 		       __u64 start, __u64 end, enum lu_ladvise_type advice)
 {
@@ -1960,6 +1997,10 @@ static int osd_ladvise(const struct lu_env *env, struct dt_object *dt,
 	ENTRY;
 
 	switch (advice) {
+	case LU_LADVISE_WILLREAD:
+		if (end > start)
+			osd_ldiskfs_readahead(inode, start, end);
+		break;
 	case LU_LADVISE_DONTNEED:
 		if (end == 0)
 			break;
@@ -210,6 +210,12 @@ static int osd_stats_init(struct osd_device *osd)
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_CACHE_MISS,
                                      LPROCFS_CNTR_AVGMINMAX,
                                      "cache_miss", "pages");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_OI_CACHE_HIT,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "oi_cache_hit", "reqs");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_OI_CACHE_MISS,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "oi_cache_miss", "reqs");
 #if OSD_THANDLE_STATS
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_THANDLE_STARTING,
                                      LPROCFS_CNTR_AVGMINMAX,
@@ -528,6 +534,122 @@ static ssize_t full_scrub_threshold_rate_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(full_scrub_threshold_rate);
 
+static ssize_t scrub_threads_show(struct kobject *kobj, struct attribute *attr,
+				  char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	return sprintf(buf, "%d\n", dev->od_scrub_threads);
+}
+
+static ssize_t scrub_threads_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+	unsigned int val;
+	int rc;
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc != 0)
+		return rc;
+
+	if (val < 1 || val > OSD_SCRUB_THREADS_MAX)
+		return -ERANGE;
+
+	/* Takes effect from the next full speed OI scrub. */
+	dev->od_scrub_threads = val;
+	return count;
+}
+LUSTRE_RW_ATTR(scrub_threads);
+
+static ssize_t scrub_rate_limit_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	return sprintf(buf, "%llu (objects/second)\n",
+		       dev->od_scrub_rate_limit);
+}
+
+static ssize_t scrub_rate_limit_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+	u64 val;
+	int rc;
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	rc = kstrtoull(buffer, 0, &val);
+	if (rc != 0)
+		return rc;
+
+	dev->od_scrub_rate_limit = val;
+	return count;
+}
+LUSTRE_RW_ATTR(scrub_rate_limit);
+
+static ssize_t oi_cache_max_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	return sprintf(buf, "%u\n", dev->od_oi_cache.occ_max);
+}
+
+static ssize_t oi_cache_max_store(struct kobject *kobj, struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+	unsigned int val;
+	int rc;
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc != 0)
+		return rc;
+
+	/* 0 disables the OI cache and releases all cached mappings */
+	osd_oi_cache_resize(dev, val);
+	return count;
+}
+LUSTRE_RW_ATTR(oi_cache_max);
+
 static int ldiskfs_osd_oi_scrub_seq_show(struct seq_file *m, void *data)
 {
 	struct osd_device *dev = osd_dt_dev((struct dt_device *)m->private);
@@ -709,6 +831,9 @@ static struct attribute *ldiskfs_attrs[] = {
 	&lustre_attr_pdo.attr,
 	&lustre_attr_full_scrub_ratio.attr,
 	&lustre_attr_full_scrub_threshold_rate.attr,
+	&lustre_attr_scrub_threads.attr,
+	&lustre_attr_scrub_rate_limit.attr,
+	&lustre_attr_oi_cache_max.attr,
 	NULL,
 };
 
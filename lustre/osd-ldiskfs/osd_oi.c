@@ -39,6 +39,7 @@
 #define DEBUG_SUBSYSTEM S_OSD
 
 #include <linux/module.h>
+#include <linux/sort.h>
 
 /*
  * struct OBD_{ALLOC,FREE}*()
@@ -69,6 +70,297 @@ static struct dt_index_features oi_feat = {
 
 #define OSD_OI_NAME_BASE        "oi.16"
 
+/* how many records osd_oi_prefetch() steps over before descending again */
+#define OSD_OI_PREFETCH_STEPS	16
+
+static const struct rhashtable_params osd_oi_cache_params = {
+	.key_len	= sizeof(struct lu_fid),
+	.key_offset	= offsetof(struct osd_oi_cache_entry, oce_fid),
+	.head_offset	= offsetof(struct osd_oi_cache_entry, oce_hash),
+	.automatic_shrinking = true,
+};
+
+/* all set up osd_oi_cache, for the shrinker */
+static LIST_HEAD(osd_oi_caches);
+static DECLARE_RWSEM(osd_oi_caches_guard);
+static struct shrinker *osd_oi_cache_shrinker;
+
+static void osd_oi_cache_del_locked(struct osd_oi_cache *occ,
+				    struct osd_oi_cache_entry *oce)
+{
+	rhashtable_remove_fast(&occ->occ_hash, &oce->oce_hash,
+			       osd_oi_cache_params);
+	list_del(&oce->oce_lru);
+	atomic_dec(&occ->occ_count);
+	kfree_rcu(oce, oce_rcu);
+}
+
+/*
+ * Release at most @nr entries from the head of the LRU, looking at no more
+ * than @scan of them. Entries that were hit since the last pass are moved
+ * to the tail instead.
+ */
+static unsigned long osd_oi_cache_shrink_locked(struct osd_oi_cache *occ,
+						unsigned long nr,
+						unsigned long scan)
+{
+	struct osd_oi_cache_entry *oce;
+	unsigned long freed = 0;
+
+	while (freed < nr && scan-- > 0 && !list_empty(&occ->occ_lru)) {
+		oce = list_first_entry(&occ->occ_lru,
+				       struct osd_oi_cache_entry, oce_lru);
+		if (READ_ONCE(oce->oce_referenced)) {
+			WRITE_ONCE(oce->oce_referenced, 0);
+			list_move_tail(&oce->oce_lru, &occ->occ_lru);
+			continue;
+		}
+
+		osd_oi_cache_del_locked(occ, oce);
+		freed++;
+	}
+
+	return freed;
+}
+
+static void osd_oi_cache_init(struct osd_device *osd)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	int rc;
+
+	spin_lock_init(&occ->occ_lock);
+	INIT_LIST_HEAD(&occ->occ_lru);
+	atomic_set(&occ->occ_count, 0);
+	occ->occ_seq = 0;
+	rc = rhashtable_init(&occ->occ_hash, &osd_oi_cache_params);
+	if (rc) {
+		CWARN("%s: cannot setup OI cache, go without it: rc = %d\n",
+		      osd_dev2name(osd), rc);
+		return;
+	}
+
+	occ->occ_inited = 1;
+	down_write(&osd_oi_caches_guard);
+	list_add_tail(&occ->occ_linkage, &osd_oi_caches);
+	up_write(&osd_oi_caches_guard);
+}
+
+static void osd_oi_cache_free(void *ptr, void *arg)
+{
+	kfree(ptr);
+}
+
+static void osd_oi_cache_fini(struct osd_device *osd)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+
+	if (!occ->occ_inited)
+		return;
+
+	down_write(&osd_oi_caches_guard);
+	list_del_init(&occ->occ_linkage);
+	up_write(&osd_oi_caches_guard);
+
+	occ->occ_inited = 0;
+	rhashtable_free_and_destroy(&occ->occ_hash, osd_oi_cache_free, NULL);
+	INIT_LIST_HEAD(&occ->occ_lru);
+	atomic_set(&occ->occ_count, 0);
+}
+
+static inline unsigned long osd_oi_cache_seq(struct osd_oi_cache *occ)
+{
+	unsigned long seq = READ_ONCE(occ->occ_seq);
+
+	/* pairs with the OI modification before osd_oi_cache_invalidate() */
+	smp_rmb();
+	return seq;
+}
+
+static bool osd_oi_cache_lookup(struct osd_device *osd,
+				const struct lu_fid *fid,
+				struct osd_inode_id *id)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	struct osd_oi_cache_entry *oce;
+	bool found = false;
+
+	if (!occ->occ_inited || occ->occ_max == 0)
+		return false;
+
+	rcu_read_lock();
+	oce = rhashtable_lookup_fast(&occ->occ_hash, fid, osd_oi_cache_params);
+	if (oce != NULL) {
+		*id = oce->oce_id;
+		if (!READ_ONCE(oce->oce_referenced))
+			WRITE_ONCE(oce->oce_referenced, 1);
+		found = true;
+	}
+	rcu_read_unlock();
+
+	lprocfs_counter_incr(osd->od_stats, found ? LPROC_OSD_OI_CACHE_HIT :
+						    LPROC_OSD_OI_CACHE_MISS);
+	return found;
+}
+
+static bool osd_oi_cache_present(struct osd_oi_cache *occ,
+				 const struct lu_fid *fid)
+{
+	bool found;
+
+	rcu_read_lock();
+	found = rhashtable_lookup_fast(&occ->occ_hash, fid,
+				       osd_oi_cache_params) != NULL;
+	rcu_read_unlock();
+
+	return found;
+}
+
+/*
+ * Cache the mapping found in the OI file. The @seq is sampled before the OI
+ * lookup, if the OI has been modified since then the mapping may be stale
+ * and it is dropped.
+ *
+ * \retval	-ESTALE if the OI has been modified since @seq
+ */
+static int osd_oi_cache_insert(struct osd_device *osd,
+			       const struct lu_fid *fid,
+			       const struct osd_inode_id *id,
+			       unsigned long seq)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	struct osd_oi_cache_entry *oce;
+	struct osd_oi_cache_entry *old;
+	unsigned int count;
+	int rc = 0;
+
+	if (!occ->occ_inited || occ->occ_max == 0)
+		return 0;
+
+	oce = kmalloc(sizeof(*oce), GFP_NOFS);
+	if (oce == NULL)
+		return -ENOMEM;
+
+	oce->oce_fid = *fid;
+	oce->oce_id = *id;
+	oce->oce_referenced = 0;
+
+	spin_lock(&occ->occ_lock);
+	if (unlikely(occ->occ_seq != seq))
+		GOTO(unlock, rc = -ESTALE);
+
+	old = rhashtable_lookup_get_insert_fast(&occ->occ_hash, &oce->oce_hash,
+						osd_oi_cache_params);
+	if (old != NULL)
+		GOTO(unlock, rc = IS_ERR(old) ? PTR_ERR(old) : 0);
+
+	list_add_tail(&oce->oce_lru, &occ->occ_lru);
+	count = atomic_inc_return(&occ->occ_count);
+	if (count > occ->occ_max)
+		osd_oi_cache_shrink_locked(occ, count - occ->occ_max, count);
+	spin_unlock(&occ->occ_lock);
+
+	return 0;
+
+unlock:
+	spin_unlock(&occ->occ_lock);
+	kfree(oce);
+	return rc;
+}
+
+/**
+ * Drop the cached mapping of \a fid.
+ *
+ * It must be called after the OI mapping of \a fid has been modified, so
+ * that a lookup which found the old mapping cannot cache it afterwards.
+ */
+void osd_oi_cache_invalidate(struct osd_device *osd, const struct lu_fid *fid)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	struct osd_oi_cache_entry *oce;
+
+	if (!occ->occ_inited)
+		return;
+
+	spin_lock(&occ->occ_lock);
+	occ->occ_seq++;
+	oce = rhashtable_lookup_fast(&occ->occ_hash, fid, osd_oi_cache_params);
+	if (oce != NULL)
+		osd_oi_cache_del_locked(occ, oce);
+	spin_unlock(&occ->occ_lock);
+}
+
+void osd_oi_cache_resize(struct osd_device *osd, unsigned int max)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	unsigned int count;
+
+	occ->occ_max = max;
+	if (!occ->occ_inited)
+		return;
+
+	spin_lock(&occ->occ_lock);
+	count = atomic_read(&occ->occ_count);
+	if (count > max)
+		osd_oi_cache_shrink_locked(occ, count - max, count * 2);
+	spin_unlock(&occ->occ_lock);
+}
+
+static unsigned long osd_oi_cache_shrink_count(struct shrinker *sk,
+					       struct shrink_control *sc)
+{
+	struct osd_oi_cache *occ;
+	unsigned long cached = 0;
+
+	down_read(&osd_oi_caches_guard);
+	list_for_each_entry(occ, &osd_oi_caches, occ_linkage)
+		cached += atomic_read(&occ->occ_count);
+	up_read(&osd_oi_caches_guard);
+
+	return cached;
+}
+
+static unsigned long osd_oi_cache_shrink_scan(struct shrinker *sk,
+					      struct shrink_control *sc)
+{
+	struct osd_oi_cache *occ;
+	unsigned long remain = sc->nr_to_scan;
+	unsigned long freed = 0;
+	unsigned long nr;
+
+	down_read(&osd_oi_caches_guard);
+	list_for_each_entry(occ, &osd_oi_caches, occ_linkage) {
+		spin_lock(&occ->occ_lock);
+		nr = osd_oi_cache_shrink_locked(occ, remain, remain * 2);
+		spin_unlock(&occ->occ_lock);
+
+		freed += nr;
+		remain -= nr;
+		if (remain == 0)
+			break;
+	}
+	up_read(&osd_oi_caches_guard);
+
+	return freed;
+}
+
+#ifndef HAVE_SHRINKER_COUNT
+static int osd_oi_cache_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct shrink_control scv = {
+		.nr_to_scan = shrink_param(sc, nr_to_scan),
+		.gfp_mask   = shrink_param(sc, gfp_mask)
+	};
+#if !defined(HAVE_SHRINKER_WANT_SHRINK_PTR) && !defined(HAVE_SHRINK_CONTROL)
+	struct shrinker *shrinker = NULL;
+#endif
+
+	if (scv.nr_to_scan != 0)
+		osd_oi_cache_shrink_scan(shrinker, &scv);
+
+	return osd_oi_cache_shrink_count(shrinker, &scv);
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
 static void osd_oi_table_put(struct osd_thread_info *info,
 			     struct osd_oi **oi_table, unsigned oi_count)
 {
@@ -508,6 +800,9 @@ out:
 		}
 	}
 
+	if (rc == 0)
+		osd_oi_cache_init(osd);
+
 	return rc;
 }
 
@@ -516,6 +811,7 @@ void osd_oi_fini(struct osd_thread_info *info, struct osd_device *osd)
 	if (unlikely(!osd->od_oi_table))
 		return;
 
+	osd_oi_cache_fini(osd);
 	osd_oi_table_put(info, osd->od_oi_table, osd->od_oi_count);
 
 	OBD_FREE(osd->od_oi_table,
@@ -613,13 +909,19 @@ static int __osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 			   const struct lu_fid *fid, struct osd_inode_id *id)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	unsigned long  seq;
 	int	       rc;
 
+	if (osd_oi_cache_lookup(osd, fid, id))
+		return 0;
+
+	seq = osd_oi_cache_seq(&osd->od_oi_cache);
 	fid_cpu_to_be(oi_fid, fid);
 	rc = osd_oi_iam_lookup(info, osd_fid2oi(osd, fid), (struct dt_rec *)id,
 			       (const struct dt_key *)oi_fid);
 	if (rc > 0) {
 		osd_id_unpack(id, id);
+		osd_oi_cache_insert(osd, fid, id, seq);
 		rc = 0;
 	} else if (rc == 0) {
 		rc = -ENOENT;
@@ -627,6 +929,146 @@ static int __osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 	return rc;
 }
 
+static int osd_oi_fid_cmp(const void *a, const void *b)
+{
+	return lu_fid_cmp(a, b);
+}
+
+/*
+ * Move the attached iterator forward to @key, over OSD_OI_PREFETCH_STEPS
+ * records at most.
+ *
+ * \retval	+1 if @key is found
+ * \retval	0 if there is no record for @key
+ * \retval	-EAGAIN if the iterator has to descend the OI again
+ * \retval	other negative errno on failure
+ */
+static int osd_oi_iam_seek(struct iam_iterator *it, const struct lu_fid *key)
+{
+	int steps;
+	int rc;
+
+	if (it->ii_state != IAM_IT_ATTACHED)
+		return -EAGAIN;
+
+	for (steps = 0; steps < OSD_OI_PREFETCH_STEPS; steps++) {
+		rc = memcmp(iam_it_key_get(it), key, sizeof(*key));
+		if (rc == 0)
+			return 1;
+		if (rc > 0)
+			return 0;
+
+		rc = iam_it_next(it);
+		if (rc != 0)
+			/* +1 means that the end of the OI is reached */
+			return rc > 0 ? 0 : rc;
+	}
+
+	return -EAGAIN;
+}
+
+/**
+ * Load the OI mappings of many FIDs into the OI cache at once.
+ *
+ * The FIDs are sorted into the OI key order, so the mappings living in
+ * the same IAM leaf are found by moving the iterator forward instead of
+ * descending the OI from its root for each of them. The later lookups of
+ * these FIDs are then served from the cache.
+ *
+ * \param[in] info	thread info
+ * \param[in] osd	osd device
+ * \param[in] fids	FIDs to be resolved, they are sorted in place
+ * \param[in] nr	count of \a fids
+ *
+ * \retval		count of the mappings that have been cached
+ * \retval		negative errno on failure
+ */
+int osd_oi_prefetch(struct osd_thread_info *info, struct osd_device *osd,
+		    struct lu_fid *fids, int nr)
+{
+	struct osd_oi_cache *occ = &osd->od_oi_cache;
+	struct iam_iterator *it = &info->oti_idx_it;
+	struct lu_fid *key = &info->oti_fid2;
+	struct osd_inode_id *id = &info->oti_id2;
+	struct iam_container *bag = NULL;
+	struct iam_path_descr *ipd = NULL;
+	struct osd_oi *oi = NULL;
+	unsigned long seq;
+	int count = 0;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	if (!occ->occ_inited || occ->occ_max == 0 || osd->od_is_ost)
+		RETURN(0);
+
+	seq = osd_oi_cache_seq(occ);
+	sort(fids, nr, sizeof(*fids), osd_oi_fid_cmp, NULL);
+	for (i = 0; i < nr; i++) {
+		struct lu_fid *fid = &fids[i];
+
+		if (!fid_is_norm(fid) ||
+		    (i > 0 && lu_fid_eq(fid, &fids[i - 1])) ||
+		    osd_oi_cache_present(occ, fid))
+			continue;
+
+		fid_cpu_to_be(key, fid);
+		rc = -EAGAIN;
+		if (oi == osd_fid2oi(osd, fid))
+			rc = osd_oi_iam_seek(it, key);
+
+		if (rc == -EAGAIN) {
+			if (oi != NULL) {
+				iam_it_put(it);
+				iam_it_fini(it);
+			}
+
+			if (oi != osd_fid2oi(osd, fid)) {
+				if (oi != NULL)
+					osd_ipd_put(info->oti_env, bag, ipd);
+
+				oi = osd_fid2oi(osd, fid);
+				bag = &oi->oi_dir.od_container;
+				ipd = osd_idx_ipd_get(info->oti_env, bag);
+				if (IS_ERR(ipd)) {
+					oi = NULL;
+					GOTO(out, rc = -ENOMEM);
+				}
+			}
+
+			/* IAM_IT_MOVE: osd_oi_iam_seek() advances it with
+			 * iam_it_next(), so the leaves are locked exclusively,
+			 * see iam_it_lock_type(). */
+			iam_it_init(it, bag, IAM_IT_MOVE, ipd);
+			rc = iam_it_get(it, (struct iam_key *)key);
+		}
+
+		if (rc < 0)
+			GOTO(out, rc);
+
+		if (rc > 0) {
+			iam_reccpy(&it->ii_path.ip_leaf, (struct iam_rec *)id);
+			osd_id_unpack(id, id);
+			/* the OI is being modified, leave it to lookups */
+			if (osd_oi_cache_insert(osd, fid, id, seq) == -ESTALE)
+				GOTO(out, rc = 0);
+
+			count++;
+		}
+	}
+
+	GOTO(out, rc = 0);
+
+out:
+	if (oi != NULL) {
+		iam_it_put(it);
+		iam_it_fini(it);
+		osd_ipd_put(info->oti_env, bag, ipd);
+	}
+
+	RETURN(rc < 0 ? rc : count);
+}
+
 int osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 		  const struct lu_fid *fid, struct osd_inode_id *id,
 		  enum oi_check_flags flags)
@@ -766,6 +1208,7 @@ update:
 		rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 					(const struct dt_rec *)oi_id,
 					(const struct dt_key *)oi_fid, th, false);
+		osd_oi_cache_invalidate(osd, fid);
 		if (rc != 0)
 			return rc;
 
@@ -809,6 +1252,7 @@ int osd_oi_delete(struct osd_thread_info *info,
 		  handle_t *th, enum oi_check_flags flags)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	int rc;
 
 	/* clear idmap cache */
 	if (lu_fid_eq(fid, &info->oti_cache.oic_fid))
@@ -821,8 +1265,10 @@ int osd_oi_delete(struct osd_thread_info *info,
 		return osd_obj_map_delete(info, osd, fid, th);
 
 	fid_cpu_to_be(oi_fid, fid);
-	return osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
-				 (const struct dt_key *)oi_fid, th);
+	rc = osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
+			       (const struct dt_key *)oi_fid, th);
+	osd_oi_cache_invalidate(osd, fid);
+	return rc;
 }
 
 int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
@@ -844,6 +1290,7 @@ int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 	rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 			       (const struct dt_rec *)oi_id,
 			       (const struct dt_key *)oi_fid, th, false);
+	osd_oi_cache_invalidate(osd, fid);
 	if (rc != 0)
 		return rc;
 
@@ -854,6 +1301,9 @@ int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 
 int osd_oi_mod_init(void)
 {
+	DEF_SHRINKER_VAR(shvar, osd_oi_cache_shrink,
+			 osd_oi_cache_shrink_count, osd_oi_cache_shrink_scan);
+
 	if (osd_oi_count == 0 || osd_oi_count > OSD_OI_FID_NR_MAX)
 		osd_oi_count = OSD_OI_FID_NR;
 
@@ -863,5 +1313,17 @@ int osd_oi_mod_init(void)
 		osd_oi_count = size_roundup_power2(osd_oi_count);
 	}
 
+	osd_oi_cache_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+	if (osd_oi_cache_shrinker == NULL)
+		return -ENOMEM;
+
 	return 0;
 }
+
+void osd_oi_mod_fini(void)
+{
+	remove_shrinker(osd_oi_cache_shrinker);
+	osd_oi_cache_shrinker = NULL;
+	/* wait for the entries released by kfree_rcu() */
+	rcu_barrier();
+}
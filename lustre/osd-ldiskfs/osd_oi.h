@@ -49,6 +49,7 @@
 /* struct rw_semaphore */
 #include <linux/rwsem.h>
 #include <linux/jbd2.h>
+#include <linux/rhashtable.h>
 #include <lustre_fid.h>
 #include <lu_object.h>
 #include <md_object.h>
@@ -56,6 +57,8 @@
 #define OSD_OI_FID_OID_BITS	6
 #define OSD_OI_FID_NR		(1UL << OSD_OI_FID_OID_BITS)
 #define OSD_OII_NOGEN		(0)
+/* default max count of FID to inode mappings in osd_oi_cache */
+#define OSD_OI_CACHE_MAX_DEFAULT	(256 * 1024)
 
 struct lu_fid;
 struct osd_thread_info;
@@ -86,6 +89,36 @@ struct osd_idmap_cache {
 	__u16			oic_remote:1;	/* FID isn't local */
 };
 
+/* FID to inode mapping cached in front of the OI files. */
+struct osd_oi_cache_entry {
+	struct lu_fid		oce_fid;
+	struct osd_inode_id	oce_id;
+	struct rhash_head	oce_hash;
+	/* linkage on osd_oi_cache::occ_lru */
+	struct list_head	oce_lru;
+	struct rcu_head		oce_rcu;
+	/* set by lookup, gives the entry a second chance on the LRU */
+	int			oce_referenced;
+};
+
+/*
+ * Per-device cache of the OI mappings. Lookups are lockless under RCU,
+ * insert, delete and the LRU are serialized by occ_lock.
+ */
+struct osd_oi_cache {
+	struct rhashtable	occ_hash;
+	spinlock_t		occ_lock;
+	struct list_head	occ_lru;
+	/* linkage on the global cache list walked by the shrinker */
+	struct list_head	occ_linkage;
+	atomic_t		occ_count;
+	/* bumped on every OI modification to drop racing inserts */
+	unsigned long		occ_seq;
+	/* max count of the cached mappings, 0 disables the cache */
+	unsigned int		occ_max;
+	unsigned int		occ_inited:1;
+};
+
 static inline void osd_id_pack(struct osd_inode_id *tgt,
 			       const struct osd_inode_id *src)
 {
@@ -137,6 +170,7 @@ enum oi_check_flags {
 extern unsigned int osd_oi_count;
 
 int osd_oi_mod_init(void);
+void osd_oi_mod_fini(void);
 int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
 		bool restored);
 void osd_oi_fini(struct osd_thread_info *info, struct osd_device *osd);
@@ -153,6 +187,11 @@ int  osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 		   const struct lu_fid *fid, const struct osd_inode_id *id,
 		   handle_t *th, enum oi_check_flags flags);
 
+int osd_oi_prefetch(struct osd_thread_info *info, struct osd_device *osd,
+		    struct lu_fid *fids, int nr);
+void osd_oi_cache_invalidate(struct osd_device *osd, const struct lu_fid *fid);
+void osd_oi_cache_resize(struct osd_device *osd, unsigned int max);
+
 int fid_is_on_ost(struct osd_thread_info *info, struct osd_device *osd,
 		  const struct lu_fid *fid, enum oi_check_flags flags);
 #endif /* _OSD_OI_H */
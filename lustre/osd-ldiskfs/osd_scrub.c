@@ -250,7 +250,7 @@ stop:
 
 static int
 osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
-		       struct osd_idmap_cache *oic, int val)
+		       struct osd_idmap_cache *oic, int val, bool prior)
 {
 	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
 	struct scrub_file	     *sf     = &scrub->os_file;
@@ -270,7 +270,7 @@ osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
 	if (val < 0)
 		GOTO(out, rc = val);
 
-	if (scrub->os_in_prior)
+	if (prior)
 		oii = list_entry(oic, struct osd_inconsistent_item,
 				 oii_cache);
 
@@ -392,7 +392,7 @@ iget:
 			 val == SCRUB_NEXT_OSTOBJ_OLD) ? OI_KNOWN_ON_OST : 0,
 			&exist);
 	if (rc == 0) {
-		if (scrub->os_in_prior)
+		if (prior)
 			sf->sf_items_updated_prior++;
 		else
 			sf->sf_items_updated++;
@@ -773,6 +773,72 @@ put:
 	return rc;
 }
 
+/**
+ * Throttle the OI scrub according to osd_device::od_scrub_rate_limit.
+ *
+ * Each of the \a nr scanning threads gets an equal share of the rate, and
+ * sleeps for the rest of current second when its share is used up.
+ */
+static void osd_scrub_rate_control(struct osd_device *dev, __u64 *scanned,
+				   unsigned long *window, int nr)
+{
+	struct ptlrpc_thread *thread = &dev->od_scrub.os_scrub.os_thread;
+	__u64 limit = dev->od_scrub_rate_limit;
+	struct l_wait_info lwi;
+	long timeout;
+
+	if (limit == OSD_SCRUB_RATE_NO_LIMIT)
+		return;
+
+	if (*window == 0)
+		*window = jiffies;
+
+	if (++(*scanned) < max_t(__u64, div_u64(limit, nr), 1))
+		return;
+
+	timeout = (long)(*window + cfs_time_seconds(1) - jiffies);
+	if (timeout > 0) {
+		lwi = LWI_TIMEOUT(timeout, NULL, NULL);
+		l_wait_event(thread->t_ctl_waitq,
+			     !thread_is_running(thread), &lwi);
+	}
+
+	*scanned = 0;
+	*window = jiffies;
+}
+
+/**
+ * Start asynchronous reading of the used part of the inode table of the
+ * block group \a bg. The LMA is stored inside the inode body for most of
+ * the objects, so the later iget() and LMA lookup will hit the cache.
+ */
+static void osd_scrub_itable_readahead(struct super_block *sb,
+				       ldiskfs_group_t bg)
+{
+	struct ldiskfs_group_desc *desc;
+	ldiskfs_fsblk_t blk;
+	__u32 used;
+	__u32 count;
+
+	if (bg >= LDISKFS_SB(sb)->s_groups_count)
+		return;
+
+	desc = ldiskfs_get_group_desc(sb, bg, NULL);
+	if (!desc || desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+		return;
+
+	used = LDISKFS_INODES_PER_GROUP(sb) -
+	       ldiskfs_itable_unused_count(sb, desc);
+	count = DIV_ROUND_UP(used, LDISKFS_INODES_PER_BLOCK(sb));
+	blk = le32_to_cpu(desc->bg_inode_table_lo);
+	if (LDISKFS_DESC_SIZE(sb) >= LDISKFS_MIN_DESC_SIZE_64BIT)
+		blk |= (ldiskfs_fsblk_t)le32_to_cpu(desc->bg_inode_table_hi)
+			<< 32;
+
+	while (count-- > 0)
+		sb_breadahead(sb, blk++);
+}
+
 static int osd_scrub_next(struct osd_thread_info *info, struct osd_device *dev,
 			  struct osd_iit_param *param,
 			  struct osd_idmap_cache **oic, const bool noslot)
@@ -900,7 +966,11 @@ static int osd_scrub_exec(struct osd_thread_info *info, struct osd_device *dev,
 		goto wait;
 	}
 
-	rc = osd_scrub_check_update(info, dev, oic, rc);
+	if (!scrub->os_in_prior)
+		osd_scrub_rate_control(dev, &dev->od_scrub.os_rate_scanned,
+				       &dev->od_scrub.os_rate_window, 1);
+
+	rc = osd_scrub_check_update(info, dev, oic, rc, scrub->os_in_prior);
 	if (rc != 0) {
 		scrub->os_in_prior = 0;
 		return rc;
@@ -1031,6 +1101,330 @@ static void osd_scrub_join(const struct lu_env *env, struct osd_device *dev,
 	EXIT;
 }
 
+/* Take the next block group for the worker, return false if none left. */
+static bool osd_scrub_worker_next_group(struct osd_scrub_worker *w)
+{
+	struct osd_scrub *oscrub = &w->osw_dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct osd_iit_param *param = &w->osw_param;
+	bool found = false;
+
+	spin_lock(&scrub->os_lock);
+	if (!oscrub->os_workers_stop &&
+	    oscrub->os_next_bg < LDISKFS_SB(param->sb)->s_groups_count) {
+		param->bg = oscrub->os_next_bg++;
+		param->offset = oscrub->os_first_offset;
+		oscrub->os_first_offset = 0;
+		param->gbase = 1 + param->bg * LDISKFS_INODES_PER_GROUP(param->sb);
+		param->start = param->gbase + param->offset;
+		w->osw_pos = param->start;
+		found = true;
+	} else {
+		w->osw_pos = 0;
+	}
+	spin_unlock(&scrub->os_lock);
+
+	return found;
+}
+
+static int osd_scrub_worker_exec(struct osd_thread_info *info,
+				 struct osd_scrub_worker *w, int rc)
+{
+	struct osd_device *dev = w->osw_dev;
+	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
+	struct scrub_file *sf = &scrub->os_file;
+	struct lu_fid *fid = &w->osw_oic.oic_fid;
+	struct osd_inode_id *lid = &w->osw_oic.oic_lid;
+
+	switch (rc) {
+	case SCRUB_NEXT_NOSCRUB:
+		down_write(&scrub->os_rwsem);
+		scrub->os_new_checked++;
+		sf->sf_items_noscrub++;
+		up_write(&scrub->os_rwsem);
+		w->osw_checked++;
+		return 0;
+	case SCRUB_NEXT_CONTINUE:
+		return 0;
+	}
+
+	osd_scrub_rate_control(dev, &w->osw_rate_scanned, &w->osw_rate_window,
+			       dev->od_scrub.os_workers_count);
+	w->osw_checked++;
+
+	/* Most OI mappings are consistent, verify them without holding the
+	 * os_rwsem, otherwise the workers will serialize on the OI lookup. */
+	if ((rc == 0 || rc == SCRUB_NEXT_OSTOBJ) &&
+	    osd_oi_lookup(info, dev, fid, &info->oti_id,
+			  rc == SCRUB_NEXT_OSTOBJ ? OI_KNOWN_ON_OST : 0) == 0 &&
+	    osd_id_eq(lid, &info->oti_id)) {
+		down_write(&scrub->os_rwsem);
+		scrub->os_new_checked++;
+		if (fid_is_igif(fid))
+			sf->sf_items_igif++;
+		up_write(&scrub->os_rwsem);
+
+		return 0;
+	}
+
+	return osd_scrub_check_update(info, dev, &w->osw_oic, rc, false);
+}
+
+static int osd_scrub_worker_main(void *args)
+{
+	struct osd_scrub_worker *w = args;
+	struct osd_device *dev = w->osw_dev;
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct ptlrpc_thread *thread = &scrub->os_thread;
+	struct osd_iit_param *param = &w->osw_param;
+	struct osd_thread_info *info;
+	struct lu_env env;
+	int rc;
+
+	rc = lu_env_init(&env, LCT_LOCAL | LCT_DT_THREAD);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	info = osd_oti_get(&env);
+	while (osd_scrub_worker_next_group(w)) {
+		struct ldiskfs_group_desc *desc;
+
+		desc = ldiskfs_get_group_desc(param->sb, param->bg, NULL);
+		if (!desc)
+			GOTO(fini, rc = -EIO);
+
+		if (desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+			continue;
+
+		osd_scrub_itable_readahead(param->sb, param->bg);
+		param->bitmap = ldiskfs_read_inode_bitmap(param->sb, param->bg);
+		if (!param->bitmap) {
+			CERROR("%s: fail to read bitmap for %u, "
+			       "scrub will stop, urgent mode\n",
+			       osd_scrub2name(scrub), (__u32)param->bg);
+			GOTO(fini, rc = -EIO);
+		}
+
+		while (param->offset +
+			ldiskfs_itable_unused_count(param->sb, desc) <
+		       LDISKFS_INODES_PER_GROUP(param->sb)) {
+			if (unlikely(!thread_is_running(thread) ||
+				     oscrub->os_workers_stop))
+				break;
+
+			rc = osd_iit_next(param, &w->osw_pos);
+			if (rc == SCRUB_NEXT_BREAK) {
+				rc = 0;
+				break;
+			}
+
+			rc = osd_iit_iget(info, dev, &w->osw_oic.oic_fid,
+					  &w->osw_oic.oic_lid, w->osw_pos,
+					  param->sb, true);
+			rc = osd_scrub_worker_exec(info, w, rc);
+			if (rc != 0)
+				break;
+		}
+
+		brelse(param->bitmap);
+		param->bitmap = NULL;
+		if (rc != 0)
+			GOTO(fini, rc);
+
+		/* Keep the position for the checkpoint if stopped. */
+		if (unlikely(!thread_is_running(thread) ||
+			     oscrub->os_workers_stop))
+			break;
+	}
+
+	GOTO(fini, rc = 0);
+
+fini:
+	lu_env_fini(&env);
+
+out:
+	CDEBUG(D_LFSCK, "%s: OI scrub worker %d exit, pos = %llu, "
+	       "checked = %llu: rc = %d\n", osd_scrub2name(scrub),
+	       w->osw_idx, w->osw_pos, w->osw_checked, rc);
+
+	spin_lock(&scrub->os_lock);
+	w->osw_rc = rc;
+	if (rc < 0)
+		oscrub->os_workers_stop = 1;
+	spin_unlock(&scrub->os_lock);
+
+	if (atomic_dec_and_test(&oscrub->os_workers_running) || rc < 0)
+		wake_up_all(&thread->t_ctl_waitq);
+
+	return rc;
+}
+
+/* The position before which all the objects have been checked. */
+static __u64 osd_scrub_workers_pos(struct osd_device *dev)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	__u64 pos;
+	int i;
+
+	spin_lock(&oscrub->os_scrub.os_lock);
+	pos = 1 + (__u64)oscrub->os_next_bg *
+		  LDISKFS_INODES_PER_GROUP(osd_sb(dev)) +
+	      oscrub->os_first_offset;
+	for (i = 0; i < oscrub->os_workers_count; i++) {
+		struct osd_scrub_worker *w = &oscrub->os_workers[i];
+
+		if (w->osw_pos != 0 && w->osw_pos < pos)
+			pos = w->osw_pos;
+	}
+	spin_unlock(&oscrub->os_scrub.os_lock);
+
+	return pos;
+}
+
+/**
+ * Scan the whole device with osd_device::od_scrub_threads workers.
+ *
+ * The workers take the block groups in ascending order. This thread only
+ * handles the inconsistent items found by the RPC services and makes the
+ * checkpoint with the lowest position in scanning.
+ *
+ * \retval SCRUB_IT_ALL if the whole device has been scanned
+ * \retval 0 if the scanning is stopped
+ * \retval -EAGAIN if no worker can be started
+ * \retval negative error number on other failures
+ */
+static int osd_inode_iteration_parallel(struct osd_thread_info *info,
+					struct osd_device *dev)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct ptlrpc_thread *thread = &scrub->os_thread;
+	struct super_block *sb = osd_sb(dev);
+	struct osd_scrub_worker *workers;
+	struct l_wait_info lwi = { 0 };
+	__u32 ipg = LDISKFS_INODES_PER_GROUP(sb);
+	__u64 pos;
+	int count = dev->od_scrub_threads;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	OBD_ALLOC(workers, sizeof(*workers) * count);
+	if (workers == NULL)
+		RETURN(-EAGAIN);
+
+	atomic_set(&oscrub->os_workers_running, 0);
+	spin_lock(&scrub->os_lock);
+	oscrub->os_next_bg = (scrub->os_pos_current - 1) / ipg;
+	oscrub->os_first_offset = (scrub->os_pos_current - 1) % ipg;
+	oscrub->os_workers_stop = 0;
+	oscrub->os_workers = workers;
+	oscrub->os_workers_count = count;
+	spin_unlock(&scrub->os_lock);
+
+	for (i = 0; i < count; i++) {
+		struct osd_scrub_worker *w = &workers[i];
+		struct task_struct *task;
+
+		w->osw_dev = dev;
+		w->osw_idx = i;
+		w->osw_param.sb = sb;
+		w->osw_time_start = ktime_get_seconds();
+		atomic_inc(&oscrub->os_workers_running);
+		task = kthread_run(osd_scrub_worker_main, w, "OI_scrub_%02d", i);
+		if (IS_ERR(task)) {
+			CDEBUG(D_LFSCK, "%s: cannot start OI scrub worker %d: "
+			       "rc = %ld\n", osd_scrub2name(scrub), i,
+			       PTR_ERR(task));
+			atomic_dec(&oscrub->os_workers_running);
+			break;
+		}
+	}
+
+	spin_lock(&scrub->os_lock);
+	oscrub->os_workers_count = i;
+	if (i == 0)
+		oscrub->os_workers = NULL;
+	spin_unlock(&scrub->os_lock);
+	if (i == 0) {
+		OBD_FREE(workers, sizeof(*workers) * count);
+		RETURN(-EAGAIN);
+	}
+
+	CDEBUG(D_LFSCK, "%s: OI scrub with %d workers, pos = %llu\n",
+	       osd_scrub2name(scrub), i, scrub->os_pos_current);
+
+	while (1) {
+		struct l_wait_info lwi_tmo;
+
+		lwi_tmo = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
+		l_wait_event(thread->t_ctl_waitq,
+			     atomic_read(&oscrub->os_workers_running) == 0 ||
+			     oscrub->os_workers_stop ||
+			     !thread_is_running(thread) ||
+			     !list_empty(&scrub->os_inconsistent_items),
+			     &lwi_tmo);
+
+		while (rc == 0 && !oscrub->os_workers_stop &&
+		       thread_is_running(thread) &&
+		       !list_empty(&scrub->os_inconsistent_items)) {
+			struct osd_inconsistent_item *oii;
+
+			spin_lock(&scrub->os_lock);
+			oii = list_entry(scrub->os_inconsistent_items.next,
+					 struct osd_inconsistent_item,
+					 oii_list);
+			spin_unlock(&scrub->os_lock);
+
+			rc = osd_scrub_check_update(info, dev, &oii->oii_cache,
+						    0, true);
+			if (rc != 0) {
+				spin_lock(&scrub->os_lock);
+				oscrub->os_workers_stop = 1;
+				spin_unlock(&scrub->os_lock);
+			}
+		}
+
+		pos = osd_scrub_workers_pos(dev);
+		if (pos - 1 > scrub->os_pos_current)
+			scrub->os_pos_current = pos - 1;
+
+		if (atomic_read(&oscrub->os_workers_running) == 0)
+			break;
+
+		if (!thread_is_running(thread) || oscrub->os_workers_stop) {
+			l_wait_event(thread->t_ctl_waitq,
+				atomic_read(&oscrub->os_workers_running) == 0,
+				&lwi);
+			continue;
+		}
+
+		if (scrub_checkpoint(info->oti_env, scrub) != 0)
+			/* Continue, as long as the scrub itself can go ahead. */
+			CDEBUG(D_LFSCK, "%s: fail to checkpoint, pos = %llu\n",
+			       osd_scrub2name(scrub), scrub->os_pos_current);
+	}
+
+	for (i = 0; i < oscrub->os_workers_count && rc == 0; i++)
+		rc = workers[i].osw_rc;
+
+	if (rc == 0 && thread_is_running(thread) &&
+	    oscrub->os_next_bg >= LDISKFS_SB(sb)->s_groups_count) {
+		scrub->os_pos_current =
+			le32_to_cpu(LDISKFS_SB(sb)->s_es->s_inodes_count) + 1;
+		rc = SCRUB_IT_ALL;
+	}
+
+	spin_lock(&scrub->os_lock);
+	oscrub->os_workers = NULL;
+	oscrub->os_workers_count = 0;
+	spin_unlock(&scrub->os_lock);
+	OBD_FREE(workers, sizeof(*workers) * count);
+
+	RETURN(rc);
+}
+
 static int osd_inode_iteration(struct osd_thread_info *info,
 			       struct osd_device *dev, __u32 max, bool preload)
 {
@@ -1140,6 +1534,12 @@ full:
 			RETURN(0);
 	}
 
+	if (!preload && scrub->os_full_speed && dev->od_scrub_threads > 1) {
+		rc = osd_inode_iteration_parallel(info, dev);
+		if (rc != -EAGAIN)
+			RETURN(rc);
+	}
+
 	noslot = false;
 	if (!preload) {
 		next = osd_scrub_next;
@@ -1185,6 +1585,11 @@ full:
 			RETURN(-EIO);
 		}
 
+		/* Overlap the inode table reading of the next group with
+		 * the scanning of current one. */
+		if (param->offset == 0)
+			osd_scrub_itable_readahead(param->sb, param->bg + 1);
+
 		do {
 			struct osd_idmap_cache *oic = NULL;
 
@@ -3117,6 +3522,8 @@ int osd_oii_lookup(struct osd_device *dev, const struct lu_fid *fid,
 void osd_scrub_dump(struct seq_file *m, struct osd_device *dev)
 {
 	struct osd_scrub *scrub = &dev->od_scrub;
+	time64_t now = ktime_get_seconds();
+	int i;
 
 	scrub_dump(m, &scrub->os_scrub);
 	seq_printf(m, "lf_scanned: %llu\n"
@@ -3127,4 +3534,18 @@ void osd_scrub_dump(struct seq_file *m, struct osd_device *dev)
 			"inconsistent" : "repaired",
 		   scrub->os_lf_repaired,
 		   scrub->os_lf_failed);
+
+	spin_lock(&scrub->os_scrub.os_lock);
+	for (i = 0; i < scrub->os_workers_count; i++) {
+		struct osd_scrub_worker *w = &scrub->os_workers[i];
+		__u64 speed = w->osw_checked;
+		time64_t duration = now - w->osw_time_start;
+
+		if (duration != 0)
+			do_div(speed, duration);
+		seq_printf(m, "worker_%d: { position: %llu, checked: %llu, "
+			   "speed: %llu }\n", w->osw_idx, w->osw_pos,
+			   w->osw_checked, speed);
+	}
+	spin_unlock(&scrub->os_scrub.os_lock);
 }
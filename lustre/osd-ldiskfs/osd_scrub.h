@@ -51,12 +51,44 @@ struct osd_iit_param {
 	__u32 start;
 };
 
+/* One of the threads that scan the device in parallel for the full speed
+ * OI scrub. Each one scans whole block groups taken in ascending order. */
+struct osd_scrub_worker {
+	struct osd_device	*osw_dev;
+	struct osd_iit_param	 osw_param;
+	struct osd_idmap_cache	 osw_oic;
+	/* The inode in scanning, zero if the worker holds no group. */
+	__u64			 osw_pos;
+	/* How many objects have been checked by this worker. */
+	__u64			 osw_checked;
+	/* For the scan rate limit. */
+	__u64			 osw_rate_scanned;
+	unsigned long		 osw_rate_window;
+	time64_t		 osw_time_start;
+	int			 osw_idx;
+	int			 osw_rc;
+};
+
 struct osd_scrub {
 	struct lustre_scrub	os_scrub;
 	struct lvfs_run_ctxt    os_ctxt;
 	struct osd_idmap_cache  os_oic;
 	struct osd_iit_param	os_iit_param;
 
+	/* The parallel scanning workers, protected by os_scrub.os_lock. */
+	struct osd_scrub_worker *os_workers;
+	int			os_workers_count;
+	atomic_t		os_workers_running;
+	/* The next block group to be taken by the workers. */
+	ldiskfs_group_t		os_next_bg;
+	/* Where to start scanning inside the first taken group. */
+	__u32			os_first_offset;
+	unsigned int		os_workers_stop:1;
+
+	/* For the scan rate limit of the OI scrub main thread. */
+	__u64			os_rate_scanned;
+	unsigned long		os_rate_window;
+
 	/* statistics for /lost+found are in ram only, it will be reset
 	 * when each time the device remount. */
 
@@ -1107,10 +1107,17 @@ static int osd_declare_punch(const struct lu_env *env, struct dt_object *dt,
 static int osd_ladvise(const struct lu_env *env, struct dt_object *dt,
 		       __u64 start, __u64 end, enum lu_ladvise_type advice)
 {
-	int	rc;
+	struct osd_object *obj = osd_dt_obj(dt);
+	int rc = 0;
 	ENTRY;
 
 	switch (advice) {
+	case LU_LADVISE_WILLREAD:
+		if (obj->oo_dn != NULL && end > start)
+			osd_dmu_prefetch(osd_obj2dev(obj)->od_os,
+					 obj->oo_dn->dn_object, 0, start,
+					 end - start, ZIO_PRIORITY_ASYNC_READ);
+		break;
 	default:
 		rc = -ENOTSUPP;
 		break;
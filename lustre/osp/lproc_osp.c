@@ -294,6 +294,61 @@ static ssize_t max_rpcs_in_progress_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_rpcs_in_progress);
 
+/**
+ * Show maximum number of objects destroyed by one sync RPC
+ *
+ * \param[in] kobj	kobject of the OSP device
+ * \param[in] attr	unused
+ * \param[in] buf	buffer to print into
+ * \retval		number of printed bytes
+ */
+static ssize_t max_destroys_per_rpc_show(struct kobject *kobj,
+					 struct attribute *attr,
+					 char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	return sprintf(buf, "%u\n", osp->opd_sync_max_destroys_per_rpc);
+}
+
+/**
+ * Change maximum number of objects destroyed by one sync RPC
+ *
+ * The objects are batched only if the OST supports it, 1 disables it.
+ *
+ * \param[in] kobj	kobject of the OSP device
+ * \param[in] attr	unused
+ * \param[in] buffer	string which represents maximum number
+ * \param[in] count	\a buffer length
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t max_destroys_per_rpc_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer,
+					  size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val == 0 || val > PTLRPC_MAX_DESTROY_OBJS)
+		return -ERANGE;
+
+	osp->opd_sync_max_destroys_per_rpc = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_destroys_per_rpc);
+
 /**
  * Show number of objects to precreate next time
  *
@@ -975,6 +1030,7 @@ static struct attribute *osp_obd_attrs[] = {
 	&lustre_attr_active.attr,
 	&lustre_attr_max_rpcs_in_flight.attr,
 	&lustre_attr_max_rpcs_in_progress.attr,
+	&lustre_attr_max_destroys_per_rpc.attr,
 	&lustre_attr_maxage.attr,
 	&lustre_attr_ost_conn_uuid.attr,
 	&lustre_attr_ping.attr,
@@ -227,6 +227,13 @@ struct osp_device {
 	/* number of RPC in processing (including non-committed by OST) */
 	atomic_t			 opd_sync_rpcs_in_progress;
 	int				 opd_sync_max_rpcs_in_progress;
+	/* unlink records to be sent in one OST_DESTROY, all from the
+	 * same plain llog */
+	struct ost_id			*opd_sync_batch_oids;
+	int				*opd_sync_batch_idx;
+	int				 opd_sync_batch_count;
+	struct llog_logid		 opd_sync_batch_lgid;
+	int				 opd_sync_max_destroys_per_rpc;
 	/* osd api's commit cb control structure */
 	struct dt_txn_callback		 opd_sync_txn_cb;
 	/* last used change number -- semantically similar to transno */
@@ -75,6 +75,11 @@
  *
  * opd_sync_rpcs_in_flight is a number of RPC in flight.
  * we control this with OSP_MAX_RPCS_IN_FLIGHT
+ *
+ * if the OST supports OBD_CONNECT2_BATCH_DESTROY, consecutive unlink records
+ * of the same plain llog are collected into one OST_DESTROY RPC, up to
+ * opd_sync_max_destroys_per_rpc objects. the open batch takes one slot in
+ * the counters above and is sent once full, or before the thread sleeps.
  */
 
 /* XXX: do math to learn reasonable threshold
@@ -83,6 +88,7 @@
 #define OSP_SYNC_THRESHOLD		10
 #define OSP_MAX_RPCS_IN_FLIGHT		8
 #define OSP_MAX_RPCS_IN_PROGRESS	4096
+#define OSP_DESTROYS_PER_RPC		256
 
 #define OSP_JOB_MAGIC		0x26112005
 
@@ -93,6 +99,10 @@ struct osp_job_req_args {
 	struct list_head		jra_in_flight_link;
 	struct llog_cookie		jra_lcookie;
 	__u32				jra_magic;
+	/* indexes of all the records of a batched destroy */
+	int				*jra_idx;
+	/* number of records in jra_idx to cancel once committed */
+	int				 jra_nr;
 };
 
 static int osp_sync_add_commit_cb(const struct lu_env *env,
@@ -130,6 +140,19 @@ static inline int osp_sync_has_new_job(struct osp_device *d)
 		d->opd_sync_prev_done == 0;
 }
 
+/**
+ * Number of objects destroyed by a sync RPC.
+ *
+ * \param[in] req	OST_DESTROY request
+ *
+ * \retval		number of objects in the request
+ */
+static inline int osp_sync_batch_size(struct ptlrpc_request *req)
+{
+	return req_capsule_get_size(&req->rq_pill, &RMF_OST_IDS, RCL_CLIENT) /
+	       sizeof(struct ost_id) + 1;
+}
+
 static inline int osp_sync_in_flight_conflict(struct osp_device *d,
 					     struct llog_rec_hdr *h)
 {
@@ -183,6 +206,24 @@ static inline int osp_sync_in_flight_conflict(struct osp_device *d,
 			conflict = 1;
 			break;
 		}
+
+		if (jra->jra_idx != NULL) {
+			struct ost_id *oids;
+			int i, nr;
+
+			nr = osp_sync_batch_size(req) - 1;
+			oids = req_capsule_client_get(&req->rq_pill,
+						      &RMF_OST_IDS);
+			for (i = 0; i < nr; i++) {
+				if (memcmp(&ostid, &oids[i],
+					   sizeof(ostid)) == 0) {
+					conflict = 1;
+					break;
+				}
+			}
+			if (conflict)
+				break;
+		}
 	}
 	spin_unlock(&d->opd_sync_lock);
 
@@ -280,9 +321,10 @@ static inline int osp_sync_can_process_new(struct osp_device *d,
 		return 0;
 	if (unlikely(osp_sync_in_flight_conflict(d, rec)))
 		return 0;
-	if (!osp_sync_rpcs_in_progress_low(d))
+	/* the open batch has its slot already, see osp_sync_batch_fits() */
+	if (!osp_sync_rpcs_in_progress_low(d) && d->opd_sync_batch_count == 0)
 		return 0;
-	if (!osp_sync_rpcs_in_flight_low(d))
+	if (!osp_sync_rpcs_in_flight_low(d) && d->opd_sync_batch_count == 0)
 		return 0;
 	if (!d->opd_imp_connected)
 		return 0;
@@ -538,6 +580,72 @@ static void osp_sync_request_commit_cb(struct ptlrpc_request *req)
 	wake_up(&d->opd_sync_waitq);
 }
 
+/**
+ * Release the record indexes of a batched destroy.
+ *
+ * \param[in] req	request
+ * \param[in] jra	request async args
+ */
+static void osp_sync_batch_free(struct ptlrpc_request *req,
+				struct osp_job_req_args *jra)
+{
+	if (jra->jra_idx == NULL)
+		return;
+
+	OBD_FREE(jra->jra_idx, sizeof(*jra->jra_idx) *
+			       osp_sync_batch_size(req));
+	jra->jra_idx = NULL;
+}
+
+/**
+ * Keep the records of a batched destroy to be cancelled once committed.
+ *
+ * Only the records of the objects which were destroyed or don't exist on
+ * the OST are cancelled. The other ones stay in llog and are processed
+ * again after next boot, as for any other failed job.
+ *
+ * \param[in] d		OSP device
+ * \param[in] req	request
+ * \param[in] jra	request async args
+ * \param[in] rc		result of the RPC
+ */
+static void osp_sync_batch_done(struct osp_device *d,
+				struct ptlrpc_request *req,
+				struct osp_job_req_args *jra, int rc)
+{
+	int	 nr = osp_sync_batch_size(req);
+	__u32	*rcs;
+	int	 i;
+	int	 j;
+
+	/* no object exists, all the records are cancelled */
+	if (rc == -ENOENT)
+		return;
+
+	jra->jra_nr = 0;
+	if (rc != 0)
+		return;
+
+	rcs = req_capsule_server_sized_get(&req->rq_pill, &RMF_RCS,
+					   nr * sizeof(*rcs));
+	if (rcs == NULL) {
+		DEBUG_REQ(D_ERROR, req, "no result of %d destroys", nr);
+		return;
+	}
+
+	for (i = 0, j = 0; i < nr; i++) {
+		int lrc = (int)rcs[i];
+
+		if (lrc == 0 || lrc == -ENOENT) {
+			jra->jra_idx[j++] = jra->jra_idx[i];
+			continue;
+		}
+		CDEBUG(D_HA, "%s: can't destroy object of record %d: rc = %d\n",
+		       d->opd_obd->obd_name, jra->jra_idx[i], lrc);
+	}
+	jra->jra_nr = j;
+}
+
 /**
  * RPC interpretation callback.
  *
@@ -571,6 +679,9 @@ static int osp_sync_interpret(const struct lu_env *env,
 	       atomic_read(&req->rq_refcount),
 	       rc, (unsigned) req->rq_transno);
 
+	if (jra->jra_idx != NULL)
+		osp_sync_batch_done(d, req, jra, rc);
+
 	if (rc == -ENOENT) {
 		/*
 		 * we tried to destroy object or update attributes,
@@ -603,6 +714,7 @@ static int osp_sync_interpret(const struct lu_env *env,
 			 * will be called at some point */
 			LASSERT(atomic_read(&d->opd_sync_rpcs_in_progress) > 0);
 			atomic_dec(&d->opd_sync_rpcs_in_progress);
+			osp_sync_batch_free(req, jra);
 		}
 
 		wake_up(&d->opd_sync_waitq);
@@ -638,14 +750,14 @@ static int osp_sync_interpret(const struct lu_env *env,
  * This is just a tiny helper function to put the request on the sending list
  *
  * \param[in] d		OSP device
- * \param[in] llh	llog handle where the record is stored
- * \param[in] h		llog record
+ * \param[in] lgid	llog where the records are stored
+ * \param[in] index	index of the first record
+ * \param[in] idx	indexes of all the records of a batched destroy or NULL
  * \param[in] req	request
  */
-static void osp_sync_send_new_rpc(struct osp_device *d,
-				  struct llog_handle *llh,
-				  struct llog_rec_hdr *h,
-				  struct ptlrpc_request *req)
+static void osp_sync_send_rpc(struct osp_device *d,
+			      const struct llog_logid *lgid, __u32 index,
+			      int *idx, struct ptlrpc_request *req)
 {
 	struct osp_job_req_args *jra;
 
@@ -654,9 +766,11 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 
 	jra = ptlrpc_req_async_args(jra, req);
 	jra->jra_magic = OSP_JOB_MAGIC;
-	jra->jra_lcookie.lgc_lgl = llh->lgh_id;
+	jra->jra_lcookie.lgc_lgl = *lgid;
 	jra->jra_lcookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
-	jra->jra_lcookie.lgc_index = h->lrh_index;
+	jra->jra_lcookie.lgc_index = index;
+	jra->jra_idx = idx;
+	jra->jra_nr = idx != NULL ? osp_sync_batch_size(req) : 0;
 	INIT_LIST_HEAD(&jra->jra_committed_link);
 	spin_lock(&d->opd_sync_lock);
 	list_add_tail(&jra->jra_in_flight_link, &d->opd_sync_in_flight_list);
@@ -665,6 +779,14 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 	ptlrpcd_add_req(req);
 }
 
+static void osp_sync_send_new_rpc(struct osp_device *d,
+				  struct llog_handle *llh,
+				  struct llog_rec_hdr *h,
+				  struct ptlrpc_request *req)
+{
+	osp_sync_send_rpc(d, &llh->lgh_id, h->lrh_index, NULL, req);
+}
+
 
 /**
  * Allocate and prepare RPC for a new change.
@@ -677,13 +799,15 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
  * \param[in] d		OSP device
  * \param[in] op	type of the change
  * \param[in] format	request format to be used
+ * \param[in] nr	number of objects destroyed besides the first one
  *
  * \retval pointer		new request on success
  * \retval ERR_PTR(errno)	on error
  */
 static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 					       enum ost_cmd op,
-					       const struct req_format *format)
+					       const struct req_format *format,
+					       int nr)
 {
 	struct ptlrpc_request	*req;
 	struct obd_import	*imp;
@@ -700,6 +824,13 @@ static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 	if (req == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	if (format == &RQF_OST_DESTROY) {
+		req_capsule_set_size(&req->rq_pill, &RMF_OST_IDS, RCL_CLIENT,
+				     nr * sizeof(struct ost_id));
+		req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+				     nr > 0 ? (nr + 1) * sizeof(__u32) : 0);
+	}
+
 	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, op);
 	if (rc) {
 		ptlrpc_req_finished(req);
@@ -753,7 +884,7 @@ static int osp_sync_new_setattr_job(struct osp_device *d,
 		RETURN(1);
 	}
 
-	req = osp_sync_new_job(d, OST_SETATTR, &RQF_OST_SETATTR);
+	req = osp_sync_new_job(d, OST_SETATTR, &RQF_OST_SETATTR, 0);
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
@@ -813,7 +944,7 @@ static int osp_sync_new_unlink_job(struct osp_device *d,
 	ENTRY;
 	LASSERT(h->lrh_type == MDS_UNLINK_REC);
 
-	req = osp_sync_new_job(d, OST_DESTROY, &RQF_OST_DESTROY);
+	req = osp_sync_new_job(d, OST_DESTROY, &RQF_OST_DESTROY, 0);
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
@@ -861,7 +992,7 @@ static int osp_sync_new_unlink64_job(struct osp_device *d,
 
 	ENTRY;
 	LASSERT(h->lrh_type == MDS_UNLINK64_REC);
-	req = osp_sync_new_job(d, OST_DESTROY, &RQF_OST_DESTROY);
+	req = osp_sync_new_job(d, OST_DESTROY, &RQF_OST_DESTROY, 0);
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
@@ -878,6 +1009,218 @@ static int osp_sync_new_unlink64_job(struct osp_device *d,
 	RETURN(0);
 }
 
+/**
+ * Check whether a llog record can be added to a batched destroy.
+ *
+ * \param[in] d		OSP device
+ * \param[in] h		llog record
+ *
+ * \retval true		the record can be batched
+ * \retval false	the record needs a RPC of its own
+ */
+static bool osp_sync_rec_batchable(struct osp_device *d,
+				   struct llog_rec_hdr *h)
+{
+	return h->lrh_type == MDS_UNLINK64_REC &&
+	       ((struct llog_unlink64_rec *)h)->lur_count == 1 &&
+	       d->opd_sync_max_destroys_per_rpc > 1 &&
+	       imp_connect_batch_destroy(d->opd_obd->u.cli.cl_import);
+}
+
+/**
+ * Check whether a llog record can be added to the open batch.
+ *
+ * A record which doesn't fit requires the batch to be sent first.
+ *
+ * \param[in] d		OSP device
+ * \param[in] llh	llog handle where the record is stored
+ * \param[in] h		llog record
+ *
+ * \retval true		there is no batch or the record fits into it
+ * \retval false	the batch has to be sent
+ */
+static bool osp_sync_batch_fits(struct osp_device *d, struct llog_handle *llh,
+				struct llog_rec_hdr *h)
+{
+	if (d->opd_sync_batch_count == 0)
+		return true;
+
+	return osp_sync_rec_batchable(d, h) &&
+	       d->opd_sync_batch_count < d->opd_sync_max_destroys_per_rpc &&
+	       !memcmp(&llh->lgh_id, &d->opd_sync_batch_lgid,
+		       sizeof(llh->lgh_id));
+}
+
+/**
+ * Send the open batch of unlink records.
+ *
+ * The function prepares one OST_DESTROY RPC for all the objects of the
+ * batch. The first object is in RMF_OST_BODY as usual, the other ones in
+ * RMF_OST_IDS. The indexes of the records are kept with the request to
+ * cancel them all at once when the RPC is committed by the OST.
+ *
+ * A batch which can't be sent stays open, with its slot, to be sent again
+ * later by the sync thread.
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval 0		the batch was sent or there is no batch
+ * \retval negative	negated errno, the batch is still open
+ */
+static int osp_sync_batch_send(struct osp_device *d)
+{
+	struct ptlrpc_request	*req;
+	struct ost_body		*body;
+	struct ost_id		*oids;
+	int			 count = d->opd_sync_batch_count;
+	int			*idx = NULL;
+	int			 rc;
+
+	ENTRY;
+
+	if (count == 0)
+		RETURN(0);
+
+	if (count > 1) {
+		OBD_ALLOC(idx, sizeof(*idx) * count);
+		if (idx == NULL)
+			GOTO(out, rc = -ENOMEM);
+		memcpy(idx, d->opd_sync_batch_idx, sizeof(*idx) * count);
+	}
+
+	req = osp_sync_new_job(d, OST_DESTROY, &RQF_OST_DESTROY, count - 1);
+	if (IS_ERR(req))
+		GOTO(out_free, rc = PTR_ERR(req));
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
+	LASSERT(body);
+	body->oa.o_oi = d->opd_sync_batch_oids[0];
+	body->oa.o_misc = 1;
+	body->oa.o_valid = OBD_MD_FLGROUP | OBD_MD_FLID | OBD_MD_FLOBJCOUNT;
+
+	if (count > 1) {
+		oids = req_capsule_client_get(&req->rq_pill, &RMF_OST_IDS);
+		LASSERT(oids);
+		memcpy(oids, &d->opd_sync_batch_oids[1],
+		       sizeof(*oids) * (count - 1));
+	}
+
+	CDEBUG(D_OTHER, "%s: destroy %d objects from "DFID" in one RPC\n",
+	       d->opd_obd->obd_name, count,
+	       PFID(&d->opd_sync_batch_lgid.lgl_oi.oi_fid));
+
+	d->opd_sync_batch_count = 0;
+	osp_sync_send_rpc(d, &d->opd_sync_batch_lgid,
+			  d->opd_sync_batch_idx[0], idx, req);
+	RETURN(0);
+
+out_free:
+	if (idx != NULL)
+		OBD_FREE(idx, sizeof(*idx) * count);
+out:
+	CDEBUG(D_HA, "%s: can't send destroy of %d objects, will retry: "
+	       "rc = %d\n", d->opd_obd->obd_name, count, rc);
+	RETURN(rc);
+}
+
+/**
+ * Send the open batch when the sync thread stops.
+ *
+ * If the batch can't be sent, its records stay in llog and are processed
+ * after next boot, as for any other failed job.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_sync_batch_flush(struct osp_device *d)
+{
+	int count = d->opd_sync_batch_count;
+
+	if (osp_sync_batch_send(d) == 0)
+		return;
+
+	CDEBUG(D_HA, "%s: drop destroy of %d objects until next boot\n",
+	       d->opd_obd->obd_name, count);
+	d->opd_sync_batch_count = 0;
+	atomic_dec(&d->opd_sync_rpcs_in_flight);
+	atomic_dec(&d->opd_sync_rpcs_in_progress);
+}
+
+/**
+ * Add an unlink record to the open batch.
+ *
+ * The first record opens the batch, the RPC slot of the batch is counted
+ * by the caller. The batch is sent once it is full.
+ *
+ * \param[in] d		OSP device
+ * \param[in] llh	llog handle where the record is stored
+ * \param[in] h		llog record
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+static int osp_sync_batch_add(struct osp_device *d, struct llog_handle *llh,
+			      struct llog_rec_hdr *h)
+{
+	struct llog_unlink64_rec	*rec = (struct llog_unlink64_rec *)h;
+	int				 count = d->opd_sync_batch_count;
+	int				 rc;
+
+	ENTRY;
+	LASSERT(h->lrh_type == MDS_UNLINK64_REC);
+
+	if (d->opd_sync_batch_oids == NULL) {
+		OBD_ALLOC_LARGE(d->opd_sync_batch_oids, PTLRPC_MAX_DESTROY_OBJS *
+				sizeof(*d->opd_sync_batch_oids));
+		if (d->opd_sync_batch_oids == NULL)
+			RETURN(-ENOMEM);
+		OBD_ALLOC_LARGE(d->opd_sync_batch_idx, PTLRPC_MAX_DESTROY_OBJS *
+				sizeof(*d->opd_sync_batch_idx));
+		if (d->opd_sync_batch_idx == NULL) {
+			OBD_FREE_LARGE(d->opd_sync_batch_oids,
+				       PTLRPC_MAX_DESTROY_OBJS *
+				       sizeof(*d->opd_sync_batch_oids));
+			d->opd_sync_batch_oids = NULL;
+			RETURN(-ENOMEM);
+		}
+	}
+
+	rc = fid_to_ostid(&rec->lur_fid, &d->opd_sync_batch_oids[count]);
+	if (rc < 0)
+		RETURN(rc);
+
+	if (count == 0)
+		d->opd_sync_batch_lgid = llh->lgh_id;
+	d->opd_sync_batch_idx[count] = h->lrh_index;
+	d->opd_sync_batch_count = ++count;
+
+	/* a batch which can't be sent now is retried by the sync thread */
+	if (count >= d->opd_sync_max_destroys_per_rpc)
+		osp_sync_batch_send(d);
+
+	RETURN(0);
+}
+
+/**
+ * Release the buffers of the batched destroy.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_sync_batch_fini(struct osp_device *d)
+{
+	LASSERT(d->opd_sync_batch_count == 0);
+
+	if (d->opd_sync_batch_oids != NULL)
+		OBD_FREE_LARGE(d->opd_sync_batch_oids,
+			       PTLRPC_MAX_DESTROY_OBJS *
+			       sizeof(*d->opd_sync_batch_oids));
+	if (d->opd_sync_batch_idx != NULL)
+		OBD_FREE_LARGE(d->opd_sync_batch_idx,
+			       PTLRPC_MAX_DESTROY_OBJS *
+			       sizeof(*d->opd_sync_batch_idx));
+	d->opd_sync_batch_oids = NULL;
+	d->opd_sync_batch_idx = NULL;
+}
+
 /**
  * Process llog records.
  *
@@ -901,6 +1244,8 @@ static void osp_sync_process_record(const struct lu_env *env,
 {
 	struct llog_handle	*cathandle = llh->u.phd.phd_cat_handle;
 	struct llog_cookie	 cookie;
+	bool			 batch;
+	bool			 slot = false;
 	int			 rc = 0;
 
 	ENTRY;
@@ -937,9 +1282,14 @@ static void osp_sync_process_record(const struct lu_env *env,
 	 */
 
 	/* notice we increment counters before sending RPC, to be consistent
-	 * in RPC interpret callback which may happen very quickly */
-	atomic_inc(&d->opd_sync_rpcs_in_flight);
-	atomic_inc(&d->opd_sync_rpcs_in_progress);
+	 * in RPC interpret callback which may happen very quickly.
+	 * a record added to an open batch uses the slot of the batch */
+	batch = osp_sync_rec_batchable(d, rec);
+	if (!batch || d->opd_sync_batch_count == 0) {
+		atomic_inc(&d->opd_sync_rpcs_in_flight);
+		atomic_inc(&d->opd_sync_rpcs_in_progress);
+		slot = true;
+	}
 
 	switch (rec->lrh_type) {
 	/* case MDS_UNLINK_REC is kept for compatibility */
@@ -947,7 +1297,10 @@ static void osp_sync_process_record(const struct lu_env *env,
 		rc = osp_sync_new_unlink_job(d, llh, rec);
 		break;
 	case MDS_UNLINK64_REC:
-		rc = osp_sync_new_unlink64_job(d, llh, rec);
+		if (batch)
+			rc = osp_sync_batch_add(d, llh, rec);
+		else
+			rc = osp_sync_new_unlink64_job(d, llh, rec);
 		break;
 	case MDS_SETATTR64_REC:
 		rc = osp_sync_new_setattr_job(d, llh, rec);
@@ -969,7 +1322,7 @@ static void osp_sync_process_record(const struct lu_env *env,
 		wake_up(&d->opd_sync_barrier_waitq);
 	}
 	atomic64_inc(&d->opd_sync_processed_recs);
-	if (rc != 0) {
+	if (rc != 0 && slot) {
 		atomic_dec(&d->opd_sync_rpcs_in_flight);
 		atomic_dec(&d->opd_sync_rpcs_in_progress);
 	}
@@ -1074,7 +1427,18 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		LASSERT(body);
 		/* import can be closing, thus all commit cb's are
 		 * called we can check committness directly */
-		if (req->rq_import_generation == imp->imp_generation) {
+		if (req->rq_import_generation == imp->imp_generation &&
+		    jra->jra_idx != NULL) {
+			/* batched destroy, all records are from one llog */
+			rc = 0;
+			if (jra->jra_nr > 0)
+				rc = llog_cat_cancel_arr_rec(env, llh,
+						&jra->jra_lcookie.lgc_lgl,
+						jra->jra_nr, jra->jra_idx);
+			if (rc)
+				CERROR("%s: can't cancel %d records: rc = %d\n",
+				       obd->obd_name, jra->jra_nr, rc);
+		} else if (req->rq_import_generation == imp->imp_generation) {
 			if (arr && (!i ||
 				    !memcmp(&jra->jra_lcookie.lgc_lgl, &lgid,
 					   sizeof(lgid)))) {
@@ -1093,6 +1457,7 @@ static void osp_sync_process_committed(const struct lu_env *env,
 			DEBUG_REQ(D_OTHER, req, "imp_committed = %llu",
 				  imp->imp_peer_committed_transno);
 		}
+		osp_sync_batch_free(req, jra);
 		ptlrpc_req_finished(req);
 		done++;
 	}
@@ -1156,15 +1521,23 @@ static int osp_sync_process_queues(const struct lu_env *env,
 
 		if (!osp_sync_running(d)) {
 			CDEBUG(D_HA, "stop llog processing\n");
+			osp_sync_batch_flush(d);
 			return LLOG_PROC_BREAK;
 		}
 
 		/* process requests committed by OST */
 		osp_sync_process_committed(env, d);
 
+		/* a record which can't join the open batch needs
+		 * a slot of its own */
+		if (llh != NULL && !osp_sync_batch_fits(d, llh, rec))
+			osp_sync_batch_send(d);
+
 		/* if we there are changes to be processed and we have
-		 * resources for this ... do now */
-		if (osp_sync_can_process_new(d, rec)) {
+		 * resources for this ... do now, unless the batch the
+		 * record can't join is still to be sent */
+		if ((llh == NULL || osp_sync_batch_fits(d, llh, rec)) &&
+		    osp_sync_can_process_new(d, rec)) {
 			if (llh == NULL) {
 				/* ask llog for another record */
 				CDEBUG(D_HA, "%u changes, %u in progress,"
@@ -1179,9 +1552,15 @@ static int osp_sync_process_queues(const struct lu_env *env,
 			rec = NULL;
 		}
 
+		/* don't keep the batch while waiting, a batch which can't
+		 * be sent now is retried a bit later */
+		if (osp_sync_batch_send(d) != 0)
+			lwi = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
+
 		l_wait_event(d->opd_sync_waitq,
 			     !osp_sync_running(d) ||
-			     osp_sync_can_process_new(d, rec) ||
+			     (d->opd_sync_batch_count == 0 &&
+			      osp_sync_can_process_new(d, rec)) ||
 			     !list_empty(&d->opd_sync_committed_there),
 			     &lwi);
 	} while (1);
@@ -1287,6 +1666,7 @@ next:
 
 	} while (rc == 0 && (wrapped ||
 			     d->opd_sync_last_catalog_idx == LLOG_CAT_FIRST));
+	osp_sync_batch_flush(d);
 
 	if (rc < 0) {
 		if (rc == -EINPROGRESS) {
@@ -1342,6 +1722,7 @@ close:
 	if (rc)
 		CERROR("can't cleanup llog: %d\n", rc);
 out:
+	osp_sync_batch_fini(d);
 	LASSERTF(atomic_read(&d->opd_sync_rpcs_in_progress) == 0,
 		 "%s: %d %d %sempty\n", d->opd_obd->obd_name,
 		 atomic_read(&d->opd_sync_rpcs_in_progress),
@@ -1519,6 +1900,7 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 
 	d->opd_sync_max_rpcs_in_flight = OSP_MAX_RPCS_IN_FLIGHT;
 	d->opd_sync_max_rpcs_in_progress = OSP_MAX_RPCS_IN_PROGRESS;
+	d->opd_sync_max_destroys_per_rpc = OSP_DESTROYS_PER_RPC;
 	spin_lock_init(&d->opd_sync_lock);
 	init_waitqueue_head(&d->opd_sync_waitq);
 	init_waitqueue_head(&d->opd_sync_barrier_waitq);
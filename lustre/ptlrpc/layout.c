@@ -470,10 +470,25 @@ static const struct req_msg_field *ldlm_intent_getattr_client[] = {
 	&RMF_MDT_BODY,     /* coincides with mds_getattr_name_client[] */
 	&RMF_CAPA1,
 	&RMF_NAME,
-	&RMF_FILE_SECCTX_NAME
+	&RMF_FILE_SECCTX_NAME,
+	&RMF_BATCH_GETATTR,
+	&RMF_BATCH_NAMES
 };
 
 static const struct req_msg_field *ldlm_intent_getattr_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REP,
+	&RMF_MDT_BODY,
+	&RMF_MDT_MD,
+	&RMF_ACL,
+	&RMF_CAPA1,
+	&RMF_FILE_SECCTX,
+	&RMF_DEFAULT_MDT_MD,
+	&RMF_BATCH_GETATTR_REP,
+	&RMF_BATCH_MD
+};
+
+static const struct req_msg_field *ldlm_intent_create_server[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REP,
 	&RMF_MDT_BODY,
@@ -618,6 +633,12 @@ static const struct req_msg_field *ost_body_only[] = {
         &RMF_OST_BODY
 };
 
+static const struct req_msg_field *ost_destroy_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_RCS
+};
+
 static const struct req_msg_field *ost_body_capa[] = {
         &RMF_PTLRPC_BODY,
         &RMF_OST_BODY,
@@ -625,10 +646,11 @@ static const struct req_msg_field *ost_body_capa[] = {
 };
 
 static const struct req_msg_field *ost_destroy_client[] = {
-        &RMF_PTLRPC_BODY,
-        &RMF_OST_BODY,
-        &RMF_DLM_REQ,
-        &RMF_CAPA1
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_DLM_REQ,
+	&RMF_CAPA1,
+	&RMF_OST_IDS
 };
 
 
@@ -641,6 +663,16 @@ static const struct req_msg_field *ost_brw_client[] = {
 	&RMF_SHORT_IO
 };
 
+static const struct req_msg_field *ost_brw_write_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_OBD_IOOBJ,
+	&RMF_NIOBUF_REMOTE,
+	&RMF_CAPA1,
+	&RMF_SHORT_IO,
+	&RMF_OBDO
+};
+
 static const struct req_msg_field *ost_brw_read_server[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_OST_BODY,
@@ -648,9 +680,10 @@ static const struct req_msg_field *ost_brw_read_server[] = {
 };
 
 static const struct req_msg_field *ost_brw_write_server[] = {
-        &RMF_PTLRPC_BODY,
-        &RMF_OST_BODY,
-        &RMF_RCS
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_RCS,
+	&RMF_OBDO
 };
 
 static const struct req_msg_field *ost_get_info_generic_server[] = {
@@ -1106,6 +1139,27 @@ struct req_msg_field RMF_DEFAULT_MDT_MD =
 		    NULL);
 EXPORT_SYMBOL(RMF_DEFAULT_MDT_MD);
 
+/* names but the first one of a batched IT_GETATTR intent enqueue */
+struct req_msg_field RMF_BATCH_GETATTR =
+	DEFINE_MSGF("batch_getattr", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_getattr),
+		    lustre_swab_mdt_batch_getattr, NULL);
+EXPORT_SYMBOL(RMF_BATCH_GETATTR);
+
+struct req_msg_field RMF_BATCH_NAMES =
+	DEFINE_MSGF("batch_names", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_NAMES);
+
+struct req_msg_field RMF_BATCH_GETATTR_REP =
+	DEFINE_MSGF("batch_getattr_rep", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_getattr_rep),
+		    lustre_swab_mdt_batch_getattr_rep, NULL);
+EXPORT_SYMBOL(RMF_BATCH_GETATTR_REP);
+
+struct req_msg_field RMF_BATCH_MD =
+	DEFINE_MSGF("batch_md", RMF_F_NO_SIZE_CHECK, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_MD);
+
 struct req_msg_field RMF_REC_REINT =
         DEFINE_MSGF("rec_reint", 0, sizeof(struct mdt_rec_reint),
                     lustre_swab_mdt_rec_reint, NULL);
@@ -1160,6 +1214,13 @@ struct req_msg_field RMF_OBD_IOOBJ =
                     sizeof(struct obd_ioobj), lustre_swab_obd_ioobj, dump_ioo);
 EXPORT_SYMBOL(RMF_OBD_IOOBJ);
 
+/* obdo of each object but the first one in a multi-object BRW write and in
+ * its reply */
+struct req_msg_field RMF_OBDO =
+	DEFINE_MSGF("obdo", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct obdo), lustre_swab_obdo, NULL);
+EXPORT_SYMBOL(RMF_OBDO);
+
 struct req_msg_field RMF_NIOBUF_REMOTE =
         DEFINE_MSGF("niobuf_remote", RMF_F_STRUCT_ARRAY,
                     sizeof(struct niobuf_remote), lustre_swab_niobuf_remote,
@@ -1197,6 +1258,13 @@ struct req_msg_field RMF_OST_ID =
 		    sizeof(struct ost_id), lustre_swab_ost_id, NULL);
 EXPORT_SYMBOL(RMF_OST_ID);
 
+/* ids of all objects but the first one in a batched OST_DESTROY, the
+ * result of each object is returned in RMF_RCS */
+struct req_msg_field RMF_OST_IDS =
+	DEFINE_MSGF("ost_ids", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_id), lustre_swab_ost_id, NULL);
+EXPORT_SYMBOL(RMF_OST_IDS);
+
 struct req_msg_field RMF_FIEMAP_KEY =
         DEFINE_MSGF("fiemap", 0, sizeof(struct ll_fiemap_info_key),
                     lustre_swab_fiemap, NULL);
@@ -1584,7 +1652,7 @@ EXPORT_SYMBOL(RQF_LDLM_INTENT_OPEN);
 
 struct req_format RQF_LDLM_INTENT_CREATE =
         DEFINE_REQ_FMT0("LDLM_INTENT_CREATE",
-                        ldlm_intent_create_client, ldlm_intent_getattr_server);
+			ldlm_intent_create_client, ldlm_intent_create_server);
 EXPORT_SYMBOL(RQF_LDLM_INTENT_CREATE);
 
 struct req_format RQF_LDLM_INTENT_GETXATTR =
@@ -1701,7 +1769,7 @@ struct req_format RQF_OST_SYNC =
 EXPORT_SYMBOL(RQF_OST_SYNC);
 
 struct req_format RQF_OST_DESTROY =
-        DEFINE_REQ_FMT0("OST_DESTROY", ost_destroy_client, ost_body_only);
+	DEFINE_REQ_FMT0("OST_DESTROY", ost_destroy_client, ost_destroy_server);
 EXPORT_SYMBOL(RQF_OST_DESTROY);
 
 struct req_format RQF_OST_BRW_READ =
@@ -1709,7 +1777,8 @@ struct req_format RQF_OST_BRW_READ =
 EXPORT_SYMBOL(RQF_OST_BRW_READ);
 
 struct req_format RQF_OST_BRW_WRITE =
-        DEFINE_REQ_FMT0("OST_BRW_WRITE", ost_brw_client, ost_brw_write_server);
+        DEFINE_REQ_FMT0("OST_BRW_WRITE", ost_brw_write_client,
+			ost_brw_write_server);
 EXPORT_SYMBOL(RQF_OST_BRW_WRITE);
 
 struct req_format RQF_OST_STATFS =
@@ -224,8 +224,9 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
 		svc_debugfs_entry = root;
         }
 
-        lprocfs_counter_init(svc_stats, PTLRPC_REQWAIT_CNTR,
-                             svc_counter_config, "req_waittime", "usec");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQWAIT_CNTR,
+			     svc_counter_config | LPROCFS_CNTR_HISTOGRAM,
+			     "req_waittime", "usec");
         lprocfs_counter_init(svc_stats, PTLRPC_REQQDEPTH_CNTR,
                              svc_counter_config, "req_qdepth", "reqs");
         lprocfs_counter_init(svc_stats, PTLRPC_REQACTIVE_CNTR,
@@ -252,9 +253,10 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
         }
         for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
                 __u32 opcode = ll_rpc_opcode_table[i].opcode;
-                lprocfs_counter_init(svc_stats,
-                                     EXTRA_MAX_OPCODES + i, svc_counter_config,
-                                     ll_opcode2str(opcode), "usec");
+		lprocfs_counter_init(svc_stats, EXTRA_MAX_OPCODES + i,
+				     svc_counter_config |
+				     LPROCFS_CNTR_HISTOGRAM,
+				     ll_opcode2str(opcode), "usec");
         }
 
 	rc = ldebugfs_register_stats(svc_debugfs_entry, name, svc_stats);
@@ -263,6 +265,9 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
 			ldebugfs_remove(&svc_debugfs_entry);
                 lprocfs_free_stats(&svc_stats);
         } else {
+		/* latency histograms are optional, "stats" is enough */
+		ldebugfs_register_stats_hist(svc_debugfs_entry, "stats_hist",
+					     svc_stats);
                 if (dir)
 			*debugfs_root_ret = svc_debugfs_entry;
                 *stats_ret = svc_stats;
@@ -417,6 +422,7 @@ static ssize_t threads_min_store(struct kobject *kobj, struct attribute *attr,
 	}
 
 	svc->srv_nthrs_cpt_init = (int)val / svc->srv_ncpts;
+	ptlrpc_svc_reset_limits(svc);
 
 	spin_unlock(&svc->srv_lock);
 
@@ -472,6 +478,7 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 	}
 
 	svc->srv_nthrs_cpt_limit = (int)val / svc->srv_ncpts;
+	ptlrpc_svc_reset_limits(svc);
 
 	spin_unlock(&svc->srv_lock);
 
@@ -479,6 +486,65 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_rebalance_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_nthrs_rebalance);
+}
+
+/* seconds between moving threads between partitions, 0 to disable */
+static ssize_t threads_rebalance_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_nthrs_rebalance = val;
+	svc->srv_rebalance_next = ktime_get_seconds() + val;
+	/* disabled, give the partitions their even share back */
+	if (val == 0)
+		ptlrpc_svc_reset_limits(svc);
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_rebalance);
+
+/* current thread limit of each partition, moved by threads_rebalance */
+static ssize_t threads_cpt_limits_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	struct ptlrpc_service_part *svcpt;
+	ssize_t len = 0;
+	int i;
+
+	spin_lock(&svc->srv_lock);
+	ptlrpc_service_for_each_part(svcpt, i, svc)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%d",
+				 i == 0 ? "" : " ", svcpt->scp_nthrs_limit);
+	spin_unlock(&svc->srv_lock);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+LUSTRE_RO_ATTR(threads_cpt_limits);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -1158,6 +1224,8 @@ static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_rebalance.attr,
+	&lustre_attr_threads_cpt_limits.attr,
 	&lustre_attr_high_priority_ratio.attr,
 	NULL,
 };
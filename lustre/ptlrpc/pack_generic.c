@@ -2584,6 +2584,21 @@ void lustre_swab_ldlm_reply (struct ldlm_reply *r)
         __swab64s (&r->lock_policy_res2);
 }
 
+void lustre_swab_mdt_batch_getattr(struct mdt_batch_getattr *mbg)
+{
+	/* mbg_handle opaque */
+	__swab32s(&mbg->mbg_name_off);
+	__swab32s(&mbg->mbg_namelen);
+}
+
+void lustre_swab_mdt_batch_getattr_rep(struct mdt_batch_getattr_rep *mbgr)
+{
+	lustre_swab_ldlm_reply(&mbgr->mbgr_dlm);
+	lustre_swab_mdt_body(&mbgr->mbgr_body);
+	__swab32s(&mbgr->mbgr_md_off);
+	CLASSERT(offsetof(typeof(*mbgr), mbgr_padding) != 0);
+}
+
 void lustre_swab_quota_body(struct quota_body *b)
 {
 	lustre_swab_lu_fid(&b->qb_fid);
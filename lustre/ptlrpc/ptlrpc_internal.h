@@ -64,6 +64,7 @@ extern struct mutex ptlrpcd_mutex;
 extern struct mutex pinger_mutex;
 
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
+void ptlrpc_svc_reset_limits(struct ptlrpc_service *svc);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
 
@@ -593,6 +593,7 @@ static void ptlrpc_server_nthreads_check(struct ptlrpc_service *svc,
 	nthrs = max(nthrs, tc->tc_nthrs_init);
 	svc->srv_nthrs_cpt_limit = nthrs;
 	svc->srv_nthrs_cpt_init = init;
+	ptlrpc_svc_reset_limits(svc);
 
 	if (nthrs * svc->srv_ncpts > tc->tc_nthrs_max) {
 		CDEBUG(D_OTHER,
@@ -812,6 +813,7 @@ struct ptlrpc_service *ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	service->srv_thread_name	= conf->psc_thr.tc_thr_name;
 	service->srv_ctx_tags		= conf->psc_thr.tc_ctx_tags;
 	service->srv_hpreq_ratio	= PTLRPC_SVC_HP_RATIO;
+	service->srv_nthrs_rebalance	= PTLRPC_SVC_REBALANCE;
 	service->srv_ops		= conf->psc_ops;
 
 	for (i = 0; i < ncpts; i++) {
@@ -2580,7 +2582,7 @@ static inline int ptlrpc_threads_increasable(struct ptlrpc_service_part *svcpt)
 {
 	return svcpt->scp_nthrs_running +
 	       svcpt->scp_nthrs_starting <
-	       svcpt->scp_service->srv_nthrs_cpt_limit;
+	       svcpt->scp_nthrs_limit;
 }
 
 /**
@@ -2603,7 +2605,7 @@ static inline bool ptlrpc_thread_should_stop(struct ptlrpc_thread *thread)
 {
 	struct ptlrpc_service_part *svcpt = thread->t_svcpt;
 
-	return thread->t_id >= svcpt->scp_service->srv_nthrs_cpt_limit &&
+	return thread->t_id >= svcpt->scp_nthrs_limit &&
 		thread->t_id == svcpt->scp_thr_nextid - 1;
 }
 
@@ -2622,10 +2624,133 @@ static inline void ptlrpc_thread_stop(struct ptlrpc_thread *thread)
 	if (ptlrpc_thread_should_stop(thread)) {
 		ptlrpc_stop_thread(thread);
 		svcpt->scp_thr_nextid--;
+		/* let the next highest numbered idle thread check it too */
+		if (svcpt->scp_thr_nextid > svcpt->scp_nthrs_limit)
+			wake_up_all(&svcpt->scp_waitq);
 	}
 	spin_unlock(&svcpt->scp_lock);
 }
 
+/**
+ * Reset the thread limit of each partition of \a svc to the even share,
+ * called with ptlrpc_service::srv_lock held after changing the limits.
+ */
+void ptlrpc_svc_reset_limits(struct ptlrpc_service *svc)
+{
+	struct ptlrpc_service_part *svcpt;
+	int i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		svcpt->scp_nthrs_limit = svc->srv_nthrs_cpt_limit;
+		svcpt->scp_qdepth_avg = 0;
+		wake_up_all(&svcpt->scp_waitq);
+	}
+}
+
+/**
+ * Move thread limit between partitions of \a svc according to their
+ * request queue depth.
+ *
+ * Requests are spread over partitions by the CPT of the network interface
+ * and of the peer, so a few partitions can be overloaded while the others
+ * are idle. The total thread limit of the service never changes: a busy
+ * partition whose threads are all running borrows \a step threads from the
+ * partition with the shortest queue, and the borrowed threads drift back
+ * once no partition is short of threads. Partitions never go below
+ * srv_nthrs_cpt_init or above twice srv_nthrs_cpt_limit threads, and only
+ * threads that are not running are given away, so the service never runs
+ * more than threads_max threads. New threads are started on demand by
+ * ptlrpc_threads_need_create().
+ */
+static void ptlrpc_svc_rebalance(struct ptlrpc_service *svc)
+{
+	struct ptlrpc_service_part *svcpt;
+	struct ptlrpc_service_part *hot = NULL;
+	struct ptlrpc_service_part *cold = NULL;
+	struct ptlrpc_service_part *high = NULL;
+	struct ptlrpc_service_part *low = NULL;
+	time64_t now = ktime_get_seconds();
+	int limit;
+	int step;
+	int i;
+
+	spin_lock(&svc->srv_lock);
+	if (svc->srv_nthrs_rebalance == 0 || now < svc->srv_rebalance_next) {
+		spin_unlock(&svc->srv_lock);
+		return;
+	}
+	svc->srv_rebalance_next = now + svc->srv_nthrs_rebalance;
+
+	limit = svc->srv_nthrs_cpt_limit;
+	step = max(limit / 8, 1);
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		unsigned int depth;
+
+		/* unlocked read, good enough to follow the trend */
+		depth = svcpt->scp_nreqs_incoming +
+			svcpt->scp_nrs_reg.nrs_req_queued;
+		if (svcpt->scp_nrs_hp != NULL)
+			depth += svcpt->scp_nrs_hp->nrs_req_queued;
+		svcpt->scp_qdepth_avg = (svcpt->scp_qdepth_avg +
+					 (depth << 4)) / 2;
+
+		if (svcpt->scp_nthrs_running + svcpt->scp_nthrs_starting >=
+		    svcpt->scp_nthrs_limit &&
+		    svcpt->scp_nthrs_limit + step <= 2 * limit &&
+		    (hot == NULL ||
+		     svcpt->scp_qdepth_avg > hot->scp_qdepth_avg))
+			hot = svcpt;
+
+		/* only give away threads that are not running */
+		if (svcpt->scp_nthrs_limit - step >= svc->srv_nthrs_cpt_init &&
+		    svcpt->scp_nthrs_running + svcpt->scp_nthrs_starting <=
+		    svcpt->scp_nthrs_limit - step &&
+		    (cold == NULL ||
+		     svcpt->scp_qdepth_avg < cold->scp_qdepth_avg))
+			cold = svcpt;
+
+		if (high == NULL ||
+		    svcpt->scp_nthrs_limit > high->scp_nthrs_limit)
+			high = svcpt;
+		if (low == NULL ||
+		    svcpt->scp_nthrs_limit < low->scp_nthrs_limit)
+			low = svcpt;
+	}
+
+	/* the hot partition has at least one request more waiting */
+	if (hot != NULL && cold != NULL && hot != cold &&
+	    hot->scp_qdepth_avg > 2 * cold->scp_qdepth_avg + (1 << 4)) {
+		high = cold;
+		low = hot;
+	} else if (hot == NULL && high->scp_nthrs_limit > limit &&
+		   low->scp_nthrs_limit < limit) {
+		step = min3(step, high->scp_nthrs_limit - limit,
+			    limit - low->scp_nthrs_limit);
+		if (high->scp_nthrs_running + high->scp_nthrs_starting >
+		    high->scp_nthrs_limit - step)
+			high = NULL;
+	} else {
+		high = NULL;
+	}
+
+	if (high != NULL) {
+		high->scp_nthrs_limit -= step;
+		low->scp_nthrs_limit += step;
+		CDEBUG(D_RPCTRACE,
+		       "%s: move %d threads from CPT %d (limit %d, queued %u/16) to CPT %d (limit %d, queued %u/16)\n",
+		       svc->srv_name, step, high->scp_cpt,
+		       high->scp_nthrs_limit, high->scp_qdepth_avg,
+		       low->scp_cpt, low->scp_nthrs_limit,
+		       low->scp_qdepth_avg);
+	}
+	spin_unlock(&svc->srv_lock);
+
+	/* let the extra threads of the donor exit */
+	if (high != NULL)
+		wake_up_all(&high->scp_waitq);
+}
+
 static inline int ptlrpc_rqbd_pending(struct ptlrpc_service_part *svcpt)
 {
 	return !list_empty(&svcpt->scp_rqbd_idle) &&
@@ -2716,6 +2841,7 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 
 	l_wait_event_exclusive_head(svcpt->scp_waitq,
 				ptlrpc_thread_stopping(thread) ||
+				ptlrpc_thread_should_stop(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
 				ptlrpc_rqbd_pending(svcpt) ||
@@ -2843,6 +2969,10 @@ static int ptlrpc_main(void *arg)
 
 		ptlrpc_check_rqbd_pool(svcpt);
 
+		if (svc->srv_ncpts > 1 && svc->srv_nthrs_rebalance != 0 &&
+		    ktime_get_seconds() >= svc->srv_rebalance_next)
+			ptlrpc_svc_rebalance(svc);
+
 		if (ptlrpc_threads_need_create(svcpt)) {
 			/* Ignore return code - we tried... */
 			ptlrpc_start_thread(svcpt, 0);
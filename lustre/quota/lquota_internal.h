@@ -147,6 +147,27 @@ struct lquota_slv_entry {
 
 	/* when latest edquot set */
 	time64_t		lse_edquot_time;
+
+	/* consumption rate, in inodes or kbytes per second */
+	__u64			lse_rate;
+
+	/* space consumed since lse_rate_time */
+	__u64			lse_rate_space;
+
+	/* start of the current rate sampling period */
+	ktime_t			lse_rate_time;
+
+	/* when the in-flight acquire request was sent */
+	ktime_t			lse_acq_start;
+
+	/* acquire round trip to the master, in microseconds: running
+	 * average and maximum */
+	__u64			lse_acq_lat;
+	__u64			lse_acq_lat_max;
+
+	/* number of acquire and pre-acquire requests completed */
+	unsigned int		lse_acq_count;
+	unsigned int		lse_preacq_count;
 };
 
 /* In-memory entry for each enforced quota id
@@ -227,6 +248,14 @@ struct lquota_site {
 #define lqe_lockh		u.se.lse_lockh
 #define lqe_acq_rc		u.se.lse_acq_rc
 #define lqe_acq_time		u.se.lse_acq_time
+#define lqe_rate		u.se.lse_rate
+#define lqe_rate_space		u.se.lse_rate_space
+#define lqe_rate_time		u.se.lse_rate_time
+#define lqe_acq_start		u.se.lse_acq_start
+#define lqe_acq_lat		u.se.lse_acq_lat
+#define lqe_acq_lat_max		u.se.lse_acq_lat_max
+#define lqe_acq_count		u.se.lse_acq_count
+#define lqe_preacq_count	u.se.lse_preacq_count
 #define lqe_edquot_time		u.se.lse_edquot_time
 
 #define LQUOTA_BUMP_VER 0x1
@@ -142,6 +142,80 @@ static int qsd_ready(struct lquota_entry *lqe, struct lustre_handle *lockh)
 	RETURN(0);
 }
 
+/* length of the consumption rate sampling period, in milliseconds */
+#define QSD_RATE_PERIOD_MS	1000
+
+/**
+ * Account \a space consumed by an operation in the consumption rate of
+ * \a lqe. The rate is a running average sampled every QSD_RATE_PERIOD_MS.
+ * Called with the lqe write lock held.
+ */
+static void qsd_rate_update(struct lquota_entry *lqe, __u64 space)
+{
+	ktime_t	now = ktime_get();
+	s64	elapsed;
+	__u64	sample;
+
+	lqe->lqe_rate_space += space;
+	if (ktime_to_ns(lqe->lqe_rate_time) == 0) {
+		lqe->lqe_rate_time = now;
+		return;
+	}
+
+	elapsed = ktime_ms_delta(now, lqe->lqe_rate_time);
+	if (elapsed < QSD_RATE_PERIOD_MS)
+		return;
+
+	sample = div_u64(lqe->lqe_rate_space * MSEC_PER_SEC, elapsed);
+	/* a long idle period restarts the average */
+	if (lqe->lqe_rate == 0 || elapsed > 4 * QSD_RATE_PERIOD_MS)
+		lqe->lqe_rate = sample;
+	else
+		lqe->lqe_rate = (lqe->lqe_rate * 3 + sample) / 4;
+	lqe->lqe_rate_space = 0;
+	lqe->lqe_rate_time = now;
+}
+
+/**
+ * Return how much spare quota space the slave should own before it stops
+ * pre-acquiring. The legacy threshold is qtune, but an ID consuming space
+ * quickly would run dry before the pre-acquire request comes back, so
+ * keep enough to cover two round trips to the master at the current
+ * consumption rate, bounded by qunit not to fight with the release logic.
+ */
+static __u64 qsd_preacq_margin(struct lquota_entry *lqe)
+{
+	__u64	margin = lqe->lqe_qtune;
+	__u64	need;
+
+	if (lqe->lqe_rate == 0 || lqe->lqe_acq_lat == 0)
+		return margin;
+
+	/* nothing consumed for a while, the rate is stale */
+	if (ktime_ms_delta(ktime_get(), lqe->lqe_rate_time) >
+	    4 * QSD_RATE_PERIOD_MS)
+		return margin;
+
+	need = div_u64(lqe->lqe_rate * lqe->lqe_acq_lat * 2, USEC_PER_SEC);
+	if (need > margin)
+		margin = min(need, lqe->lqe_qunit);
+
+	return margin;
+}
+
+/**
+ * Helper function returning true when quota space should be pre-acquired
+ * for \a lqe, given the current \a usage (including pending and waiting
+ * writes) and \a granted space.
+ */
+static inline bool qsd_preacq_needed(struct lquota_entry *lqe, __u64 usage,
+				     __u64 granted)
+{
+	return !lqe->lqe_edquot && !lqe->lqe_nopreacq && usage > 0 &&
+	       lqe->lqe_qunit != 0 &&
+	       granted < usage + qsd_preacq_margin(lqe);
+}
+
 /**
  * Check whether any quota space adjustment (pre-acquire/release/report) is
  * needed for a given quota ID. If a non-null \a qbody is passed, then the
@@ -264,8 +338,7 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 	}
 
 	/* 3. Time to pre-acquire? */
-	if (!lqe->lqe_edquot && !lqe->lqe_nopreacq && usage > 0 &&
-	    lqe->lqe_qunit != 0 && granted < usage + lqe->lqe_qtune) {
+	if (qsd_preacq_needed(lqe, usage, granted)) {
 		/* To pre-acquire quota space, we report how much spare quota
 		 * space the slave currently owns, then the master will grant us
 		 * back how much we can pretend given the current state of
@@ -295,6 +368,27 @@ static inline bool qsd_adjust_needed(struct lquota_entry *lqe)
 	return qsd_calc_adjust(lqe, NULL);
 }
 
+/**
+ * Account the round trip of the acquire or pre-acquire request which just
+ * completed for \a lqe. Called with the lqe write lock held.
+ */
+static void qsd_acq_stats_update(struct lquota_entry *lqe, __u32 flags)
+{
+	__u64 lat = ktime_us_delta(ktime_get(), lqe->lqe_acq_start);
+
+	if (lqe->lqe_acq_lat == 0)
+		lqe->lqe_acq_lat = lat;
+	else
+		lqe->lqe_acq_lat = (lqe->lqe_acq_lat * 7 + lat) / 8;
+	if (lat > lqe->lqe_acq_lat_max)
+		lqe->lqe_acq_lat_max = lat;
+
+	if (req_is_preacq(flags))
+		lqe->lqe_preacq_count++;
+	else
+		lqe->lqe_acq_count++;
+}
+
 /**
  * Callback function called when an acquire/release request sent to the master
  * is completed
@@ -399,6 +493,13 @@ static void qsd_req_completion(const struct lu_env *env,
 	if (req_is_preacq(reqbody->qb_flags) && ret == -EDQUOT)
 		lqe->lqe_nopreacq = true;
 out:
+	if (reqbody && ktime_to_ns(lqe->lqe_acq_start) != 0 &&
+	    (req_is_acq(reqbody->qb_flags) ||
+	     req_is_preacq(reqbody->qb_flags)) &&
+	    (ret == 0 || ret == -EDQUOT))
+		qsd_acq_stats_update(lqe, reqbody->qb_flags);
+	lqe->lqe_acq_start = ktime_set(0, 0);
+
 	adjust = qsd_adjust_needed(lqe);
 	if (reqbody && req_is_acq(reqbody->qb_flags) && ret != -EDQUOT) {
 		lqe->lqe_acq_rc = ret;
@@ -457,6 +558,7 @@ static int qsd_acquire_local(struct lquota_entry *lqe, __u64 space)
 		/* Yay! we got enough space */
 		lqe->lqe_pending_write += space;
 		lqe->lqe_waiting_write -= space;
+		qsd_rate_update(lqe, space);
 		rc = 0;
 	/* lqe_edquot flag is used to avoid flooding dqacq requests when
 	 * the user is over quota, however, the lqe_edquot could be stale
@@ -575,6 +677,7 @@ static int qsd_acquire_remote(const struct lu_env *env,
 		RETURN(rc);
 	}
 
+	lqe->lqe_acq_start = ktime_get();
 	lustre_handle_copy(&qti->qti_lockh, &lqe->lqe_lockh);
 	lqe_write_unlock(lqe);
 
@@ -743,7 +846,23 @@ static int qsd_op_begin0(const struct lu_env *env, struct qsd_qtype_info *qqi,
 			  &lwi);
 
 	if (rc == 0 && ret == 0) {
+		bool preacq;
+
 		qid->lqi_space += space;
+
+		/* kick off pre-acquire from the writeback thread now rather
+		 * than in qsd_op_end(), so that the new grant is back before
+		 * the following operations run out of space */
+		lqe_read_lock(lqe);
+		preacq = lustre_handle_is_used(&lqe->lqe_lockh) &&
+			 lqe->lqe_pending_req == 0 &&
+			 qsd_preacq_needed(lqe, lqe->lqe_usage +
+					   lqe->lqe_pending_write +
+					   lqe->lqe_waiting_write,
+					   lqe->lqe_granted);
+		lqe_read_unlock(lqe);
+		if (preacq)
+			qsd_adjust_schedule(lqe, false, false);
 	} else {
 		if (rc == 0)
 			rc = ret;
@@ -957,6 +1076,8 @@ int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
 
 	if (req_is_rel(qbody->qb_flags))
 		lqe->lqe_pending_rel = qbody->qb_count;
+	else
+		lqe->lqe_acq_start = ktime_get();
 	lustre_handle_copy(&qti->qti_lockh, &lqe->lqe_lockh);
 	lqe_write_unlock(lqe);
 
@@ -264,6 +264,52 @@ qsd_timeout_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(qsd_timeout);
 
+static int qsd_acquire_stats_iter_cb(struct cfs_hash *hs,
+				     struct cfs_hash_bd *bd,
+				     struct hlist_node *hnode, void *data)
+{
+	struct seq_file		*m = data;
+	struct lquota_entry	*lqe;
+	struct qsd_qtype_info	*qqi;
+
+	lqe = hlist_entry(hnode, struct lquota_entry, lqe_hash);
+	if (lqe->lqe_acq_count == 0 && lqe->lqe_preacq_count == 0)
+		return 0;
+
+	qqi = lqe->lqe_site->lqs_parent;
+	seq_printf(m, "- %s %llu: { rate: %llu, acquire: %u, "
+		   "preacquire: %u, latency_avg_us: %llu, "
+		   "latency_max_us: %llu }\n",
+		   qtype_name(qqi->qqi_qtype), lqe->lqe_id.qid_uid,
+		   lqe->lqe_rate, lqe->lqe_acq_count, lqe->lqe_preacq_count,
+		   lqe->lqe_acq_lat, lqe->lqe_acq_lat_max);
+	return 0;
+}
+
+/* per-ID consumption rate and acquire round trip to the master */
+static int qsd_acquire_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct qsd_instance	*qsd = m->private;
+	int			 qtype;
+
+	LASSERT(qsd != NULL);
+
+	seq_printf(m, "acquire_stats:\n");
+	if (!qsd->qsd_prepared)
+		return 0;
+
+	for (qtype = USRQUOTA; qtype < LL_MAXQUOTAS; qtype++) {
+		struct qsd_qtype_info *qqi = qsd->qsd_type_array[qtype];
+
+		if (qqi == NULL || qqi->qqi_site == NULL)
+			continue;
+		cfs_hash_for_each(qqi->qqi_site->lqs_hash,
+				  qsd_acquire_stats_iter_cb, m);
+	}
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(qsd_acquire_stats);
+
 static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	{ .name	=	"info",
 	  .fops	=	&qsd_state_fops		},
@@ -273,6 +319,8 @@ static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	  .fops	=	&qsd_force_reint_fops	},
 	{ .name	=	"timeout",
 	  .fops	=	&qsd_timeout_fops	},
+	{ .name	=	"acquire_stats",
+	  .fops	=	&qsd_acquire_stats_fops	},
 	{ NULL }
 };
 
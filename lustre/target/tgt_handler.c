@@ -185,6 +185,94 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/*
+ * An OBD_CONNECT2_MULTIOBJ_BRW write carries an obdo for each object but the
+ * first one, whose attributes come in the ost_body as usual. Those obdos are
+ * validated and ID-mapped here like the ost_body one.
+ */
+static int tgt_io_data_unpack_multi(struct tgt_session_info *tsi,
+				    struct obd_ioobj *ioo,
+				    struct niobuf_remote *rnb, int obj_count)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct lu_nodemap	*nodemap;
+	struct obdo		*oa;
+	int			 niocount = 0;
+	int			 i, j;
+	int			 rc = 0;
+
+	ENTRY;
+
+	if (!exp_connect_multiobj_brw(tsi->tsi_exp) ||
+	    lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) != OST_WRITE ||
+	    obj_count > PTLRPC_MAX_BRW_OBJS) {
+		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
+		       obj_count);
+		RETURN(-EPROTO);
+	}
+
+	if (!req_capsule_field_present(pill, &RMF_OBDO, RCL_CLIENT) ||
+	    req_capsule_get_size(pill, &RMF_OBDO, RCL_CLIENT) !=
+	    (obj_count - 1) * sizeof(*oa))
+		RETURN(-EPROTO);
+
+	oa = req_capsule_client_get(pill, &RMF_OBDO);
+	if (oa == NULL)
+		RETURN(-EPROTO);
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		RETURN(PTR_ERR(nodemap));
+
+	for (i = 0; i < obj_count; i++) {
+		if (i > 0) {
+			if (!(oa[i - 1].o_valid & OBD_MD_FLID))
+				GOTO(out, rc = -EPROTO);
+
+			rc = tgt_validate_obdo(tsi, &oa[i - 1]);
+			if (rc)
+				GOTO(out, rc);
+
+			oa[i - 1].o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
+							 NODEMAP_CLIENT_TO_FS,
+							 oa[i - 1].o_uid);
+			oa[i - 1].o_gid = nodemap_map_id(nodemap, NODEMAP_GID,
+							 NODEMAP_CLIENT_TO_FS,
+							 oa[i - 1].o_gid);
+			ioo[i].ioo_oid = oa[i - 1].o_oi;
+		}
+
+		if (ioo[i].ioo_bufcnt == 0 ||
+		    ioo[i].ioo_bufcnt > PTLRPC_MAX_BRW_PAGES - niocount) {
+			CERROR("%s: ioo %d has bad bufcnt %u\n",
+			       tgt_name(tsi->tsi_tgt), i, ioo[i].ioo_bufcnt);
+			GOTO(out, rc = -EPROTO);
+		}
+		niocount += ioo[i].ioo_bufcnt;
+
+		/* the same object twice would lock its pages twice */
+		for (j = 0; j < i; j++) {
+			if (lu_fid_eq(&ioo[j].ioo_oid.oi_fid,
+				      &ioo[i].ioo_oid.oi_fid))
+				GOTO(out, rc = -EPROTO);
+		}
+	}
+
+	if (niocount != req_capsule_get_size(pill, &RMF_NIOBUF_REMOTE,
+					     RCL_CLIENT) / sizeof(*rnb))
+		GOTO(out, rc = -EPROTO);
+
+	/* server-side locking is done for a single object only */
+	for (i = 0; i < niocount; i++) {
+		if (rnb[i].rnb_flags & OBD_BRW_SRVLOCK)
+			GOTO(out, rc = -EPROTO);
+	}
+	EXIT;
+out:
+	nodemap_putref(nodemap);
+	return rc;
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
@@ -218,9 +306,10 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
 	} else if (obj_count > 1) {
-		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
-		       obj_count);
-		RETURN(-EPROTO);
+		int rc = tgt_io_data_unpack_multi(tsi, ioo, rnb, obj_count);
+
+		if (rc < 0)
+			RETURN(rc);
 	}
 
 	if (ioo->ioo_bufcnt == 0) {
@@ -446,6 +535,28 @@ static int tgt_handle_request0(struct tgt_session_info *tsi,
 					 remote_nb[0].rnb_len : 0);
 		}
 
+		/* result of each object of a batched OST_DESTROY */
+		if (req_capsule_has_field(tsi->tsi_pill, &RMF_RCS,
+					  RCL_SERVER)) {
+			int nr = 0;
+
+			if (req_capsule_has_field(tsi->tsi_pill, &RMF_OST_IDS,
+						  RCL_CLIENT) &&
+			    req_capsule_field_present(tsi->tsi_pill,
+						      &RMF_OST_IDS, RCL_CLIENT))
+				nr = req_capsule_get_size(tsi->tsi_pill,
+							  &RMF_OST_IDS,
+							  RCL_CLIENT) /
+				     sizeof(struct ost_id);
+			/* a bad count is refused by the handler */
+			if (nr >= PTLRPC_MAX_DESTROY_OBJS)
+				nr = 0;
+			req_capsule_set_size(tsi->tsi_pill, &RMF_RCS,
+					     RCL_SERVER,
+					     nr > 0 ? (nr + 1) * sizeof(__u32) :
+					     0);
+		}
+
 		rc = req_capsule_server_pack(tsi->tsi_pill);
 	}
 
@@ -2466,6 +2577,141 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+static inline struct obdo *tgt_brw_obj_oa(struct obdo *oa, struct obdo *oas,
+					  int idx)
+{
+	return idx == 0 ? oa : &oas[idx - 1];
+}
+
+/* number of pages covered by the remote buffers of one object */
+static int tgt_brw_obj_pages(struct obd_ioobj *ioo, struct niobuf_remote *rnb)
+{
+	int npages = 0;
+	int i;
+
+	for (i = 0; i < ioo->ioo_bufcnt; i++)
+		npages += ((rnb[i].rnb_offset + rnb[i].rnb_len - 1) >>
+			   PAGE_SHIFT) - (rnb[i].rnb_offset >> PAGE_SHIFT) + 1;
+
+	return npages;
+}
+
+/*
+ * Prepare the local buffers of all objects of a BRW write.
+ *
+ * The objects of a multi-object write are prepared in FID order, so that two
+ * such writes sharing some objects can't deadlock on them, while their local
+ * buffers are kept in the order of the remote ones, since both the bulk and
+ * the checksum cover them in that order.
+ */
+static int tgt_brw_preprw(const struct lu_env *env, struct obd_export *exp,
+			  struct tgt_thread_big_cache *tbc, struct obdo *oa,
+			  struct obdo *oas, int objcount, struct obd_ioobj *ioo,
+			  struct niobuf_remote *rnb, int *npages)
+{
+	int i, j, k, nr;
+	int rc = 0;
+
+	ENTRY;
+
+	if (objcount == 1) {
+		*npages = PTLRPC_MAX_BRW_PAGES;
+		rc = obd_preprw(env, OBD_BRW_WRITE, exp, oa, 1, ioo, rnb,
+				npages, tbc->local);
+		RETURN(rc);
+	}
+
+	for (i = 0, j = 0, *npages = 0; i < objcount; i++) {
+		tbc->obj_rnb[i] = j;
+		tbc->obj_lnb[i] = *npages;
+		tbc->obj_npages[i] = 0;
+		*npages += tgt_brw_obj_pages(&ioo[i], rnb + j);
+		j += ioo[i].ioo_bufcnt;
+
+		for (k = i; k > 0 &&
+		     lu_fid_cmp(&ioo[tbc->obj_order[k - 1]].ioo_oid.oi_fid,
+				&ioo[i].ioo_oid.oi_fid) > 0; k--)
+			tbc->obj_order[k] = tbc->obj_order[k - 1];
+		tbc->obj_order[k] = i;
+	}
+	if (*npages > PTLRPC_MAX_BRW_PAGES)
+		RETURN(-EPROTO);
+
+	for (k = 0; k < objcount; k++) {
+		i = tbc->obj_order[k];
+		nr = (i + 1 < objcount ? tbc->obj_lnb[i + 1] : *npages) -
+		     tbc->obj_lnb[i];
+		rc = obd_preprw(env, OBD_BRW_WRITE, exp,
+				tgt_brw_obj_oa(oa, oas, i), 1, &ioo[i],
+				rnb + tbc->obj_rnb[i], &nr,
+				tbc->local + tbc->obj_lnb[i]);
+		if (rc < 0)
+			break;
+		tbc->obj_npages[i] = nr;
+	}
+
+	if (rc < 0) {
+		/* release the objects prepared so far */
+		while (k-- > 0) {
+			i = tbc->obj_order[k];
+			obd_commitrw(env, OBD_BRW_WRITE, exp,
+				     tgt_brw_obj_oa(oa, oas, i), 1, &ioo[i],
+				     rnb + tbc->obj_rnb[i], tbc->obj_npages[i],
+				     tbc->local + tbc->obj_lnb[i], rc);
+		}
+		RETURN(rc);
+	}
+
+	/* close the holes left if the OSD needed fewer buffers than pages */
+	for (i = 0, *npages = 0; i < objcount; i++) {
+		if (tbc->obj_lnb[i] != *npages) {
+			memmove(tbc->local + *npages,
+				tbc->local + tbc->obj_lnb[i],
+				tbc->obj_npages[i] * sizeof(tbc->local[0]));
+			tbc->obj_lnb[i] = *npages;
+		}
+		*npages += tbc->obj_npages[i];
+	}
+
+	RETURN(0);
+}
+
+/*
+ * Commit the local buffers of all objects of a BRW write. The attributes and
+ * the over-quota flags of each object are returned into its own obdo, which
+ * tgt_brw_write() copies to the reply.
+ */
+static int tgt_brw_commitrw(const struct lu_env *env, struct obd_export *exp,
+			    struct tgt_thread_big_cache *tbc, struct obdo *oa,
+			    struct obdo *oas, int objcount,
+			    struct obd_ioobj *ioo, struct niobuf_remote *rnb,
+			    int npages, int old_rc)
+{
+	int i, k;
+	int rc = 0;
+	int rc2;
+
+	ENTRY;
+
+	if (objcount == 1) {
+		rc = obd_commitrw(env, OBD_BRW_WRITE, exp, oa, 1, ioo, rnb,
+				  npages, tbc->local, old_rc);
+		RETURN(rc);
+	}
+
+	for (k = 0; k < objcount; k++) {
+		i = tbc->obj_order[k];
+		rc2 = obd_commitrw(env, OBD_BRW_WRITE, exp,
+				   tgt_brw_obj_oa(oa, oas, i), 1, &ioo[i],
+				   rnb + tbc->obj_rnb[i], tbc->obj_npages[i],
+				   tbc->local + tbc->obj_lnb[i], old_rc);
+		if (rc2 != 0 && (rc == 0 || rc2 == -ENOTCONN))
+			rc = rc2;
+	}
+
+	RETURN(rc);
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2475,6 +2721,7 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct niobuf_local	*local_nb;
 	struct obd_ioobj	*ioo;
 	struct ost_body		*body, *repbody;
+	struct obdo		*oas = NULL;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
 	int			 objcount, niocount, npages;
@@ -2540,12 +2787,18 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 			sizeof(*remote_nb))
 		RETURN(err_serious(-EPROTO));
 
+	/* validated by tgt_io_data_unpack_multi() */
+	if (objcount > 1)
+		oas = req_capsule_client_get(&req->rq_pill, &RMF_OBDO);
+
 	if ((remote_nb[0].rnb_flags & OBD_BRW_MEMALLOC) &&
 	    ptlrpc_connection_is_local(exp->exp_connection))
 		memory_pressure_set();
 
 	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
 			     niocount * sizeof(*rcs));
+	req_capsule_set_size(&req->rq_pill, &RMF_OBDO, RCL_SERVER,
+			     (objcount - 1) * sizeof(*oas));
 	rc = req_capsule_server_pack(&req->rq_pill);
 	if (rc != 0)
 		GOTO(out, rc = err_serious(rc));
@@ -2588,9 +2841,8 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
-	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb);
+	rc = tgt_brw_preprw(tsi->tsi_env, exp, tbc, &repbody->oa, oas,
+			    objcount, ioo, remote_nb, &npages);
 	if (rc < 0)
 		GOTO(out_lock, rc);
 	if (body->oa.o_flags & OBD_FL_SHORT_IO) {
@@ -2672,8 +2924,8 @@ skip_transfer:
 
 out_commitrw:
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, rc);
+	rc = tgt_brw_commitrw(tsi->tsi_env, exp, tbc, &repbody->oa, oas,
+			      objcount, ioo, remote_nb, npages, rc);
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2693,6 +2945,17 @@ out_commitrw:
 	 */
 	repbody->oa.o_valid &= ~(OBD_MD_FLMTIME | OBD_MD_FLATIME);
 
+	/* the other objects' attributes and over-quota flags, in ioo order */
+	if (objcount > 1) {
+		struct obdo *repoas;
+
+		repoas = req_capsule_server_get(&req->rq_pill, &RMF_OBDO);
+		for (i = 0; i < objcount - 1; i++) {
+			repoas[i] = oas[i];
+			repoas[i].o_valid &= ~(OBD_MD_FLMTIME | OBD_MD_FLATIME);
+		}
+	}
+
 	if (rc == 0) {
 		int nob = 0;
 
@@ -70,42 +70,104 @@ static int tgt_bitmap_chunk_alloc(struct lu_target *lut, int chunk)
 	return 0;
 }
 
-/* Look for an available reply data slot in the bitmap
- * of the target @lut
+/* Look for an available reply data slot in the bitmap of the target @lut,
+ * starting at slot @start and wrapping around to slot 0
  * Allocate bitmap chunk when first used
- * XXX algo could be improved if this routine limits performance
  */
-static int tgt_find_free_reply_slot(struct lu_target *lut)
+static int tgt_find_free_reply_slot_from(struct lu_target *lut, int start)
 {
+	const int total = LUT_REPLY_SLOTS_MAX_CHUNKS *
+			  LUT_REPLY_SLOTS_PER_CHUNK;
 	unsigned long *bmp;
-	int chunk = 0;
+	int from, to;
+	int pass;
+	int chunk;
+	int end;
 	int rc;
 	int b;
 
-	for (chunk = 0; chunk < LUT_REPLY_SLOTS_MAX_CHUNKS; chunk++) {
-		/* allocate the bitmap chunk if necessary */
-		if (unlikely(lut->lut_reply_bitmap[chunk] == NULL)) {
-			rc = tgt_bitmap_chunk_alloc(lut, chunk);
-			if (rc != 0)
-				return rc;
+	for (pass = 0; pass < 2; pass++) {
+		from = pass == 0 ? start : 0;
+		to = pass == 0 ? total : start;
+		for (chunk = from / LUT_REPLY_SLOTS_PER_CHUNK;
+		     chunk * LUT_REPLY_SLOTS_PER_CHUNK < to; chunk++) {
+			/* allocate the bitmap chunk if necessary */
+			if (unlikely(lut->lut_reply_bitmap[chunk] == NULL)) {
+				rc = tgt_bitmap_chunk_alloc(lut, chunk);
+				if (rc != 0)
+					return rc;
+			}
+			bmp = lut->lut_reply_bitmap[chunk];
+
+			b = max(from - chunk * LUT_REPLY_SLOTS_PER_CHUNK, 0);
+			end = min(to - chunk * LUT_REPLY_SLOTS_PER_CHUNK,
+				  LUT_REPLY_SLOTS_PER_CHUNK);
+
+			/* look for an available slot in this chunk */
+			do {
+				b = find_next_zero_bit(bmp, end, b);
+				if (b >= end)
+					break;
+
+				/* found one */
+				if (test_and_set_bit(b, bmp) == 0)
+					return chunk * LUT_REPLY_SLOTS_PER_CHUNK
+					       + b;
+			} while (true);
 		}
-		bmp = lut->lut_reply_bitmap[chunk];
-
-		/* look for an available slot in this chunk */
-		do {
-			b = find_first_zero_bit(bmp, LUT_REPLY_SLOTS_PER_CHUNK);
-			if (b >= LUT_REPLY_SLOTS_PER_CHUNK)
-				break;
-
-			/* found one */
-			if (test_and_set_bit(b, bmp) == 0)
-				return chunk * LUT_REPLY_SLOTS_PER_CHUNK + b;
-		} while (true);
 	}
 
 	return -ENOSPC;
 }
 
+/* Lower the bitmap search cursor of the target @lut to the released
+ * slot @idx, this keeps the reply_data file compact
+ */
+static void tgt_reply_slot_lower(struct lu_target *lut, int idx)
+{
+	int next = atomic_read(&lut->lut_reply_next);
+	int old;
+
+	while (idx < next) {
+		old = atomic_cmpxchg(&lut->lut_reply_next, next, idx);
+		if (old == next)
+			break;
+		next = old;
+	}
+}
+
+/* Get an available reply data slot for the target @lut
+ * Use the slots released on the current CPT first, then search the bitmap
+ * from the lowest slot which may be free
+ */
+static int tgt_find_free_reply_slot(struct lu_target *lut)
+{
+	struct tgt_reply_slot_cache *rsc;
+	int start;
+	int idx;
+
+	if (lut->lut_reply_slot_cache != NULL) {
+		rsc = lut->lut_reply_slot_cache[cfs_cpt_current(cfs_cpt_table,
+								0)];
+		spin_lock(&rsc->rsc_lock);
+		if (rsc->rsc_count > 0) {
+			idx = rsc->rsc_slots[--rsc->rsc_count];
+			spin_unlock(&rsc->rsc_lock);
+			return idx;
+		}
+		spin_unlock(&rsc->rsc_lock);
+	}
+
+	start = atomic_read(&lut->lut_reply_next);
+	idx = tgt_find_free_reply_slot_from(lut, start);
+	/* all the slots in [start, idx] are used now, unless one of them
+	 * was released meanwhile and moved the cursor */
+	if (idx >= start)
+		atomic_cmpxchg(&lut->lut_reply_next, start, idx + 1);
+
+	return idx;
+}
+
 /* Mark the reply data slot @idx 'used' in the corresponding bitmap chunk
  * of the target @lut
  * Allocate the bitmap chunk if necessary
@@ -161,6 +223,21 @@ static int tgt_clear_reply_slot(struct lu_target *lut, int idx)
 	LASSERT(chunk < LUT_REPLY_SLOTS_MAX_CHUNKS);
 	LASSERT(b < LUT_REPLY_SLOTS_PER_CHUNK);
 
+	if (lut->lut_reply_slot_cache != NULL) {
+		struct tgt_reply_slot_cache *rsc;
+
+		rsc = lut->lut_reply_slot_cache[cfs_cpt_current(cfs_cpt_table,
+								0)];
+		spin_lock(&rsc->rsc_lock);
+		if (rsc->rsc_count < LUT_REPLY_SLOTS_CACHE) {
+			/* keep the slot for this CPT, the bit stays set */
+			rsc->rsc_slots[rsc->rsc_count++] = idx;
+			spin_unlock(&rsc->rsc_lock);
+			return 0;
+		}
+		spin_unlock(&rsc->rsc_lock);
+	}
+
 	if (lut->lut_reply_bitmap[chunk] == NULL) {
 		CERROR("%s: slot %d not allocated\n",
 		       tgt_name(lut), idx);
@@ -172,6 +249,7 @@ static int tgt_clear_reply_slot(struct lu_target *lut, int idx)
 		       tgt_name(lut), idx);
 		return -EALREADY;
 	}
+	tgt_reply_slot_lower(lut, idx);
 
 	return 0;
 }
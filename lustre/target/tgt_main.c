@@ -402,6 +402,7 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	atomic_set(&lut->lut_client_generation, 0);
 	lut->lut_reply_data = NULL;
 	lut->lut_reply_bitmap = NULL;
+	lut->lut_reply_slot_cache = NULL;
 	obd->u.obt.obt_lut = lut;
 	obd->u.obt.obt_magic = OBT_MAGIC;
 
@@ -507,6 +508,17 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	if (lut->lut_reply_bitmap == NULL)
 		GOTO(out, rc = -ENOMEM);
 
+	lut->lut_reply_slot_cache = cfs_percpt_alloc(cfs_cpt_table,
+					sizeof(*lut->lut_reply_slot_cache[0]));
+	if (lut->lut_reply_slot_cache != NULL) {
+		struct tgt_reply_slot_cache *rsc;
+
+		cfs_percpt_for_each(rsc, i, lut->lut_reply_slot_cache)
+			spin_lock_init(&rsc->rsc_lock);
+	}
+	/* else slots are always searched in the bitmap */
+	atomic_set(&lut->lut_reply_next, 0);
+
 	memset(&attr, 0, sizeof(attr));
 	attr.la_valid = LA_MODE;
 	attr.la_mode = S_IFREG | S_IRUGO | S_IWUSR;
@@ -544,6 +556,10 @@ out_put:
 	if (lut->lut_reply_data != NULL)
 		dt_object_put(env, lut->lut_reply_data);
 	lut->lut_reply_data = NULL;
+	if (lut->lut_reply_slot_cache != NULL) {
+		cfs_percpt_free(lut->lut_reply_slot_cache);
+		lut->lut_reply_slot_cache = NULL;
+	}
 	if (lut->lut_reply_bitmap != NULL) {
 		for (i = 0; i < LUT_REPLY_SLOTS_MAX_CHUNKS; i++) {
 			if (lut->lut_reply_bitmap[i] != NULL)
@@ -583,6 +599,10 @@ void tgt_fini(const struct lu_env *env, struct lu_target *lut)
 	if (lut->lut_reply_data != NULL)
 		dt_object_put(env, lut->lut_reply_data);
 	lut->lut_reply_data = NULL;
+	if (lut->lut_reply_slot_cache != NULL) {
+		cfs_percpt_free(lut->lut_reply_slot_cache);
+		lut->lut_reply_slot_cache = NULL;
+	}
 	if (lut->lut_reply_bitmap != NULL) {
 		for (i = 0; i < LUT_REPLY_SLOTS_MAX_CHUNKS; i++) {
 			if (lut->lut_reply_bitmap[i] != NULL)
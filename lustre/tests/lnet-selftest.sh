@@ -189,6 +189,59 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+# sum the $1 column of the lst_t rows of workitem_stats
+wi_stats_sum () {
+	local field=$1
+
+	$LCTL get_param -n workitem_stats | awk -v f=$field '
+		NR == 1 { for (i = 1; i <= NF; i++) if ($i == f) col = i; next }
+		$1 == "lst_t" { sum += $col }
+		END { print sum + 0 }'
+}
+
+test_workitem () {
+	local ncpts=$($LCTL get_param -n cpu_partition_table 2>/dev/null |
+		      wc -l)
+
+	[ $ncpts -ge 2 ] || skip_env "needs at least 2 CPU partitions"
+
+	lst_prepare
+	$LCTL get_param -n workitem_stats > /dev/null 2>&1 ||
+		{ lst_cleanup_all; skip "no workitem_stats"; }
+
+	local nid=$($LCTL list_nids | head -n1)
+	local stolen=$(wi_stats_sum stolen)
+	local remote=$(wi_stats_sum remote)
+
+	# all the test workitems of a single peer are scheduled on the CPT
+	# of its NID, the lst_t threads of the other CPTs have to steal them
+	export LST_SESSION=$$
+	$LST new_session --timeo 100000 wi || error "new_session failed"
+	$LST add_group c $nid || error "add_group c failed"
+	$LST add_group s $nid || error "add_group s failed"
+	$LST add_batch b || error "add_batch failed"
+	$LST add_test --batch b --loop 10000000 --concurrency 64 \
+		--from c --to s brw write check=full size=1M ||
+		error "add_test failed"
+	$LST run b || error "run batch failed"
+	sleep 20
+
+	$LCTL get_param -n workitem_stats
+	stolen=$(($(wi_stats_sum stolen) - stolen))
+	remote=$(($(wi_stats_sum remote) - remote))
+	echo "lst_t workitems stolen: $stolen, from another CPT: $remote"
+
+	# destroy the schedulers with the batch still running
+	rmmod lnet_selftest || error "unload with workitems in flight failed"
+	lsmod | grep -q lnet_selftest && error "lnet_selftest still loaded"
+	lst_cleanup_all
+
+	((remote > 0)) || error "no lst_t workitem run on another CPT"
+	((stolen >= remote)) ||
+		error "stolen $stolen less than stolen from other CPTs $remote"
+}
+run_test workitem "lst load is shared by the workitem threads of all CPTs"
+
 complete $SECONDS
 _restore_mount
 check_and_cleanup_lustre
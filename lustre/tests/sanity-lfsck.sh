@@ -5761,6 +5761,48 @@ test_39()
 }
 run_test 39 "LFSCK does not break foreign dir and reverse is also true"
 
+test_40() {
+	echo "#####"
+	echo "The layout LFSCK with several assistant threads should find"
+	echo "out and repair all the dangling references as one thread does."
+	echo "#####"
+
+	check_mount_and_prep
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+
+	local saved=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      mdd.${MDT_DEV}.lfsck_assistant_threads)
+	do_facet $SINGLEMDS $LCTL set_param -n \
+		mdd.${MDT_DEV}.lfsck_assistant_threads=4 ||
+		error "(0) Fail to set lfsck_assistant_threads"
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param -n \
+		mdd.${MDT_DEV}.lfsck_assistant_threads=$saved" EXIT
+
+	echo "Inject failure stub to simulate dangling referenced MDT-object"
+	#define OBD_FAIL_LFSCK_DANGLING	0x1610
+	do_facet ost1 $LCTL set_param fail_loc=0x1610
+	local count=$(precreated_ost_obj_count 0 0)
+
+	createmany -o $DIR/$tdir/f $((count + 63))
+	do_facet ost1 $LCTL set_param fail_loc=0
+
+	# exhaust other pre-created dangling cases
+	count=$(precreated_ost_obj_count 0 0)
+	createmany -o $DIR/$tdir/a $count ||
+		error "(1) Fail to create $count files."
+
+	echo "Trigger layout LFSCK to find out dangling reference"
+	$START_LAYOUT -r -o -d || error "(2) Fail to start LFSCK for layout!"
+
+	wait_all_targets_blocked layout completed 3
+
+	local repaired=$($SHOW_LAYOUT |
+			 awk '/^repaired_dangling/ { print $2 }')
+	[ $repaired -ge 64 ] ||
+		error "(4) Fail to repair dangling reference: $repaired"
+}
+run_test 40 "layout LFSCK with parallel assistant threads"
+
 # restore MDS/OST size
 MDSSIZE=${SAVED_MDSSIZE}
 OSTSIZE=${SAVED_OSTSIZE}
@@ -1273,6 +1273,39 @@ test_16() {
 }
 run_test 16 "Test detach with different options"
 
+test_17() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tfile
+	local cmd
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	do_facet $SINGLEAGT mkdir -p $hsm_root ||
+		error "mkdir $hsm_root failed"
+	setup_pcc_mapping $SINGLEAGT \
+		"fname={$tfile}\ roid=$HSM_ARCHIVE_NUMBER\ ropcc=1"
+
+	$LFS mirror create -N2 $file || error "create mirrored $file failed"
+	echo -n ropcc_data > $file || error "write $file failed"
+	$LFS mirror resync $file || error "resync $file failed"
+	cancel_lru_locks mdc
+
+	# The first read-only open queues the fill into the PCC backend
+	check_file_data $SINGLEAGT $file "ropcc_data"
+	cmd="$LFS pcc state $file | awk -F 'type: ' '{print \$2}' |
+		awk -F ',' '{print \$1}'"
+	wait_update_facet $SINGLEAGT "$cmd" "readonly" 20 ||
+		error "$file is not filled into RO-PCC"
+	check_file_data $SINGLEAGT $file "ropcc_data"
+
+	# Write from another mount revokes the layout lock of RO-PCC copy
+	echo -n ropcc_new > $DIR2/$tfile || error "write $DIR2/$tfile failed"
+	check_lpcc_state $file "none"
+	check_file_data $SINGLEAGT $file "ropcc_new"
+}
+run_test 17 "Test RO-PCC asynchronous fill and invalidation by layout lock"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
@@ -3463,6 +3463,34 @@ test_65() {
 }
 run_test 65 "Check lfs quota result"
 
+test_66() {
+	local LIMIT=1024 # 1G
+	local TESTFILE="$DIR/$tdir/$tfile-0"
+	local stats
+
+	setup_quota_test || error "setup quota failed with $?"
+	set_ost_qtype $QTYPE || error "enable ost quota failed"
+	quota_init
+
+	$LFS setquota -u $TSTUSR -b 0 -B ${LIMIT}M -i 0 -I 0 $DIR ||
+		error "set quota failed"
+	$LFS setstripe $TESTFILE -c 1 -i 0 || error "setstripe $TESTFILE failed"
+	chown $TSTUSR.$TSTUSR $TESTFILE || error "chown $TESTFILE failed"
+
+	$RUNAS $DD of=$TESTFILE count=64 oflag=sync ||
+		error "write $TESTFILE failure, expect success"
+
+	stats=$(do_facet ost1 $LCTL get_param -n \
+		osd-*.$FSNAME-OST0000.quota_slave.acquire_stats)
+	echo "$stats"
+	echo "$stats" | grep -q "usr $TSTID:.*acquire:" ||
+		error "no acquire stats for $TSTUSR"
+
+	rm -f $TESTFILE
+	cleanup_quota_test
+}
+run_test 66 "quota slave reports per-ID acquire stats"
+
 quota_fini()
 {
 	do_nodes $(comma_list $(nodes_list)) "lctl set_param debug=-quota"
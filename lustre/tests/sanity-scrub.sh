@@ -1273,6 +1273,69 @@ test_16() {
 }
 run_test 16 "Initial OI scrub can rebuild crashed index objects"
 
+test_17() {
+	[ $(facet_fstype $SINGLEMDS) != "ldiskfs" ] &&
+		skip "ldiskfs special test" && return
+
+	local saved=$(do_facet mds1 $LCTL get_param -n \
+		      osd-*.$(facet_svc mds1).scrub_threads)
+
+	scrub_prep 500 1
+	echo "starting MDTs with OI scrub disabled"
+	scrub_start_mds 2 "$MOUNT_OPTS_NOSCRUB"
+	scrub_check_flags 3 recreated,inconsistent
+
+	do_nodes $(comma_list $(mdts_nodes)) \
+		$LCTL set_param -n osd-*.*.scrub_threads=4 ||
+		error "(4) Fail to set scrub_threads"
+	stack_trap "do_nodes $(comma_list $(mdts_nodes)) \
+		$LCTL set_param -n osd-*.*.scrub_threads=$saved" EXIT
+
+	scrub_start 5
+	scrub_check_status 6 completed
+	scrub_check_flags 7 ""
+	scrub_check_repaired 8 500 0
+
+	mount_client $MOUNT || error "(9) Fail to start client!"
+	scrub_check_data 10
+}
+run_test 17 "OI scrub with several scanning threads"
+
+test_18() {
+	[ $(facet_fstype $SINGLEMDS) != "ldiskfs" ] &&
+		skip "ldiskfs special test" && return
+
+	local mdt=$(facet_svc mds1)
+	local hits
+
+	scrub_prep 200
+	echo "starting MDTs with OI scrub disabled"
+	scrub_start_mds 1 "$MOUNT_OPTS_NOSCRUB"
+	mount_client $MOUNT || error "(2) Fail to start client!"
+
+	do_facet mds1 $LCTL set_param -n osd-*.$mdt.stats=clear
+	ls -l $DIR/$tdir/mds1 > /dev/null || error "(3) Fail to ls"
+	hits=$(do_facet mds1 $LCTL get_param -n osd-*.$mdt.stats |
+	       awk '/^oi_cache_hit/ { print $2 }')
+	echo "OI cache hits after readdir: ${hits:-0}"
+	[ ${hits:-0} -gt 0 ] || error "(4) OI cache is not used"
+
+	do_facet mds1 $LCTL set_param -n osd-*.$mdt.oi_cache_max=0 ||
+		error "(5) Fail to disable OI cache"
+	stack_trap "do_facet mds1 $LCTL set_param -n \
+		osd-*.$mdt.oi_cache_max=262144" EXIT
+
+	cancel_lru_locks mdc
+	do_facet mds1 $LCTL set_param -n osd-*.$mdt.stats=clear
+	ls -l $DIR/$tdir/mds1 > /dev/null || error "(6) Fail to ls"
+	hits=$(do_facet mds1 $LCTL get_param -n osd-*.$mdt.stats |
+	       awk '/^oi_cache_hit/ { print $2 }')
+	[ ${hits:-0} -eq 0 ] || error "(7) OI cache is used after disabled"
+
+	scrub_check_data 8
+}
+run_test 18 "OI lookups are served from the OI cache after readdir"
+
 # restore MDS/OST size
 MDSSIZE=${SAVED_MDSSIZE}
 OSTSIZE=${SAVED_OSTSIZE}
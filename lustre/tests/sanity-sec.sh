@@ -2592,6 +2592,47 @@ test_34() {
 }
 run_test 34 "deny_unknown on default nodemap"
 
+test_35() {
+	local upcall=$(do_facet $SINGLEMDS $LCTL get_param -n $IDENTITY_UPCALL)
+	local param=mdt.$MDT.identity
+
+	[ "$upcall" != "NONE" ] || skip "identity upcall is disabled"
+	[ -n "$(do_facet $SINGLEMDS $LCTL get_param -n \
+		${param}_stale_expire 2>/dev/null)" ] ||
+		skip "no identity_stale_expire on MDS"
+
+	local expire=$(do_facet $SINGLEMDS $LCTL get_param -n ${param}_expire)
+	local stale=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		      ${param}_stale_expire)
+	local inflight=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			 ${param}_inflight_max)
+
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param -n \
+		    ${param}_expire=$expire ${param}_stale_expire=$stale \
+		    ${param}_inflight_max=$inflight $IDENTITY_FLUSH=-1" EXIT
+	# one upcall at a time, the others wait in the refresh queue
+	do_facet $SINGLEMDS $LCTL set_param -n ${param}_expire=1 \
+		${param}_stale_expire=60 ${param}_inflight_max=1 \
+		$IDENTITY_FLUSH=-1
+
+	do_facet $SINGLEMDS $LCTL set_param -n ${param}_warm="[$ID0,$ID1]" ||
+		error "warm identities of $ID0 and $ID1 failed"
+	do_facet $SINGLEMDS $LCTL set_param -n ${param}_warm="[abc]" &&
+		error "warm with bad uid list should fail"
+
+	mkdir -p $DIR/$tdir
+	chmod 0777 $DIR/$tdir
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f0 || error "touch (1)"
+	sleep 2
+	# expired identities are used while they are refreshed
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f1 || error "touch (2)"
+	$RUNAS_CMD -u $ID1 touch $DIR/$tdir/f2 || error "touch (3)"
+	sleep 2
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f3 || error "touch (4)"
+	rm -rf $DIR/$tdir
+}
+run_test 35 "expired identities are refreshed in the background"
+
 log "cleanup: ======================================================"
 
 sec_unsetup() {
@@ -2961,6 +2961,57 @@ test_27N() {
 }
 run_test 27N "lctl pool_list on separate MGS gives correct pool name"
 
+test_27O() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local osp=$FSNAME-OST0000-osc-MDT0000
+	local nr=200
+	local before
+	local after
+	local rpcs
+	local i
+
+	do_facet mds1 $LCTL get_param -n osp.$osp.import |
+		grep -q batch_destroy || skip "no batched destroy support"
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/$tfile $nr || error "create failed"
+	wait_delete_completed
+
+	before=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		 awk '/^ost_destroy/ { print $2 }')
+	unlinkmany $DIR/$tdir/$tfile $nr || error "unlink failed"
+	wait_delete_completed
+	after=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		awk '/^ost_destroy/ { print $2 }')
+
+	rpcs=$((${after:-0} - ${before:-0}))
+	echo "$rpcs OST_DESTROY RPCs for $nr objects"
+	(( rpcs > 0 && rpcs < nr / 2 )) ||
+		error "$rpcs OST_DESTROY RPCs for $nr objects"
+
+	# a batch which can't be sent is retried, not left until next boot
+	createmany -o $DIR/$tdir/$tfile $nr || error "create failed"
+	sync
+	sleep 2
+	before=$($LFS df -i $MOUNT | awk '/OST0000/ { print $3 }')
+	#define OBD_FAIL_OSP_CHECK_ENOMEM	0x2101
+	do_facet mds1 $LCTL set_param fail_loc=0x80002101
+	unlinkmany $DIR/$tdir/$tfile $nr || error "unlink failed"
+	wait_delete_completed
+	do_facet mds1 $LCTL set_param fail_loc=0
+	for i in {1..20}; do
+		sleep 1
+		after=$($LFS df -i $MOUNT | awk '/OST0000/ { print $3 }')
+		(( before - after >= nr )) && break
+	done
+	(( before - after >= nr )) ||
+		error "only $((before - after)) of $nr objects destroyed"
+}
+run_test 27O "destroy of several OST objects in one RPC"
+
 # createtest also checks that device nodes are created and
 # then visible correctly (#2091)
 test_28() { # bug 2091
@@ -4710,6 +4761,70 @@ test_42e() { # bug22074
 }
 run_test 42e "verify sub-RPC writes are not done synchronously"
 
+test_42f_write_rpcs() {
+	local osc=$1
+
+	$LCTL get_param -n $osc.rpc_stats |
+		sed -n '/pages per rpc/,/^$/p' |
+		awk '/^[0-9]+:/ { writes += $6 }; END { print writes }'
+}
+
+test_42f() {
+	local osc=osc.$(get_osc_import_name client ost1)
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local nfiles=64
+	local rpcs
+	local i
+
+	[[ $($LCTL get_param $osc.import) =~ connect_flags.*multiobj_brw ]] ||
+		skip "OST does not support multi-object BRW"
+
+	save_lustre_params client "$osc.max_objs_per_rpc" > $p
+	stack_trap "restore_lustre_params < $p; rm -f $p" EXIT
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=16k count=1 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+
+	# one RPC per file without batching
+	$LCTL set_param $osc.max_objs_per_rpc=1
+	$LCTL set_param -n $osc.rpc_stats=0
+	for i in $(seq $nfiles); do
+		cp $TMP/$tfile $DIR/$tdir/f1.$i || error "cp f1.$i failed"
+	done
+	sync
+	rpcs=$(test_42f_write_rpcs $osc)
+	(( rpcs == nfiles )) || error "$rpcs write RPCs for $nfiles files"
+
+	# small files of several objects are written by the same RPCs
+	$LCTL set_param $osc.max_objs_per_rpc=32
+	$LCTL set_param -n $osc.rpc_stats=0
+	for i in $(seq $nfiles); do
+		cp $TMP/$tfile $DIR/$tdir/f2.$i || error "cp f2.$i failed"
+	done
+	sync
+	rpcs=$(test_42f_write_rpcs $osc)
+	echo "$rpcs write RPCs for $nfiles files"
+	(( rpcs <= nfiles / 2 )) ||
+		error "$rpcs write RPCs for $nfiles files, not batched"
+
+	# each object gets its own attributes back from the batched writes
+	for i in $(seq $nfiles); do
+		(( $(stat -c %b $DIR/$tdir/f2.$i) > 0 )) ||
+			error "f2.$i has no blocks after the write"
+	done
+
+	cancel_lru_locks osc
+	for i in $(seq $nfiles); do
+		cmp $TMP/$tfile $DIR/$tdir/f1.$i || error "f1.$i corrupted"
+		cmp $TMP/$tfile $DIR/$tdir/f2.$i || error "f2.$i corrupted"
+	done
+	rm -rf $DIR/$tdir
+}
+run_test 42f "small writes of several objects in one BRW RPC"
+
 test_43A() { # was test_43
 	test_mkdir $DIR/$tdir
 	cp -p /bin/ls $DIR/$tdir/$tfile
@@ -8383,6 +8498,47 @@ test_77l() {
 }
 run_test 77l "preferred checksum type is remembered after reconnected"
 
+test_77m() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$GSS && skip_env "could not run with gss"
+
+	local param=/sys/module/obdclass/parameters/obd_dif_parallel_pages
+	local algos=$(echo $CKSUM_TYPES | tr ' ' '\n' | grep t10)
+
+	[ -n "$algos" ] || skip "no T10-PI checksum types supported"
+	[ -f $param ] || skip "no parallel T10-PI guard generation"
+
+	local orig=$(cat $param)
+
+	[ ! -f $F77_TMP ] && setup_f77
+	set_checksums 1
+	stack_trap "set_checksums $ORIG_CSUM" EXIT
+	stack_trap "set_checksum_type $ORIG_CSUM_TYPE" EXIT
+	stack_trap "echo $orig > $param" EXIT
+
+	$LFS setstripe -c 1 -i 0 -S 8M $DIR/$tfile
+	for algo in $algos; do
+		set_checksum_type $algo || error "fail to set checksum type $algo"
+
+		# write with the guards generated by worker threads,
+		# read back with the guards generated inline, then reverse
+		echo 1 > $param
+		dd if=$F77_TMP of=$DIR/$tfile bs=4M count=$((F77SZ / 4)) ||
+			error "dd write $algo failed"
+		cancel_lru_locks osc
+		echo 0 > $param
+		cmp $F77_TMP $DIR/$tfile || error "$algo: compare after write failed"
+
+		dd if=$F77_TMP of=$DIR/$tfile bs=4M count=$((F77SZ / 4)) ||
+			error "dd write $algo failed"
+		cancel_lru_locks osc
+		echo 1 > $param
+		cmp $F77_TMP $DIR/$tfile || error "$algo: compare after read failed"
+	done
+	rm -f $DIR/$tfile
+}
+run_test 77m "parallel T10-PI guards match inline ones"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -10149,6 +10305,73 @@ test_116b() { # LU-2093
 }
 run_test 116b "QoS shouldn't LBUG if not enough OSTs found on the 2nd pass"
 
+test_116c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	[[ $OSTCOUNT -lt 2 ]] && skip_env "needs >= 2 OSTs"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local lod=lod.$FSNAME-MDT0000-mdtlov
+	local old_rr=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		       $lod.qos_threshold_rr | head -n1)
+	local old_free=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			 $lod.qos_prio_free | head -n1)
+
+	[ -z "$old_rr" ] && skip "no QOS"
+	declare -a AVAIL
+	free_min_max
+	[ $MINV -eq 0 ] && skip "no free space in OST$MINI, skip"
+	[ $MAXV -gt 10000000 ] && skip "too much free space in OST$MAXI, skip"
+
+	# any imbalance selects QoS, weights are free space only
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param \
+		$lod.qos_threshold_rr=${old_rr%%%} \
+		$lod.qos_prio_free=${old_free%%%}" EXIT
+	do_facet $SINGLEMDS $LCTL set_param $lod.qos_threshold_rr=0 \
+		$lod.qos_prio_free=100
+
+	# use a quarter of the space of the OST with the least free space
+	test_mkdir $DIR/$tdir
+	stack_trap "rm -rf $DIR/$tdir; wait_delete_completed" EXIT
+	$LFS setstripe -i $MINI -c 1 $DIR/$tdir/fill ||
+		error "setstripe $DIR/$tdir/fill failed"
+	dd if=/dev/zero of=$DIR/$tdir/fill bs=1M count=$((MINV / 4096)) ||
+		error "fill OST$MINI failed"
+	sync
+	sleep_maxage
+	free_min_max
+
+	local fullest=$MINI
+	local nfiles=$((OSTCOUNT * 100))
+
+	# objects are drawn from the shared QoS tree, which is rebuilt only
+	# every few allocations when there are less than 8 OSTs
+	test_mkdir $DIR/$tdir/qos
+	$LFS setstripe -c 1 $DIR/$tdir/qos || error "setstripe failed"
+	createmany -o $DIR/$tdir/qos/f- $nfiles ||
+		error "create $nfiles files failed"
+
+	local count
+	local mincnt=$nfiles
+	local maxcnt=0
+	local fullcnt
+	local i
+
+	for ((i = 0; i < OSTCOUNT; i++)); do
+		count=$($LFS find $DIR/$tdir/qos -type f -i $i | wc -l)
+		echo "OST$i: ${AVAIL[i]}KB free, $count objects"
+		((count < mincnt)) && mincnt=$count
+		((count > maxcnt)) && maxcnt=$count
+		((i == fullest)) && fullcnt=$count
+	done
+
+	((mincnt > 0)) || error "some OSTs got no objects"
+	((maxcnt * 4 < nfiles * 3)) ||
+		error "$maxcnt of $nfiles objects on a single OST"
+	((fullcnt < maxcnt)) ||
+		error "OST$fullest with least free space got most objects"
+}
+run_test 116c "stripe QOS: spread objects over unbalanced OSTs"
+
 test_117() # bug 10891
 {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -11035,6 +11258,127 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+test_123c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_getattr ||
+		skip "MDS does not support batched getattr"
+
+	local count=1000
+	local mdtidx
+	local mdt
+	local enq
+	local enq_batch
+	local batch_max=$($LCTL get_param -n llite.*.statahead_batch_max |
+			  head -n 1)
+
+	test_mkdir -i 0 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- $count
+	mdtidx=$($LFS getstripe -m $DIR/$tdir)
+	mdt=MDT$(printf %04x $mdtidx)
+	stack_trap "$LCTL set_param -n llite.*.statahead_batch_max=$batch_max"
+
+	$LCTL set_param -n llite.*.statahead_batch_max=0
+	cancel_lru_locks mdc
+	$LCTL set_param -n mdc.*.stats=clear
+	ls -l $DIR/$tdir > /dev/null || error "ls -l failed"
+	enq=$($LCTL get_param -n mdc.*$mdt*.stats |
+	      awk '/ldlm_ibits_enqueue/ { print $2 }')
+
+	$LCTL set_param -n llite.*.statahead_batch_max=16
+	cancel_lru_locks mdc
+	$LCTL set_param -n mdc.*.stats=clear
+	ls -l $DIR/$tdir > /dev/null || error "ls -l with batch failed"
+	enq_batch=$($LCTL get_param -n mdc.*$mdt*.stats |
+		    awk '/ldlm_ibits_enqueue/ { print $2 }')
+	$LCTL get_param -n llite.*.statahead_stats
+
+	echo "enqueues: $enq unbatched, $enq_batch batched"
+	# statahead may stop early, expect at least a 2x reduction
+	(( enq_batch * 2 < enq )) ||
+		error "too many enqueues $enq_batch, unbatched $enq"
+	[ $(ls -l $DIR/$tdir | grep -c $tfile-) -eq $count ] ||
+		error "ls -l lists wrong number of files"
+}
+run_test 123c "statahead batches getattrs of a directory in one RPC"
+
+test_123d() {
+	local snap_max=$($LCTL get_param -n llite.*.dir_snapshot_max |
+			 head -n 1)
+	local enq
+	local i
+
+	[ -n "$snap_max" ] || skip "client does not support dir snapshots"
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- 100
+	stack_trap "$LCTL set_param -n llite.*.dir_snapshot_max=$snap_max"
+	$LCTL set_param -n llite.*.dir_snapshot_max=4096
+	cancel_lru_locks mdc
+
+	# a few misses make the client take a snapshot of the directory
+	for i in {1..10}; do
+		stat $DIR/$tdir/warm-$i 2> /dev/null &&
+			error "warm-$i should not exist"
+	done
+
+	$LCTL set_param -n mdc.*.stats=clear
+	for i in {1..100}; do
+		stat $DIR/$tdir/missing-$i 2> /dev/null &&
+			error "missing-$i should not exist"
+	done
+	enq=$($LCTL get_param -n mdc.*MDT0000*.stats |
+	      awk '/ldlm_ibits_enqueue/ { print $2 }')
+	echo "enqueues for 100 negative lookups: ${enq:-0}"
+	(( ${enq:-0} < 10 )) || error "too many enqueues $enq"
+
+	# a new name must invalidate the snapshot
+	touch $DIR/$tdir/missing-1 || error "touch missing-1 failed"
+	stat $DIR/$tdir/missing-1 || error "stat missing-1 failed"
+	if [ -n "$DIR2" ] && [ -d "$DIR2/$tdir" ]; then
+		touch $DIR2/$tdir/missing-2 || error "touch missing-2 failed"
+		stat $DIR/$tdir/missing-2 ||
+			error "missing-2 created by another mount not found"
+	fi
+}
+run_test 123d "negative lookups are answered from the directory snapshot"
+
+test_123e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	[ "$mds1_FSTYPE" != "ldiskfs" ] && skip_env "ldiskfs only test"
+
+	local mdt=$(facet_svc mds1)
+	local oi_max=$(do_facet mds1 $LCTL get_param -n osd-*.$mdt.oi_cache_max)
+	local count=5000
+	local hits
+	local misses
+
+	[ -n "$oi_max" ] || skip "MDS does not have an OI cache"
+	(( oi_max >= count )) || skip "OI cache max $oi_max is too small"
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile- $count || error "create failed"
+
+	# drop the cached objects and OI mappings on the MDS
+	cancel_lru_locks mdc
+	do_facet mds1 "sync; echo 2 > /proc/sys/vm/drop_caches"
+	do_facet mds1 $LCTL set_param -n osd-*.$mdt.stats=clear
+
+	# readdir prefetches the OI mappings of each dirent page in one pass
+	ls -l $DIR/$tdir > /dev/null || error "ls -l failed"
+	hits=$(do_facet mds1 $LCTL get_param -n osd-*.$mdt.stats |
+	       awk '/^oi_cache_hit/ { print $2 }')
+	misses=$(do_facet mds1 $LCTL get_param -n osd-*.$mdt.stats |
+		 awk '/^oi_cache_miss/ { print $2 }')
+	echo "OI cache: ${hits:-0} hits, ${misses:-0} misses for $count files"
+	(( ${hits:-0} >= count / 2 )) ||
+		error "only ${hits:-0} OI cache hits for $count files"
+	(( ${misses:-0} < ${hits:-0} )) ||
+		error "${misses:-0} OI cache misses, ${hits:-0} hits"
+	[ $(ls $DIR/$tdir | wc -l) -eq $count ] ||
+		error "ls lists wrong number of files"
+}
+run_test 123e "readdir prefetches the OI mappings of a large directory"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -11472,6 +11816,43 @@ test_127c() { # LU-12394
 }
 run_test 127c "test llite extent stats with regular & mmap i/o"
 
+test_127d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	local param="osc.$FSNAME-OST0000-osc-[^M]*"
+
+	$LCTL list_param $param.stats_hist >/dev/null 2>&1 ||
+		skip "no stats_hist support"
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+	$LCTL set_param $param.stats=0
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd failed"
+
+	# the stats format is unchanged unless histograms are asked for
+	$LCTL get_param $param.stats | grep ost_write
+	$LCTL get_param -n $param.stats | grep "^ost_write" | grep -qw hist &&
+		error "histogram in ost_write stats"
+
+	local old_hist=$($LCTL get_param -n stats_hist)
+
+	stack_trap "$LCTL set_param stats_hist=$old_hist" EXIT
+	$LCTL set_param stats_hist=1
+	$LCTL get_param $param.stats | grep ost_write
+	$LCTL get_param -n $param.stats | grep "^ost_write" | grep -qw hist ||
+		error "no histogram in ost_write stats with stats_hist=1"
+	$LCTL set_param stats_hist=$old_hist
+
+	$LCTL get_param -n $param.stats_hist
+	$LCTL get_param -n $param.stats_hist | grep -A3 "^ost_write:" |
+		grep -q "hist: {" || error "no ost_write in stats_hist"
+
+	$LCTL set_param $param.stats=0
+	$LCTL get_param -n $param.stats_hist | grep -q "^ost_write:" &&
+		error "ost_write histogram not cleared"
+	rm -f $DIR/$tfile
+}
+run_test 127d "verify latency histograms of client RPC stats"
+
 test_128() { # bug 15212
 	touch $DIR/$tfile
 	$LFS 2>&1 <<-EOF | tee $TMP/$tfile.log
@@ -14577,6 +14958,70 @@ test_171() { # bug20592
 }
 run_test 171 "test libcfs_debug_dumplog_thread stuck in do_exit() ======"
 
+test_172() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL list_param debug_defer >/dev/null 2>&1 ||
+		skip "no deferred debug formatting"
+
+	local old_debug=$($LCTL get_param -n debug)
+	local old_defer=$($LCTL get_param -n debug_defer)
+
+	stack_trap "$LCTL set_param debug_defer=$old_defer" EXIT
+	stack_trap "$LCTL set_param debug='$old_debug'" EXIT
+	$LCTL set_param debug=+trace debug_defer=1
+	$LCTL clear
+
+	touch $DIR/$tfile || error "touch failed"
+	stat $DIR/$tfile > /dev/null || error "stat failed"
+
+	# deferred records are formatted when dumped
+	$LCTL dk > $TMP/$tfile.dk
+	stack_trap "rm -f $TMP/$tfile.dk" EXIT
+	grep -q "Process leaving (rc=[0-9]* : -\?[0-9]* : [0-9a-f]*)" \
+		$TMP/$tfile.dk || error "no formatted RETURN messages"
+	grep "Process leaving (rc=%" $TMP/$tfile.dk &&
+		error "unformatted messages in debug log"
+	rm -f $DIR/$tfile
+}
+run_test 172 "debug messages logged with debug_defer are formatted"
+
+test_173() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local stats="mdt.$FSNAME-MDT0000.site_stats"
+	local hit1
+	local hit2
+	local purged1
+	local purged2
+
+	test_mkdir -i 0 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+	stack_trap "unlinkmany $DIR/$tdir/f 1000" EXIT
+
+	# site_stats fields: busy/total populated/buckets max_search created
+	# cache_hit cache_miss cache_race cache_death_race lru_purged
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "first ls failed"
+	hit1=$(do_facet mds1 $LCTL get_param -n $stats | awk '{ print $5 }')
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "second ls failed"
+	hit2=$(do_facet mds1 $LCTL get_param -n $stats | awk '{ print $5 }')
+	echo "cache_hit: $hit1 -> $hit2"
+	(( hit2 >= hit1 + 1000 )) || error "cached objects were not found"
+
+	# shrinker purges the unreferenced objects from the site LRU
+	purged1=$(do_facet mds1 $LCTL get_param -n $stats | awk '{ print $9 }')
+	do_facet mds1 "echo 2 > /proc/sys/vm/drop_caches"
+	purged2=$(do_facet mds1 $LCTL get_param -n $stats | awk '{ print $9 }')
+	echo "lru_purged: $purged1 -> $purged2"
+	(( purged2 > purged1 )) || error "no objects purged from the LRU"
+
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls after purge failed"
+}
+run_test 173 "lu_site cache hits and LRU purge"
+
 # it would be good to share it with obdfilter-survey/iokit-libecho code
 setup_obdecho_osc () {
         local rc=0
@@ -15320,7 +15765,7 @@ jobstats_set() {
 		"$FSNAME.sys.jobid_var" $new_jobenv
 }
 
-test_205() { # Job stats
+test_205a() { # Job stats
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	[[ $MDS1_VERSION -ge $(version_code 2.7.1) ]] ||
 		skip "Need MDS version with at least 2.7.1"
@@ -15422,7 +15867,71 @@ test_205() { # Job stats
 
 	verify_jobstats "touch $DIR/$tfile" $SINGLEMDS
 }
-run_test 205 "Verify job stats"
+run_test 205a "Verify job stats"
+
+# read the job_stats_bin header fields as 32-bit words, after writing the
+# generation $2 to the file if given
+jobstats_bin_hdr() {
+	local bin=$1
+	local gen=$2
+
+	if [ -n "$gen" ]; then
+		do_facet $SINGLEMDS "exec 3<>$bin; echo $gen >&3;
+				     od -A n -t u4 -N 32 <&3; exec 3>&-"
+	else
+		do_facet $SINGLEMDS "od -A n -t u4 -N 32 $bin"
+	fi
+}
+
+test_205b() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep jobstats)" ] &&
+		skip "Server doesn't support jobstats"
+	[[ $JOBID_VAR = disable ]] && skip_env "jobstats is disabled"
+
+	local bin=/proc/fs/lustre/mdt/$(facet_svc $SINGLEMDS)/job_stats_bin
+	local old_jobvar=$($LCTL get_param -n jobid_var)
+	local old_jobname=$($LCTL get_param -n jobid_name)
+	local jobid=id.205b.$RANDOM
+	local hdr
+	local gen
+
+	do_facet $SINGLEMDS "test -f $bin" || skip "no job_stats_bin support"
+
+	stack_trap "$LCTL set_param jobid_var=$old_jobvar \
+		    jobid_name=$old_jobname" EXIT
+	$LCTL set_param jobid_var=nodelocal jobid_name=$jobid
+
+	# magic, version | flags, rec_size, rec_count, cntr_num, pad, gen
+	hdr=($(jobstats_bin_hdr $bin))
+	echo "full snapshot: ${hdr[*]}"
+	[ ${hdr[0]} -eq $((0x10B57A75)) ] || error "bad magic ${hdr[0]}"
+	(( (hdr[1] >> 16) & 1 )) || error "first snapshot is not full"
+	gen=$((hdr[6] + (hdr[7] << 32)))
+
+	mkdir $DIR/$tdir || error "mkdir failed"
+
+	hdr=($(jobstats_bin_hdr $bin $gen))
+	echo "delta from $gen: ${hdr[*]}"
+	[ ${hdr[3]} -ge 1 ] || error "no job updated since generation $gen"
+	do_facet $SINGLEMDS "exec 3<>$bin; echo $gen >&3;
+			     strings <&3 | grep -q $jobid; exec 3>&-" ||
+		error "job $jobid not in delta snapshot"
+
+	# a removed job is reported by the next delta read, not a full one
+	gen=$((hdr[6] + (hdr[7] << 32)))
+	do_facet $SINGLEMDS $LCTL set_param \
+		mdt.$(facet_svc $SINGLEMDS).job_stats=$jobid ||
+		error "remove job $jobid failed"
+	hdr=($(jobstats_bin_hdr $bin $gen))
+	echo "delta from $gen: ${hdr[*]}"
+	(( (hdr[1] >> 16) & 1 )) && error "snapshot after removal is full"
+	do_facet $SINGLEMDS "exec 3<>$bin; echo $gen >&3;
+			     strings <&3 | grep -q $jobid; exec 3>&-" ||
+		error "removed job $jobid not in delta snapshot"
+}
+run_test 205b "Verify binary job stats with delta reads"
 
 # LU-1480, LU-1773 and LU-1657
 test_206() {
@@ -18702,6 +19211,55 @@ test_271g() {
 }
 run_test 271g "Discard DoM data vs client flush race"
 
+test_271h() {
+	local mdc=$($LCTL get_param -N mdc.$FSNAME-MDT0000-mdc-*.import |
+		    sed 's/\.import$//')
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local nfiles=64
+	local rpcs
+	local i
+
+	[[ $($LCTL get_param $mdc.import) =~ connect_flags.*multiobj_brw ]] ||
+		skip "MDT does not support multi-object BRW"
+
+	save_lustre_params client "$mdc.max_objs_per_rpc" > $p
+	stack_trap "restore_lustre_params < $p; rm -f $p" EXIT
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	$LFS setstripe -E 1M -L mdt $DIR/$tdir || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=8k count=1 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile" EXIT
+
+	$LCTL set_param $mdc.max_objs_per_rpc=1
+	$LCTL set_param -n $mdc.rpc_stats=0
+	for i in $(seq $nfiles); do
+		cp $TMP/$tfile $DIR/$tdir/f1.$i || error "cp f1.$i failed"
+	done
+	sync
+	rpcs=$(test_42f_write_rpcs $mdc)
+	(( rpcs == nfiles )) || error "$rpcs write RPCs for $nfiles files"
+
+	$LCTL set_param $mdc.max_objs_per_rpc=32
+	$LCTL set_param -n $mdc.rpc_stats=0
+	for i in $(seq $nfiles); do
+		cp $TMP/$tfile $DIR/$tdir/f2.$i || error "cp f2.$i failed"
+	done
+	sync
+	rpcs=$(test_42f_write_rpcs $mdc)
+	echo "$rpcs write RPCs for $nfiles DoM files"
+	(( rpcs <= nfiles / 2 )) ||
+		error "$rpcs write RPCs for $nfiles DoM files, not batched"
+
+	cancel_lru_locks mdc
+	for i in $(seq $nfiles); do
+		cmp $TMP/$tfile $DIR/$tdir/f1.$i || error "f1.$i corrupted"
+		cmp $TMP/$tfile $DIR/$tdir/f2.$i || error "f2.$i corrupted"
+	done
+	rm -rf $DIR/$tdir
+}
+run_test 271h "DoM: small files written by the same BRW RPCs"
+
 test_272a() {
 	[ $MDS1_VERSION -lt $(version_code 2.11.50) ] &&
 		skip "Need MDS version at least 2.11.50"
@@ -21391,6 +21949,75 @@ test_422() {
 }
 run_test 422 "kill a process with RPC in progress"
 
+test_423() {
+	local svc="mds.MDS.mdt"
+	local param="$svc.threads_rebalance"
+	local old=$(do_facet mds1 $LCTL get_param -n $param)
+	local limits
+	local ncpts
+	local old_min
+	local old_max
+	local max
+	local started
+	local sum
+	local high
+	local pids
+	local i
+
+	[ -n "$old" ] || skip "no threads_rebalance on MDS"
+
+	limits=($(do_facet mds1 $LCTL get_param -n $svc.threads_cpt_limits))
+	ncpts=${#limits[@]}
+	(( ncpts > 1 )) || skip "MDS has a single CPT"
+
+	old_min=$(do_facet mds1 $LCTL get_param -n $svc.threads_min)
+	old_max=$(do_facet mds1 $LCTL get_param -n $svc.threads_max)
+	stack_trap "do_facet mds1 $LCTL set_param $svc.threads_max=$old_max \
+		    $svc.threads_min=$old_min $param=$old" EXIT
+
+	# few threads per CPT, so that the CPT this client's requests land
+	# on runs out of threads
+	max=$((ncpts * 4))
+	do_facet mds1 $LCTL set_param $svc.threads_min=$((ncpts * 2)) \
+		$svc.threads_max=$max || error "set threads_min/max failed"
+	do_facet mds1 $LCTL set_param $param=1 ||
+		error "set $param=1 failed"
+
+	test_mkdir $DIR/$tdir
+	# create and unlink files for 10s
+	for i in $(seq 8); do
+		createmany -o -u -t 10 $DIR/$tdir/f-$i- 10000000 > /dev/null &
+		pids="$pids $!"
+	done
+	sleep 6
+	limits=($(do_facet mds1 $LCTL get_param -n $svc.threads_cpt_limits))
+	started=$(do_facet mds1 $LCTL get_param -n $svc.threads_started)
+	wait $pids || error "create/unlink files failed"
+	echo "threads_cpt_limits: ${limits[*]}, threads_started: $started"
+
+	sum=0
+	high=0
+	for i in ${limits[*]}; do
+		sum=$((sum + i))
+		(( i > high )) && high=$i
+	done
+	(( sum == max )) || error "CPT limits ${limits[*]} don't add to $max"
+	(( high > max / ncpts )) ||
+		error "no CPT got more threads: ${limits[*]}"
+	(( started <= max )) ||
+		error "threads_started $started > threads_max $max"
+
+	# disabling it gives each partition its even share of threads back
+	do_facet mds1 $LCTL set_param $param=0 ||
+		error "set $param=0 failed"
+	limits=($(do_facet mds1 $LCTL get_param -n $svc.threads_cpt_limits))
+	for i in ${limits[*]}; do
+		(( i == max / ncpts )) ||
+			error "CPT limits ${limits[*]} not reset"
+	done
+}
+run_test 423 "service threads move to the busy CPT within threads_max"
+
 prep_801() {
 	[[ $(lustre_version_code mds1) -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
@@ -896,6 +896,47 @@ test_32b() { # bug 11270
 }
 run_test 32b "lockless i/o"
 
+test_32c() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	$LCTL list_param $OSC.*.max_nolock_bytes >/dev/null 2>&1 ||
+		skip "client does not support max_nolock_bytes"
+
+	local facets=$(get_facets OST)
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+
+	save_lustre_params client "$OSC.*.max_nolock_bytes" > $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.max_nolock_bytes" >> $p
+	stack_trap "restore_lustre_params < $p; rm -f $p" EXIT
+	lctl set_param -n $OSC.*.max_nolock_bytes=32768
+	do_nodes $(comma_list $(osts_nodes)) \
+		"lctl set_param -n ldlm.namespaces.filter-*.max_nolock_bytes=32768"
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	clear_stats $OSC.*.${OSC}_stats
+
+	# small records written to disjoint areas of the file from two
+	# mounts ping-pong the extent locks, which is detected as contention
+	for i in {1..100}; do
+		dd if=/dev/zero of=$DIR1/$tfile bs=4k count=1 seek=$((i * 2)) \
+			conv=notrunc > /dev/null 2>&1
+		dd if=/dev/zero of=$DIR2/$tfile bs=4k count=1 \
+			seek=$((i * 2 + 1)) conv=notrunc > /dev/null 2>&1
+	done
+	[ $(calc_stats $OSC.*.${OSC}_stats lockless_write_bytes) -ne 0 ] ||
+		error "small writes to contended file were not lockless"
+
+	# large writes still take client locks
+	clear_stats $OSC.*.${OSC}_stats
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=1 conv=notrunc ||
+		error "1MB write failed"
+	[ $(calc_stats $OSC.*.${OSC}_stats lockless_write_bytes) -eq 0 ] ||
+		error "large write to contended file was lockless"
+	$CHECKSTAT -s 1048576 $DIR2/$tfile || error "wrong file size"
+	rm -f $DIR1/$tfile
+}
+run_test 32c "lockless small writes to contended file"
+
 print_jbd_stat () {
     local dev
     local mdts=$(get_facets MDS)
@@ -611,6 +611,12 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_LSOM);
 	CHECK_DEFINE_64X(OBD_CONNECT2_PCC);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ASYNC_DISCARD);
+	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_FIDMAP);
+	CHECK_DEFINE_64X(OBD_CONNECT2_GETATTR_PFID);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MULTIOBJ_BRW);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_DESTROY);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_GETATTR);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -1536,6 +1542,27 @@ check_ldlm_reply(void)
 	CHECK_MEMBER(ldlm_reply, lock_policy_res2);
 }
 
+static void
+check_mdt_batch_getattr(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_getattr);
+	CHECK_MEMBER(mdt_batch_getattr, mbg_handle);
+	CHECK_MEMBER(mdt_batch_getattr, mbg_name_off);
+	CHECK_MEMBER(mdt_batch_getattr, mbg_namelen);
+}
+
+static void
+check_mdt_batch_getattr_rep(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_getattr_rep);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_dlm);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_body);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_md_off);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_padding);
+}
+
 static void
 check_ldlm_ost_lvb_v1(void)
 {
@@ -2886,6 +2913,8 @@ main(int argc, char **argv)
 	check_ldlm_lock_desc();
 	check_ldlm_request();
 	check_ldlm_reply();
+	check_mdt_batch_getattr();
+	check_mdt_batch_getattr_rep();
 	check_ldlm_ost_lvb_v1();
 	check_ldlm_ost_lvb();
 	check_ldlm_lquota_lvb();
@@ -1374,6 +1374,18 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_PCC);
 	LASSERTF(OBD_CONNECT2_ASYNC_DISCARD == 0x4000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_ASYNC_DISCARD);
+	LASSERTF(OBD_CONNECT2_ENCRYPT == 0x8000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_ENCRYPT);
+	LASSERTF(OBD_CONNECT2_FIDMAP == 0x10000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_FIDMAP);
+	LASSERTF(OBD_CONNECT2_GETATTR_PFID == 0x20000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_GETATTR_PFID);
+	LASSERTF(OBD_CONNECT2_MULTIOBJ_BRW == 0x1000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MULTIOBJ_BRW);
+	LASSERTF(OBD_CONNECT2_BATCH_DESTROY == 0x2000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_DESTROY);
+	LASSERTF(OBD_CONNECT2_BATCH_GETATTR == 0x4000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_GETATTR);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -3615,6 +3627,42 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ldlm_reply *)0)->lock_policy_res2) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct ldlm_reply *)0)->lock_policy_res2));
 
+	/* Checks for struct mdt_batch_getattr */
+	LASSERTF((int)sizeof(struct mdt_batch_getattr) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_getattr));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr, mbg_handle) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr, mbg_handle));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr *)0)->mbg_handle) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr *)0)->mbg_handle));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr, mbg_name_off) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr, mbg_name_off));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr *)0)->mbg_name_off) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr *)0)->mbg_name_off));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr, mbg_namelen) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr, mbg_namelen));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr *)0)->mbg_namelen) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr *)0)->mbg_namelen));
+
+	/* Checks for struct mdt_batch_getattr_rep */
+	LASSERTF((int)sizeof(struct mdt_batch_getattr_rep) == 336, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_getattr_rep));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_dlm) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_dlm));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_dlm) == 112, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_dlm));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_body) == 112, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_body));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_body) == 216, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_body));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_md_off) == 328, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_md_off));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_md_off) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_md_off));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_padding) == 332, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_padding));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_padding));
+
 	/* Checks for struct ost_lvb_v1 */
 	LASSERTF((int)sizeof(struct ost_lvb_v1) == 40, "found %lld\n",
 		 (long long)(int)sizeof(struct ost_lvb_v1));